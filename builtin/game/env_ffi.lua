@@ -0,0 +1,128 @@
+-- Minetest: builtin/game/env_ffi.lua
+
+--
+-- LuaJIT FFI fast path for the hottest environment calls.
+-- The engine only hands out the FFI entry points when built with LuaJIT,
+-- otherwise the regular API functions stay in place.
+--
+
+local api = core.ffi_env_api
+core.ffi_env_api = nil -- Not for mods
+if not api then
+	return
+end
+
+local ffi = api.ffi
+local script = api.script
+
+-- Must match struct FfiNode in src/script/lua_api/l_env.cpp
+ffi.cdef[[
+typedef struct { uint16_t content; uint8_t param1; uint8_t param2; } mt_ffi_node;
+]]
+
+local ffi_get_node = ffi.cast(
+	"int (*)(void *, double, double, double, mt_ffi_node *)",
+	api.get_node)
+local ffi_set_node = ffi.cast(
+	"int (*)(void *, double, double, double, const mt_ffi_node *)",
+	api.set_node)
+local ffi_get_objects_inside_radius = ffi.cast(
+	"int (*)(void *, double, double, double, double, uint16_t *, int)",
+	api.get_objects_inside_radius)
+
+local node_buf = ffi.new("mt_ffi_node")
+local ids_buf = ffi.new("uint16_t[?]", 256)
+
+-- A negative result means the call has to go through the regular API
+local FALLBACK = -1
+
+local classic_get_node = core.get_node
+local classic_set_node = core.set_node
+local classic_get_objects_inside_radius = core.get_objects_inside_radius
+local get_content_id = core.get_content_id
+local get_name_from_content_id = core.get_name_from_content_id
+local object_refs = core.object_refs
+
+-- Content ids do not change once the environment exists, which is the
+-- only time these caches are filled
+local node_names = {}
+local content_ids = {}
+
+local function is_pos(pos)
+	return type(pos) == "table" and type(pos.x) == "number" and
+		type(pos.y) == "number" and type(pos.z) == "number"
+end
+
+function core.get_node(pos)
+	if not is_pos(pos) or
+			ffi_get_node(script, pos.x, pos.y, pos.z, node_buf) == FALLBACK then
+		return classic_get_node(pos)
+	end
+
+	local content = node_buf.content
+	local name = node_names[content]
+	if not name then
+		name = get_name_from_content_id(content)
+		node_names[content] = name
+	end
+	return {name = name, param1 = node_buf.param1, param2 = node_buf.param2}
+end
+
+function core.set_node(pos, node)
+	if not is_pos(pos) or type(node) ~= "table" then
+		return classic_set_node(pos, node)
+	end
+
+	local name = node.name
+	local content = content_ids[name]
+	if not content then
+		-- Unknown names and aliases are resolved (or rejected) by the engine
+		local ok, id = pcall(get_content_id, name)
+		if not ok or type(name) ~= "string" then
+			return classic_set_node(pos, node)
+		end
+		content = id
+	end
+
+	node_buf.content = content
+	node_buf.param1 = tonumber(node.param1) or 0
+	node_buf.param2 = tonumber(node.param2) or 0
+	local result = ffi_set_node(script, pos.x, pos.y, pos.z, node_buf)
+	if result == FALLBACK then
+		return classic_set_node(pos, node)
+	end
+	content_ids[name] = content
+	return result == 1
+end
+
+core.add_node = core.set_node
+
+function core.get_objects_inside_radius(pos, radius)
+	if not is_pos(pos) or type(radius) ~= "number" then
+		return classic_get_objects_inside_radius(pos, radius)
+	end
+
+	local max_ids = ffi.sizeof(ids_buf) / 2
+	local count = ffi_get_objects_inside_radius(script,
+		pos.x, pos.y, pos.z, radius, ids_buf, max_ids)
+	if count == FALLBACK then
+		return classic_get_objects_inside_radius(pos, radius)
+	elseif count > max_ids then
+		-- Grow the buffer and ask again
+		ids_buf = ffi.new("uint16_t[?]", count * 2)
+		max_ids = count * 2
+		count = math.min(max_ids, ffi_get_objects_inside_radius(script,
+			pos.x, pos.y, pos.z, radius, ids_buf, max_ids))
+	end
+
+	local objects = {}
+	local n = 0
+	for i = 0, count - 1 do
+		local obj = object_refs[ids_buf[i]]
+		if obj then
+			n = n + 1
+			objects[n] = obj
+		end
+	end
+	return objects
+end
@@ -21,6 +21,7 @@ dofile(commonpath .. "after.lua")
 dofile(gamepath .. "item_entity.lua")
 dofile(gamepath .. "deprecated.lua")
 dofile(gamepath .. "misc.lua")
+dofile(gamepath .. "env_ffi.lua")
 dofile(gamepath .. "privileges.lua")
 dofile(gamepath .. "auth.lua")
 dofile(commonpath .. "chatcommands.lua")
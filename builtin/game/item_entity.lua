@@ -38,6 +38,8 @@ core.register_entity(":__builtin:item", {
 	physical_state = true,
 	-- Item expiry
 	age = 0,
+	-- Game time when the item fell asleep
+	sleep_start = nil,
 	-- Pushing item out of solid nodes
 	force_out = nil,
 	force_out_start = nil,
@@ -79,7 +81,7 @@ core.register_entity(":__builtin:item", {
 	get_staticdata = function(self)
 		return core.serialize({
 			itemstring = self.itemstring,
-			age = self.age,
+			age = self.age + self:get_sleep_time(),
 			dropped_by = self.dropped_by
 		})
 	end,
@@ -139,6 +141,24 @@ core.register_entity(":__builtin:item", {
 		return true
 	end,
 
+	get_sleep_time = function(self)
+		if not self.sleep_start then
+			return 0
+		end
+		return core.get_gametime() - self.sleep_start
+	end,
+
+	-- A settled item does nothing until a node next to it changes or it
+	-- expires, so it stops being stepped until then
+	sleep = function(self)
+		local duration
+		if time_to_live > 0 then
+			duration = math.max(time_to_live - self.age, 1)
+		end
+		self.sleep_start = core.get_gametime()
+		self.object:sleep(duration)
+	end,
+
 	enable_physics = function(self)
 		if not self.physical_state then
 			self.physical_state = true
@@ -158,7 +178,9 @@ core.register_entity(":__builtin:item", {
 	end,
 
 	on_step = function(self, dtime)
-		self.age = self.age + dtime
+		-- dtime does not include the time spent sleeping
+		self.age = self.age + dtime + self:get_sleep_time()
+		self.sleep_start = nil
 		if time_to_live > 0 and self.age > time_to_live then
 			self.itemstring = ""
 			self.object:remove()
@@ -271,6 +293,9 @@ core.register_entity(":__builtin:item", {
 		if self.moving_state == is_moving and
 				self.slippery_state == is_slippery then
 			-- Do not update anything until the moving state changes
+			if not is_moving then
+				self:sleep()
+			end
 			return
 		end
 
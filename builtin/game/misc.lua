@@ -212,6 +212,58 @@ function core.is_area_protected(minp, maxp, player_name, interval)
 end
 
 
+-- Iterates over the nodes matching 'nodenames' one mapblock at a time, so
+-- that large areas do not need to be returned as one huge table.
+-- Yields the position and the node name of each match.
+
+function core.find_nodes_in_area_iter(pos1, pos2, nodenames)
+	local minp, maxp = vector.sort(vector.round(pos1), vector.round(pos2))
+	local bmin = vector.floor(vector.divide(minp, 16))
+	local bmax = vector.floor(vector.divide(maxp, 16))
+
+	-- Current mapblock, advanced before the first lookup
+	local bx, by, bz = bmin.x, bmin.y, bmin.z - 1
+	local grouped, name, list, i = {}, nil, nil, 0
+
+	return function()
+		while true do
+			if list and i < #list then
+				i = i + 1
+				return list[i], name
+			end
+			name, list = next(grouped, name)
+			i = 0
+			if not name then
+				-- Done with this mapblock, move on to the next one
+				bz = bz + 1
+				if bz > bmax.z then
+					bz = bmin.z
+					by = by + 1
+				end
+				if by > bmax.y then
+					by = bmin.y
+					bx = bx + 1
+				end
+				if bx > bmax.x then
+					return nil
+				end
+				local p1 = {
+					x = math.max(bx * 16, minp.x),
+					y = math.max(by * 16, minp.y),
+					z = math.max(bz * 16, minp.z),
+				}
+				local p2 = {
+					x = math.min(bx * 16 + 15, maxp.x),
+					y = math.min(by * 16 + 15, maxp.y),
+					z = math.min(bz * 16 + 15, maxp.z),
+				}
+				grouped = core.find_nodes_in_area(p1, p2, nodenames, true)
+			end
+		end
+	end
+end
+
+
 local raillike_ids = {}
 local raillike_cur_id = 0
 function core.raillike_group(name)
@@ -778,6 +778,53 @@ minetest.register_chatcommand("bench_bulk_set_node", {
 	end,
 })
 
+minetest.register_chatcommand("bench_env_api", {
+	params = "",
+	description = "Calls per second of get_node, set_node and get_objects_inside_radius (bench)",
+	func = function(name, param)
+		local player = minetest.get_player_by_name(name)
+		if not player then
+			return
+		end
+		local ppos = vector.round(player:get_pos())
+		local pos_list = {}
+		for x=2,21 do
+			for y=2,21 do
+				for z=2,21 do
+					pos_list[#pos_list + 1] = vector.add(ppos, {x=x, y=y, z=z})
+				end
+			end
+		end
+
+		-- warm up with default:stone to prevent having different callbacks
+		-- due to different node topology
+		minetest.bulk_set_node(pos_list, {name = "default:stone"})
+
+		local function bench(label, func)
+			local calls = 0
+			local start_time = os.clock()
+			repeat
+				for i=1,#pos_list do
+					func(pos_list[i])
+				end
+				calls = calls + #pos_list
+			until os.clock() - start_time > 0.5
+			return string.format("%s[%.0f calls/s]", label,
+				calls / (os.clock() - start_time))
+		end
+
+		minetest.chat_send_player(name, "Bench results: " .. table.concat({
+			bench("get_node", minetest.get_node),
+			bench("set_node", function(pos)
+				minetest.set_node(pos, {name = "default:stone"})
+			end),
+			bench("get_objects_inside_radius", function(pos)
+				minetest.get_objects_inside_radius(pos, 8)
+			end),
+		}, ", ") .. (jit and " (LuaJIT)" or ""))
+	end,
+})
+
 local formspec_test_active = false
 
 minetest.register_on_player_receive_fields(function(player, formname, fields)
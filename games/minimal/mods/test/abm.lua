@@ -0,0 +1,62 @@
+--
+-- Minimal Development Test
+-- Mod: test
+--
+
+--
+-- find_nodes_in_area after an ABM changed the block
+--
+-- The ABM handler caches the content types of the blocks it scans and
+-- find_nodes_in_area skips blocks by that cache, so a node placed by an ABM
+-- must still be found afterwards.
+--
+minetest.register_node("test:abm_source", {
+	tiles = { "air.png" }
+})
+minetest.register_node("test:abm_product", {
+	tiles = { "air.png" }
+})
+
+minetest.register_abm({
+	label = "find_nodes_in_area test",
+	nodenames = {"test:abm_source"},
+	interval = 1,
+	chance = 1,
+	action = function(pos)
+		local above = {x = pos.x, y = pos.y + 1, z = pos.z}
+		if minetest.get_node(above).name ~= "test:abm_product" then
+			minetest.set_node(above, {name = "test:abm_product"})
+		end
+	end,
+})
+
+local function run_abm_find_nodes_test(player)
+	-- Lowest node of the player's mapblock, the product lands in the same block
+	local pos = vector.round(player:get_pos())
+	pos.y = math.floor(pos.y / 16) * 16
+	local above = {x = pos.x, y = pos.y + 1, z = pos.z}
+	minetest.set_node(pos, {name = "test:abm_source"})
+	minetest.set_node(above, {name = "air"})
+
+	-- Several ABM runs, the later ones use the content cache of the block
+	minetest.after(4, function()
+		assert(minetest.get_node(above).name == "test:abm_product")
+		local found = minetest.find_nodes_in_area(pos, above, {"test:abm_product"})
+		assert(#found == 1)
+		assert(vector.equals(found[1], above))
+
+		minetest.remove_node(pos)
+		minetest.remove_node(above)
+		minetest.chat_send_all("ABM find_nodes_in_area test passed")
+	end)
+end
+minetest.register_on_joinplayer(function(player)
+	local name = player:get_player_name()
+	-- Wait until the blocks around the player are loaded
+	minetest.after(2, function()
+		player = minetest.get_player_by_name(name)
+		if player then
+			run_abm_find_nodes_test(player)
+		end
+	end)
+end)
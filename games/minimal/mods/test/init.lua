@@ -13,3 +13,5 @@ local modpath = minetest.get_modpath("test")
 dofile(modpath .. "/player.lua")
 dofile(modpath .. "/formspec.lua")
 dofile(modpath .. "/crafting.lua")
+dofile(modpath .. "/abm.lua")
+dofile(modpath .. "/item_entity.lua")
@@ -0,0 +1,46 @@
+--
+-- Minimal Development Test
+-- Mod: test
+--
+
+--
+-- Dropped items sleep once settled
+--
+-- A settled item is not stepped until a node next to it changes, so it must
+-- fall asleep on the ground and wake up when the ground goes away.
+--
+local function run_item_sleep_test(player)
+	local floor = vector.round(player:get_pos())
+	floor.x = floor.x + 2
+	local above = {x = floor.x, y = floor.y + 1, z = floor.z}
+	local old_floor = minetest.get_node(floor)
+	local old_above = minetest.get_node(above)
+	minetest.set_node(floor, {name = "default:stone"})
+	minetest.set_node(above, {name = "air"})
+
+	local obj = minetest.add_item(above, "default:stone")
+	assert(obj)
+	minetest.after(5, function()
+		assert(obj:get_pos())
+		assert(obj:is_sleeping())
+
+		-- Removing the node below wakes the item up
+		minetest.set_node(floor, {name = "air"})
+		assert(not obj:is_sleeping())
+
+		obj:remove()
+		minetest.set_node(floor, old_floor)
+		minetest.set_node(above, old_above)
+		minetest.chat_send_all("Item entity sleep test passed")
+	end)
+end
+minetest.register_on_joinplayer(function(player)
+	local name = player:get_player_name()
+	-- Wait until the blocks around the player are loaded
+	minetest.after(2, function()
+		player = minetest.get_player_by_name(name)
+		if player then
+			run_item_sleep_test(player)
+		end
+	end)
+end)
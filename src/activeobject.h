@@ -53,6 +53,9 @@ struct ActiveObjectMessage
 	u16 id;
 	bool reliable;
 	std::string datastring;
+	// Replaces datastring for clients that are too old to understand it
+	std::string legacy_datastring;
+	u16 min_protocol_version = 0;
 };
 
 /*
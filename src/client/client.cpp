@@ -29,11 +29,13 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "threading/mutex_auto_lock.h"
 #include "client/clientevent.h"
 #include "client/gameui.h"
+#include "client/mediadecodepool.h"
 #include "client/renderingengine.h"
 #include "client/sound.h"
 #include "client/tile.h"
 #include "util/auth.h"
 #include "util/directiontables.h"
+#include "util/numeric.h"
 #include "util/pointedthing.h"
 #include "util/serialize.h"
 #include "util/string.h"
@@ -84,7 +86,7 @@ Client::Client(
 	m_nodedef(nodedef),
 	m_sound(sound),
 	m_event(event),
-	m_mesh_update_thread(this),
+	m_mesh_update_manager(this),
 	m_env(
 		new ClientMap(this, control, 666),
 		tsrc, this
@@ -257,7 +259,7 @@ void Client::Stop()
 	if (m_mods_loaded)
 		m_script->on_shutdown();
 	//request all client managed threads to stop
-	m_mesh_update_thread.stop();
+	m_mesh_update_manager.stop();
 	// Save local server map
 	if (m_localdb) {
 		infostream << "Local map saving ended." << std::endl;
@@ -270,7 +272,7 @@ void Client::Stop()
 
 bool Client::isShutdown()
 {
-	return m_shutdown || !m_mesh_update_thread.isRunning();
+	return m_shutdown || !m_mesh_update_manager.isRunning();
 }
 
 Client::~Client()
@@ -280,10 +282,10 @@ Client::~Client()
 
 	deleteAuthData();
 
-	m_mesh_update_thread.stop();
-	m_mesh_update_thread.wait();
-	while (!m_mesh_update_thread.m_queue_out.empty()) {
-		MeshUpdateResult r = m_mesh_update_thread.m_queue_out.pop_frontNoEx();
+	m_mesh_update_manager.stop();
+	m_mesh_update_manager.wait();
+	while (!m_mesh_update_manager.m_queue_out.empty()) {
+		MeshUpdateResult r = m_mesh_update_manager.m_queue_out.pop_frontNoEx();
 		delete r.mesh;
 	}
 
@@ -490,20 +492,38 @@ void Client::step(float dtime)
 	*/
 	{
 		int num_processed_meshes = 0;
+		int num_reused_meshes = 0;
 		std::vector<v3s16> blocks_to_ack;
-		while (!m_mesh_update_thread.m_queue_out.empty())
+		while (!m_mesh_update_manager.m_queue_out.empty())
 		{
 			num_processed_meshes++;
 
 			MinimapMapblock *minimap_mapblock = NULL;
 			bool do_mapper_update = true;
 
-			MeshUpdateResult r = m_mesh_update_thread.m_queue_out.pop_frontNoEx();
+			MeshUpdateResult r = m_mesh_update_manager.m_queue_out.pop_frontNoEx();
+			if (r.lod > 1) {
+				m_env.getClientMap().onLodMeshUpdated(r);
+				continue;
+			}
+
 			MapBlock *block = m_env.getMap().getBlockNoCreateNoEx(r.p);
-			if (block) {
+			if (r.unchanged) {
+				do_mapper_update = false;
+				if (block && block->mesh_data_hash != r.data_hash) {
+					// Another mesh replaced the one the data was compared
+					// with, or the block was replaced
+					addUpdateMeshTask(r.p, false, false);
+				} else {
+					num_reused_meshes++;
+				}
+			} else if (block) {
+				m_env.getClientMap().onBlockMeshChanged(r.p);
+
 				// Delete the old mesh
 				delete block->mesh;
 				block->mesh = nullptr;
+				block->mesh_data_hash = r.data_hash;
 
 				if (r.mesh) {
 					minimap_mapblock = r.mesh->moveMinimapMapblock();
@@ -542,8 +562,12 @@ void Client::step(float dtime)
 				sendGotBlocks(blocks_to_ack);
 		}
 
-		if (num_processed_meshes > 0)
+		if (num_processed_meshes > 0) {
 			g_profiler->graphAdd("num_processed_meshes", num_processed_meshes);
+			g_profiler->graphAdd("num_reused_meshes", num_reused_meshes);
+			g_profiler->avg("Client: Reused meshes [%]",
+					100.0f * num_reused_meshes / num_processed_meshes);
+		}
 	}
 
 	/*
@@ -639,23 +663,45 @@ void Client::step(float dtime)
 	}
 }
 
-bool Client::loadMedia(const std::string &data, const std::string &filename)
-{
-	// Silly irrlicht's const-incorrectness
-	Buffer<char> data_rw(data.c_str(), data.size());
+static const char *media_image_ext[] = {
+	".png", ".jpg", ".bmp", ".tga",
+	".pcx", ".ppm", ".psd", ".wal", ".rgb",
+	NULL
+};
 
-	std::string name;
+static const char *media_sound_ext[] = {
+	".0.ogg", ".1.ogg", ".2.ogg", ".3.ogg", ".4.ogg",
+	".5.ogg", ".6.ogg", ".7.ogg", ".8.ogg", ".9.ogg",
+	".ogg", NULL
+};
 
-	const char *image_ext[] = {
-		".png", ".jpg", ".bmp", ".tga",
-		".pcx", ".ppm", ".psd", ".wal", ".rgb",
-		NULL
-	};
-	name = removeStringEnd(filename, image_ext);
-	if (!name.empty()) {
-		verbosestream<<"Client: Attempting to load image "
+static const char *media_model_ext[] = {
+	".x", ".b3d", ".md2", ".obj",
+	NULL
+};
+
+static const char *media_translate_ext[] = {
+	".tr", NULL
+};
+
+bool Client::decodeMedia(const std::string &data, const std::string &filename,
+		DecodedMedia &decoded)
+{
+	if (!removeStringEnd(filename, media_image_ext).empty()) {
+		verbosestream<<"Client: Attempting to decode image "
 		<<"file \""<<filename<<"\""<<std::endl;
 
+		// Silly irrlicht's const-incorrectness
+		Buffer<char> data_rw(data.c_str(), data.size());
+
+		// Only the PNG loader of Irrlicht keeps no shared state, the JPEG
+		// one e.g. stores the file name in a static. Any other format is
+		// decoded by one thread at a time.
+		static std::mutex image_loader_mutex;
+		MutexAutoLock image_loader_lock(image_loader_mutex, std::defer_lock);
+		if (data.compare(0, 8, "\x89PNG\r\n\x1a\n") != 0)
+			image_loader_lock.lock();
+
 		io::IFileSystem *irrfs = RenderingEngine::get_filesystem();
 		video::IVideoDriver *vdrv = RenderingEngine::get_video_driver();
 
@@ -666,39 +712,57 @@ bool Client::loadMedia(const std::string &data, const std::string &filename)
 		FATAL_ERROR_IF(!rfile, "Could not create irrlicht memory file.");
 
 		// Read image
-		video::IImage *img = vdrv->createImageFromFile(rfile);
-		if (!img) {
+		decoded.image = vdrv->createImageFromFile(rfile);
+		rfile->drop();
+		if (!decoded.image) {
 			errorstream<<"Client: Cannot create image from data of "
 					<<"file \""<<filename<<"\""<<std::endl;
-			rfile->drop();
 			return false;
 		}
+		return true;
+	}
 
-		m_tsrc->insertSourceImage(filename, img);
-		img->drop();
-		rfile->drop();
+	if (!removeStringEnd(filename, media_sound_ext).empty())
+		return m_sound->decodeSoundData(data, filename, decoded.sound);
+
+	if (!removeStringEnd(filename, media_model_ext).empty() ||
+			!removeStringEnd(filename, media_translate_ext).empty())
+		return true;
+
+	errorstream << "Client: Don't know how to load file \""
+		<< filename << "\"" << std::endl;
+	return false;
+}
+
+bool Client::loadMedia(const std::string &data, const std::string &filename,
+		DecodedMedia &decoded)
+{
+	std::string name;
+
+	name = removeStringEnd(filename, media_image_ext);
+	if (!name.empty()) {
+		verbosestream<<"Client: Attempting to load image "
+		<<"file \""<<filename<<"\""<<std::endl;
+
+		if (!decoded.image)
+			return false;
+
+		// Cached textures made from the image are checked against the
+		// file data, 0 is reserved for images made in memory
+		u64 file_hash = murmur_hash_64_ua(data.data(), (int)data.size(), 0x1337);
+		m_tsrc->insertSourceImage(filename, decoded.image, file_hash ? file_hash : 1);
 		return true;
 	}
 
-	const char *sound_ext[] = {
-		".0.ogg", ".1.ogg", ".2.ogg", ".3.ogg", ".4.ogg",
-		".5.ogg", ".6.ogg", ".7.ogg", ".8.ogg", ".9.ogg",
-		".ogg", NULL
-	};
-	name = removeStringEnd(filename, sound_ext);
+	name = removeStringEnd(filename, media_sound_ext);
 	if (!name.empty()) {
 		verbosestream<<"Client: Attempting to load sound "
 		<<"file \""<<filename<<"\""<<std::endl;
-		m_sound->loadSoundData(name, data);
+		m_sound->loadDecodedSound(name, decoded.sound);
 		return true;
 	}
 
-	const char *model_ext[] = {
-		".x", ".b3d", ".md2", ".obj",
-		NULL
-	};
-
-	name = removeStringEnd(filename, model_ext);
+	name = removeStringEnd(filename, media_model_ext);
 	if (!name.empty()) {
 		verbosestream<<"Client: Storing model into memory: "
 				<<"\""<<filename<<"\""<<std::endl;
@@ -709,10 +773,7 @@ bool Client::loadMedia(const std::string &data, const std::string &filename)
 		return true;
 	}
 
-	const char *translate_ext[] = {
-		".tr", NULL
-	};
-	name = removeStringEnd(filename, translate_ext);
+	name = removeStringEnd(filename, media_translate_ext);
 	if (!name.empty()) {
 		verbosestream << "Client: Loading translation: "
 				<< "\"" << filename << "\"" << std::endl;
@@ -1566,7 +1627,12 @@ void Client::addUpdateMeshTask(v3s16 p, bool ack_to_server, bool urgent)
 	if (b == NULL)
 		return;
 
-	m_mesh_update_thread.updateBlock(&m_env.getMap(), p, ack_to_server, urgent);
+	m_mesh_update_manager.updateBlock(&m_env.getMap(), p, ack_to_server, urgent);
+}
+
+void Client::addUpdateLodMeshTask(v3s16 p, u16 lod)
+{
+	m_mesh_update_manager.updateBlock(&m_env.getMap(), p, false, false, lod);
 }
 
 void Client::addUpdateMeshTaskWithEdge(v3s16 blockpos, bool ack_to_server, bool urgent)
@@ -1740,8 +1806,8 @@ void Client::afterContentReceived()
 	delete[] tu_args.text_base;
 
 	// Start mesh update thread after setting up content definitions
-	infostream<<"- Starting mesh update thread"<<std::endl;
-	m_mesh_update_thread.start();
+	infostream<<"- Starting mesh update threads"<<std::endl;
+	m_mesh_update_manager.start();
 
 	m_state = LC_Ready;
 	sendReady();
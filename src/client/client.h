@@ -52,6 +52,7 @@ class ISoundManager;
 class NodeDefManager;
 //class IWritableCraftDefManager;
 class ClientMediaDownloader;
+struct DecodedMedia;
 struct MapDrawControl;
 class ModChannelMgr;
 class MtEventManager;
@@ -309,12 +310,15 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	u64 getMapSeed(){ return m_map_seed; }
 
 	void addUpdateMeshTask(v3s16 blockpos, bool ack_to_server=false, bool urgent=false);
+	// Queues the far mesh of the group of lod * lod * lod blocks starting
+	// at p, see MeshMakeData::m_lod
+	void addUpdateLodMeshTask(v3s16 p, u16 lod);
 	// Including blocks at appropriate edges
 	void addUpdateMeshTaskWithEdge(v3s16 blockpos, bool ack_to_server=false, bool urgent=false);
 	void addUpdateMeshTaskForNode(v3s16 nodepos, bool ack_to_server=false, bool urgent=false);
 
 	void updateCameraOffset(v3s16 camera_offset)
-	{ m_mesh_update_thread.m_camera_offset = camera_offset; }
+	{ m_mesh_update_manager.m_camera_offset = camera_offset; }
 
 	bool hasClientEvents() const { return !m_client_event_queue.empty(); }
 	// Get event from queue. If queue is empty, it triggers an assertion failure.
@@ -385,8 +389,13 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void unregisterModStorage(const std::string &name) override;
 
 	// The following set of functions is used by ClientMediaDownloader
-	// Insert a media file appropriately into the appropriate manager
-	bool loadMedia(const std::string &data, const std::string &filename);
+	// Decode a media file as far as possible without touching the managers,
+	// may be called from any thread
+	bool decodeMedia(const std::string &data, const std::string &filename,
+			DecodedMedia &decoded);
+	// Insert a decoded media file appropriately into the appropriate manager
+	bool loadMedia(const std::string &data, const std::string &filename,
+			DecodedMedia &decoded);
 	// Send a request for conventional media transfer
 	void request_media(const std::vector<std::string> &file_requests);
 
@@ -490,7 +499,7 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	MtEventManager *m_event;
 
 
-	MeshUpdateThread m_mesh_update_thread;
+	MeshUpdateManager m_mesh_update_manager;
 	ClientEnvironment m_env;
 	ParticleManager m_particle_manager;
 	std::unique_ptr<con::Connection> m_con;
@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "clientmap.h"
 #include "client.h"
 #include "mapblock_mesh.h"
+#include "mesh.h"
 #include <IMaterialRenderer.h>
 #include <matrix4.h>
 #include "mapsector.h"
@@ -28,6 +29,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "settings.h"
 #include "camera.h"               // CameraModes
 #include "util/basic_macros.h"
+#include "util/numeric.h"
 #include <algorithm>
 #include "client/renderingengine.h"
 
@@ -57,7 +59,20 @@ ClientMap::ClientMap(
 	m_cache_trilinear_filter  = g_settings->getBool("trilinear_filter");
 	m_cache_bilinear_filter   = g_settings->getBool("bilinear_filter");
 	m_cache_anistropic_filter = g_settings->getBool("anisotropic_filter");
+	m_cache_lod_distance      = g_settings->getFloat("lod_distance");
+	m_cache_mesh_batching     = g_settings->getBool("enable_mesh_batching");
+	m_cache_enable_vbo        = g_settings->getBool("enable_vbo");
 
+	m_occlusion_cull_pool.reset(new WorkerPool("OcclusionCull", rangelim(
+		g_settings->getS32("occlusion_culling_threads"), 0, 8)));
+}
+
+ClientMap::~ClientMap()
+{
+	for (auto &batch : m_mesh_batches)
+		clearMeshBatch(batch.second);
+	for (auto &it : m_lod_meshes)
+		delete it.second.mesh;
 }
 
 MapSector * ClientMap::emergeSector(v2s16 p2d)
@@ -112,16 +127,65 @@ void ClientMap::getBlocksInViewRange(v3s16 cam_pos_nodes,
 			p_nodes_max.Z / MAP_BLOCKSIZE + 1);
 }
 
+static u16 getLodAtDistance(f32 d, f32 lod_distance)
+{
+	if (d < lod_distance)
+		return 1;
+	if (d < lod_distance * 2)
+		return 2;
+	return 4;
+}
+
+// Side length in mapblocks of the regions that share a level of detail.
+// Far meshes are made of groups of 2x2x2 or 4x4x4 blocks that never cross
+// the border of a region.
+static const s16 LOD_REGION_SIZE = 4;
+
+u16 ClientMap::getRegionLod(v3s16 region, u16 current_lod) const
+{
+	if (m_cache_lod_distance <= 0)
+		return 1;
+
+	const s16 region_nodes = LOD_REGION_SIZE * MAP_BLOCKSIZE;
+	v3f center = intToFloat(region * region_nodes + region_nodes / 2, BS);
+	f32 d = center.getDistanceFrom(m_camera_position) / BS;
+
+	// Keeps groups from being meshed again and again while the camera
+	// moves back and forth over a border
+	const f32 margin = MAP_BLOCKSIZE;
+	if (current_lod >= getLodAtDistance(d - margin, m_cache_lod_distance) &&
+			current_lod <= getLodAtDistance(d + margin, m_cache_lod_distance))
+		return current_lod;
+
+	return getLodAtDistance(d, m_cache_lod_distance);
+}
+
+// Side length in mapblocks of the regions whose meshes are batched
+static const s16 MESH_BATCH_REGION_SIZE = 4;
+// Limits the merging work per frame. Until their batch is made, blocks are
+// drawn on their own.
+static const u32 MESH_BATCH_BUILDS_PER_FRAME = 4;
+
+// Whether the buffer of a mesh is drawn as part of a mesh batch, matches
+// what mergeMeshBuffer() accepts
+static bool isBufferBatched(MapBlockMesh *mesh, u8 layer, u32 i,
+		scene::IMeshBuffer *buf, bool transparent)
+{
+	return !transparent && buf->getVertexType() == video::EVT_STANDARD &&
+			!mesh->isBufferAnimated(layer, i);
+}
+
+// The draw list is kept while the camera turns less than this (about 5
+// degrees), the wider fov used for the list covers the difference
+static const f32 DRAWLIST_REUSE_MIN_COS = 0.996f;
+
+// Number of blocks an occlusion culling thread tests at once
+static const size_t OCCLUSION_CULL_BATCH_SIZE = 32;
+
 void ClientMap::updateDrawList()
 {
 	ScopeProfiler sp(g_profiler, "CM::updateDrawList()", SPT_AVG);
 
-	for (auto &i : m_drawlist) {
-		MapBlock *block = i.second;
-		block->refDrop();
-	}
-	m_drawlist.clear();
-
 	v3f camera_position = m_camera_position;
 	v3f camera_direction = m_camera_direction;
 	f32 camera_fov = m_camera_fov;
@@ -132,14 +196,7 @@ void ClientMap::updateDrawList()
 	camera_fov *= 1.2;
 
 	v3s16 cam_pos_nodes = floatToInt(camera_position, BS);
-	v3s16 p_blocks_min;
-	v3s16 p_blocks_max;
-	getBlocksInViewRange(cam_pos_nodes, &p_blocks_min, &p_blocks_max);
-
-	// Number of blocks with mesh in rendering range
-	u32 blocks_in_range_with_mesh = 0;
-	// Number of blocks occlusion culled
-	u32 blocks_occlusion_culled = 0;
+	v3s16 cam_pos_block = getNodeBlockPos(cam_pos_nodes);
 
 	// No occlusion culling when free_move is on and camera is
 	// inside ground
@@ -156,24 +213,70 @@ void ClientMap::updateDrawList()
 	//if (occlusion_culling_enabled && m_control.show_wireframe)
 	//    occlusion_culling_enabled = porting::getTimeS() & 1;
 
-	for (const auto &sector_it : m_sectors) {
-		MapSector *sector = sector_it.second;
-		v2s16 sp = sector->getPos();
+	/*
+		Blocks are only tested again once the camera enters another block,
+		turns too far or the meshes change. Until then, only keep the drawn
+		blocks loaded.
+	*/
+	if (m_drawlist_valid &&
+			cam_pos_block == m_drawlist_camera_block &&
+			camera_direction.dotProduct(m_drawlist_camera_direction) >=
+				DRAWLIST_REUSE_MIN_COS &&
+			camera_fov == m_drawlist_camera_fov &&
+			m_camera_offset == m_drawlist_camera_offset &&
+			m_control.wanted_range == m_drawlist_range &&
+			m_control.range_all == m_drawlist_range_all &&
+			occlusion_culling_enabled == m_drawlist_occlusion_culling) {
+		for (auto &i : m_drawlist)
+			i.second->resetUsageTimer();
+		for (MapBlock *block : m_lod_drawlist_blocks)
+			block->resetUsageTimer();
+		g_profiler->avg("CM: draw list reused [%]", 100);
+		g_profiler->avg("MapBlocks drawn [#]", m_drawlist.size());
+		return;
+	}
+	g_profiler->avg("CM: draw list reused [%]", 0);
 
-		if (!m_control.range_all) {
-			if (sp.X < p_blocks_min.X || sp.X > p_blocks_max.X ||
-					sp.Y < p_blocks_min.Z || sp.Y > p_blocks_max.Z)
-				continue;
-		}
+	m_drawlist_valid = true;
+	m_drawlist_camera_block = cam_pos_block;
+	m_drawlist_camera_direction = camera_direction;
+	m_drawlist_camera_fov = camera_fov;
+	m_drawlist_camera_offset = m_camera_offset;
+	m_drawlist_range = m_control.wanted_range;
+	m_drawlist_range_all = m_control.range_all;
+	m_drawlist_occlusion_culling = occlusion_culling_enabled;
 
-		MapBlockVect sectorblocks;
-		sector->getBlocks(sectorblocks);
+	for (auto &i : m_drawlist) {
+		MapBlock *block = i.second;
+		block->refDrop();
+	}
+	m_drawlist.clear();
+	for (MapBlock *block : m_lod_drawlist_blocks)
+		block->refDrop();
+	m_lod_drawlist_blocks.clear();
+	m_lod_drawlist.clear();
 
-		/*
-			Loop through blocks in sector
-		*/
+	v3s16 p_blocks_min;
+	v3s16 p_blocks_max;
+	getBlocksInViewRange(cam_pos_nodes, &p_blocks_min, &p_blocks_max);
+
+	// Number of blocks with mesh in rendering range
+	u32 blocks_in_range_with_mesh = 0;
+	// Number of blocks occlusion culled
+	u32 blocks_occlusion_culled = 0;
+
+	float range = 100000 * BS;
+	if (!m_control.range_all)
+		range = m_control.wanted_range * BS;
 
-		u32 sector_blocks_drawn = 0;
+	// Blocks in sight that have a mesh, before occlusion culling
+	std::vector<MapBlock *> &candidates = m_drawlist_candidates;
+	candidates.clear();
+
+	MapBlockVect sectorblocks;
+	auto add_sector = [&] (MapSector *sector) {
+		sectorblocks.clear();
+		sector->getBlocks(sectorblocks);
 
 		for (MapBlock *block : sectorblocks) {
 			/*
@@ -184,16 +287,11 @@ void ClientMap::updateDrawList()
 			if (block->mesh)
 				block->mesh->updateCameraOffset(m_camera_offset);
 
-			float range = 100000 * BS;
-			if (!m_control.range_all)
-				range = m_control.wanted_range * BS;
-
 			float d = 0.0;
 			if (!isBlockInSight(block->getPos(), camera_position,
 					camera_direction, camera_fov, range, &d))
 				continue;
 
-
 			/*
 				Ignore if mesh doesn't exist
 			*/
@@ -202,32 +300,290 @@ void ClientMap::updateDrawList()
 
 			blocks_in_range_with_mesh++;
 
-			/*
-				Occlusion culling
-			*/
-			if ((!m_control.range_all && d > m_control.wanted_range * BS) ||
-					(occlusion_culling_enabled && isBlockOccluded(block, cam_pos_nodes))) {
+			if (!m_control.range_all && d > m_control.wanted_range * BS) {
 				blocks_occlusion_culled++;
 				continue;
 			}
 
-			// This block is in range. Reset usage timer.
-			block->resetUsageTimer();
+			candidates.push_back(block);
+		}
+	};
 
-			// Add to set
-			block->refGrab();
-			m_drawlist[block->getPos()] = block;
+	if (m_control.range_all) {
+		for (const auto &sector_it : m_sectors)
+			add_sector(sector_it.second);
+	} else {
+		// The sectors are sorted by X first, so every column of the view
+		// range is a single run of the map
+		for (s32 x = p_blocks_min.X; x <= p_blocks_max.X; x++) {
+			auto it = m_sectors.lower_bound(v2s16(x, p_blocks_min.Z));
+			for (; it != m_sectors.end() && it->first.X == x &&
+					it->first.Y <= p_blocks_max.Z; ++it)
+				add_sector(it->second);
+		}
+	}
 
-			sector_blocks_drawn++;
-		} // foreach sectorblocks
+	/*
+		Occlusion culling
+	*/
+	std::vector<u8> &occluded = m_drawlist_occluded;
+	occluded.assign(candidates.size(), 0);
+	if (occlusion_culling_enabled) {
+		// The map is not modified while the blocks are tested
+		m_occlusion_cull_pool->run(candidates.size(), OCCLUSION_CULL_BATCH_SIZE,
+			[&] (size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+					occluded[i] = isBlockOccluded(candidates[i], cam_pos_nodes);
+			});
+	}
+
+	std::map<v3s16, u16> region_lods;
+	std::set<LodMeshKey> lod_meshes_drawn;
+
+	for (size_t i = 0; i < candidates.size(); i++) {
+		if (occluded[i]) {
+			blocks_occlusion_culled++;
+			continue;
+		}
 
-		if (sector_blocks_drawn != 0)
-			m_last_drawn_sectors.insert(sp);
+		MapBlock *block = candidates[i];
+		v3s16 bp = block->getPos();
+
+		// This block is in range. Reset usage timer.
+		block->resetUsageTimer();
+		block->refGrab();
+		m_last_drawn_sectors.insert(v2s16(bp.X, bp.Z));
+
+		v3s16 region = getContainerPos(bp, LOD_REGION_SIZE);
+		auto lod_it = region_lods.find(region);
+		if (lod_it == region_lods.end()) {
+			auto old_it = m_region_lods.find(region);
+			u16 lod = getRegionLod(region,
+					old_it != m_region_lods.end() ? old_it->second : 1);
+			lod_it = region_lods.emplace(region, lod).first;
+		}
+
+		/*
+			Far regions are drawn with the meshes of their groups of
+			blocks. Until the mesh of a group is made, its blocks are drawn.
+		*/
+		const u16 lod = lod_it->second;
+		if (lod > 1) {
+			LodMeshKey key(getContainerPos(bp, lod) * lod, lod);
+			LodMesh &lod_mesh = m_lod_meshes[key];
+			if ((lod_mesh.data_hash == 0 || lod_mesh.dirty) &&
+					!lod_mesh.requested) {
+				lod_mesh.requested = true;
+				lod_mesh.dirty = false;
+				m_client->addUpdateLodMeshTask(key.first, lod);
+			}
+			if (lod_mesh.data_hash != 0) {
+				if (lod_mesh.mesh && lod_meshes_drawn.insert(key).second)
+					m_lod_drawlist.push_back(key);
+				m_lod_drawlist_blocks.push_back(block);
+				continue;
+			}
+		}
+
+		// Add to set
+		m_drawlist[bp] = block;
 	}
 
+	m_region_lods.swap(region_lods);
+	removeUnusedLodMeshes();
+
+	updateMeshBatchBlocks();
+
 	g_profiler->avg("MapBlock meshes in range [#]", blocks_in_range_with_mesh);
 	g_profiler->avg("MapBlocks occlusion culled [#]", blocks_occlusion_culled);
 	g_profiler->avg("MapBlocks drawn [#]", m_drawlist.size());
+	g_profiler->avg("CM: LOD meshes drawn [#]", m_lod_drawlist.size());
+	g_profiler->avg("CM: MapBlocks drawn as LOD meshes [#]",
+			m_lod_drawlist_blocks.size());
+}
+
+u64 ClientMap::getLodMeshHash(v3s16 p, u16 lod) const
+{
+	auto it = m_lod_meshes.find(LodMeshKey(p, lod));
+	return it != m_lod_meshes.end() ? it->second.data_hash : 0;
+}
+
+void ClientMap::onLodMeshUpdated(const MeshUpdateResult &r)
+{
+	auto it = m_lod_meshes.find(LodMeshKey(r.p, r.lod));
+	if (it == m_lod_meshes.end()) {
+		// Went out of range meanwhile
+		delete r.mesh;
+		return;
+	}
+
+	LodMesh &lod_mesh = it->second;
+	lod_mesh.requested = false;
+	if (r.unchanged) {
+		// Another mesh replaced the one the data was compared with
+		if (lod_mesh.data_hash != r.data_hash)
+			lod_mesh.dirty = true;
+		return;
+	}
+
+	delete lod_mesh.mesh;
+	lod_mesh.mesh = r.mesh;
+	lod_mesh.data_hash = r.data_hash;
+
+	bool is_empty = true;
+	for (int l = 0; l < MAX_TILE_LAYERS; l++)
+		if (r.mesh->getMesh(l)->getMeshBufferCount() != 0)
+			is_empty = false;
+	if (is_empty) {
+		delete lod_mesh.mesh;
+		lod_mesh.mesh = nullptr;
+	}
+
+	m_drawlist_valid = false;
+}
+
+void ClientMap::removeUnusedLodMeshes()
+{
+	// Kept while the camera turns, up to a region out of range
+	const f32 range = (m_control.wanted_range +
+			LOD_REGION_SIZE * MAP_BLOCKSIZE) * BS;
+
+	for (auto it = m_lod_meshes.begin(); it != m_lod_meshes.end();) {
+		const v3s16 &p = it->first.first;
+		const u16 lod = it->first.second;
+		v3f center = intToFloat(p * MAP_BLOCKSIZE +
+				MAP_BLOCKSIZE * lod / 2, BS);
+		bool in_range = m_control.range_all ||
+				center.getDistanceFrom(m_camera_position) <= range;
+		if (in_range &&
+				getRegionLod(getContainerPos(p, LOD_REGION_SIZE), lod) == lod) {
+			++it;
+			continue;
+		}
+
+		delete it->second.mesh;
+		it = m_lod_meshes.erase(it);
+	}
+}
+
+void ClientMap::onBlockMeshChanged(v3s16 blockpos)
+{
+	m_drawlist_valid = false;
+
+	// The groups the block is in, and those whose faces towards the next
+	// group are made of it
+	for (u16 lod = 2; lod <= LOD_REGION_SIZE; lod *= 2) {
+		v3s16 origin = getContainerPos(blockpos, lod) * lod;
+		v3s16 d;
+		for (d.X = 0; d.X <= 1; d.X++)
+		for (d.Y = 0; d.Y <= 1; d.Y++)
+		for (d.Z = 0; d.Z <= 1; d.Z++) {
+			if ((d.X && blockpos.X != origin.X) ||
+					(d.Y && blockpos.Y != origin.Y) ||
+					(d.Z && blockpos.Z != origin.Z))
+				continue;
+			auto it = m_lod_meshes.find(LodMeshKey(origin - d * lod, lod));
+			if (it != m_lod_meshes.end())
+				it->second.dirty = true;
+		}
+	}
+
+	auto it = m_mesh_batches.find(
+			getContainerPos(blockpos, MESH_BATCH_REGION_SIZE));
+	if (it == m_mesh_batches.end())
+		return;
+
+	const std::vector<v3s16> &blocks = it->second.blocks;
+	if (std::binary_search(blocks.begin(), blocks.end(), blockpos))
+		it->second.dirty = true;
+}
+
+void ClientMap::updateMeshBatchBlocks()
+{
+	if (!m_cache_mesh_batching)
+		return;
+
+	// The draw list is sorted, so are the blocks of each region
+	std::map<v3s16, std::vector<v3s16>> region_blocks;
+	for (auto &i : m_drawlist)
+		region_blocks[getContainerPos(i.first, MESH_BATCH_REGION_SIZE)]
+				.push_back(i.first);
+
+	for (auto it = m_mesh_batches.begin(); it != m_mesh_batches.end();) {
+		if (region_blocks.find(it->first) == region_blocks.end()) {
+			clearMeshBatch(it->second);
+			it = m_mesh_batches.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (auto &region : region_blocks) {
+		MeshBatch &batch = m_mesh_batches[region.first];
+		if (batch.blocks != region.second) {
+			batch.blocks.swap(region.second);
+			batch.dirty = true;
+		}
+	}
+}
+
+void ClientMap::buildMeshBatch(MeshBatch &batch, video::IVideoDriver *driver)
+{
+	clearMeshBatch(batch);
+	batch.camera_offset = m_camera_offset;
+
+	for (const v3s16 &p : batch.blocks) {
+		auto it = m_drawlist.find(p);
+		if (it == m_drawlist.end() || !it->second->mesh)
+			continue;
+
+		MapBlockMesh *mesh = it->second->mesh;
+		mesh->updateCameraOffset(m_camera_offset);
+
+		for (u8 layer = 0; layer < MAX_TILE_LAYERS; layer++) {
+			scene::IMesh *layer_mesh = mesh->getMesh(layer);
+			for (u32 i = 0; i < layer_mesh->getMeshBufferCount(); i++) {
+				scene::IMeshBuffer *buf = layer_mesh->getMeshBuffer(i);
+				if (mesh->isBufferAnimated(layer, i))
+					continue;
+
+				video::SMaterial &material = buf->getMaterial();
+				video::IMaterialRenderer *rnd =
+					driver->getMaterialRenderer(material.MaterialType);
+				// So that the materials of new meshes match the others
+				setMaterialFlags(material);
+				mergeMeshBuffer(batch.buffers, layer, buf,
+						rnd && rnd->isTransparent());
+			}
+		}
+	}
+
+	if (m_cache_enable_vbo) {
+		for (auto &merged : batch.buffers)
+			merged.second->setHardwareMappingHint(scene::EHM_STATIC);
+	}
+
+	batch.dirty = false;
+}
+
+void ClientMap::clearMeshBatch(MeshBatch &batch)
+{
+	for (auto &merged : batch.buffers) {
+		if (m_cache_enable_vbo)
+			RenderingEngine::get_video_driver()->removeHardwareBuffer(
+					merged.second);
+		merged.second->drop();
+	}
+	batch.buffers.clear();
+	batch.dirty = true;
+}
+
+void ClientMap::setMaterialFlags(video::SMaterial &material) const
+{
+	material.setFlag(video::EMF_TRILINEAR_FILTER, m_cache_trilinear_filter);
+	material.setFlag(video::EMF_BILINEAR_FILTER, m_cache_bilinear_filter);
+	material.setFlag(video::EMF_ANISOTROPIC_FILTER, m_cache_anistropic_filter);
+	material.setFlag(video::EMF_WIREFRAME, m_control.show_wireframe);
 }
 
 struct MeshBufList
@@ -301,6 +657,23 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 	v3f camera_direction = m_camera_direction;
 	f32 camera_fov = m_camera_fov;
 
+	/*
+		Merge the buffers of the batches whose blocks or meshes changed
+	*/
+	if (m_cache_mesh_batching && pass == scene::ESNRP_SOLID) {
+		u32 batches_built = 0;
+		for (auto &it : m_mesh_batches) {
+			MeshBatch &batch = it.second;
+			if (batch.camera_offset != m_camera_offset)
+				batch.dirty = true;
+			if (!batch.dirty || batches_built >= MESH_BATCH_BUILDS_PER_FRAME)
+				continue;
+			buildMeshBatch(batch, driver);
+			batches_built++;
+		}
+		g_profiler->avg("renderMap(): mesh batches built [#]", batches_built);
+	}
+
 	/*
 		Get all blocks and draw all visible ones
 	*/
@@ -317,6 +690,9 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 
 	MeshBufListList drawbufs;
 
+	// Batches with blocks in sight
+	std::set<MeshBatch *> batches_drawn;
+
 	for (auto &i : m_drawlist) {
 		MapBlock *block = i.second;
 
@@ -329,6 +705,18 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 				camera_direction, camera_fov, 100000 * BS, &d))
 			continue;
 
+		// Set if the static opaque buffers of the block are drawn by its
+		// batch
+		MeshBatch *batch = nullptr;
+		if (m_cache_mesh_batching && !is_transparent_pass) {
+			auto it = m_mesh_batches.find(
+					getContainerPos(block->getPos(), MESH_BATCH_REGION_SIZE));
+			if (it != m_mesh_batches.end() && !it->second.dirty) {
+				batch = &it->second;
+				batches_drawn.insert(batch);
+			}
+		}
+
 		// Mesh animation
 		if (pass == scene::ESNRP_SOLID) {
 			//MutexAutoLock lock(block->mesh_mutex);
@@ -370,18 +758,15 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 						driver->getMaterialRenderer(material.MaterialType);
 					bool transparent = (rnd && rnd->isTransparent());
 					if (transparent == is_transparent_pass) {
+						if (batch && isBufferBatched(mapBlockMesh, layer, i,
+								buf, transparent))
+							continue;
+
 						if (buf->getVertexCount() == 0)
 							errorstream << "Block [" << analyze_block(block)
 								<< "] contains an empty meshbuf" << std::endl;
 
-						material.setFlag(video::EMF_TRILINEAR_FILTER,
-							m_cache_trilinear_filter);
-						material.setFlag(video::EMF_BILINEAR_FILTER,
-							m_cache_bilinear_filter);
-						material.setFlag(video::EMF_ANISOTROPIC_FILTER,
-							m_cache_anistropic_filter);
-						material.setFlag(video::EMF_WIREFRAME,
-							m_control.show_wireframe);
+						setMaterialFlags(material);
 
 						drawbufs.add(buf, layer);
 					}
@@ -390,6 +775,54 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 		}
 	}
 
+	/*
+		Draw the far meshes of the groups of blocks
+	*/
+	for (const LodMeshKey &key : m_lod_drawlist) {
+		auto it = m_lod_meshes.find(key);
+		if (it == m_lod_meshes.end() || !it->second.mesh)
+			continue;
+
+		MapBlockMesh *lod_mesh = it->second.mesh;
+		lod_mesh->updateCameraOffset(m_camera_offset);
+
+		if (pass == scene::ESNRP_SOLID) {
+			if (lod_mesh->isAnimationForced() ||
+					mesh_animate_count < (m_control.range_all ? 200 : 50)) {
+				if (lod_mesh->animate(true, animation_time, crack,
+						daynight_ratio))
+					mesh_animate_count++;
+			} else {
+				lod_mesh->decreaseAnimationForceTimer();
+			}
+		}
+
+		for (int layer = 0; layer < MAX_TILE_LAYERS; layer++) {
+			scene::IMesh *mesh = lod_mesh->getMesh(layer);
+			for (u32 i = 0; i < mesh->getMeshBufferCount(); i++) {
+				scene::IMeshBuffer *buf = mesh->getMeshBuffer(i);
+				video::SMaterial &material = buf->getMaterial();
+				video::IMaterialRenderer *rnd =
+					driver->getMaterialRenderer(material.MaterialType);
+				bool transparent = (rnd && rnd->isTransparent());
+				if (transparent != is_transparent_pass)
+					continue;
+
+				setMaterialFlags(material);
+				drawbufs.add(buf, layer);
+			}
+		}
+	}
+
+	u32 batched_buffer_count = 0;
+	for (MeshBatch *batch : batches_drawn) {
+		for (auto &merged : batch->buffers) {
+			setMaterialFlags(merged.second->Material);
+			drawbufs.add(merged.second, merged.first);
+		}
+		batched_buffer_count += batch->buffers.size();
+	}
+
 	TimeTaker draw("Drawing mesh buffers");
 
 	// Render all layers in order
@@ -414,6 +847,9 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 	// Log only on solid pass because values are the same
 	if (pass == scene::ESNRP_SOLID) {
 		g_profiler->avg("renderMap(): animated meshes [#]", mesh_animate_count);
+		if (m_cache_mesh_batching)
+			g_profiler->avg("renderMap(): batched buffers [#]",
+					batched_buffer_count);
 	}
 
 	g_profiler->avg(prefix + "vertices drawn [#]", vertex_count);
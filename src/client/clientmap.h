@@ -22,6 +22,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irrlichttypes_extrabloated.h"
 #include "map.h"
 #include "camera.h"
+#include "threading/workerpool.h"
+#include <memory>
 #include <set>
 #include <map>
 
@@ -37,6 +39,8 @@ struct MapDrawControl
 
 class Client;
 class ITextureSource;
+class MapBlockMesh;
+struct MeshUpdateResult;
 
 /*
 	ClientMap
@@ -53,7 +57,7 @@ class ClientMap : public Map, public scene::ISceneNode
 			s32 id
 	);
 
-	virtual ~ClientMap() = default;
+	virtual ~ClientMap();
 
 	s32 mapType() const
 	{
@@ -101,6 +105,16 @@ class ClientMap : public Map, public scene::ISceneNode
 	void getBlocksInViewRange(v3s16 cam_pos_nodes,
 		v3s16 *p_blocks_min, v3s16 *p_blocks_max);
 	void updateDrawList();
+	// Data hash of the far mesh of the group of lod * lod * lod blocks
+	// starting at p, 0 if there is none yet. See MeshMakeData::m_lod.
+	u64 getLodMeshHash(v3s16 p, u16 lod) const;
+	// Takes the far mesh of a group of blocks made by the mesh update
+	// threads
+	void onLodMeshUpdated(const MeshUpdateResult &r);
+	// Called when the mesh of a block was replaced. Forces the next
+	// updateDrawList() to rebuild the list and the far meshes made from
+	// the block to be made again.
+	void onBlockMeshChanged(v3s16 blockpos);
 	void renderMap(video::IVideoDriver* driver, s32 pass);
 
 	int getBackgroundBrightness(float max_d, u32 daylight_factor,
@@ -114,6 +128,53 @@ class ClientMap : public Map, public scene::ISceneNode
 	const MapDrawControl & getControl() const { return m_control; }
 	f32 getCameraFov() const { return m_camera_fov; }
 private:
+	/*
+		The static opaque mesh buffers of the drawn blocks of a region of
+		the map, merged into as few buffers per material as possible
+	*/
+	struct MeshBatch
+	{
+		// Drawn blocks of the region, sorted
+		std::vector<v3s16> blocks;
+		// Merged buffers and their layers
+		std::vector<std::pair<u8, scene::SMeshBuffer *>> buffers;
+		// Camera offset of the merged vertices
+		v3s16 camera_offset;
+		// The blocks or their meshes changed since the buffers were made
+		bool dirty = true;
+	};
+
+	/*
+		The far mesh of a group of blocks, drawn in place of the blocks
+	*/
+	struct LodMesh
+	{
+		// nullptr if the group has no faces
+		MapBlockMesh *mesh = nullptr;
+		// Hash of the data of the mesh, 0 until the first mesh was made
+		u64 data_hash = 0;
+		// Waiting for the mesh update threads
+		bool requested = false;
+		// The blocks changed since the mesh was requested
+		bool dirty = false;
+	};
+	// Position of the first block of the group and lod
+	typedef std::pair<v3s16, u16> LodMeshKey;
+
+	// Level of detail of a region, see LOD_REGION_SIZE. Regions close to
+	// a border between two levels keep current_lod.
+	u16 getRegionLod(v3s16 region, u16 current_lod) const;
+	// Deletes the far meshes that are out of range or of another lod than
+	// their region
+	void removeUnusedLodMeshes();
+
+	// Assigns the blocks of the draw list to their batches
+	void updateMeshBatchBlocks();
+	void buildMeshBatch(MeshBatch &batch, video::IVideoDriver *driver);
+	void clearMeshBatch(MeshBatch &batch);
+
+	void setMaterialFlags(video::SMaterial &material) const;
+
 	Client *m_client;
 
 	aabb3f m_box = aabb3f(-BS * 1000000, -BS * 1000000, -BS * 1000000,
@@ -128,9 +189,40 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	std::map<v3s16, MapBlock*> m_drawlist;
 
+	// Far meshes drawn in place of their blocks, and the blocks in sight
+	// they are drawn for
+	std::vector<LodMeshKey> m_lod_drawlist;
+	std::vector<MapBlock *> m_lod_drawlist_blocks;
+
+	// Camera state the draw list was last built for
+	bool m_drawlist_valid = false;
+	v3s16 m_drawlist_camera_block;
+	v3f m_drawlist_camera_direction;
+	f32 m_drawlist_camera_fov = 0.0f;
+	v3s16 m_drawlist_camera_offset;
+	float m_drawlist_range = 0.0f;
+	bool m_drawlist_range_all = false;
+	bool m_drawlist_occlusion_culling = false;
+
+	// Scratch space of updateDrawList(), kept to reuse the allocations
+	std::vector<MapBlock *> m_drawlist_candidates;
+	std::vector<u8> m_drawlist_occluded;
+
+	std::unique_ptr<WorkerPool> m_occlusion_cull_pool;
+
 	std::set<v2s16> m_last_drawn_sectors;
 
 	bool m_cache_trilinear_filter;
 	bool m_cache_bilinear_filter;
 	bool m_cache_anistropic_filter;
+	f32 m_cache_lod_distance;
+	bool m_cache_mesh_batching;
+	bool m_cache_enable_vbo;
+
+	// By region position, see MESH_BATCH_REGION_SIZE
+	std::map<v3s16, MeshBatch> m_mesh_batches;
+
+	std::map<LodMeshKey, LodMesh> m_lod_meshes;
+	// Level of detail of the regions in sight when the draw list was built
+	std::map<v3s16, u16> m_region_lods;
 };
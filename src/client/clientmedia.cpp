@@ -23,13 +23,16 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "filecache.h"
 #include "filesys.h"
 #include "log.h"
+#include "mediadecodepool.h"
 #include "porting.h"
 #include "settings.h"
 #include "util/hex.h"
 #include "util/serialize.h"
-#include "util/sha1.h"
 #include "util/string.h"
 
+// Cached media files read and decoded together when joining a server
+#define MEDIA_LOAD_BATCH_SIZE 256
+
 static std::string getMediaCacheDir()
 {
 	return porting::path_cache + DIR_DELIM + "media";
@@ -47,6 +50,18 @@ ClientMediaDownloader::ClientMediaDownloader():
 
 ClientMediaDownloader::~ClientMediaDownloader()
 {
+	if (m_decode_pool) {
+		// Read, checksum, decode and cache write are summed over all threads
+		infostream << "Client: Loaded " << m_loaded_count << " media files in "
+			<< (porting::getTimeUs() - m_start_time) / 1000 << " ms using "
+			<< m_decode_pool->getThreadCount() + 1 << " threads; read: "
+			<< m_decode_pool->getReadTime() / 1000 << " ms, checksum: "
+			<< m_decode_pool->getChecksumTime() / 1000 << " ms, decode: "
+			<< m_decode_pool->getDecodeTime() / 1000 << " ms, cache write: "
+			<< m_decode_pool->getCacheWriteTime() / 1000 << " ms, load: "
+			<< m_load_time / 1000 << " ms" << std::endl;
+	}
+
 	if (m_httpfetch_caller != HTTPFETCH_DISCARD)
 		httpfetch_caller_free(m_httpfetch_caller);
 
@@ -128,6 +143,7 @@ void ClientMediaDownloader::step(Client *client)
 	if (m_httpfetch_active) {
 		bool fetched_something = false;
 		HTTPFetchResult fetch_result;
+		std::vector<MediaFile> files;
 
 		while (httpfetch_async_get(m_httpfetch_caller, fetch_result)) {
 			m_httpfetch_active--;
@@ -137,7 +153,17 @@ void ClientMediaDownloader::step(Client *client)
 			if (fetch_result.request_id < m_remotes.size())
 				remoteHashSetReceived(fetch_result);
 			else
-				remoteMediaReceived(fetch_result, client);
+				remoteMediaReceived(fetch_result, files);
+		}
+
+		// Load the media files received in this step together
+		loadFiles(files, client);
+		for (const MediaFile &file : files) {
+			if (file.loaded) {
+				m_files[file.name]->received = true;
+				assert(m_uncached_received_count < m_uncached_count);
+				m_uncached_received_count++;
+			}
 		}
 
 		if (fetched_something)
@@ -160,22 +186,28 @@ void ClientMediaDownloader::step(Client *client)
 
 void ClientMediaDownloader::initialStep(Client *client)
 {
-	// Check media cache
+	m_start_time = porting::getTimeUs();
+
+	s32 num_threads = g_settings->getS32("media_decode_threads");
+	if (num_threads == 0)
+		num_threads = Thread::getNumberOfProcessors() - 1;
+	m_decode_pool.reset(new MediaDecodePool(rangelim(num_threads, 0, 16)));
+
+	// Check media cache. The files are read and decoded in batches, so
+	// only one batch of them is held in memory at a time.
 	m_uncached_count = m_files.size();
-	for (auto &file_it : m_files) {
-		std::string name = file_it.first;
-		FileStatus *filestatus = file_it.second;
-		const std::string &sha1 = filestatus->sha1;
-
-		std::ostringstream tmp_os(std::ios_base::binary);
-		bool found_in_cache = m_media_cache.load(hex_encode(sha1), tmp_os);
-
-		// If found in cache, try to load it from there
-		if (found_in_cache) {
-			bool success = checkAndLoad(name, sha1,
-					tmp_os.str(), true, client);
-			if (success) {
-				filestatus->received = true;
+	std::vector<MediaFile> files;
+	files.reserve(MEDIA_LOAD_BATCH_SIZE);
+	for (auto file_it = m_files.begin(); file_it != m_files.end();) {
+		files.clear();
+		for (; file_it != m_files.end() &&
+				files.size() < MEDIA_LOAD_BATCH_SIZE; ++file_it)
+			files.emplace_back(file_it->first, file_it->second->sha1, true);
+
+		loadFiles(files, client);
+		for (const MediaFile &file : files) {
+			if (file.loaded) {
+				m_files[file.name]->received = true;
 				m_uncached_count--;
 			}
 		}
@@ -311,13 +343,13 @@ void ClientMediaDownloader::remoteHashSetReceived(
 }
 
 void ClientMediaDownloader::remoteMediaReceived(
-		const HTTPFetchResult &fetch_result,
-		Client *client)
+		HTTPFetchResult &fetch_result,
+		std::vector<MediaFile> &files)
 {
 	// Some remote server sent us a file.
 	// -> decrement number of active fetches
-	// -> mark file as received if fetch succeeded
-	// -> try to load media
+	// -> add it to the files to load if fetch succeeded,
+	//    the file is marked as received once it is loaded
 
 	std::string name;
 	{
@@ -339,16 +371,11 @@ void ClientMediaDownloader::remoteMediaReceived(
 	filestatus->current_remote = -1;
 	remote->active_count--;
 
-	// If fetch succeeded, try to load media file
+	// If fetch succeeded, load media file with the others
 
 	if (fetch_result.succeeded) {
-		bool success = checkAndLoad(name, filestatus->sha1,
-				fetch_result.data, false, client);
-		if (success) {
-			filestatus->received = true;
-			assert(m_uncached_received_count < m_uncached_count);
-			m_uncached_received_count++;
-		}
+		files.emplace_back(name, filestatus->sha1, false);
+		files.back().data.swap(fetch_result.data);
 	}
 }
 
@@ -472,91 +499,105 @@ void ClientMediaDownloader::startConventionalTransfers(Client *client)
 }
 
 void ClientMediaDownloader::conventionalTransferDone(
-		const std::string &name,
-		const std::string &data,
+		std::vector<std::pair<std::string, std::string>> &files,
 		Client *client)
 {
-	// Check that file was announced
-	std::map<std::string, FileStatus*>::iterator
-		file_iter = m_files.find(name);
-	if (file_iter == m_files.end()) {
-		errorstream << "Client: server sent media file that was"
-			<< "not announced, ignoring it: \"" << name << "\""
-			<< std::endl;
-		return;
-	}
-	FileStatus *filestatus = file_iter->second;
-	assert(filestatus != NULL);
+	std::vector<MediaFile> received;
+	for (auto &file : files) {
+		const std::string &name = file.first;
+
+		// Check that file was announced
+		std::map<std::string, FileStatus*>::iterator
+			file_iter = m_files.find(name);
+		if (file_iter == m_files.end()) {
+			errorstream << "Client: server sent media file that was"
+				<< "not announced, ignoring it: \"" << name << "\""
+				<< std::endl;
+			continue;
+		}
+		FileStatus *filestatus = file_iter->second;
+		assert(filestatus != NULL);
 
-	// Check that file hasn't already been received
-	if (filestatus->received) {
-		errorstream << "Client: server sent media file that we already"
-			<< "received, ignoring it: \"" << name << "\""
-			<< std::endl;
-		return;
-	}
+		// Check that file hasn't already been received
+		if (filestatus->received) {
+			errorstream << "Client: server sent media file that we already"
+				<< "received, ignoring it: \"" << name << "\""
+				<< std::endl;
+			continue;
+		}
 
-	// Mark file as received, regardless of whether loading it works and
-	// whether the checksum matches (because at this point there is no
-	// other server that could send a replacement)
-	filestatus->received = true;
-	assert(m_uncached_received_count < m_uncached_count);
-	m_uncached_received_count++;
+		// Mark file as received, regardless of whether loading it works and
+		// whether the checksum matches (because at this point there is no
+		// other server that could send a replacement)
+		filestatus->received = true;
+		assert(m_uncached_received_count < m_uncached_count);
+		m_uncached_received_count++;
+
+		received.emplace_back(name, filestatus->sha1, false);
+		received.back().data.swap(file.second);
+	}
 
-	// Check that received file matches announced checksum
-	// If so, load it
-	checkAndLoad(name, filestatus->sha1, data, false, client);
+	// Check that received files match announced checksums
+	// If so, load them
+	loadFiles(received, client);
 }
 
-bool ClientMediaDownloader::checkAndLoad(
-		const std::string &name, const std::string &sha1,
-		const std::string &data, bool is_from_cache, Client *client)
+void ClientMediaDownloader::loadFiles(std::vector<MediaFile> &files,
+		Client *client)
 {
-	const char *cached_or_received = is_from_cache ? "cached" : "received";
-	const char *cached_or_received_uc = is_from_cache ? "Cached" : "Received";
-	std::string sha1_hex = hex_encode(sha1);
+	if (files.empty())
+		return;
 
-	// Compute actual checksum of data
-	std::string data_sha1;
-	{
-		SHA1 data_sha1_calculator;
-		data_sha1_calculator.addBytes(data.c_str(), data.size());
-		unsigned char *data_tmpdigest = data_sha1_calculator.getDigest();
-		data_sha1.assign((char*) data_tmpdigest, 20);
-		free(data_tmpdigest);
-	}
+	u64 t0 = porting::getTimeUs();
+	m_decode_pool->run(client, &m_media_cache, files);
+	u64 t1 = porting::getTimeUs();
+
+	for (MediaFile &file : files) {
+		if (!file.found)
+			continue;
+
+		const char *cached_or_received = file.from_cache ? "cached" : "received";
+		const char *cached_or_received_uc = file.from_cache ? "Cached" : "Received";
+		std::string sha1_hex = hex_encode(file.sha1);
+
+		// Check that received file matches announced checksum
+		if (file.data_sha1 != file.sha1) {
+			std::string data_sha1_hex = hex_encode(file.data_sha1);
+			infostream << "Client: "
+				<< cached_or_received_uc << " media file "
+				<< sha1_hex << " \"" << file.name << "\" "
+				<< "mismatches actual checksum " << data_sha1_hex
+				<< std::endl;
+			continue;
+		}
 
-	// Check that received file matches announced checksum
-	if (data_sha1 != sha1) {
-		std::string data_sha1_hex = hex_encode(data_sha1);
-		infostream << "Client: "
-			<< cached_or_received_uc << " media file "
-			<< sha1_hex << " \"" << name << "\" "
-			<< "mismatches actual checksum " << data_sha1_hex
-			<< std::endl;
-		return false;
-	}
+		// Checksum is ok, try loading the file
+		// (the pool has already updated the cache on success)
+		bool success = file.decoded &&
+				client->loadMedia(file.data, file.name, file.media);
+		if (!success) {
+			infostream << "Client: "
+				<< "Failed to load " << cached_or_received << " media: "
+				<< sha1_hex << " \"" << file.name << "\""
+				<< std::endl;
+			continue;
+		}
 
-	// Checksum is ok, try loading the file
-	bool success = client->loadMedia(data, name);
-	if (!success) {
-		infostream << "Client: "
-			<< "Failed to load " << cached_or_received << " media: "
-			<< sha1_hex << " \"" << name << "\""
+		verbosestream << "Client: "
+			<< "Loaded " << cached_or_received << " media: "
+			<< sha1_hex << " \"" << file.name << "\""
 			<< std::endl;
-		return false;
-	}
 
-	verbosestream << "Client: "
-		<< "Loaded " << cached_or_received << " media: "
-		<< sha1_hex << " \"" << name << "\""
-		<< std::endl;
+		file.loaded = true;
+		m_loaded_count++;
+	}
 
-	// Update cache (unless we just loaded the file from the cache)
-	if (!is_from_cache)
-		m_media_cache.update(sha1_hex, data);
+	u64 t2 = porting::getTimeUs();
+	m_load_time += t2 - t1;
 
-	return true;
+	verbosestream << "Client: Prepared " << files.size()
+		<< " media files in " << (t1 - t0) / 1000 << " ms, loaded them in "
+		<< (t2 - t1) / 1000 << " ms" << std::endl;
 }
 
 
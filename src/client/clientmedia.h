@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "irrlichttypes.h"
 #include "filecache.h"
+#include <memory>
 #include <ostream>
 #include <map>
 #include <set>
@@ -28,7 +29,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <unordered_map>
 
 class Client;
+class MediaDecodePool;
 struct HTTPFetchResult;
+struct MediaFile;
 
 #define MTHASHSET_FILE_SIGNATURE 0x4d544853 // 'MTHS'
 #define MTHASHSET_FILE_NAME "index.mth"
@@ -75,10 +78,10 @@ class ClientMediaDownloader
 	// After step has been called once, don't call addFile/addRemoteServer.
 	void step(Client *client);
 
-	// Must be called for each file received through TOCLIENT_MEDIA
+	// Must be called with the files of each TOCLIENT_MEDIA packet,
+	// given as pairs of name and data
 	void conventionalTransferDone(
-			const std::string &name,
-			const std::string &data,
+			std::vector<std::pair<std::string, std::string>> &files,
 			Client *client);
 
 private:
@@ -96,15 +99,15 @@ class ClientMediaDownloader
 
 	void initialStep(Client *client);
 	void remoteHashSetReceived(const HTTPFetchResult &fetch_result);
-	void remoteMediaReceived(const HTTPFetchResult &fetch_result,
-			Client *client);
+	void remoteMediaReceived(HTTPFetchResult &fetch_result,
+			std::vector<MediaFile> &files);
 	s32 selectRemoteServer(FileStatus *filestatus);
 	void startRemoteMediaTransfers();
 	void startConventionalTransfers(Client *client);
 
-	bool checkAndLoad(const std::string &name, const std::string &sha1,
-			const std::string &data, bool is_from_cache,
-			Client *client);
+	// Checks the files and loads them into the client, the slow parts
+	// happen on m_decode_pool. Sets MediaFile::loaded on success.
+	void loadFiles(std::vector<MediaFile> &files, Client *client);
 
 	std::string serializeRequiredHashSet();
 	static void deSerializeHashSet(const std::string &data,
@@ -119,6 +122,14 @@ class ClientMediaDownloader
 	// Filesystem-based media cache
 	FileCache m_media_cache;
 
+	// Created by the initial step
+	std::unique_ptr<MediaDecodePool> m_decode_pool;
+
+	// For the timing summary
+	u64 m_start_time = 0;
+	u64 m_load_time = 0;
+	s32 m_loaded_count = 0;
+
 	// Has an attempt been made to load media files from the file cache?
 	// Have hash sets been requested from remote servers?
 	bool m_initial_step_done = false;
@@ -1427,8 +1427,11 @@ void GenericCAO::processMessage(const std::string &data)
 	std::istringstream is(data, std::ios::binary);
 	// command
 	u8 cmd = readU8(is);
-	if (cmd == GENERIC_CMD_SET_PROPERTIES) {
-		m_prop = gob_read_set_properties(is);
+	if (cmd == GENERIC_CMD_SET_PROPERTIES || cmd == GENERIC_CMD_UPDATE_PROPERTIES) {
+		if (cmd == GENERIC_CMD_SET_PROPERTIES)
+			m_prop = gob_read_set_properties(is);
+		else
+			m_prop.deSerializeDelta(is);
 
 		m_selection_box = m_prop.selectionbox;
 		m_selection_box.MinEdge *= BS;
@@ -64,8 +64,7 @@ MapblockMeshGenerator::MapblockMeshGenerator(MeshMakeData *input, MeshCollector
 	data      = input;
 	collector = output;
 
-	nodedef   = data->m_client->ndef();
-	meshmanip = RenderingEngine::get_scene_manager()->getMeshManipulator();
+	nodedef   = data->m_nodedef;
 
 	enable_mesh_cache = g_settings->getBool("enable_mesh_cache") &&
 		!data->m_smooth_lighting; // Mesh cache is not supported with smooth lighting
@@ -1342,7 +1341,8 @@ void MapblockMeshGenerator::drawMeshNode()
 		mesh = cloneMesh(f->mesh_ptr[0]);
 		rotateMeshBy6dFacedir(mesh, facedir);
 		recalculateBoundingBox(mesh);
-		meshmanip->recalculateNormals(mesh, true, false);
+		RenderingEngine::get_scene_manager()->getMeshManipulator()
+			->recalculateNormals(mesh, true, false);
 	} else
 		return;
 
@@ -65,7 +65,6 @@ class MapblockMeshGenerator
 	MeshCollector *collector;
 
 	const NodeDefManager *nodedef;
-	scene::IMeshManipulator *meshmanip;
 
 // options
 	bool enable_mesh_cache;
@@ -0,0 +1,300 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "imagecache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "exceptions.h"
+#include "filesys.h"
+#include "log.h"
+#include "serialization.h"
+#include "util/numeric.h"
+#include "util/serialize.h"
+
+static const u8 GENERATED_IMAGE_FILE_VERSION = 2;
+
+GeneratedImageCache::GeneratedImageCache(video::IVideoDriver *driver,
+		const std::string &disk_dir, const std::string &settings_key,
+		u64 disk_max_bytes):
+	m_driver(driver),
+	m_disk_dir(disk_dir),
+	m_disk(disk_dir),
+	m_settings_key(settings_key),
+	m_disk_max_bytes(disk_max_bytes)
+{
+	if (m_disk_dir.empty())
+		return;
+	if (!fs::CreateAllDirs(m_disk_dir)) {
+		errorstream << "GeneratedImageCache: Could not create "
+				<< m_disk_dir << std::endl;
+		m_disk_dir.clear();
+		return;
+	}
+	trimDisk();
+}
+
+GeneratedImageCache::~GeneratedImageCache()
+{
+	infostream << "GeneratedImageCache: " << m_hits_memory
+			<< " hits in memory, " << m_hits_disk << " hits on disk, "
+			<< m_misses << " misses" << std::endl;
+	for (auto &entry : m_entries)
+		entry.second.image->drop();
+}
+
+video::IImage *GeneratedImageCache::get(const std::string &name,
+		ISourceImageHashes &sources, std::vector<std::string> &source_names)
+{
+	auto it = m_entries.find(name);
+	if (it != m_entries.end()) {
+		Entry &entry = it->second;
+		if (sourcesMatch(entry.sources, sources)) {
+			m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+			for (const auto &source : entry.sources)
+				source_names.push_back(source.first);
+			m_hits_memory++;
+			return copyImage(entry.image);
+		}
+		erase(it);
+	}
+
+	if (!m_disk_dir.empty()) {
+		SourceHashes hashes;
+		video::IImage *img = load(name, hashes);
+		if (img && sourcesMatch(hashes, sources)) {
+			add(name, img, hashes);
+			for (const auto &source : hashes)
+				source_names.push_back(source.first);
+			m_hits_disk++;
+			return copyImage(img);
+		}
+		if (img)
+			img->drop();
+	}
+
+	m_misses++;
+	return NULL;
+}
+
+void GeneratedImageCache::insert(const std::string &name, video::IImage *img,
+		ISourceImageHashes &sources, const std::vector<std::string> &source_names,
+		size_t sources_begin, bool to_disk)
+{
+	SourceHashes hashes;
+	for (size_t i = sources_begin; i < source_names.size(); i++) {
+		const std::string &source = source_names[i];
+		bool known = false;
+		for (const auto &hash : hashes)
+			known |= hash.first == source;
+		if (!known)
+			hashes.emplace_back(source, sources.getSourceHash(source));
+	}
+
+	auto it = m_entries.find(name);
+	if (it != m_entries.end())
+		erase(it);
+	add(name, copyImage(img), hashes);
+
+	if (to_disk && !m_disk_dir.empty())
+		save(name, img, hashes);
+}
+
+bool GeneratedImageCache::sourcesMatch(const SourceHashes &hashes,
+		ISourceImageHashes &sources)
+{
+	for (const auto &hash : hashes) {
+		if (sources.getSourceHash(hash.first) != hash.second)
+			return false;
+	}
+	return true;
+}
+
+std::string GeneratedImageCache::getFileName(const std::string &name) const
+{
+	std::string key = m_settings_key + name;
+	std::ostringstream os;
+	os << std::hex << std::setw(16) << std::setfill('0')
+			<< murmur_hash_64_ua(key.data(), (int)key.size(), 0x1337);
+	return os.str();
+}
+
+video::IImage *GeneratedImageCache::copyImage(video::IImage *img)
+{
+	video::IImage *copy = m_driver->createImage(img->getColorFormat(),
+			img->getDimension());
+	img->copyTo(copy);
+	return copy;
+}
+
+// Takes over the reference to img
+void GeneratedImageCache::add(const std::string &name, video::IImage *img,
+		const SourceHashes &hashes)
+{
+	m_lru.push_front(name);
+	Entry &entry = m_entries[name];
+	entry.image = img;
+	entry.sources = hashes;
+	entry.lru_it = m_lru.begin();
+	m_bytes += img->getImageDataSizeInBytes();
+
+	while (m_bytes > MAX_BYTES && m_lru.size() > 1)
+		erase(m_entries.find(m_lru.back()));
+}
+
+void GeneratedImageCache::erase(
+		std::unordered_map<std::string, Entry>::iterator it)
+{
+	m_bytes -= it->second.image->getImageDataSizeInBytes();
+	it->second.image->drop();
+	m_lru.erase(it->second.lru_it);
+	m_entries.erase(it);
+}
+
+void GeneratedImageCache::trimDisk()
+{
+	struct DiskFile
+	{
+		std::string path;
+		u64 size;
+		u64 mtime;
+	};
+
+	std::vector<DiskFile> files;
+	u64 total_bytes = 0;
+	for (const fs::DirListNode &node : fs::GetDirListing(m_disk_dir)) {
+		if (node.dir)
+			continue;
+		DiskFile file;
+		file.path = m_disk_dir + DIR_DELIM + node.name;
+		if (!fs::GetFileInfo(file.path, &file.size, &file.mtime))
+			continue;
+		total_bytes += file.size;
+		files.push_back(std::move(file));
+	}
+	m_disk_bytes = total_bytes;
+	if (total_bytes <= m_disk_max_bytes)
+		return;
+
+	std::sort(files.begin(), files.end(),
+		[] (const DiskFile &a, const DiskFile &b) {
+			return a.mtime < b.mtime;
+		});
+
+	const u64 target_bytes = m_disk_max_bytes / 4 * 3;
+	u32 deleted = 0;
+	for (const DiskFile &file : files) {
+		if (total_bytes <= target_bytes)
+			break;
+		if (!fs::DeleteSingleFileOrEmptyDirectory(file.path))
+			continue;
+		total_bytes -= file.size;
+		deleted++;
+	}
+	m_disk_bytes = total_bytes;
+	infostream << "GeneratedImageCache: Deleted " << deleted
+			<< " old files from " << m_disk_dir << ", "
+			<< total_bytes / 1024 << " KiB left" << std::endl;
+}
+
+video::IImage *GeneratedImageCache::load(const std::string &name,
+		SourceHashes &hashes)
+{
+	std::ostringstream file(std::ios::binary);
+	if (!m_disk.load(getFileName(name), file))
+		return NULL;
+
+	std::istringstream is(file.str(), std::ios::binary);
+	try {
+		if (readU8(is) != GENERATED_IMAGE_FILE_VERSION)
+			return NULL;
+		// Other settings or another name with the same file name
+		if (deSerializeString(is) != m_settings_key ||
+				deSerializeLongString(is) != name)
+			return NULL;
+
+		u16 count = readU16(is);
+		for (u16 i = 0; i < count; i++) {
+			std::string source = deSerializeString(is);
+			hashes.emplace_back(source, readU64(is));
+		}
+
+		core::dimension2d<u32> dim;
+		dim.Width = readU32(is);
+		dim.Height = readU32(is);
+		u8 format = readU8(is);
+		if (!is.good() || format > video::ECF_A8R8G8B8 ||
+				dim.Width == 0 || dim.Width > 0x4000 ||
+				dim.Height == 0 || dim.Height > 0x4000)
+			return NULL;
+
+		std::ostringstream pixels(std::ios::binary);
+		decompressZlib(is, pixels);
+		const std::string &data = pixels.str();
+
+		video::IImage *img = m_driver->createImage(
+				(video::ECOLOR_FORMAT)format, dim);
+		if (data.size() != img->getImageDataSizeInBytes()) {
+			img->drop();
+			return NULL;
+		}
+		memcpy(img->lock(), data.c_str(), data.size());
+		img->unlock();
+		return img;
+	} catch (SerializationError &e) {
+		warningstream << "GeneratedImageCache: Ignoring broken file for \""
+				<< name << "\": " << e.what() << std::endl;
+		return NULL;
+	}
+}
+
+void GeneratedImageCache::save(const std::string &name, video::IImage *img,
+		const SourceHashes &hashes)
+{
+	if (hashes.size() > U16_MAX)
+		return;
+
+	std::ostringstream os(std::ios::binary);
+	writeU8(os, GENERATED_IMAGE_FILE_VERSION);
+	os << serializeString(m_settings_key);
+	os << serializeLongString(name);
+	writeU16(os, hashes.size());
+	for (const auto &hash : hashes) {
+		os << serializeString(hash.first);
+		writeU64(os, hash.second);
+	}
+
+	core::dimension2d<u32> dim = img->getDimension();
+	writeU32(os, dim.Width);
+	writeU32(os, dim.Height);
+	writeU8(os, img->getColorFormat());
+	// Fast compression, the images are written while joining
+	compressZlib((const u8 *)img->lock(), img->getImageDataSizeInBytes(), os, 1);
+	img->unlock();
+
+	const std::string &data = os.str();
+	if (!m_disk.update(getFileName(name), data))
+		return;
+
+	m_disk_bytes += data.size();
+	if (m_disk_bytes > m_disk_max_bytes)
+		trimDisk();
+}
@@ -0,0 +1,125 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include "irrlichttypes_extrabloated.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "filecache.h"
+
+/*
+	Tells which version of a source image is in use
+*/
+class ISourceImageHashes
+{
+public:
+	virtual ~ISourceImageHashes() = default;
+
+	// Hash of the file the source image was read from, 0 if there is none.
+	// Must not decode the image.
+	virtual u64 getSourceHash(const std::string &name) = 0;
+};
+
+/*
+	GeneratedImageCache: Images made from texture modifier strings, in
+	memory and optionally on disk. An image is only used while the source
+	images it was made from have the same hashes as back then.
+*/
+class GeneratedImageCache
+{
+public:
+	// Memory used by the images, beyond this the least recently used go
+	static const size_t MAX_BYTES = 64 * 1024 * 1024;
+
+	/*
+		Disk storage is off if disk_dir is empty. settings_key describes
+		the settings that change the result of texture modifiers, the disk
+		entries of other settings are not used. Whenever the files on disk
+		grow beyond disk_max_bytes, the ones written longest ago are deleted.
+	*/
+	GeneratedImageCache(video::IVideoDriver *driver, const std::string &disk_dir,
+			const std::string &settings_key, u64 disk_max_bytes);
+	~GeneratedImageCache();
+
+	/*
+		Returns a copy of the image made from name, to be dropped, or NULL
+		if there is none with unchanged sources. The names of the sources
+		are appended to source_names.
+	*/
+	video::IImage *get(const std::string &name, ISourceImageHashes &sources,
+			std::vector<std::string> &source_names);
+
+	/*
+		Adds an image made from name. The sources are the names from
+		source_names, starting at sources_begin.
+	*/
+	void insert(const std::string &name, video::IImage *img,
+			ISourceImageHashes &sources,
+			const std::vector<std::string> &source_names,
+			size_t sources_begin, bool to_disk);
+
+private:
+	// Source image names and their ISourceImageHashes::getSourceHash()
+	typedef std::vector<std::pair<std::string, u64>> SourceHashes;
+
+	struct Entry
+	{
+		video::IImage *image;
+		SourceHashes sources;
+		std::list<std::string>::iterator lru_it;
+	};
+
+	static bool sourcesMatch(const SourceHashes &hashes,
+			ISourceImageHashes &sources);
+	std::string getFileName(const std::string &name) const;
+	video::IImage *copyImage(video::IImage *img);
+
+	void add(const std::string &name, video::IImage *img,
+			const SourceHashes &hashes);
+	void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+	// Deletes the files written longest ago until the rest take three
+	// quarters of m_disk_max_bytes, so that not every write lists the
+	// directory again
+	void trimDisk();
+	video::IImage *load(const std::string &name, SourceHashes &hashes);
+	void save(const std::string &name, video::IImage *img,
+			const SourceHashes &hashes);
+
+	video::IVideoDriver *m_driver;
+
+	std::string m_disk_dir;
+	FileCache m_disk;
+	std::string m_settings_key;
+	u64 m_disk_max_bytes;
+	// Size of the files on disk, counted up by save() between trims
+	u64 m_disk_bytes = 0;
+
+	std::unordered_map<std::string, Entry> m_entries;
+	// Most recently used first
+	std::list<std::string> m_lru;
+	size_t m_bytes = 0;
+
+	u32 m_hits_memory = 0;
+	u32 m_hits_disk = 0;
+	u32 m_misses = 0;
+};
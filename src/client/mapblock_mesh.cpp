@@ -27,6 +27,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "minimap.h"
 #include "content_mapblock.h"
 #include "util/directiontables.h"
+#include "util/numeric.h"
 #include "client/meshgen/collector.h"
 #include "client/renderingengine.h"
 #include <array>
@@ -37,7 +38,16 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 MeshMakeData::MeshMakeData(Client *client, bool use_shaders,
 		bool use_tangent_vertices):
-	m_client(client),
+	MeshMakeData(client->ndef(), client->getTextureSource(),
+		client->getShaderSource(), use_shaders, use_tangent_vertices)
+{}
+
+MeshMakeData::MeshMakeData(const NodeDefManager *nodedef,
+		ITextureSource *tsrc, IShaderSource *shdsrc, bool use_shaders,
+		bool use_tangent_vertices):
+	m_nodedef(nodedef),
+	m_tsrc(tsrc),
+	m_shdsrc(shdsrc),
 	m_use_shaders(use_shaders),
 	m_use_tangent_vertices(use_tangent_vertices)
 {}
@@ -49,6 +59,13 @@ void MeshMakeData::fillBlockDataBegin(const v3s16 &blockpos)
 	v3s16 blockpos_nodes = m_blockpos*MAP_BLOCKSIZE;
 
 	m_vmanip.clear();
+	if (m_lod > 1) {
+		// The blocks of the group and the next block along each axis
+		VoxelArea voxel_area(blockpos_nodes, blockpos_nodes +
+				v3s16(1,1,1) * MAP_BLOCKSIZE * (m_lod + 1) - v3s16(1,1,1));
+		m_vmanip.addArea(voxel_area);
+		return;
+	}
 	VoxelArea voxel_area(blockpos_nodes - v3s16(1,1,1) * MAP_BLOCKSIZE,
 			blockpos_nodes + v3s16(1,1,1) * MAP_BLOCKSIZE*2-v3s16(1,1,1));
 	m_vmanip.addArea(voxel_area);
@@ -108,6 +125,33 @@ void MeshMakeData::fillSingleNode(MapNode *node)
 	delete[] data;
 }
 
+u64 MeshMakeData::getHash()
+{
+	const v3s16 blockpos_nodes = m_blockpos * MAP_BLOCKSIZE;
+	// Far meshes read no previous nodes, but the first m_lod layers of the
+	// next blocks
+	const s16 first = m_lod > 1 ? 0 : -1;
+	const s16 last = MAP_BLOCKSIZE * m_lod + m_lod - 1;
+	const s32 side = last - first + 1;
+	std::vector<MapNode> nodes;
+	nodes.reserve(side * side * side);
+
+	v3s16 p;
+	for (p.Z = first; p.Z <= last; p.Z++)
+	for (p.Y = first; p.Y <= last; p.Y++)
+	for (p.X = first; p.X <= last; p.X++) {
+		// Nodes without data read as CONTENT_IGNORE
+		nodes.push_back(m_vmanip.getNodeRefUnsafeCheckFlags(blockpos_nodes + p));
+	}
+
+	u64 hash = murmur_hash_64_ua(nodes.data(), nodes.size() * sizeof(MapNode),
+			0x1337 + m_smooth_lighting + (m_lod << 1));
+	// The crack is drawn into the mesh
+	hash ^= murmur_hash_64_ua(&m_crack_pos_relative, sizeof(v3s16), 0x1337) +
+			0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	return hash ? hash : 1;
+}
+
 void MeshMakeData::setCrack(int crack_level, v3s16 crack_pos)
 {
 	if (crack_level >= 0)
@@ -119,6 +163,12 @@ void MeshMakeData::setSmoothLighting(bool smooth_lighting)
 	m_smooth_lighting = smooth_lighting;
 }
 
+void MeshMakeData::setLod(u16 lod)
+{
+	assert(lod == 1 || lod == 2 || lod == 4);
+	m_lod = lod;
+}
+
 /*
 	Light and vertex color functions
 */
@@ -190,7 +240,7 @@ u16 getFaceLight(MapNode n, MapNode n2, const v3s16 &face_dir,
 static u16 getSmoothLightCombined(const v3s16 &p,
 	const std::array<v3s16,8> &dirs, MeshMakeData *data)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_nodedef;
 
 	u16 ambient_occlusion = 0;
 	u16 light_count = 0;
@@ -461,8 +511,13 @@ struct FastFace
 	bool vertex_0_2_connected;
 };
 
+/*
+	tex_scale: number of texture repetitions along the horizontal and the
+	vertical texture axis of the face
+*/
 static void makeFastFace(const TileSpec &tile, u16 li0, u16 li1, u16 li2, u16 li3,
-	const v3f &tp, const v3f &p, const v3s16 &dir, const v3f &scale, std::vector<FastFace> &dest)
+	const v3f &tp, const v3f &p, const v3s16 &dir, const v3f &scale,
+	const v2f &tex_scale, std::vector<FastFace> &dest)
 {
 	// Position is at the center of the cube.
 	v3f pos = p * BS;
@@ -604,11 +659,6 @@ static void makeFastFace(const TileSpec &tile, u16 li0, u16 li1, u16 li2, u16 li
 		vpos += pos;
 	}
 
-	f32 abs_scale = 1.0f;
-	if      (scale.X < 0.999f || scale.X > 1.001f) abs_scale = scale.X;
-	else if (scale.Y < 0.999f || scale.Y > 1.001f) abs_scale = scale.Y;
-	else if (scale.Z < 0.999f || scale.Z > 1.001f) abs_scale = scale.Z;
-
 	v3f normal(dir.X, dir.Y, dir.Z);
 
 	u16 li[4] = { li0, li1, li2, li3 };
@@ -624,10 +674,10 @@ static void makeFastFace(const TileSpec &tile, u16 li0, u16 li1, u16 li2, u16 li
 			< abs(day[1] - day[3]) + abs(night[1] - night[3]);
 
 	v2f32 f[4] = {
-		core::vector2d<f32>(x0 + w * abs_scale, y0 + h),
-		core::vector2d<f32>(x0, y0 + h),
+		core::vector2d<f32>(x0 + w * tex_scale.X, y0 + h * tex_scale.Y),
+		core::vector2d<f32>(x0, y0 + h * tex_scale.Y),
 		core::vector2d<f32>(x0, y0),
-		core::vector2d<f32>(x0 + w * abs_scale, y0) };
+		core::vector2d<f32>(x0 + w * tex_scale.X, y0) };
 
 	// equivalent to dest.push_back(FastFace()) but faster
 	dest.emplace_back();
@@ -706,7 +756,7 @@ static u8 face_contents(content_t m1, content_t m2, bool *equivalent,
 */
 void getNodeTileN(MapNode mn, const v3s16 &p, u8 tileindex, MeshMakeData *data, TileSpec &tile)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_nodedef;
 	const ContentFeatures &f = ndef->get(mn);
 	tile = f.tiles[tileindex];
 	bool has_crack = p == data->m_crack_pos_relative;
@@ -726,7 +776,7 @@ void getNodeTileN(MapNode mn, const v3s16 &p, u8 tileindex, MeshMakeData *data,
 */
 void getNodeTile(MapNode mn, const v3s16 &p, const v3s16 &dir, MeshMakeData *data, TileSpec &tile)
 {
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_nodedef;
 
 	// Direction must be (1,0,0), (-1,0,0), (0,1,0), (0,-1,0),
 	// (0,0,1), (0,0,-1) or (0,0,0)
@@ -800,7 +850,7 @@ static void getTileInfo(
 	)
 {
 	VoxelManipulator &vmanip = data->m_vmanip;
-	const NodeDefManager *ndef = data->m_client->ndef();
+	const NodeDefManager *ndef = data->m_nodedef;
 	v3s16 blockpos_nodes = data->m_blockpos * MAP_BLOCKSIZE;
 
 	const MapNode &n0 = vmanip.getNodeRefUnsafe(blockpos_nodes + p);
@@ -865,147 +915,298 @@ static void getTileInfo(
 	}
 }
 
+struct FastFaceInfo
+{
+	bool makes_face = false;
+	// Set once the face is part of a generated FastFace
+	bool used = false;
+	v3s16 p_corrected;
+	v3s16 face_dir_corrected;
+	u16 lights[4] = {0, 0, 0, 0};
+	u8 waving = 0;
+	TileSpec tile;
+};
+
 /*
-	startpos:
-	translate_dir: unit vector with only one of x, y or z
-	face_dir: unit vector with only one of x, y or z
+	Whether the face of other can be drawn together with the face of first
+	at offset of the nodes.
 */
-static void updateFastFaceRow(
-		MeshMakeData *data,
-		const v3s16 &&startpos,
-		v3s16 translate_dir,
-		const v3f &&translate_dir_f,
-		const v3s16 &&face_dir,
-		std::vector<FastFace> &dest)
+static bool canMergeFaces(const FastFaceInfo &first, const FastFaceInfo &other,
+		const v3s16 &offset)
 {
 	static thread_local const bool waving_liquids =
 		g_settings->getBool("enable_shaders") &&
 		g_settings->getBool("enable_waving_water");
 
-	v3s16 p = startpos;
+	return other.makes_face && !other.used
+			&& other.p_corrected == first.p_corrected + offset
+			&& other.face_dir_corrected == first.face_dir_corrected
+			&& memcmp(other.lights, first.lights, ARRLEN(first.lights) * sizeof(u16)) == 0
+			// Don't apply fast faces to waving water.
+			&& (first.waving != 3 || !waving_liquids)
+			&& (other.waving != 3 || !waving_liquids)
+			&& other.tile.isTileable(first.tile);
+}
 
-	u16 continuous_tiles_count = 1;
+/*
+	Generates the faces between the nodes of a slice of the block and their
+	neighbours in face_dir. Adjacent faces with the same tile and lighting
+	are merged into rectangles, extending along translate_dir first. The
+	texture is repeated over the rectangle by the texture coordinates.
+
+	startpos: first node of the slice
+	translate_dir: unit vector with only one of x, y or z, the horizontal
+	               texture axis of the faces
+	slice_dir: unit vector with only one of x, y or z, the vertical
+	           texture axis of the faces
+	face_dir: unit vector with only one of x, y or z
+*/
+static void updateFastFaceSlice(
+		MeshMakeData *data,
+		const v3s16 &startpos,
+		const v3s16 &translate_dir,
+		const v3s16 &slice_dir,
+		const v3s16 &face_dir,
+		std::vector<FastFaceInfo> &infos,
+		std::vector<FastFace> &dest)
+{
+	// infos[v * MAP_BLOCKSIZE + u]
+	infos.resize(MAP_BLOCKSIZE * MAP_BLOCKSIZE);
+	for (u16 v = 0; v < MAP_BLOCKSIZE; v++)
+	for (u16 u = 0; u < MAP_BLOCKSIZE; u++) {
+		FastFaceInfo &info = infos[v * MAP_BLOCKSIZE + u];
+		info.used = false;
+		getTileInfo(data, startpos + translate_dir * u + slice_dir * v, face_dir,
+				info.makes_face, info.p_corrected, info.face_dir_corrected,
+				info.lights, info.waving, info.tile);
+	}
 
-	bool makes_face = false;
-	v3s16 p_corrected;
-	v3s16 face_dir_corrected;
-	u16 lights[4] = {0, 0, 0, 0};
-	u8 waving;
-	TileSpec tile;
-	getTileInfo(data, p, face_dir,
-			makes_face, p_corrected, face_dir_corrected,
-			lights, waving, tile);
-
-	// Unroll this variable which has a significant build cost
-	TileSpec next_tile;
-	for (u16 j = 0; j < MAP_BLOCKSIZE; j++) {
-		// If tiling can be done, this is set to false in the next step
-		bool next_is_different = true;
-
-		v3s16 p_next;
-
-		bool next_makes_face = false;
-		v3s16 next_p_corrected;
-		v3s16 next_face_dir_corrected;
-		u16 next_lights[4] = {0, 0, 0, 0};
-
-		// If at last position, there is nothing to compare to and
-		// the face must be drawn anyway
-		if (j != MAP_BLOCKSIZE - 1) {
-			p_next = p + translate_dir;
-
-			getTileInfo(data, p_next, face_dir,
-					next_makes_face, next_p_corrected,
-					next_face_dir_corrected, next_lights,
-					waving,
-					next_tile);
-
-			if (next_makes_face == makes_face
-					&& next_p_corrected == p_corrected + translate_dir
-					&& next_face_dir_corrected == face_dir_corrected
-					&& memcmp(next_lights, lights, ARRLEN(lights) * sizeof(u16)) == 0
-					// Don't apply fast faces to waving water.
-					&& (waving != 3 || !waving_liquids)
-					&& next_tile.isTileable(tile)) {
-				next_is_different = false;
-				continuous_tiles_count++;
-			}
+	for (u16 v = 0; v < MAP_BLOCKSIZE; v++)
+	for (u16 u = 0; u < MAP_BLOCKSIZE; u++) {
+		FastFaceInfo &first = infos[v * MAP_BLOCKSIZE + u];
+		if (!first.makes_face || first.used)
+			continue;
+		first.used = true;
+
+		// Extend along the row
+		u16 width = 1;
+		while (u + width < MAP_BLOCKSIZE && canMergeFaces(first,
+				infos[v * MAP_BLOCKSIZE + u + width], translate_dir * width)) {
+			infos[v * MAP_BLOCKSIZE + u + width].used = true;
+			width++;
 		}
-		if (next_is_different) {
-			/*
-				Create a face if there should be one
-			*/
-			if (makes_face) {
-				// Floating point conversion of the position vector
-				v3f pf(p_corrected.X, p_corrected.Y, p_corrected.Z);
-				// Center point of face (kind of)
-				v3f sp = pf - ((f32)continuous_tiles_count * 0.5f - 0.5f)
-					* translate_dir_f;
-				v3f scale(1, 1, 1);
-
-				if (translate_dir.X != 0)
-					scale.X = continuous_tiles_count;
-				if (translate_dir.Y != 0)
-					scale.Y = continuous_tiles_count;
-				if (translate_dir.Z != 0)
-					scale.Z = continuous_tiles_count;
-
-				makeFastFace(tile, lights[0], lights[1], lights[2], lights[3],
-						pf, sp, face_dir_corrected, scale, dest);
-				g_profiler->avg("Meshgen: Tiles per face [#]", continuous_tiles_count);
-			}
 
-			continuous_tiles_count = 1;
+		// Extend over the next rows as long as they match the whole width.
+		// World aligned textures are only merged along the row.
+		u16 height = 1;
+		while (!first.tile.world_aligned && v + height < MAP_BLOCKSIZE) {
+			bool row_matches = true;
+			for (u16 i = 0; i < width && row_matches; i++)
+				row_matches = canMergeFaces(first,
+						infos[(v + height) * MAP_BLOCKSIZE + u + i],
+						translate_dir * i + slice_dir * height);
+			if (!row_matches)
+				break;
+			for (u16 i = 0; i < width; i++)
+				infos[(v + height) * MAP_BLOCKSIZE + u + i].used = true;
+			height++;
 		}
 
-		makes_face = next_makes_face;
-		p_corrected = next_p_corrected;
-		face_dir_corrected = next_face_dir_corrected;
-		std::memcpy(lights, next_lights, ARRLEN(lights) * sizeof(u16));
-		if (next_is_different)
-			tile = next_tile;
-		p = p_next;
+		// Floating point conversion of the position of the last node
+		v3s16 p_last = first.p_corrected + translate_dir * (width - 1) +
+				slice_dir * (height - 1);
+		v3f pf(p_last.X, p_last.Y, p_last.Z);
+		// Center point of face (kind of)
+		v3f sp = pf - intToFloat(translate_dir * (width - 1) +
+				slice_dir * (height - 1), 0.5f);
+		v3f scale(1, 1, 1);
+		v3s16 extent = translate_dir * width + slice_dir * height;
+		if (translate_dir.X != 0 || slice_dir.X != 0)
+			scale.X = extent.X;
+		if (translate_dir.Y != 0 || slice_dir.Y != 0)
+			scale.Y = extent.Y;
+		if (translate_dir.Z != 0 || slice_dir.Z != 0)
+			scale.Z = extent.Z;
+
+		makeFastFace(first.tile, first.lights[0], first.lights[1],
+				first.lights[2], first.lights[3], pf, sp,
+				first.face_dir_corrected, scale, v2f(width, height), dest);
+		g_profiler->avg("Meshgen: Tiles per face [#]", width * height);
 	}
 }
 
 static void updateAllFastFaceRows(MeshMakeData *data,
 		std::vector<FastFace> &dest)
 {
+	std::vector<FastFaceInfo> infos;
+
 	/*
-		Go through every y,z and get top(y+) faces in rows of x+
+		Go through every y and get top(y+) faces in rows of x+, z+
 	*/
 	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
-	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
-		updateFastFaceRow(data,
-				v3s16(0, y, z),
+		updateFastFaceSlice(data,
+				v3s16(0, y, 0),
 				v3s16(1, 0, 0), //dir
-				v3f  (1, 0, 0),
+				v3s16(0, 0, 1), //slice dir
 				v3s16(0, 1, 0), //face dir
-				dest);
+				infos, dest);
 
 	/*
-		Go through every x,y and get right(x+) faces in rows of z+
+		Go through every x and get right(x+) faces in rows of z+, y+
 	*/
 	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
-	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
-		updateFastFaceRow(data,
-				v3s16(x, y, 0),
+		updateFastFaceSlice(data,
+				v3s16(x, 0, 0),
 				v3s16(0, 0, 1), //dir
-				v3f  (0, 0, 1),
+				v3s16(0, 1, 0), //slice dir
 				v3s16(1, 0, 0), //face dir
-				dest);
+				infos, dest);
 
 	/*
-		Go through every y,z and get back(z+) faces in rows of x+
+		Go through every z and get back(z+) faces in rows of x+, y+
 	*/
 	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
-	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
-		updateFastFaceRow(data,
-				v3s16(0, y, z),
+		updateFastFaceSlice(data,
+				v3s16(0, 0, z),
 				v3s16(1, 0, 0), //dir
-				v3f  (1, 0, 0),
+				v3s16(0, 1, 0), //slice dir
 				v3s16(0, 0, 1), //face dir
-				dest);
+				infos, dest);
+}
+
+/*
+	A cube of m_lod * m_lod * m_lod nodes of a far mesh
+*/
+struct LodCell
+{
+	// Node drawn for the whole cell, CONTENT_IGNORE if there is no data
+	MapNode node = MapNode(CONTENT_IGNORE);
+	// getLodRank() of node
+	u8 rank = 0;
+	// Node the light of the faces next to the cell is taken from
+	MapNode light_node = MapNode(CONTENT_IGNORE);
+};
+
+/*
+	How well a node hides what is behind it: 3 for solid nodes, 2 for
+	leaves and glass, 1 for liquid sources and 0 for everything that far
+	meshes leave out.
+*/
+static u8 getLodRank(const ContentFeatures &f)
+{
+	if (f.solidness == 2)
+		return 3;
+	if (f.visual_solidness != 0)
+		return 2;
+	return f.solidness;
+}
+
+static void getLodCell(MeshMakeData *data, const v3s16 &origin, LodCell &cell)
+{
+	VoxelManipulator &vmanip = data->m_vmanip;
+	const NodeDefManager *ndef = data->m_nodedef;
+	const s16 lod = data->m_lod;
+	bool has_light = false;
+
+	// Top down, so that the surface is drawn of cells with several nodes
+	// of the same rank
+	v3s16 p;
+	for (p.Y = origin.Y + lod - 1; p.Y >= origin.Y; p.Y--)
+	for (p.Z = origin.Z; p.Z < origin.Z + lod; p.Z++)
+	for (p.X = origin.X; p.X < origin.X + lod; p.X++) {
+		const MapNode &n = vmanip.getNodeRefUnsafeCheckFlags(p);
+		if (n.getContent() == CONTENT_IGNORE)
+			continue;
+
+		const ContentFeatures &f = ndef->get(n);
+		u8 rank = getLodRank(f);
+		if (cell.node.getContent() == CONTENT_IGNORE || rank > cell.rank) {
+			cell.node = n;
+			cell.rank = rank;
+		}
+		if (!has_light && f.light_propagates) {
+			cell.light_node = n;
+			has_light = true;
+		}
+	}
+
+	if (!has_light)
+		cell.light_node = cell.node;
+}
+
+/*
+	Generates the faces of a far mesh. The group of m_lod * m_lod * m_lod
+	blocks is divided into MAP_BLOCKSIZE cells of m_lod nodes per side, each
+	drawn as a cube of the node that hides the most of it. Faces are only
+	made between cells of different rank, and nodes that are not cube-like
+	are left out.
+*/
+static void updateLodFaces(MeshMakeData *data, std::vector<FastFace> &dest)
+{
+	const NodeDefManager *ndef = data->m_nodedef;
+	const s16 lod = data->m_lod;
+	const s16 cells = MAP_BLOCKSIZE;
+	// One more cell along each axis for the faces towards the next groups
+	const s16 side = cells + 1;
+	const v3s16 blockpos_nodes = data->m_blockpos * MAP_BLOCKSIZE;
+
+	std::vector<LodCell> grid(side * side * side);
+	auto cell_at = [&] (const v3s16 &c) -> LodCell & {
+		return grid[(c.Z * side + c.Y) * side + c.X];
+	};
+
+	v3s16 c;
+	for (c.Z = 0; c.Z < side; c.Z++)
+	for (c.Y = 0; c.Y < side; c.Y++)
+	for (c.X = 0; c.X < side; c.X++) {
+		// Cells past more than one side of the group are never used
+		if ((c.X == cells) + (c.Y == cells) + (c.Z == cells) > 1)
+			continue;
+		getLodCell(data, blockpos_nodes + c * lod, cell_at(c));
+	}
+
+	static const v3s16 face_dirs[3] = {
+		v3s16(0, 1, 0),
+		v3s16(1, 0, 0),
+		v3s16(0, 0, 1),
+	};
+	const v3f scale(lod, lod, lod);
+	const v2f tex_scale(lod, lod);
+
+	for (c.Z = 0; c.Z < cells; c.Z++)
+	for (c.Y = 0; c.Y < cells; c.Y++)
+	for (c.X = 0; c.X < cells; c.X++) {
+		const LodCell &cell0 = cell_at(c);
+		if (cell0.node.getContent() == CONTENT_IGNORE)
+			continue;
+
+		for (const v3s16 &face_dir : face_dirs) {
+			const LodCell &cell1 = cell_at(c + face_dir);
+			if (cell1.node.getContent() == CONTENT_IGNORE ||
+					cell0.rank == cell1.rank)
+				continue;
+
+			// The cell that hides more draws the face between both
+			bool first = cell0.rank > cell1.rank;
+			const LodCell &drawn = first ? cell0 : cell1;
+			v3s16 p = (first ? c : c + face_dir) * lod;
+			v3s16 dir = first ? face_dir : -face_dir;
+
+			TileSpec tile;
+			getNodeTile(drawn.node, p, dir, data, tile);
+			tile.emissive_light = ndef->get(drawn.node).light_source;
+
+			u16 light = getFaceLight(cell0.light_node, cell1.light_node,
+					face_dir, ndef);
+
+			v3s16 p_last = p + v3s16(lod - 1, lod - 1, lod - 1);
+			// Center of the cell
+			v3f center = intToFloat(p, 1.0f) + scale * 0.5f - v3f(0.5f);
+			makeFastFace(tile, light, light, light, light,
+					intToFloat(p_last, 1.0f), center, dir, scale, tex_scale,
+					dest);
+		}
+	}
 }
 
 static void applyTileColor(PreMeshBuffer &pmb)
@@ -1028,8 +1229,8 @@ static void applyTileColor(PreMeshBuffer &pmb)
 
 MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 	m_minimap_mapblock(NULL),
-	m_tsrc(data->m_client->getTextureSource()),
-	m_shdrsrc(data->m_client->getShaderSource()),
+	m_tsrc(data->m_tsrc),
+	m_shdrsrc(data->m_shdsrc),
 	m_animation_force_timer(0), // force initial animation
 	m_last_crack(-1),
 	m_last_daynight_ratio((u32) -1)
@@ -1040,7 +1241,8 @@ MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 	m_use_tangent_vertices = data->m_use_tangent_vertices;
 	m_enable_vbo = g_settings->getBool("enable_vbo");
 
-	if (g_settings->getBool("enable_minimap")) {
+	// The minimap is made of the meshes of single blocks
+	if (data->m_lod == 1 && g_settings->getBool("enable_minimap")) {
 		m_minimap_mapblock = new MinimapMapblock;
 		m_minimap_mapblock->getMinimapNodes(
 			&data->m_vmanip, data->m_blockpos * MAP_BLOCKSIZE);
@@ -1063,7 +1265,10 @@ MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 	{
 		// 4-23ms for MAP_BLOCKSIZE=16  (NOTE: probably outdated)
 		//TimeTaker timer2("updateAllFastFaceRows()");
-		updateAllFastFaceRows(data, fastfaces_new);
+		if (data->m_lod > 1)
+			updateLodFaces(data, fastfaces_new);
+		else
+			updateAllFastFaceRows(data, fastfaces_new);
 	}
 	// End of slow part
 
@@ -1093,9 +1298,10 @@ MapBlockMesh::MapBlockMesh(MeshMakeData *data, v3s16 camera_offset):
 		- flowing water
 		- fences
 		- whatever
+		Far meshes leave them out.
 	*/
 
-	{
+	if (data->m_lod == 1) {
 		MapblockMeshGenerator generator(data, &collector);
 		generator.generate();
 	}
@@ -27,6 +27,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 class Client;
 class IShaderSource;
+class NodeDefManager;
 
 /*
 	Mesh making stuff
@@ -42,16 +43,28 @@ struct MeshMakeData
 	v3s16 m_blockpos = v3s16(-1337,-1337,-1337);
 	v3s16 m_crack_pos_relative = v3s16(-1337,-1337,-1337);
 	bool m_smooth_lighting = false;
+	// Blocks along each side of the group a far mesh is made of, and nodes
+	// along each side of its cells. 1 for the mesh of a single block with
+	// full detail. The group starts at m_blockpos.
+	u16 m_lod = 1;
 
-	Client *m_client;
+	const NodeDefManager *m_nodedef;
+	ITextureSource *m_tsrc;
+	IShaderSource *m_shdsrc;
 	bool m_use_shaders;
 	bool m_use_tangent_vertices;
 
+	// Uses the definitions and sources of the client
 	MeshMakeData(Client *client, bool use_shaders,
 			bool use_tangent_vertices = false);
+	MeshMakeData(const NodeDefManager *nodedef, ITextureSource *tsrc,
+			IShaderSource *shdsrc, bool use_shaders,
+			bool use_tangent_vertices = false);
 
 	/*
-		Copy block data manually (to allow optimizations by the caller)
+		Copy block data manually (to allow optimizations by the caller).
+		Far meshes need the blocks from 0 to m_lod along each axis, call
+		setLod() first.
 	*/
 	void fillBlockDataBegin(const v3s16 &blockpos);
 	void fillBlockData(const v3s16 &block_offset, MapNode *data);
@@ -67,6 +80,12 @@ struct MeshMakeData
 	*/
 	void fillSingleNode(MapNode *node);
 
+	/*
+		Hash of the nodes the mesh is made from, the block and the nodes
+		next to it, and the other inputs of the mesh. Never 0.
+	*/
+	u64 getHash();
+
 	/*
 		Set the (node) position of a crack
 	*/
@@ -76,6 +95,11 @@ struct MeshMakeData
 		Enable or disable smooth lighting
 	*/
 	void setSmoothLighting(bool smooth_lighting);
+
+	/*
+		Set the level of detail, see m_lod. Must be 1, 2 or 4.
+	*/
+	void setLod(u16 lod);
 };
 
 /*
@@ -121,6 +145,15 @@ class MapBlockMesh
 		return p;
 	}
 
+	// Whether animate() changes the buffer
+	bool isBufferAnimated(u8 layer, u32 i) const
+	{
+		std::pair<u8, u32> key(layer, i);
+		return m_crack_materials.count(key) != 0 ||
+				m_animation_tiles.count(key) != 0 ||
+				m_daynight_diffs.count(key) != 0;
+	}
+
 	bool isAnimationForced() const
 	{
 		return m_animation_force_timer == 0;
@@ -0,0 +1,120 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <set>
+#include <sstream>
+#include <IImage.h>
+#include "mediadecodepool.h"
+#include "client.h"
+#include "filecache.h"
+#include "porting.h"
+#include "util/hex.h"
+#include "util/sha1.h"
+
+/*
+	DecodedMedia
+*/
+
+DecodedMedia::DecodedMedia(DecodedMedia &&other):
+	image(other.image),
+	sound(std::move(other.sound))
+{
+	other.image = nullptr;
+}
+
+DecodedMedia::~DecodedMedia()
+{
+	if (image)
+		image->drop();
+}
+
+/*
+	MediaDecodePool
+*/
+
+MediaDecodePool::MediaDecodePool(u16 num_threads) :
+	m_pool("MediaDecode", num_threads),
+	m_read_time(0),
+	m_checksum_time(0),
+	m_decode_time(0),
+	m_cache_write_time(0)
+{
+}
+
+void MediaDecodePool::run(Client *client, FileCache *cache,
+	std::vector<MediaFile> &files)
+{
+	m_write_cache.assign(files.size(), 0);
+	std::set<std::string> written;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (!files[i].from_cache)
+			m_write_cache[i] = written.insert(files[i].sha1).second;
+	}
+
+	// Files are handed out one by one, decoding one takes long enough
+	m_pool.run(files.size(), 1, [&] (size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			prepareFile(client, cache, files[i], m_write_cache[i]);
+	});
+}
+
+void MediaDecodePool::prepareFile(Client *client, FileCache *cache,
+	MediaFile &file, bool write_cache)
+{
+	u64 t0 = porting::getTimeUs();
+
+	if (file.from_cache) {
+		std::ostringstream os(std::ios_base::binary);
+		file.found = cache->load(hex_encode(file.sha1), os);
+		if (!file.found)
+			return;
+		file.data = os.str();
+	} else {
+		file.found = true;
+	}
+
+	u64 t1 = porting::getTimeUs();
+
+	// Compute actual checksum of data
+	{
+		SHA1 data_sha1_calculator;
+		data_sha1_calculator.addBytes(file.data.c_str(), file.data.size());
+		unsigned char *data_tmpdigest = data_sha1_calculator.getDigest();
+		file.data_sha1.assign((char *)data_tmpdigest, 20);
+		free(data_tmpdigest);
+	}
+
+	u64 t2 = porting::getTimeUs();
+
+	if (file.data_sha1 == file.sha1)
+		file.decoded = client->decodeMedia(file.data, file.name, file.media);
+
+	u64 t3 = porting::getTimeUs();
+
+	// Files that cannot be loaded are not cached
+	if (file.decoded && write_cache)
+		cache->update(hex_encode(file.sha1), file.data);
+
+	u64 t4 = porting::getTimeUs();
+
+	m_read_time += t1 - t0;
+	m_checksum_time += t2 - t1;
+	m_decode_time += t3 - t2;
+	m_cache_write_time += t4 - t3;
+}
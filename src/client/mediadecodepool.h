@@ -0,0 +1,113 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "irrlichttypes.h"
+#include "client/sound.h"
+#include "threading/workerpool.h"
+
+namespace irr { namespace video {
+	class IImage;
+} }
+
+class Client;
+class FileCache;
+
+// Result of Client::decodeMedia()
+struct DecodedMedia
+{
+	DecodedMedia() = default;
+	DecodedMedia(DecodedMedia &&other);
+	DecodedMedia(const DecodedMedia &) = delete;
+	DecodedMedia &operator=(const DecodedMedia &) = delete;
+	~DecodedMedia();
+
+	video::IImage *image = nullptr;
+	DecodedSound sound;
+};
+
+// A media file on its way from the media cache or the network to the client
+struct MediaFile
+{
+	MediaFile(const std::string &name_, const std::string &sha1_,
+			bool from_cache_):
+		name(name_),
+		sha1(sha1_),
+		from_cache(from_cache_)
+	{}
+
+	std::string name;
+	// Announced SHA1, raw
+	std::string sha1;
+	// Read by MediaDecodePool::run() if the file is from the cache
+	std::string data;
+	bool from_cache;
+
+	// Results of MediaDecodePool::run()
+	bool found = false;
+	// Actual SHA1 of data, raw
+	std::string data_sha1;
+	bool decoded = false;
+	DecodedMedia media;
+
+	// Set once the file has been loaded into the client
+	bool loaded = false;
+};
+
+/*
+	Prepares media files on a WorkerPool: reads them from the media cache,
+	checks their SHA1, decodes them with Client::decodeMedia() and writes
+	received files to the cache. Loading them into the client is left to the
+	main thread.
+*/
+class MediaDecodePool
+{
+public:
+	MediaDecodePool(u16 num_threads);
+	~MediaDecodePool();
+
+	void run(Client *client, FileCache *cache, std::vector<MediaFile> &files);
+
+	u16 getThreadCount() const { return m_pool.getThreadCount(); }
+
+	// Time spent in each stage, summed over all threads, in microseconds
+	u64 getReadTime() const { return m_read_time; }
+	u64 getChecksumTime() const { return m_checksum_time; }
+	u64 getDecodeTime() const { return m_decode_time; }
+	u64 getCacheWriteTime() const { return m_cache_write_time; }
+
+private:
+	void prepareFile(Client *client, FileCache *cache, MediaFile &file,
+			bool write_cache);
+
+	WorkerPool m_pool;
+
+	// Whether a received file is the first with its SHA1 in the job, only
+	// those are written to keep the threads from writing the same file
+	std::vector<u8> m_write_cache;
+
+	std::atomic<u64> m_read_time;
+	std::atomic<u64> m_checksum_time;
+	std::atomic<u64> m_decode_time;
+	std::atomic<u64> m_cache_write_time;
+};
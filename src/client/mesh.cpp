@@ -378,6 +378,37 @@ scene::SMesh* cloneMesh(scene::IMesh *src_mesh)
 	return dst_mesh;
 }
 
+bool mergeMeshBuffer(std::vector<std::pair<u8, scene::SMeshBuffer *>> &merged,
+		u8 layer, scene::IMeshBuffer *buf, bool transparent)
+{
+	if (transparent || buf->getVertexType() != video::EVT_STANDARD)
+		return false;
+
+	const video::SMaterial &material = buf->getMaterial();
+	scene::SMeshBuffer *dst = nullptr;
+	for (auto &candidate : merged) {
+		// Vertices are addressed by 16-bit indices
+		if (candidate.first == layer &&
+				candidate.second->getVertexCount() + buf->getVertexCount() <=
+					(u32)U16_MAX + 1 &&
+				candidate.second->Material.TextureLayer[0].Texture ==
+					material.TextureLayer[0].Texture &&
+				candidate.second->Material == material) {
+			dst = candidate.second;
+			break;
+		}
+	}
+	if (!dst) {
+		dst = new scene::SMeshBuffer();
+		dst->Material = material;
+		merged.emplace_back(layer, dst);
+	}
+
+	dst->append(buf->getVertices(), buf->getVertexCount(),
+			buf->getIndices(), buf->getIndexCount());
+	return true;
+}
+
 scene::IMesh* convertNodeboxesToMesh(const std::vector<aabb3f> &boxes,
 		const f32 *uv_coords, float expand)
 {
@@ -107,6 +107,15 @@ scene::IMeshBuffer* cloneMeshBuffer(scene::IMeshBuffer *mesh_buffer);
 */
 scene::SMesh* cloneMesh(scene::IMesh *src_mesh);
 
+/*
+	Appends buf to the first buffer in merged with the same layer and
+	material that still has room for its vertices, or else to a new buffer.
+	Only opaque buffers of standard vertices are merged, returns false for
+	the others. The buffers added to merged must be dropped by the caller.
+*/
+bool mergeMeshBuffer(std::vector<std::pair<u8, scene::SMeshBuffer *>> &merged,
+		u8 layer, scene::IMeshBuffer *buf, bool transparent);
+
 /*
 	Convert nodeboxes to mesh. Each tile goes into a different buffer.
 	boxes - set of nodeboxes to be converted into cuboids
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "settings.h"
 #include "profiler.h"
 #include "client.h"
+#include "clientmap.h"
 #include "mapblock.h"
 #include "map.h"
 
@@ -48,6 +49,18 @@ QueuedMeshUpdate::~QueuedMeshUpdate()
 	MeshUpdateQueue
 */
 
+// The blocks the mesh of the block or group at p is made from
+static void getMeshDataArea(v3s16 p, u16 lod, v3s16 &min, v3s16 &max)
+{
+	if (lod > 1) {
+		min = p;
+		max = p + v3s16(1, 1, 1) * lod;
+	} else {
+		min = p - v3s16(1, 1, 1);
+		max = p + v3s16(1, 1, 1);
+	}
+}
+
 MeshUpdateQueue::MeshUpdateQueue(Client *client):
 	m_client(client)
 {
@@ -72,7 +85,8 @@ MeshUpdateQueue::~MeshUpdateQueue()
 	}
 }
 
-void MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent)
+void MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
+		bool urgent, u16 lod)
 {
 	MutexAutoLock lock(m_mutex);
 
@@ -80,18 +94,19 @@ void MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool
 
 	/*
 		Cache the block data (force-update the center block, don't update the
-		neighbors but get them if they aren't already cached)
+		neighbors but get them if they aren't already cached). The blocks
+		of a group are all force-updated.
 	*/
 	std::vector<CachedMapBlockData*> cached_blocks;
 	size_t cache_hit_counter = 0;
-	cached_blocks.reserve(3*3*3);
-	v3s16 dp;
-	for (dp.X = -1; dp.X <= 1; dp.X++)
-	for (dp.Y = -1; dp.Y <= 1; dp.Y++)
-	for (dp.Z = -1; dp.Z <= 1; dp.Z++) {
-		v3s16 p1 = p + dp;
+	v3s16 area_min, area_max;
+	getMeshDataArea(p, lod, area_min, area_max);
+	v3s16 p1;
+	for (p1.X = area_min.X; p1.X <= area_max.X; p1.X++)
+	for (p1.Y = area_min.Y; p1.Y <= area_max.Y; p1.Y++)
+	for (p1.Z = area_min.Z; p1.Z <= area_max.Z; p1.Z++) {
 		CachedMapBlockData *cached_block;
-		if (dp == v3s16(0, 0, 0))
+		if (p1 == p || lod > 1)
 			cached_block = cacheBlock(map, p1, FORCE_UPDATE);
 		else
 			cached_block = cacheBlock(map, p1, SKIP_UPDATE_IF_ALREADY_CACHED,
@@ -102,23 +117,33 @@ void MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool
 			100.0f * cache_hit_counter / cached_blocks.size());
 
 	/*
-		Mark the block as urgent if requested
+		Mark the block as urgent if requested, far meshes never are
 	*/
-	if (urgent)
+	if (urgent && lod == 1)
 		m_urgents.insert(p);
 
+	u64 previous_hash;
+	if (lod > 1) {
+		previous_hash = m_client->getEnv().getClientMap()
+				.getLodMeshHash(p, lod);
+	} else {
+		MapBlock *block = map->getBlockNoCreateNoEx(p);
+		previous_hash = block ? block->mesh_data_hash : 0;
+	}
+
 	/*
 		Find if block is already in queue.
 		If it is, update the data and quit.
 	*/
 	for (QueuedMeshUpdate *q : m_queue) {
-		if (q->p == p) {
+		if (q->p == p && q->lod == lod) {
 			// NOTE: We are not adding a new position to the queue, thus
 			//       refcount_from_queue stays the same.
 			if(ack_block_to_server)
 				q->ack_block_to_server = true;
 			q->crack_level = m_client->getCrackLevel();
 			q->crack_pos = m_client->getCrackPos();
+			q->previous_hash = previous_hash;
 			return;
 		}
 	}
@@ -131,6 +156,8 @@ void MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool
 	q->ack_block_to_server = ack_block_to_server;
 	q->crack_level = m_client->getCrackLevel();
 	q->crack_pos = m_client->getCrackPos();
+	q->lod = lod;
+	q->previous_hash = previous_hash;
 	m_queue.push_back(q);
 
 	// This queue entry is a new reference to the cached blocks
@@ -145,18 +172,37 @@ QueuedMeshUpdate *MeshUpdateQueue::pop()
 {
 	MutexAutoLock lock(m_mutex);
 
+	// Urgent blocks go first, unless they are all being worked on
 	bool must_be_urgent = !m_urgents.empty();
+	std::vector<QueuedMeshUpdate*>::iterator found = m_queue.end();
 	for (std::vector<QueuedMeshUpdate*>::iterator i = m_queue.begin();
 			i != m_queue.end(); ++i) {
 		QueuedMeshUpdate *q = *i;
-		if(must_be_urgent && m_urgents.count(q->p) == 0)
+		if (m_inflight_blocks.count(std::make_pair(q->p, q->lod)) != 0)
 			continue;
-		m_queue.erase(i);
-		m_urgents.erase(q->p);
-		fillDataFromMapBlockCache(q);
-		return q;
+		if (!must_be_urgent || (q->lod == 1 && m_urgents.count(q->p) != 0)) {
+			found = i;
+			break;
+		}
+		if (found == m_queue.end())
+			found = i;
 	}
-	return NULL;
+	if (found == m_queue.end())
+		return NULL;
+
+	QueuedMeshUpdate *q = *found;
+	m_queue.erase(found);
+	if (q->lod == 1)
+		m_urgents.erase(q->p);
+	m_inflight_blocks.insert(std::make_pair(q->p, q->lod));
+	fillDataFromMapBlockCache(q);
+	return q;
+}
+
+void MeshUpdateQueue::done(v3s16 p, u16 lod)
+{
+	MutexAutoLock lock(m_mutex);
+	m_inflight_blocks.erase(std::make_pair(p, lod));
 }
 
 CachedMapBlockData* MeshUpdateQueue::cacheBlock(Map *map, v3s16 p, UpdateMode mode,
@@ -211,26 +257,31 @@ void MeshUpdateQueue::fillDataFromMapBlockCache(QueuedMeshUpdate *q)
 			m_cache_use_tangent_vertices);
 	q->data = data;
 
+	data->setLod(q->lod);
 	data->fillBlockDataBegin(q->p);
 
 	std::time_t t_now = std::time(0);
 
-	// Collect data for 3*3*3 blocks from cache
-	v3s16 dp;
-	for (dp.X = -1; dp.X <= 1; dp.X++)
-	for (dp.Y = -1; dp.Y <= 1; dp.Y++)
-	for (dp.Z = -1; dp.Z <= 1; dp.Z++) {
-		v3s16 p = q->p + dp;
+	// Collect data for the 3*3*3 blocks, or the blocks of the group, from
+	// cache
+	v3s16 area_min, area_max;
+	getMeshDataArea(q->p, q->lod, area_min, area_max);
+	v3s16 p;
+	for (p.X = area_min.X; p.X <= area_max.X; p.X++)
+	for (p.Y = area_min.Y; p.Y <= area_max.Y; p.Y++)
+	for (p.Z = area_min.Z; p.Z <= area_max.Z; p.Z++) {
 		CachedMapBlockData *cached_block = getCachedBlock(p);
 		if (cached_block) {
 			cached_block->refcount_from_queue--;
 			cached_block->last_used_timestamp = t_now;
 			if (cached_block->data)
-				data->fillBlockData(dp, cached_block->data);
+				data->fillBlockData(p - q->p, cached_block->data);
 		}
 	}
 
-	data->setCrack(q->crack_level, q->crack_pos);
+	// Far meshes leave out the crack
+	if (q->lod == 1)
+		data->setCrack(q->crack_level, q->crack_pos);
 	data->setSmoothLighting(m_cache_smooth_lighting);
 }
 
@@ -264,42 +315,110 @@ void MeshUpdateQueue::cleanupCache()
 }
 
 /*
-	MeshUpdateThread
+	MeshUpdateWorkerThread
 */
 
-MeshUpdateThread::MeshUpdateThread(Client *client):
+MeshUpdateWorkerThread::MeshUpdateWorkerThread(MeshUpdateQueue *queue_in,
+		MeshUpdateManager *manager, v3s16 *camera_offset):
 	UpdateThread("Mesh"),
-	m_queue_in(client)
+	m_queue_in(queue_in),
+	m_manager(manager),
+	m_camera_offset(camera_offset)
 {
 	m_generation_interval = g_settings->getU16("mesh_generation_interval");
 	m_generation_interval = rangelim(m_generation_interval, 0, 50);
 }
 
-void MeshUpdateThread::updateBlock(Map *map, v3s16 p, bool ack_block_to_server,
-		bool urgent)
-{
-	// Allow the MeshUpdateQueue to do whatever it wants
-	m_queue_in.addBlock(map, p, ack_block_to_server, urgent);
-	deferUpdate();
-}
-
-void MeshUpdateThread::doUpdate()
+void MeshUpdateWorkerThread::doUpdate()
 {
 	QueuedMeshUpdate *q;
-	while ((q = m_queue_in.pop())) {
+	while ((q = m_queue_in->pop())) {
 		if (m_generation_interval)
 			sleep_ms(m_generation_interval);
 		ScopeProfiler sp(g_profiler, "Client: Mesh making (sum)");
 
-		MapBlockMesh *mesh_new = new MapBlockMesh(q->data, m_camera_offset);
-
 		MeshUpdateResult r;
 		r.p = q->p;
-		r.mesh = mesh_new;
+		r.lod = q->lod;
 		r.ack_block_to_server = q->ack_block_to_server;
 
-		m_queue_out.push_back(r);
+		// Keep the current mesh if it was made from the same data
+		r.data_hash = q->data->getHash();
+		if (r.data_hash == q->previous_hash)
+			r.unchanged = true;
+		else
+			r.mesh = new MapBlockMesh(q->data, *m_camera_offset);
+
+		m_manager->putResult(r);
+		m_queue_in->done(q->p, q->lod);
 
 		delete q;
 	}
 }
+
+/*
+	MeshUpdateManager
+*/
+
+MeshUpdateManager::MeshUpdateManager(Client *client):
+	m_queue_in(client)
+{
+	int number_of_threads = rangelim(
+		g_settings->getS32("mesh_generation_threads"), 0, 8);
+	// If automatic, use half of the processors, the main thread and the
+	// local server need the rest
+	if (number_of_threads == 0)
+		number_of_threads = Thread::getNumberOfProcessors() / 2;
+	number_of_threads = MYMAX(number_of_threads, 1);
+	infostream << "MeshUpdateManager: using " << number_of_threads
+			<< " mesh generation threads" << std::endl;
+
+	for (int i = 0; i < number_of_threads; i++)
+		m_workers.emplace_back(new MeshUpdateWorkerThread(&m_queue_in, this,
+				&m_camera_offset));
+}
+
+void MeshUpdateManager::updateBlock(Map *map, v3s16 p, bool ack_block_to_server,
+		bool urgent, u16 lod)
+{
+	// Allow the MeshUpdateQueue to do whatever it wants
+	m_queue_in.addBlock(map, p, ack_block_to_server, urgent, lod);
+	deferUpdate();
+}
+
+void MeshUpdateManager::putResult(const MeshUpdateResult &r)
+{
+	m_queue_out.push_back(r);
+}
+
+void MeshUpdateManager::deferUpdate()
+{
+	for (auto &thread : m_workers)
+		thread->deferUpdate();
+}
+
+void MeshUpdateManager::start()
+{
+	for (auto &thread : m_workers)
+		thread->start();
+}
+
+void MeshUpdateManager::stop()
+{
+	for (auto &thread : m_workers)
+		thread->stop();
+}
+
+void MeshUpdateManager::wait()
+{
+	for (auto &thread : m_workers)
+		thread->wait();
+}
+
+bool MeshUpdateManager::isRunning()
+{
+	for (auto &thread : m_workers)
+		if (!thread->isRunning())
+			return false;
+	return true;
+}
@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #pragma once
 
 #include <ctime>
+#include <memory>
 #include <mutex>
 #include "mapblock_mesh.h"
 #include "threading/mutex_auto_lock.h"
@@ -43,6 +44,9 @@ struct QueuedMeshUpdate
 	bool urgent = false;
 	int crack_level = -1;
 	v3s16 crack_pos;
+	u16 lod = 1;
+	// Data hash of the current mesh when the update was queued
+	u64 previous_hash = 0;
 	MeshMakeData *data = nullptr; // This is generated in MeshUpdateQueue::pop()
 
 	QueuedMeshUpdate() = default;
@@ -66,13 +70,19 @@ class MeshUpdateQueue
 	~MeshUpdateQueue();
 
 	// Caches the block at p and its neighbors (if needed) and queues a mesh
-	// update for the block at p
-	void addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent);
+	// update for the block at p. With a lod above 1, queues the far mesh of
+	// the group of blocks starting at p instead, see MeshMakeData::m_lod.
+	void addBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent,
+			u16 lod = 1);
 
 	// Returned pointer must be deleted
-	// Returns NULL if queue is empty
+	// Returns NULL if queue is empty or all queued blocks are being worked
+	// on by other threads
 	QueuedMeshUpdate *pop();
 
+	// Marks the block returned by pop() as done, it may be popped again
+	void done(v3s16 p, u16 lod);
+
 	u32 size()
 	{
 		MutexAutoLock lock(m_mutex);
@@ -83,6 +93,9 @@ class MeshUpdateQueue
 	Client *m_client;
 	std::vector<QueuedMeshUpdate *> m_queue;
 	std::set<v3s16> m_urgents;
+	// Blocks and groups being meshed, by position and lod. Not handed out
+	// again so that an older mesh can not replace a newer one.
+	std::set<std::pair<v3s16, u16>> m_inflight_blocks;
 	std::map<v3s16, CachedMapBlockData *> m_cache;
 	std::mutex m_mutex;
 
@@ -102,30 +115,65 @@ class MeshUpdateQueue
 struct MeshUpdateResult
 {
 	v3s16 p = v3s16(-1338, -1338, -1338);
+	// Above 1 for the far mesh of a group of blocks, see MeshMakeData::m_lod
+	u16 lod = 1;
 	MapBlockMesh *mesh = nullptr;
 	bool ack_block_to_server = false;
+	// Hash of the data of the mesh, see MeshMakeData::getHash()
+	u64 data_hash = 0;
+	// The data did not change since the current mesh was made, no mesh
+	// was made
+	bool unchanged = false;
 
 	MeshUpdateResult() = default;
 };
 
-class MeshUpdateThread : public UpdateThread
+class MeshUpdateManager;
+
+class MeshUpdateWorkerThread : public UpdateThread
 {
 public:
-	MeshUpdateThread(Client *client);
+	MeshUpdateWorkerThread(MeshUpdateQueue *queue_in,
+			MeshUpdateManager *manager, v3s16 *camera_offset);
+
+protected:
+	virtual void doUpdate();
+
+private:
+	MeshUpdateQueue *m_queue_in;
+	MeshUpdateManager *m_manager;
+	v3s16 *m_camera_offset;
+
+	// TODO: Add callback to update these when g_settings changes
+	int m_generation_interval;
+};
+
+/*
+	Owns the worker threads that build the meshes of the queued blocks
+*/
+class MeshUpdateManager
+{
+public:
+	MeshUpdateManager(Client *client);
 
 	// Caches the block at p and its neighbors (if needed) and queues a mesh
-	// update for the block at p
-	void updateBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent);
+	// update for the block at p, see MeshUpdateQueue::addBlock() for lod
+	void updateBlock(Map *map, v3s16 p, bool ack_block_to_server, bool urgent,
+			u16 lod = 1);
+
+	void putResult(const MeshUpdateResult &r);
 
 	v3s16 m_camera_offset;
 	MutexedQueue<MeshUpdateResult> m_queue_out;
 
-private:
-	MeshUpdateQueue m_queue_in;
+	void start();
+	void stop();
+	void wait();
+	bool isRunning();
 
-	// TODO: Add callback to update these when g_settings changes
-	int m_generation_interval;
+private:
+	void deferUpdate();
 
-protected:
-	virtual void doUpdate();
+	MeshUpdateQueue m_queue_in;
+	std::vector<std::unique_ptr<MeshUpdateWorkerThread>> m_workers;
 };
@@ -18,6 +18,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "particles.h"
+#include <algorithm>
 #include <cmath>
 #include "client.h"
 #include "collision.h"
@@ -45,208 +46,184 @@ v3f random_v3f(v3f min, v3f max)
 		rand() / (float)RAND_MAX * (max.Z - min.Z) + min.Z);
 }
 
-Particle::Particle(
-	IGameDef *gamedef,
-	LocalPlayer *player,
-	ClientEnvironment *env,
-	v3f pos,
-	v3f velocity,
-	v3f acceleration,
-	float expirationtime,
-	float size,
-	bool collisiondetection,
-	bool collision_removal,
-	bool object_collision,
-	bool vertical,
-	video::ITexture *texture,
-	v2f texpos,
-	v2f texsize,
-	const struct TileAnimationParams &anim,
-	u8 glow,
-	video::SColor color
-):
-	scene::ISceneNode(RenderingEngine::get_scene_manager()->getRootSceneNode(),
-		RenderingEngine::get_scene_manager())
-{
-	// Misc
-	m_gamedef = gamedef;
-	m_env = env;
+/*
+	ParticleWorld on the client map
+*/
 
-	// Texture
-	m_material.setFlag(video::EMF_LIGHTING, false);
-	m_material.setFlag(video::EMF_BACK_FACE_CULLING, false);
-	m_material.setFlag(video::EMF_BILINEAR_FILTER, false);
-	m_material.setFlag(video::EMF_FOG_ENABLE, true);
-	m_material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL;
-	m_material.setTexture(0, texture);
-	m_texpos = texpos;
-	m_texsize = texsize;
-	m_animation = anim;
+class ClientParticleWorld : public ParticleWorld
+{
+public:
+	ClientParticleWorld(ClientEnvironment *env, IGameDef *gamedef) :
+		m_env(env),
+		m_gamedef(gamedef),
+		m_map(env->getClientMap()),
+		m_ndef(gamedef->ndef()),
+		m_daynight_ratio(env->getDayNightRatio())
+	{}
+
+	bool isSolid(v3s16 p) override
+	{
+		bool pos_ok;
+		MapNode n = m_map.getNode(p, &pos_ok);
+		// Like collisionMoveSimple(), unloaded nodes stop particles
+		if (!pos_ok)
+			return true;
+		return m_ndef->get(n).walkable;
+	}
 
-	// Color
-	m_base_color = color;
-	m_color = color;
+	u8 getLight(v3s16 p) override
+	{
+		bool pos_ok;
+		MapNode n = m_map.getNode(p, &pos_ok);
+		if (pos_ok)
+			return n.getLightBlend(m_daynight_ratio, m_ndef);
+		return blend_light(m_daynight_ratio, LIGHT_SUN, 0);
+	}
 
-	// Particle related
-	m_pos = pos;
-	m_velocity = velocity;
-	m_acceleration = acceleration;
-	m_expiration = expirationtime;
-	m_player = player;
-	m_size = size;
-	m_collisiondetection = collisiondetection;
-	m_collision_removal = collision_removal;
-	m_object_collision = object_collision;
-	m_vertical = vertical;
-	m_glow = glow;
+	bool moveWithObjects(float size, float dtime,
+			v3f &pos, v3f &vel, v3f acc) override
+	{
+		aabb3f box(-size / 2, -size / 2, -size / 2,
+				size / 2, size / 2, size / 2);
+		v3f p_pos = pos * BS;
+		v3f p_velocity = vel * BS;
+		collisionMoveResult r = collisionMoveSimple(m_env, m_gamedef, BS * 0.5f,
+			box, 0.0f, dtime, &p_pos, &p_velocity, acc * BS, nullptr, true);
+		pos = p_pos / BS;
+		vel = p_velocity / BS;
+		return r.collides;
+	}
 
-	// Irrlicht stuff
-	m_collisionbox = aabb3f(
-		-size / 2,
-		-size / 2,
-		-size / 2,
-		 size / 2,
-		 size / 2,
-		 size / 2);
-	this->setAutomaticCulling(scene::EAC_OFF);
-
-	// Init lighting
-	updateLight();
-
-	// Init model
-	updateVertices();
-}
+private:
+	ClientEnvironment *m_env;
+	IGameDef *m_gamedef;
+	ClientMap &m_map;
+	const NodeDefManager *m_ndef;
+	u32 m_daynight_ratio;
+};
 
-void Particle::OnRegisterSceneNode()
-{
-	if (IsVisible)
-		SceneManager->registerNodeForRendering(this, scene::ESNRP_TRANSPARENT_EFFECT);
+/*
+	ParticleRenderer
+*/
 
-	ISceneNode::OnRegisterSceneNode();
-}
+// 16-bit indices address this many quads per buffer
+#define PARTICLE_MAX_BUFFER_QUADS (0x10000 / 4)
 
-void Particle::render()
+class ParticleRenderer : public scene::ISceneNode
 {
-	video::IVideoDriver *driver = SceneManager->getVideoDriver();
-	driver->setMaterial(m_material);
-	driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
-
-	u16 indices[] = {0,1,2, 2,3,0};
-	driver->drawVertexPrimitiveList(m_vertices, 4,
-			indices, 2, video::EVT_STANDARD,
-			scene::EPT_TRIANGLES, video::EIT_16BIT);
-}
+public:
+	ParticleRenderer(scene::ISceneManager *smgr) :
+		scene::ISceneNode(smgr->getRootSceneNode(), smgr)
+	{
+		setAutomaticCulling(scene::EAC_OFF);
+	}
 
-void Particle::step(float dtime)
-{
-	m_time += dtime;
-	if (m_collisiondetection) {
-		aabb3f box = m_collisionbox;
-		v3f p_pos = m_pos * BS;
-		v3f p_velocity = m_velocity * BS;
-		collisionMoveResult r = collisionMoveSimple(m_env, m_gamedef, BS * 0.5f,
-			box, 0.0f, dtime, &p_pos, &p_velocity, m_acceleration * BS, nullptr,
-			m_object_collision);
-		if (m_collision_removal && r.collides) {
-			// force expiration of the particle
-			m_expiration = -1.0;
-		} else {
-			m_pos = p_pos / BS;
-			m_velocity = p_velocity / BS;
-		}
-	} else {
-		m_velocity += m_acceleration * dtime;
-		m_pos += m_velocity * dtime;
+	~ParticleRenderer()
+	{
+		for (auto &buffers : m_buffers)
+			for (scene::SMeshBuffer *buf : buffers)
+				buf->drop();
 	}
-	if (m_animation.type != TAT_NONE) {
-		m_animation_time += dtime;
-		int frame_length_i, frame_count;
-		m_animation.determineParams(
-				m_material.getTexture(0)->getSize(),
-				&frame_count, &frame_length_i, NULL);
-		float frame_length = frame_length_i / 1000.0;
-		while (m_animation_time > frame_length) {
-			m_animation_frame++;
-			m_animation_time -= frame_length;
-		}
+
+	virtual const aabb3f &getBoundingBox() const
+	{
+		return m_box;
 	}
 
-	// Update lighting
-	updateLight();
+	virtual void OnRegisterSceneNode()
+	{
+		if (IsVisible && m_quads > 0)
+			SceneManager->registerNodeForRendering(this,
+					scene::ESNRP_TRANSPARENT_EFFECT);
 
-	// Update model
-	updateVertices();
-}
+		ISceneNode::OnRegisterSceneNode();
+	}
 
-void Particle::updateLight()
-{
-	u8 light = 0;
-	bool pos_ok;
+	virtual void render()
+	{
+		video::IVideoDriver *driver = SceneManager->getVideoDriver();
+		driver->setTransform(video::ETS_WORLD, AbsoluteTransformation);
+		for (auto &buffers : m_buffers) {
+			for (scene::SMeshBuffer *buf : buffers) {
+				if (buf->getIndexCount() == 0)
+					continue;
+				driver->setMaterial(buf->Material);
+				driver->drawMeshBuffer(buf);
+			}
+		}
+	}
 
-	v3s16 p = v3s16(
-		floor(m_pos.X+0.5),
-		floor(m_pos.Y+0.5),
-		floor(m_pos.Z+0.5)
-	);
-	MapNode n = m_env->getClientMap().getNode(p, &pos_ok);
-	if (pos_ok)
-		light = n.getLightBlend(m_env->getDayNightRatio(), m_gamedef->ndef());
-	else
-		light = blend_light(m_env->getDayNightRatio(), LIGHT_SUN, 0);
+	// Sizes the buffers for quads[t] quads with textures[t]
+	void resize(const std::vector<u32> &quads,
+			const std::vector<video::ITexture *> &textures)
+	{
+		m_quads = 0;
+		m_box.reset(0.0f, 0.0f, 0.0f);
+		for (size_t t = textures.size(); t < m_buffers.size(); t++)
+			for (scene::SMeshBuffer *buf : m_buffers[t])
+				buf->drop();
+		m_buffers.resize(textures.size());
+		for (size_t t = 0; t < textures.size(); t++) {
+			std::vector<scene::SMeshBuffer *> &buffers = m_buffers[t];
+			u32 count = quads[t];
+			m_quads += count;
+			while (buffers.size() * PARTICLE_MAX_BUFFER_QUADS < count)
+				buffers.push_back(createBuffer());
+
+			for (scene::SMeshBuffer *buf : buffers) {
+				// Texture indices change, see ParticleManager::removeUnusedTextures()
+				buf->Material.setTexture(0, textures[t]);
+				u32 n = std::min<u32>(count, PARTICLE_MAX_BUFFER_QUADS);
+				count -= n;
+				buf->Vertices.set_used(n * 4);
+				if (buf->Indices.size() == n * 6)
+					continue;
+				buf->Indices.set_used(n * 6);
+				for (u32 q = 0; q < n; q++) {
+					u16 *index = &buf->Indices[q * 6];
+					u16 v = q * 4;
+					index[0] = v;
+					index[1] = v + 1;
+					index[2] = v + 2;
+					index[3] = v + 2;
+					index[4] = v + 3;
+					index[5] = v;
+				}
+			}
+		}
+	}
 
-	u8 m_light = decode_light(light + m_glow);
-	m_color.set(255,
-		m_light * m_base_color.getRed() / 255,
-		m_light * m_base_color.getGreen() / 255,
-		m_light * m_base_color.getBlue() / 255);
-}
+	// The four vertices of quad q with texture t
+	video::S3DVertex *getQuad(u16 t, u32 q)
+	{
+		scene::SMeshBuffer *buf = m_buffers[t][q / PARTICLE_MAX_BUFFER_QUADS];
+		return &buf->Vertices[(q % PARTICLE_MAX_BUFFER_QUADS) * 4];
+	}
 
-void Particle::updateVertices()
-{
-	f32 tx0, tx1, ty0, ty1;
-
-	if (m_animation.type != TAT_NONE) {
-		const v2u32 texsize = m_material.getTexture(0)->getSize();
-		v2f texcoord, framesize_f;
-		v2u32 framesize;
-		texcoord = m_animation.getTextureCoords(texsize, m_animation_frame);
-		m_animation.determineParams(texsize, NULL, NULL, &framesize);
-		framesize_f = v2f(framesize.X / (float) texsize.X, framesize.Y / (float) texsize.Y);
-
-		tx0 = m_texpos.X + texcoord.X;
-		tx1 = m_texpos.X + texcoord.X + framesize_f.X * m_texsize.X;
-		ty0 = m_texpos.Y + texcoord.Y;
-		ty1 = m_texpos.Y + texcoord.Y + framesize_f.Y * m_texsize.Y;
-	} else {
-		tx0 = m_texpos.X;
-		tx1 = m_texpos.X + m_texsize.X;
-		ty0 = m_texpos.Y;
-		ty1 = m_texpos.Y + m_texsize.Y;
+	void addToBox(const v3f &p)
+	{
+		m_box.addInternalPoint(p);
 	}
 
-	m_vertices[0] = video::S3DVertex(-m_size / 2, -m_size / 2,
-		0, 0, 0, 0, m_color, tx0, ty1);
-	m_vertices[1] = video::S3DVertex(m_size / 2, -m_size / 2,
-		0, 0, 0, 0, m_color, tx1, ty1);
-	m_vertices[2] = video::S3DVertex(m_size / 2, m_size / 2,
-		0, 0, 0, 0, m_color, tx1, ty0);
-	m_vertices[3] = video::S3DVertex(-m_size / 2, m_size / 2,
-		0, 0, 0, 0, m_color, tx0, ty0);
-
-	v3s16 camera_offset = m_env->getCameraOffset();
-	for (video::S3DVertex &vertex : m_vertices) {
-		if (m_vertical) {
-			v3f ppos = m_player->getPosition()/BS;
-			vertex.Pos.rotateXZBy(std::atan2(ppos.Z - m_pos.Z, ppos.X - m_pos.X) /
-				core::DEGTORAD + 90);
-		} else {
-			vertex.Pos.rotateYZBy(m_player->getPitch());
-			vertex.Pos.rotateXZBy(m_player->getYaw());
-		}
-		m_box.addInternalPoint(vertex.Pos);
-		vertex.Pos += m_pos*BS - intToFloat(camera_offset, BS);
+private:
+	static scene::SMeshBuffer *createBuffer()
+	{
+		scene::SMeshBuffer *buf = new scene::SMeshBuffer();
+		video::SMaterial &material = buf->Material;
+		material.setFlag(video::EMF_LIGHTING, false);
+		material.setFlag(video::EMF_BACK_FACE_CULLING, false);
+		material.setFlag(video::EMF_BILINEAR_FILTER, false);
+		material.setFlag(video::EMF_FOG_ENABLE, true);
+		material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL;
+		return buf;
 	}
-}
+
+	aabb3f m_box;
+	u32 m_quads = 0;
+	// Per texture, as many buffers as the quads need. The quads of a texture
+	// are drawn in the order they are given, see updateBuffers().
+	std::vector<std::vector<scene::SMeshBuffer *>> m_buffers;
+};
 
 /*
 	ParticleSpawner
@@ -343,25 +320,19 @@ void ParticleSpawner::spawnParticle(ClientEnvironment *env, float radius,
 		* (m_maxsize - m_minsize)
 		+ m_minsize;
 
-	m_particlemanager->addParticle(new Particle(
-		m_gamedef,
-		m_player,
-		env,
-		pos,
-		vel,
-		acc,
-		exptime,
-		size,
-		m_collisiondetection,
-		m_collision_removal,
-		m_object_collision,
-		m_vertical,
-		m_texture,
-		v2f(0.0, 0.0),
-		v2f(1.0, 1.0),
-		m_animation,
-		m_glow
-	));
+	ParticleSpec spec;
+	spec.pos = pos;
+	spec.vel = vel;
+	spec.acc = acc;
+	spec.expiration = exptime;
+	spec.size = size;
+	spec.collisiondetection = m_collisiondetection;
+	spec.collision_removal = m_collision_removal;
+	spec.object_collision = m_object_collision;
+	spec.vertical = m_vertical;
+	spec.animation = m_animation;
+	spec.glow = m_glow;
+	m_particlemanager->addParticle(spec, m_texture);
 }
 
 void ParticleSpawner::step(float dtime, ClientEnvironment *env)
@@ -420,6 +391,10 @@ ParticleManager::ParticleManager(ClientEnvironment *env) :
 ParticleManager::~ParticleManager()
 {
 	clearAll();
+	if (m_renderer) {
+		m_renderer->remove();
+		m_renderer->drop();
+	}
 }
 
 void ParticleManager::step(float dtime)
@@ -445,18 +420,134 @@ void ParticleManager::stepSpawners(float dtime)
 void ParticleManager::stepParticles(float dtime)
 {
 	MutexAutoLock lock(m_particle_list_lock);
-	for (auto i = m_particles.begin(); i != m_particles.end();) {
-		if ((*i)->get_expired()) {
-			(*i)->remove();
-			delete *i;
-			i = m_particles.erase(i);
+	if (!m_renderer)
+		return;
+
+	ClientParticleWorld world(m_env, m_env->getGameDef());
+	m_particles.step(dtime, &world);
+	updateBuffers();
+}
+
+void ParticleManager::updateBuffers()
+{
+	std::vector<u32> quads(m_textures.size(), 0);
+	for (size_t i = 0; i < m_particles.size(); i++)
+		quads[m_particles.getLook(i).texture]++;
+	removeUnusedTextures(quads);
+	m_renderer->resize(quads, m_textures);
+
+	// Facing the player, the same for all particles that are not vertical
+	LocalPlayer *player = m_env->getLocalPlayer();
+	v3f player_pos = player->getPosition() / BS;
+	v3f right(1.0f, 0.0f, 0.0f);
+	v3f up(0.0f, 1.0f, 0.0f);
+	right.rotateYZBy(player->getPitch());
+	right.rotateXZBy(player->getYaw());
+	up.rotateYZBy(player->getPitch());
+	up.rotateXZBy(player->getYaw());
+	v3f camera_offset = intToFloat(m_env->getCameraOffset(), BS);
+
+	// The particles are blended without writing depth, so each texture
+	// draws its particles from back to front
+	scene::ICameraSceneNode *camera =
+		m_renderer->getSceneManager()->getActiveCamera();
+	v3f eye_pos = camera ? (camera->getAbsolutePosition() + camera_offset) / BS :
+		player->getEyePosition() / BS;
+	m_draw_order.resize(m_particles.size());
+	for (size_t i = 0; i < m_particles.size(); i++) {
+		m_draw_order[i].first =
+			m_particles.getPosition(i).getDistanceFromSQ(eye_pos);
+		m_draw_order[i].second = i;
+	}
+	std::sort(m_draw_order.begin(), m_draw_order.end(),
+		[] (const std::pair<f32, u32> &a, const std::pair<f32, u32> &b) {
+			return a.first > b.first;
+		});
+
+	std::fill(quads.begin(), quads.end(), 0);
+	for (const auto &draw : m_draw_order) {
+		u32 i = draw.second;
+		const ParticleStore::Look &look = m_particles.getLook(i);
+		v3f pos = m_particles.getPosition(i);
+
+		f32 tx0, tx1, ty0, ty1;
+		if (look.animation.type != TAT_NONE && m_textures[look.texture]) {
+			const v2u32 texsize = m_textures[look.texture]->getSize();
+			v2f texcoord, framesize_f;
+			v2u32 framesize;
+			texcoord = look.animation.getTextureCoords(texsize,
+					look.animation_frame);
+			look.animation.determineParams(texsize, NULL, NULL, &framesize);
+			framesize_f = v2f(framesize.X / (float) texsize.X,
+					framesize.Y / (float) texsize.Y);
+
+			tx0 = look.texpos.X + texcoord.X;
+			tx1 = look.texpos.X + texcoord.X + framesize_f.X * look.texsize.X;
+			ty0 = look.texpos.Y + texcoord.Y;
+			ty1 = look.texpos.Y + texcoord.Y + framesize_f.Y * look.texsize.Y;
 		} else {
-			(*i)->step(dtime);
-			++i;
+			tx0 = look.texpos.X;
+			tx1 = look.texpos.X + look.texsize.X;
+			ty0 = look.texpos.Y;
+			ty1 = look.texpos.Y + look.texsize.Y;
 		}
+
+		u8 light = decode_light(m_particles.getLight(i) + look.glow);
+		video::SColor color(255,
+			light * look.color.getRed() / 255,
+			light * look.color.getGreen() / 255,
+			light * look.color.getBlue() / 255);
+
+		v3f r = right;
+		v3f u = up;
+		if (look.vertical) {
+			r = v3f(1.0f, 0.0f, 0.0f);
+			r.rotateXZBy(std::atan2(player_pos.Z - pos.Z, player_pos.X - pos.X) /
+				core::DEGTORAD + 90);
+			u = v3f(0.0f, 1.0f, 0.0f);
+		}
+		r *= look.size / 2;
+		u *= look.size / 2;
+
+		v3f center = pos * BS - camera_offset;
+		video::S3DVertex *vertices = m_renderer->getQuad(look.texture,
+				quads[look.texture]++);
+		vertices[0] = video::S3DVertex(center - r - u, v3f(), color,
+				v2f(tx0, ty1));
+		vertices[1] = video::S3DVertex(center + r - u, v3f(), color,
+				v2f(tx1, ty1));
+		vertices[2] = video::S3DVertex(center + r + u, v3f(), color,
+				v2f(tx1, ty0));
+		vertices[3] = video::S3DVertex(center - r + u, v3f(), color,
+				v2f(tx0, ty0));
+		for (int j = 0; j < 4; j++)
+			m_renderer->addToBox(vertices[j].Pos);
 	}
 }
 
+void ParticleManager::removeUnusedTextures(std::vector<u32> &quads)
+{
+	if (std::find(quads.begin(), quads.end(), 0) == quads.end())
+		return;
+
+	std::vector<u16> new_index(m_textures.size(), 0);
+	size_t used = 0;
+	for (size_t t = 0; t < m_textures.size(); t++) {
+		if (quads[t] == 0) {
+			m_texture_ids.erase(m_textures[t]);
+			continue;
+		}
+		new_index[t] = used;
+		m_textures[used] = m_textures[t];
+		m_texture_ids[m_textures[used]] = used;
+		quads[used] = quads[t];
+		used++;
+	}
+	m_textures.resize(used);
+	quads.resize(used);
+	m_particles.remapTextures(new_index);
+}
+
 void ParticleManager::clearAll()
 {
 	MutexAutoLock lock(m_spawner_list_lock);
@@ -466,12 +557,11 @@ void ParticleManager::clearAll()
 		m_particle_spawners.erase(i++);
 	}
 
-	for(auto i = m_particles.begin(); i != m_particles.end();)
-	{
-		(*i)->remove();
-		delete *i;
-		i = m_particles.erase(i);
-	}
+	m_particles.clear();
+	m_textures.clear();
+	m_texture_ids.clear();
+	if (m_renderer)
+		m_renderer->resize(std::vector<u32>(), m_textures);
 }
 
 void ParticleManager::handleParticleEvent(ClientEvent *event, Client *client,
@@ -543,23 +633,20 @@ void ParticleManager::handleParticleEvent(ClientEvent *event, Client *client,
 			video::ITexture *texture =
 				client->tsrc()->getTextureForMesh(*(event->spawn_particle.texture));
 
-			Particle *toadd = new Particle(client, player, m_env,
-					*event->spawn_particle.pos,
-					*event->spawn_particle.vel,
-					*event->spawn_particle.acc,
-					event->spawn_particle.expirationtime,
-					event->spawn_particle.size,
-					event->spawn_particle.collisiondetection,
-					event->spawn_particle.collision_removal,
-					event->spawn_particle.object_collision,
-					event->spawn_particle.vertical,
-					texture,
-					v2f(0.0, 0.0),
-					v2f(1.0, 1.0),
-					event->spawn_particle.animation,
-					event->spawn_particle.glow);
-
-			addParticle(toadd);
+			ParticleSpec spec;
+			spec.pos = *event->spawn_particle.pos;
+			spec.vel = *event->spawn_particle.vel;
+			spec.acc = *event->spawn_particle.acc;
+			spec.expiration = event->spawn_particle.expirationtime;
+			spec.size = event->spawn_particle.size;
+			spec.collisiondetection = event->spawn_particle.collisiondetection;
+			spec.collision_removal = event->spawn_particle.collision_removal;
+			spec.object_collision = event->spawn_particle.object_collision;
+			spec.vertical = event->spawn_particle.vertical;
+			spec.animation = event->spawn_particle.animation;
+			spec.glow = event->spawn_particle.glow;
+
+			addParticle(spec, texture);
 
 			delete event->spawn_particle.pos;
 			delete event->spawn_particle.vel;
@@ -601,8 +688,6 @@ void ParticleManager::addNodeParticle(IGameDef *gamedef,
 	u8 texid = myrand_range(0, 5);
 	const TileLayer &tile = f.tiles[texid].layers[0];
 	video::ITexture *texture;
-	struct TileAnimationParams anim;
-	anim.type = TAT_NONE;
 
 	// Only use first frame of animated texture
 	if (tile.material_flags & MATERIAL_FLAG_ANIMATION)
@@ -642,31 +727,41 @@ void ParticleManager::addNodeParticle(IGameDef *gamedef,
 	else
 		n.getColor(f, &color);
 
-	Particle *toadd = new Particle(
-		gamedef,
-		player,
-		m_env,
-		particlepos,
-		velocity,
-		acceleration,
-		(rand() % 100) / 100.0f, // expiration time
-		visual_size,
-		true,
-		false,
-		false,
-		false,
-		texture,
-		texpos,
-		texsize,
-		anim,
-		0,
-		color);
-
-	addParticle(toadd);
+	ParticleSpec spec;
+	spec.pos = particlepos;
+	spec.vel = velocity;
+	spec.acc = acceleration;
+	spec.expiration = (rand() % 100) / 100.0f;
+	spec.size = visual_size;
+	spec.collisiondetection = true;
+	spec.texpos = texpos;
+	spec.texsize = texsize;
+	spec.color = color;
+
+	addParticle(spec, texture);
 }
 
-void ParticleManager::addParticle(Particle *toadd)
+void ParticleManager::addParticle(ParticleSpec &spec, video::ITexture *texture)
 {
 	MutexAutoLock lock(m_particle_list_lock);
-	m_particles.push_back(toadd);
+	auto it = m_texture_ids.find(texture);
+	if (it == m_texture_ids.end()) {
+		if (m_textures.size() > U16_MAX)
+			return;
+		it = m_texture_ids.emplace(texture, m_textures.size()).first;
+		m_textures.push_back(texture);
+	}
+	spec.texture = it->second;
+
+	if (spec.animation.type != TAT_NONE && texture) {
+		int frame_length_ms;
+		spec.animation.determineParams(texture->getSize(), NULL,
+				&frame_length_ms, NULL);
+		spec.frame_length = frame_length_ms / 1000.0f;
+	}
+
+	if (!m_renderer)
+		m_renderer = new ParticleRenderer(RenderingEngine::get_scene_manager());
+
+	m_particles.add(spec);
 }
@@ -24,95 +24,14 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "client/tile.h"
 #include "localplayer.h"
 #include "tileanimation.h"
+#include "client/particlestore.h"
 
 struct ClientEvent;
 class ParticleManager;
 class ClientEnvironment;
 struct MapNode;
 struct ContentFeatures;
-
-class Particle : public scene::ISceneNode
-{
-	public:
-	Particle(
-		IGameDef* gamedef,
-		LocalPlayer *player,
-		ClientEnvironment *env,
-		v3f pos,
-		v3f velocity,
-		v3f acceleration,
-		float expirationtime,
-		float size,
-		bool collisiondetection,
-		bool collision_removal,
-		bool object_collision,
-		bool vertical,
-		video::ITexture *texture,
-		v2f texpos,
-		v2f texsize,
-		const struct TileAnimationParams &anim,
-		u8 glow,
-		video::SColor color = video::SColor(0xFFFFFFFF)
-	);
-	~Particle() = default;
-
-	virtual const aabb3f &getBoundingBox() const
-	{
-		return m_box;
-	}
-
-	virtual u32 getMaterialCount() const
-	{
-		return 1;
-	}
-
-	virtual video::SMaterial& getMaterial(u32 i)
-	{
-		return m_material;
-	}
-
-	virtual void OnRegisterSceneNode();
-	virtual void render();
-
-	void step(float dtime);
-
-	bool get_expired ()
-	{ return m_expiration < m_time; }
-
-private:
-	void updateLight();
-	void updateVertices();
-
-	video::S3DVertex m_vertices[4];
-	float m_time = 0.0f;
-	float m_expiration;
-
-	ClientEnvironment *m_env;
-	IGameDef *m_gamedef;
-	aabb3f m_box;
-	aabb3f m_collisionbox;
-	video::SMaterial m_material;
-	v2f m_texpos;
-	v2f m_texsize;
-	v3f m_pos;
-	v3f m_velocity;
-	v3f m_acceleration;
-	LocalPlayer *m_player;
-	float m_size;
-	//! Color without lighting
-	video::SColor m_base_color;
-	//! Final rendered color
-	video::SColor m_color;
-	bool m_collisiondetection;
-	bool m_collision_removal;
-	bool m_object_collision;
-	bool m_vertical;
-	v3s16 m_camera_offset;
-	struct TileAnimationParams m_animation;
-	float m_animation_time = 0.0f;
-	int m_animation_frame = 0;
-	u8 m_glow;
-};
+class ParticleRenderer;
 
 class ParticleSpawner
 {
@@ -207,16 +126,29 @@ friend class ParticleSpawner;
 	}
 
 protected:
-	void addParticle(Particle* toadd);
+	// Looks up the texture and animation of spec and adds the particle
+	void addParticle(ParticleSpec &spec, video::ITexture *texture);
 
 private:
 
 	void stepParticles(float dtime);
 	void stepSpawners(float dtime);
+	// Rebuilds the quads of all particles, facing the local player
+	void updateBuffers();
+	// Drops the textures no particle uses, quads[t] is the number of
+	// particles with texture t
+	void removeUnusedTextures(std::vector<u32> &quads);
 
 	void clearAll();
 
-	std::vector<Particle*> m_particles;
+	ParticleStore m_particles;
+	// Textures of the particles, indexed by ParticleSpec::texture
+	std::vector<video::ITexture *> m_textures;
+	std::unordered_map<video::ITexture *, u16> m_texture_ids;
+	// Scratch space of updateBuffers(), distance and index of each particle
+	std::vector<std::pair<f32, u32>> m_draw_order;
+	// Draws every particle, created with the first one
+	ParticleRenderer *m_renderer = nullptr;
 	std::unordered_map<u64, ParticleSpawner*> m_particle_spawners;
 	// Start the particle spawner ids generated from here after u32_max. lower values are
 	// for server sent spawners.
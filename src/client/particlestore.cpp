@@ -0,0 +1,295 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "particlestore.h"
+#include <algorithm>
+#include <cmath>
+#include "constants.h"
+
+// Longest distance a colliding particle moves between two voxel checks
+#define PARTICLE_COLLISION_STEP 0.5f
+#define PARTICLE_MAX_COLLISION_STEPS 8
+
+static inline s16 toNode(float f)
+{
+	return std::floor(f + 0.5f);
+}
+
+static inline v3s16 toNode(const v3f &p)
+{
+	return v3s16(toNode(p.X), toNode(p.Y), toNode(p.Z));
+}
+
+void ParticleStore::push(const ParticleSpec &spec)
+{
+	m_pos_x.push_back(spec.pos.X);
+	m_pos_y.push_back(spec.pos.Y);
+	m_pos_z.push_back(spec.pos.Z);
+	m_vel_x.push_back(spec.vel.X);
+	m_vel_y.push_back(spec.vel.Y);
+	m_vel_z.push_back(spec.vel.Z);
+	m_acc_x.push_back(spec.acc.X);
+	m_acc_y.push_back(spec.acc.Y);
+	m_acc_z.push_back(spec.acc.Z);
+	m_time.push_back(0.0f);
+	m_expiration.push_back(spec.expiration);
+	m_light.push_back(0);
+
+	Look look;
+	look.size = spec.size;
+	look.texture = spec.texture;
+	look.vertical = spec.vertical;
+	look.glow = spec.glow;
+	look.texpos = spec.texpos;
+	look.texsize = spec.texsize;
+	look.color = spec.color;
+	look.animation = spec.animation;
+	look.animation_frame = 0;
+	m_looks.push_back(look);
+
+	Cold cold;
+	cold.frame_length = spec.frame_length;
+	cold.animation_time = 0.0f;
+	cold.collision_removal = spec.collision_removal;
+	cold.object_collision = spec.object_collision;
+	m_cold.push_back(cold);
+}
+
+void ParticleStore::add(const ParticleSpec &spec)
+{
+	push(spec);
+	if (spec.collisiondetection) {
+		swapParticles(m_num_colliding, size() - 1);
+		m_num_colliding++;
+	}
+}
+
+void ParticleStore::swapParticles(size_t a, size_t b)
+{
+	if (a == b)
+		return;
+	std::swap(m_pos_x[a], m_pos_x[b]);
+	std::swap(m_pos_y[a], m_pos_y[b]);
+	std::swap(m_pos_z[a], m_pos_z[b]);
+	std::swap(m_vel_x[a], m_vel_x[b]);
+	std::swap(m_vel_y[a], m_vel_y[b]);
+	std::swap(m_vel_z[a], m_vel_z[b]);
+	std::swap(m_acc_x[a], m_acc_x[b]);
+	std::swap(m_acc_y[a], m_acc_y[b]);
+	std::swap(m_acc_z[a], m_acc_z[b]);
+	std::swap(m_time[a], m_time[b]);
+	std::swap(m_expiration[a], m_expiration[b]);
+	std::swap(m_light[a], m_light[b]);
+	std::swap(m_looks[a], m_looks[b]);
+	std::swap(m_cold[a], m_cold[b]);
+}
+
+void ParticleStore::remove(size_t i)
+{
+	// Keep the colliding particles contiguous
+	if (i < m_num_colliding) {
+		m_num_colliding--;
+		swapParticles(i, m_num_colliding);
+		i = m_num_colliding;
+	}
+	swapParticles(i, size() - 1);
+
+	m_pos_x.pop_back();
+	m_pos_y.pop_back();
+	m_pos_z.pop_back();
+	m_vel_x.pop_back();
+	m_vel_y.pop_back();
+	m_vel_z.pop_back();
+	m_acc_x.pop_back();
+	m_acc_y.pop_back();
+	m_acc_z.pop_back();
+	m_time.pop_back();
+	m_expiration.pop_back();
+	m_light.pop_back();
+	m_looks.pop_back();
+	m_cold.pop_back();
+}
+
+void ParticleStore::removeExpired()
+{
+	for (size_t i = 0; i < size();) {
+		if (m_expiration[i] < m_time[i])
+			remove(i);
+		else
+			i++;
+	}
+}
+
+void ParticleStore::clear()
+{
+	m_pos_x.clear();
+	m_pos_y.clear();
+	m_pos_z.clear();
+	m_vel_x.clear();
+	m_vel_y.clear();
+	m_vel_z.clear();
+	m_acc_x.clear();
+	m_acc_y.clear();
+	m_acc_z.clear();
+	m_time.clear();
+	m_expiration.clear();
+	m_light.clear();
+	m_looks.clear();
+	m_cold.clear();
+	m_num_colliding = 0;
+}
+
+void ParticleStore::remapTextures(const std::vector<u16> &new_index)
+{
+	for (Look &look : m_looks)
+		look.texture = new_index[look.texture];
+}
+
+void ParticleStore::step(float dtime, ParticleWorld *world)
+{
+	removeExpired();
+
+	const size_t count = size();
+	float *time = m_time.data();
+	for (size_t i = 0; i < count; i++)
+		time[i] += dtime;
+
+	for (size_t i = 0; i < m_num_colliding; i++) {
+		if (moveColliding(i, dtime, world) && m_cold[i].collision_removal) {
+			// Removed on the next step
+			m_expiration[i] = -1.0f;
+		}
+	}
+	integrate(m_num_colliding, count, dtime);
+
+	animate(dtime);
+
+	for (size_t i = 0; i < count; i++)
+		m_light[i] = world->getLight(toNode(getPosition(i)));
+}
+
+/*
+	Moves a particle through the voxels one axis at a time, so it slides along
+	walls and floors. Nodes count as full cubes and the motion is split into
+	steps of at most PARTICLE_COLLISION_STEP nodes, which is plenty for things
+	the size of a particle. Collisions with objects need the full collision
+	code.
+*/
+bool ParticleStore::moveColliding(size_t i, float dtime, ParticleWorld *world)
+{
+	v3f pos = getPosition(i);
+	v3f vel = getVelocity(i);
+	v3f acc(m_acc_x[i], m_acc_y[i], m_acc_z[i]);
+	bool collided = false;
+
+	if (m_cold[i].object_collision) {
+		collided = world->moveWithObjects(m_looks[i].size, dtime, pos, vel, acc);
+	} else {
+		vel += acc * dtime;
+		v3f move = vel * dtime;
+		float half = m_looks[i].size / BS / 2.0f;
+
+		float dist = std::max(std::fabs(move.X),
+				std::max(std::fabs(move.Y), std::fabs(move.Z)));
+		int steps = std::min(PARTICLE_MAX_COLLISION_STEPS,
+				std::max(1, (int)std::ceil(dist / PARTICLE_COLLISION_STEP)));
+		move /= steps;
+
+		float *p[3] = {&pos.X, &pos.Y, &pos.Z};
+		float *v[3] = {&vel.X, &vel.Y, &vel.Z};
+		const float d[3] = {move.X, move.Y, move.Z};
+		for (int s = 0; s < steps; s++)
+		for (int a = 0; a < 3; a++) {
+			if (d[a] == 0.0f || *v[a] == 0.0f)
+				continue;
+
+			float next = *p[a] + d[a];
+			// Leading face of the collision box
+			v3f probe = pos;
+			float *probe_a[3] = {&probe.X, &probe.Y, &probe.Z};
+			*probe_a[a] = next + (d[a] > 0.0f ? half : -half);
+			v3s16 node = toNode(probe);
+			if (!world->isSolid(node)) {
+				*p[a] = next;
+				continue;
+			}
+
+			// Stop at the face of the node, but never move backwards out
+			// of a node the particle already overlaps
+			s16 n = a == 0 ? node.X : a == 1 ? node.Y : node.Z;
+			if (d[a] > 0.0f)
+				*p[a] = std::max(*p[a], std::min(next, n - 0.5f - half));
+			else
+				*p[a] = std::min(*p[a], std::max(next, n + 0.5f + half));
+			*v[a] = 0.0f;
+			collided = true;
+		}
+	}
+
+	if (collided && m_cold[i].collision_removal)
+		return true;
+
+	m_pos_x[i] = pos.X;
+	m_pos_y[i] = pos.Y;
+	m_pos_z[i] = pos.Z;
+	m_vel_x[i] = vel.X;
+	m_vel_y[i] = vel.Y;
+	m_vel_z[i] = vel.Z;
+	return collided;
+}
+
+/*
+	Semi-implicit Euler along one axis. Without branches or aliasing between
+	the arrays the compiler turns this into packed SIMD arithmetic.
+*/
+static void integrateAxis(float *__restrict pos, float *__restrict vel,
+		const float *__restrict acc, size_t count, float dtime)
+{
+	for (size_t i = 0; i < count; i++) {
+		vel[i] += acc[i] * dtime;
+		pos[i] += vel[i] * dtime;
+	}
+}
+
+// Moves the particles that do not collide
+void ParticleStore::integrate(size_t begin, size_t end, float dtime)
+{
+	if (begin >= end)
+		return;
+	size_t count = end - begin;
+	integrateAxis(&m_pos_x[begin], &m_vel_x[begin], &m_acc_x[begin], count, dtime);
+	integrateAxis(&m_pos_y[begin], &m_vel_y[begin], &m_acc_y[begin], count, dtime);
+	integrateAxis(&m_pos_z[begin], &m_vel_z[begin], &m_acc_z[begin], count, dtime);
+}
+
+void ParticleStore::animate(float dtime)
+{
+	for (size_t i = 0; i < size(); i++) {
+		Look &look = m_looks[i];
+		Cold &cold = m_cold[i];
+		if (look.animation.type == TAT_NONE || cold.frame_length <= 0.0f)
+			continue;
+
+		cold.animation_time += dtime;
+		while (cold.animation_time > cold.frame_length) {
+			look.animation_frame++;
+			cold.animation_time -= cold.frame_length;
+		}
+	}
+}
@@ -0,0 +1,156 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <vector>
+#include <SColor.h>
+#include "irrlichttypes_bloated.h"
+#include "tileanimation.h"
+
+/*
+	What the particles of a ParticleStore move through.
+	All positions are in nodes.
+*/
+class ParticleWorld
+{
+public:
+	virtual ~ParticleWorld() = default;
+
+	// Whether particles collide with the node at p
+	virtual bool isSolid(v3s16 p) = 0;
+
+	// Light level at p for the current time of day, 0 to LIGHT_SUN
+	virtual u8 getLight(v3s16 p) = 0;
+
+	// Full collision against node boxes and objects, used by particles with
+	// object_collision set. Returns whether the particle collided.
+	virtual bool moveWithObjects(float size, float dtime,
+			v3f &pos, v3f &vel, v3f acc) = 0;
+};
+
+// Everything a particle is created with
+struct ParticleSpec
+{
+	ParticleSpec()
+	{
+		animation.type = TAT_NONE;
+	}
+
+	v3f pos;
+	v3f vel;
+	v3f acc;
+	float expiration = 1.0f;
+	// Visual size in world units, the collision box is as big
+	float size = 1.0f;
+	bool collisiondetection = false;
+	bool collision_removal = false;
+	bool object_collision = false;
+	bool vertical = false;
+	// Index into the texture table of the owner of the store
+	u16 texture = 0;
+	v2f texpos = v2f(0.0f, 0.0f);
+	v2f texsize = v2f(1.0f, 1.0f);
+	TileAnimationParams animation;
+	// Seconds per animation frame, see TileAnimationParams::determineParams()
+	float frame_length = 0.0f;
+	u8 glow = 0;
+	video::SColor color = video::SColor(0xFFFFFFFF);
+};
+
+/*
+	Particles stored as structure of arrays, so the per-frame update runs
+	over contiguous floats. Particles that collide are kept in front of the
+	others and removal swaps the last particle into the hole, so the arrays
+	double as the pool and no allocation happens once they have grown.
+*/
+class ParticleStore
+{
+public:
+	// Everything the renderer needs apart from the position
+	struct Look
+	{
+		float size;
+		u16 texture;
+		bool vertical;
+		u8 glow;
+		v2f texpos;
+		v2f texsize;
+		video::SColor color;
+		TileAnimationParams animation;
+		int animation_frame;
+	};
+
+	void add(const ParticleSpec &spec);
+
+	// Removes expired particles, then moves, animates and lights the rest
+	void step(float dtime, ParticleWorld *world);
+
+	void clear();
+
+	// Changes the texture index of every particle from t to new_index[t]
+	void remapTextures(const std::vector<u16> &new_index);
+
+	size_t size() const { return m_pos_x.size(); }
+
+	v3f getPosition(size_t i) const
+	{
+		return v3f(m_pos_x[i], m_pos_y[i], m_pos_z[i]);
+	}
+
+	v3f getVelocity(size_t i) const
+	{
+		return v3f(m_vel_x[i], m_vel_y[i], m_vel_z[i]);
+	}
+
+	u8 getLight(size_t i) const { return m_light[i]; }
+
+	const Look &getLook(size_t i) const { return m_looks[i]; }
+
+private:
+	// Rarely touched state, kept apart from the arrays the update streams
+	struct Cold
+	{
+		float frame_length;
+		float animation_time;
+		bool collision_removal;
+		bool object_collision;
+	};
+
+	void push(const ParticleSpec &spec);
+	void swapParticles(size_t a, size_t b);
+	void remove(size_t i);
+	void removeExpired();
+
+	bool moveColliding(size_t i, float dtime, ParticleWorld *world);
+	void integrate(size_t begin, size_t end, float dtime);
+	void animate(float dtime);
+
+	std::vector<float> m_pos_x, m_pos_y, m_pos_z;
+	std::vector<float> m_vel_x, m_vel_y, m_vel_z;
+	std::vector<float> m_acc_x, m_acc_y, m_acc_z;
+	std::vector<float> m_time;
+	std::vector<float> m_expiration;
+	std::vector<u8> m_light;
+	std::vector<Look> m_looks;
+	std::vector<Cold> m_cold;
+
+	// Particles [0, m_num_colliding) collide with the world
+	size_t m_num_colliding = 0;
+};
@@ -392,7 +392,7 @@ u32 ShaderSource::getShader(const std::string &name,
 
 	// We're gonna ask the result to be put into here
 
-	static ResultQueue<std::string, u32, u8, u8> result_queue;
+	static thread_local ResultQueue<std::string, u32, u8, u8> result_queue;
 
 	// Throw a request in
 	m_get_shader_queue.add(name, 0, 0, &result_queue);
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include <set>
 #include <string>
+#include <vector>
 #include "irr_v3d.h"
 #include "../sound.h"
 
@@ -32,6 +33,14 @@ class OnDemandSoundFetcher
 			std::set<std::string> &dst_datas) = 0;
 };
 
+// Sound data decoded to 16-bit samples, see ISoundManager::decodeSoundData()
+struct DecodedSound
+{
+	bool stereo = false;
+	s32 freq = 0;
+	std::vector<char> samples;
+};
+
 class ISoundManager
 {
 public:
@@ -44,6 +53,13 @@ class ISoundManager
 			const std::string &name, const std::string &filepath) = 0;
 	virtual bool loadSoundData(
 			const std::string &name, const std::string &filedata) = 0;
+	// Decodes a sound file without touching the sound manager, so this may
+	// be called from any thread. The result is added with loadDecodedSound()
+	// from the main thread, which takes over its samples.
+	virtual bool decodeSoundData(const std::string &filedata,
+			const std::string &id_for_log, DecodedSound &dst) = 0;
+	virtual bool loadDecodedSound(
+			const std::string &name, DecodedSound &sound) = 0;
 
 	virtual void updateListener(
 			const v3f &pos, const v3f &vel, const v3f &at, const v3f &up) = 0;
@@ -84,6 +100,15 @@ class DummySoundManager : public ISoundManager
 	{
 		return true;
 	}
+	virtual bool decodeSoundData(const std::string &filedata,
+			const std::string &id_for_log, DecodedSound &dst)
+	{
+		return true;
+	}
+	virtual bool loadDecodedSound(const std::string &name, DecodedSound &sound)
+	{
+		return true;
+	}
 	void updateListener(const v3f &pos, const v3f &vel, const v3f &at, const v3f &up)
 	{
 	}
@@ -111,8 +111,9 @@ struct SoundBuffer
 	std::vector<char> buffer;
 };
 
-SoundBuffer *load_opened_ogg_file(OggVorbis_File *oggFile,
-		const std::string &filename_for_logging)
+// Decodes and closes an opened file, does not use OpenAL
+bool decode_opened_ogg_file(OggVorbis_File *oggFile,
+		const std::string &filename_for_logging, DecodedSound &dst)
 {
 	int endian = 0; // 0 for Little-Endian, 1 for Big-Endian
 	int bitStream;
@@ -120,21 +121,17 @@ SoundBuffer *load_opened_ogg_file(OggVorbis_File *oggFile,
 	char array[BUFFER_SIZE]; // Local fixed size array
 	vorbis_info *pInfo;
 
-	SoundBuffer *snd = new SoundBuffer;
-
 	// Get some information about the OGG file
 	pInfo = ov_info(oggFile, -1);
 
 	// Check the number of channels... always use 16-bit samples
-	if(pInfo->channels == 1)
-		snd->format = AL_FORMAT_MONO16;
-	else
-		snd->format = AL_FORMAT_STEREO16;
+	dst.stereo = pInfo->channels != 1;
 
 	// The frequency of the sampling rate
-	snd->freq = pInfo->rate;
+	dst.freq = pInfo->rate;
 
 	// Keep reading until all is read
+	dst.samples.clear();
 	do
 	{
 		// Read up to a buffer's worth of decoded sound data
@@ -145,14 +142,28 @@ SoundBuffer *load_opened_ogg_file(OggVorbis_File *oggFile,
 			ov_clear(oggFile);
 			infostream << "Audio: Error decoding "
 				<< filename_for_logging << std::endl;
-			delete snd;
-			return nullptr;
+			return false;
 		}
 
 		// Append to end of buffer
-		snd->buffer.insert(snd->buffer.end(), array, array + bytes);
+		dst.samples.insert(dst.samples.end(), array, array + bytes);
 	} while (bytes > 0);
 
+	// Clean up!
+	ov_clear(oggFile);
+
+	return true;
+}
+
+// Uploads decoded samples to OpenAL, takes over the samples of sound
+SoundBuffer *load_decoded_sound(DecodedSound &sound,
+		const std::string &filename_for_logging)
+{
+	SoundBuffer *snd = new SoundBuffer;
+	snd->format = sound.stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+	snd->freq = sound.freq;
+	snd->buffer.swap(sound.samples);
+
 	alGenBuffers(1, &snd->buffer_id);
 	alBufferData(snd->buffer_id, snd->format,
 			&(snd->buffer[0]), snd->buffer.size(),
@@ -168,12 +179,19 @@ SoundBuffer *load_opened_ogg_file(OggVorbis_File *oggFile,
 	infostream << "Audio file "
 		<< filename_for_logging << " loaded" << std::endl;
 
-	// Clean up!
-	ov_clear(oggFile);
-
 	return snd;
 }
 
+SoundBuffer *load_opened_ogg_file(OggVorbis_File *oggFile,
+		const std::string &filename_for_logging)
+{
+	DecodedSound sound;
+	if (!decode_opened_ogg_file(oggFile, filename_for_logging, sound))
+		return nullptr;
+
+	return load_decoded_sound(sound, filename_for_logging);
+}
+
 SoundBuffer *load_ogg_from_file(const std::string &path)
 {
 	OggVorbis_File oggFile;
@@ -241,7 +259,8 @@ static ov_callbacks g_buffer_ov_callbacks = {
 	&BufferSourceell_func
 };
 
-SoundBuffer *load_ogg_from_buffer(const std::string &buf, const std::string &id_for_log)
+bool decode_ogg_from_buffer(const std::string &buf,
+		const std::string &id_for_log, DecodedSound &dst)
 {
 	OggVorbis_File oggFile;
 
@@ -253,10 +272,19 @@ SoundBuffer *load_ogg_from_buffer(const std::string &buf, const std::string &id_
 	if (ov_open_callbacks(&s, &oggFile, nullptr, 0, g_buffer_ov_callbacks) != 0) {
 		infostream << "Audio: Error opening " << id_for_log
 			<< " for decoding" << std::endl;
-		return nullptr;
+		return false;
 	}
 
-	return load_opened_ogg_file(&oggFile, id_for_log);
+	return decode_opened_ogg_file(&oggFile, id_for_log, dst);
+}
+
+SoundBuffer *load_ogg_from_buffer(const std::string &buf, const std::string &id_for_log)
+{
+	DecodedSound sound;
+	if (!decode_ogg_from_buffer(buf, id_for_log, sound))
+		return nullptr;
+
+	return load_decoded_sound(sound, id_for_log);
 }
 
 struct PlayingSound
@@ -542,6 +570,18 @@ class OpenALSoundManager: public ISoundManager
 		return false;
 	}
 
+	bool decodeSoundData(const std::string &filedata,
+			const std::string &id_for_log, DecodedSound &dst)
+	{
+		return decode_ogg_from_buffer(filedata, id_for_log, dst);
+	}
+
+	bool loadDecodedSound(const std::string &name, DecodedSound &sound)
+	{
+		addBuffer(name, load_decoded_sound(sound, name));
+		return true;
+	}
+
 	void updateListener(const v3f &pos, const v3f &vel, const v3f &at, const v3f &up)
 	{
 		alListener3f(AL_POSITION, pos.X, pos.Y, pos.Z);
@@ -24,8 +24,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <IrrCompileConfig.h>
 #include "util/string.h"
 #include "util/container.h"
+#include "util/numeric.h"
 #include "util/thread.h"
 #include "filesys.h"
+#include "imagecache.h"
+#include "porting.h"
 #include "settings.h"
 #include "mesh.h"
 #include "gamedef.h"
@@ -194,11 +197,55 @@ struct TextureInfo
 	}
 };
 
+/*
+	Settings read by generateImagePart(), see GeneratedImageCache
+*/
+static std::string getGeneratedImageSettingsKey()
+{
+	std::ostringstream os;
+	os << g_settings->getBool("texture_clean_transparent") << ","
+			<< (g_settings->getBool("trilinear_filter") ||
+				g_settings->getBool("bilinear_filter")) << ","
+			<< g_settings->getS32("texture_min_size") << ","
+			<< ENABLE_GLES;
+	return os.str();
+}
+
+/*
+	Hash of the pixels of an image, never 0
+*/
+static u64 hashImage(video::IImage *img)
+{
+	core::dimension2d<u32> dim = img->getDimension();
+	unsigned int seed = dim.Width ^ (dim.Height << 12) ^
+			((unsigned int)img->getColorFormat() << 24);
+	u64 hash = murmur_hash_64_ua(img->lock(), (int)img->getImageDataSizeInBytes(),
+			seed);
+	img->unlock();
+	return hash ? hash : 1;
+}
+
+/*
+	Hash of the path, size and modification time of a file, never 0.
+	0 if there is no such file.
+*/
+static u64 hashFileInfo(const std::string &path)
+{
+	u64 size, mtime;
+	if (!fs::GetFileInfo(path, &size, &mtime))
+		return 0;
+	std::ostringstream os;
+	os << path << ":" << size << ":" << mtime;
+	const std::string &key = os.str();
+	u64 hash = murmur_hash_64_ua(key.data(), (int)key.size(), 0x1337);
+	return hash ? hash : 1;
+}
+
 /*
 	SourceImageCache: A cache used for storing source images.
 */
 
-class SourceImageCache
+class SourceImageCache : public ISourceImageHashes
 {
 public:
 	~SourceImageCache() {
@@ -207,7 +254,10 @@ class SourceImageCache
 		}
 		m_images.clear();
 	}
-	void insert(const std::string &name, video::IImage *img, bool prefer_local)
+	// file_hash is the hash of the data img was decoded from, 0 if there is
+	// no such file
+	void insert(const std::string &name, video::IImage *img, bool prefer_local,
+			u64 file_hash)
 	{
 		assert(img); // Pre-condition
 		// Remove old image
@@ -232,6 +282,7 @@ class SourceImageCache
 				if (img2){
 					toadd = img2;
 					need_to_grab = false;
+					file_hash = hashFileInfo(path);
 				}
 			}
 		}
@@ -239,6 +290,8 @@ class SourceImageCache
 		if (need_to_grab)
 			toadd->grab();
 		m_images[name] = toadd;
+		// Images made in memory are small, like the shader flags texture
+		m_hashes[name] = file_hash ? file_hash : hashImage(toadd);
 	}
 	video::IImage* get(const std::string &name)
 	{
@@ -274,8 +327,22 @@ class SourceImageCache
 		}
 		return img;
 	}
+	// Files not loaded yet are looked up, but not read
+	u64 getSourceHash(const std::string &name) override
+	{
+		std::map<std::string, u64>::iterator n = m_hashes.find(name);
+		if (n != m_hashes.end())
+			return n->second;
+		std::string path = getTexturePath(name);
+		if (path.empty())
+			return 0;
+		u64 hash = hashFileInfo(path);
+		m_hashes[name] = hash;
+		return hash;
+	}
 private:
 	std::map<std::string, video::IImage*> m_images;
+	std::map<std::string, u64> m_hashes;
 };
 
 /*
@@ -372,7 +439,8 @@ class TextureSource : public IWritableTextureSource
 
 	// Insert an image into the cache without touching the filesystem.
 	// Shall be called from the main thread.
-	void insertSourceImage(const std::string &name, video::IImage *img);
+	void insertSourceImage(const std::string &name, video::IImage *img,
+			u64 file_hash);
 
 	// Rebuild images and textures from the current set of source images
 	// Shall be called from the main thread.
@@ -391,6 +459,14 @@ class TextureSource : public IWritableTextureSource
 	// This should be only accessed from the main thread
 	SourceImageCache m_sourcecache;
 
+	// Cache of images made from texture modifiers
+	// This should be only accessed from the main thread
+	GeneratedImageCache m_generated_cache;
+	// Names of the source images used by the generateImage() calls in
+	// progress, see GeneratedImageCache
+	std::vector<std::string> m_source_names;
+	u32 m_generate_depth = 0;
+
 	// Generate a texture
 	u32 generateTexture(const std::string &name);
 
@@ -405,6 +481,9 @@ class TextureSource : public IWritableTextureSource
 	 */
 	video::IImage* generateImage(const std::string &name);
 
+	// generateImage() without looking at m_generated_cache
+	video::IImage* generateImageUncached(const std::string &name);
+
 	// Thread-safe cache of what source images are known (true = known)
 	MutexedMap<std::string, bool> m_source_image_existence;
 
@@ -437,7 +516,12 @@ IWritableTextureSource *createTextureSource()
 	return new TextureSource();
 }
 
-TextureSource::TextureSource()
+TextureSource::TextureSource():
+	m_generated_cache(RenderingEngine::get_video_driver(),
+		g_settings->getBool("texture_disk_cache") ?
+		porting::path_cache + DIR_DELIM + "textures" : "",
+		getGeneratedImageSettingsKey(),
+		g_settings->getU64("texture_disk_cache_size") * 1024 * 1024)
 {
 	m_main_thread = std::this_thread::get_id();
 
@@ -503,7 +587,7 @@ u32 TextureSource::getTextureId(const std::string &name)
 	infostream<<"getTextureId(): Queued: name=\""<<name<<"\""<<std::endl;
 
 	// We're gonna ask the result to be put into here
-	static ResultQueue<std::string, u32, u8, u8> result_queue;
+	static thread_local ResultQueue<std::string, u32, u8, u8> result_queue;
 
 	// Throw a request in
 	m_get_texture_queue.add(name, 0, 0, &result_queue);
@@ -746,13 +830,14 @@ void TextureSource::processQueue()
 	}
 }
 
-void TextureSource::insertSourceImage(const std::string &name, video::IImage *img)
+void TextureSource::insertSourceImage(const std::string &name, video::IImage *img,
+		u64 file_hash)
 {
 	//infostream<<"TextureSource::insertSourceImage(): name="<<name<<std::endl;
 
 	sanity_check(std::this_thread::get_id() == m_main_thread);
 
-	m_sourcecache.insert(name, img, true);
+	m_sourcecache.insert(name, img, true, file_hash);
 	m_source_image_existence.set(name, true);
 }
 
@@ -903,6 +988,32 @@ static video::IImage *createInventoryCubeImage(
 }
 
 video::IImage* TextureSource::generateImage(const std::string &name)
+{
+	m_generate_depth++;
+	size_t sources_begin = m_source_names.size();
+
+	video::IImage *img;
+	if (name.find_first_of("^[") == std::string::npos) {
+		// Plain file names are only kept in the source image cache
+		img = generateImageUncached(name);
+	} else {
+		img = m_generated_cache.get(name, m_sourcecache, m_source_names);
+		if (!img) {
+			img = generateImageUncached(name);
+			// Only whole texture names are worth keeping across joins
+			if (img)
+				m_generated_cache.insert(name, img, m_sourcecache,
+						m_source_names, sources_begin, m_generate_depth == 1);
+		}
+	}
+
+	m_generate_depth--;
+	if (m_generate_depth == 0)
+		m_source_names.clear();
+	return img;
+}
+
+video::IImage* TextureSource::generateImageUncached(const std::string &name)
 {
 	// Get the base image
 
@@ -1093,6 +1204,7 @@ bool TextureSource::generateImagePart(std::string part_of_name,
 
 	// Stuff starting with [ are special commands
 	if (part_of_name.empty() || part_of_name[0] != '[') {
+		m_source_names.push_back(part_of_name);
 		video::IImage *image = m_sourcecache.getOrLoad(part_of_name);
 #if ENABLE_GLES
 		image = Align2Npot2(image, driver);
@@ -1234,6 +1346,7 @@ bool TextureSource::generateImagePart(std::string part_of_name,
 					It is an image with a number of cracking stages
 					horizontally tiled.
 				*/
+				m_source_names.push_back("crack_anylength.png");
 				video::IImage *img_crack = m_sourcecache.getOrLoad(
 					"crack_anylength.png");
 
@@ -2256,7 +2369,7 @@ video::ITexture *TextureSource::getShaderFlagsTexture(bool normalmap_present)
 	sanity_check(flags_image != NULL);
 	video::SColor c(255, normalmap_present ? 255 : 0, 0, 0);
 	flags_image->setPixel(0, 0, c);
-	insertSourceImage(tname, flags_image);
+	insertSourceImage(tname, flags_image, 0);
 	flags_image->drop();
 	return getTexture(tname);
 
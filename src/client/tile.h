@@ -125,7 +125,10 @@ class IWritableTextureSource : public ITextureSource
 	virtual bool isKnownSourceImage(const std::string &name)=0;
 
 	virtual void processQueue()=0;
-	virtual void insertSourceImage(const std::string &name, video::IImage *img)=0;
+	// file_hash identifies the data img was decoded from, like a hash of the
+	// media file. 0 if it was made in memory.
+	virtual void insertSourceImage(const std::string &name, video::IImage *img,
+			u64 file_hash)=0;
 	virtual void rebuildImagesAndTextures()=0;
 	virtual video::ITexture* getNormalTexture(const std::string &name)=0;
 	virtual video::SColor getTextureAverageColor(const std::string &name)=0;
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <algorithm>
 #include <sstream>
 #include "clientiface.h"
 #include "network/connection.h"
@@ -790,6 +791,39 @@ RemoteClient* ClientInterface::lockedGetClientNoEx(session_t peer_id, ClientStat
 	return NULL;
 }
 
+void ClientInterface::addKnownObject(RemoteClient *client, u16 id)
+{
+	if (!client->m_known_objects.insert(id).second)
+		return;
+
+	m_object_subscribers[id].push_back(client);
+}
+
+void ClientInterface::removeKnownObject(RemoteClient *client, u16 id)
+{
+	if (client->m_known_objects.erase(id) == 0)
+		return;
+	client->m_position_updates_skipped.erase(id);
+
+	auto subscribers = m_object_subscribers.find(id);
+	if (subscribers == m_object_subscribers.end())
+		return;
+
+	std::vector<RemoteClient *> &list = subscribers->second;
+	list.erase(std::remove(list.begin(), list.end(), client), list.end());
+	if (list.empty())
+		m_object_subscribers.erase(subscribers);
+}
+
+const std::vector<RemoteClient *> *ClientInterface::getObjectSubscribers(u16 id) const
+{
+	auto subscribers = m_object_subscribers.find(id);
+	if (subscribers == m_object_subscribers.end())
+		return nullptr;
+
+	return &subscribers->second;
+}
+
 ClientState ClientInterface::getClientState(session_t peer_id)
 {
 	RecursiveMutexAutoLock clientslock(m_clients_mutex);
@@ -835,6 +869,14 @@ void ClientInterface::DeleteClient(session_t peer_id)
 
 		if(obj && obj->m_known_by_count > 0)
 			obj->m_known_by_count--;
+
+		auto subscribers = m_object_subscribers.find(id);
+		if (subscribers == m_object_subscribers.end())
+			continue;
+		std::vector<RemoteClient *> &list = subscribers->second;
+		list.erase(std::remove(list.begin(), list.end(), client), list.end());
+		if (list.empty())
+			m_object_subscribers.erase(subscribers);
 	}
 
 	// Delete client
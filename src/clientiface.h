@@ -30,6 +30,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <list>
 #include <vector>
 #include <set>
+#include <unordered_map>
 #include <mutex>
 
 class MapBlock;
@@ -302,6 +303,18 @@ class RemoteClient
 		List of active objects that the client knows of.
 	*/
 	std::set<u16> m_known_objects;
+	/*
+		Position updates held back per known object because of the
+		distance based update rate (active_object_lod_distance)
+	*/
+	struct PositionUpdateSkips
+	{
+		u8 count = 0;
+		// Motion of the last update sent, updates changing it are sent
+		v3f velocity;
+		v3f acceleration;
+	};
+	std::unordered_map<u16, PositionUpdateSkips> m_position_updates_skipped;
 
 	ClientState getState() const { return m_state; }
 
@@ -465,6 +478,13 @@ class ClientInterface {
 	/* get client by peer_id (make sure you have list lock before!*/
 	RemoteClient *lockedGetClientNoEx(session_t peer_id,  ClientState state_min = CS_Active);
 
+	/* mark object as (not) known by client (make sure you have list lock before!) */
+	void addKnownObject(RemoteClient *client, u16 id);
+	void removeKnownObject(RemoteClient *client, u16 id);
+
+	/* get clients knowing an object, or nullptr (make sure you have list lock before!) */
+	const std::vector<RemoteClient *> *getObjectSubscribers(u16 id) const;
+
 	/* get state of client by id*/
 	ClientState getClientState(session_t peer_id);
 
@@ -507,6 +527,9 @@ class ClientInterface {
 	RemoteClientMap m_clients;
 	std::vector<std::string> m_clients_names; //for announcing masterserver
 
+	// Clients knowing each object, the inverse of RemoteClient::m_known_objects
+	std::unordered_map<u16, std::vector<RemoteClient *>> m_object_subscribers;
+
 	// Environment
 	ServerEnvironment *m_env;
 
@@ -30,11 +30,17 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "serverobject.h"
 #include "util/timetaker.h"
 #include "profiler.h"
+#include "threading/mutex_auto_lock.h"
 
 // float error is 10 - 9.96875 = 0.03125
 //#define COLL_ZERO 0.032 // broken unit tests
 #define COLL_ZERO 0
 
+// Entity physics may run on several threads, see ServerActiveObject::stepPhysics().
+// Map lookups update the lookup caches of the map and collision caches are
+// built on first use, so both are serialized.
+static std::mutex s_map_access_mutex;
+
 
 struct NearbyCollisionInfo {
 	NearbyCollisionInfo(bool is_ul, bool is_obj, int bouncy,
@@ -206,11 +212,64 @@ bool wouldCollideWithCeiling(
 static inline void getNeighborConnectingFace(const v3s16 &p,
 	const NodeDefManager *nodedef, Map *map, MapNode n, int v, int *neighbors)
 {
-	MapNode n2 = map->getNode(p);
+	MapNode n2;
+	{
+		MutexAutoLock lock(s_map_access_mutex);
+		n2 = map->getNode(p);
+	}
 	if (nodedef->nodeboxConnects(n, n2, v))
 		*neighbors |= v;
 }
 
+static const MapBlockCollisionCache &getCollisionCache(MapBlock *block,
+	const NodeDefManager *nodedef)
+{
+	block->collision_cache_unused_time = 0.0f;
+	if (block->collision_cache)
+		return *block->collision_cache;
+
+	block->collision_cache.reset(new MapBlockCollisionCache());
+	MapBlockCollisionCache &cache = *block->collision_cache;
+
+	const MapNode *data = block->getData();
+	std::vector<aabb3f> nodeboxes;
+	for (u32 i = 0; i < MapBlock::nodecount; i++) {
+		cache.first_box[i] = cache.boxes.size();
+		cache.node_flags[i] = 0;
+
+		const MapNode &n = data[i];
+		if (n.getContent() == CONTENT_IGNORE) {
+			cache.node_flags[i] = MapBlockCollisionCache::NODE_IGNORE;
+			continue;
+		}
+
+		const ContentFeatures &f = nodedef->get(n);
+		if (!f.walkable)
+			continue;
+
+		if (f.drawtype == NDT_NODEBOX && f.node_box.type == NODEBOX_CONNECTED) {
+			cache.node_flags[i] = MapBlockCollisionCache::NODE_CONNECTED;
+			continue;
+		}
+
+		nodeboxes.clear();
+		n.getCollisionBoxes(nodedef, &nodeboxes);
+
+		v3s16 p(i % MAP_BLOCKSIZE, (i / MAP_BLOCKSIZE) % MAP_BLOCKSIZE,
+			i / (MAP_BLOCKSIZE * MAP_BLOCKSIZE));
+		v3f posf = intToFloat(p, BS);
+		int bouncy = itemgroup_get(f.groups, "bouncy");
+		for (aabb3f box : nodeboxes) {
+			box.MinEdge += posf;
+			box.MaxEdge += posf;
+			cache.boxes.push_back(box);
+			cache.box_bouncy.push_back(bouncy);
+		}
+	}
+	cache.first_box[MapBlock::nodecount] = cache.boxes.size();
+	return cache;
+}
+
 collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		f32 pos_max_d, const aabb3f &box_0,
 		f32 stepheight, f32 dtime,
@@ -218,7 +277,7 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		v3f accel_f, ActiveObject *self,
 		bool collideWithObjects)
 {
-	static bool time_notification_done = false;
+	static thread_local bool time_notification_done = false;
 	Map *map = &env->getMap();
 
 	ScopeProfiler sp(g_profiler, "collisionMoveSimple()", SPT_AVG);
@@ -252,7 +311,9 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	/*
 		Collect node boxes in movement range
 	*/
-	std::vector<NearbyCollisionInfo> cinfo;
+	// Reused between calls to keep its memory
+	static thread_local std::vector<NearbyCollisionInfo> cinfo;
+	cinfo.clear();
 	{
 	//TimeTaker tt2("collisionMoveSimple collect boxes");
 	ScopeProfiler sp2(g_profiler, "collisionMoveSimple(): collect boxes", SPT_AVG);
@@ -272,29 +333,60 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	v3s16 max = floatToInt(maxpos_f + box_0.MaxEdge, BS) + v3s16(1, 1, 1);
 
 	bool any_position_valid = false;
+	const NodeDefManager *nodedef = gamedef->getNodeDefManager();
+
+	// Node boxes come from the per-block cache, only the last used block
+	// is looked up again
+	v3s16 cached_blockpos(S16_MAX, S16_MAX, S16_MAX);
+	MapBlock *block = nullptr;
+	const MapBlockCollisionCache *cache = nullptr;
 
 	v3s16 p;
 	for (p.X = min.X; p.X <= max.X; p.X++)
 	for (p.Y = min.Y; p.Y <= max.Y; p.Y++)
 	for (p.Z = min.Z; p.Z <= max.Z; p.Z++) {
-		bool is_position_valid;
-		MapNode n = map->getNode(p, &is_position_valid);
+		v3s16 blockpos = getNodeBlockPos(p);
+		if (blockpos != cached_blockpos) {
+			cached_blockpos = blockpos;
+			MutexAutoLock lock(s_map_access_mutex);
+			block = map->getBlockNoCreateNoEx(blockpos);
+			cache = block && !block->isDummy() ?
+				&getCollisionCache(block, nodedef) : nullptr;
+		}
+
+		u8 flags = MapBlockCollisionCache::NODE_IGNORE;
+		u32 index = 0;
+		if (cache) {
+			v3s16 relpos = p - blockpos * MAP_BLOCKSIZE;
+			index = relpos.Z * MapBlock::zstride + relpos.Y * MapBlock::ystride +
+				relpos.X;
+			flags = cache->node_flags[index];
+		}
 
-		if (is_position_valid && n.getContent() != CONTENT_IGNORE) {
+		if (!(flags & MapBlockCollisionCache::NODE_IGNORE)) {
 			// Object collides into walkable nodes
 
 			any_position_valid = true;
-			const NodeDefManager *nodedef = gamedef->getNodeDefManager();
-			const ContentFeatures &f = nodedef->get(n);
 
-			if (!f.walkable)
+			if (!(flags & MapBlockCollisionCache::NODE_CONNECTED)) {
+				v3f blockposf = intToFloat(blockpos * MAP_BLOCKSIZE, BS);
+				for (u32 i = cache->first_box[index];
+						i < cache->first_box[index + 1]; i++) {
+					aabb3f box = cache->boxes[i];
+					box.MinEdge += blockposf;
+					box.MaxEdge += blockposf;
+					cinfo.emplace_back(false, false, cache->box_bouncy[i], p, box);
+				}
 				continue;
+			}
 
+			// Connected node boxes depend on the neighbours
+			MapNode n = block->getData()[index];
+			const ContentFeatures &f = nodedef->get(n);
 			int n_bouncy_value = itemgroup_get(f.groups, "bouncy");
 
 			int neighbors = 0;
-			if (f.drawtype == NDT_NODEBOX &&
-				f.node_box.type == NODEBOX_CONNECTED) {
+			{
 				v3s16 p2 = p;
 
 				p2.Y++;
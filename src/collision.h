@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #pragma once
 
 #include "irrlichttypes_bloated.h"
+#include "constants.h"
 #include <vector>
 
 class Map;
@@ -63,6 +64,28 @@ struct collisionMoveResult
 	std::vector<CollisionInfo> collisions;
 };
 
+/*
+	Collision boxes of all walkable nodes in a MapBlock, in BS units relative
+	to the block origin. Built on first use and freed when the block changes,
+	see MapBlock::collision_cache.
+*/
+struct MapBlockCollisionCache
+{
+	enum NodeFlags : u8 {
+		// The node is CONTENT_IGNORE, collide as with unloaded nodes
+		NODE_IGNORE = 0x01,
+		// The boxes depend on the neighbours and are not cached
+		NODE_CONNECTED = 0x02,
+	};
+
+	u8 node_flags[MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	// The boxes of node i are boxes[first_box[i]] to boxes[first_box[i + 1] - 1]
+	u32 first_box[MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE + 1];
+	std::vector<aabb3f> boxes;
+	// Value of the "bouncy" group of the node, for each box
+	std::vector<int> box_bouncy;
+};
+
 // Moves using a single iteration; speed should not exceed pos_max_d/dtime
 collisionMoveResult collisionMoveSimple(Environment *env,IGameDef *gamedef,
 		f32 pos_max_d, const aabb3f &box_0,
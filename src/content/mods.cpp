@@ -408,9 +408,8 @@ void ModMetadata::clear()
 bool ModMetadata::save(const std::string &root_path)
 {
 	Json::Value json;
-	for (StringMap::const_iterator it = m_stringvars.begin();
-			it != m_stringvars.end(); ++it) {
-		json[it->first] = it->second;
+	for (const auto &it : getStrings()) {
+		json[it.first] = it.second;
 	}
 
 	if (!fs::PathExists(root_path)) {
@@ -440,7 +439,7 @@ bool ModMetadata::save(const std::string &root_path)
 
 bool ModMetadata::load(const std::string &root_path)
 {
-	m_stringvars.clear();
+	Metadata::clear();
 
 	std::ifstream is((root_path + DIR_DELIM + m_mod_name).c_str(),
 			std::ios_base::binary);
@@ -461,10 +460,11 @@ bool ModMetadata::load(const std::string &root_path)
 		return false;
 	}
 
+	StringMap &vars = getStringsMutable();
 	const Json::Value::Members attr_list = root.getMemberNames();
 	for (const auto &it : attr_list) {
 		Json::Value attr_value = root[it];
-		m_stringvars[it] = attr_value.asString();
+		vars[it] = attr_value.asString();
 	}
 
 	return true;
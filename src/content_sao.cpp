@@ -132,6 +132,7 @@ void UnitSAO::setArmorGroups(const ItemGroupList &armor_groups)
 {
 	m_armor_groups = armor_groups;
 	m_armor_groups_sent = false;
+	wakeUp();
 }
 
 const ItemGroupList &UnitSAO::getArmorGroups() const
@@ -147,6 +148,7 @@ void UnitSAO::setAnimation(v2f frame_range, float frame_speed, float frame_blend
 	m_animation_blend = frame_blend;
 	m_animation_loop = frame_loop;
 	m_animation_sent = false;
+	wakeUp();
 }
 
 void UnitSAO::getAnimation(v2f *frame_range, float *frame_speed, float *frame_blend, bool *frame_loop)
@@ -161,6 +163,7 @@ void UnitSAO::setAnimationSpeed(float frame_speed)
 {
 	m_animation_speed = frame_speed;
 	m_animation_speed_sent = false;
+	wakeUp();
 }
 
 void UnitSAO::setBonePosition(const std::string &bone, v3f position, v3f rotation)
@@ -168,6 +171,7 @@ void UnitSAO::setBonePosition(const std::string &bone, v3f position, v3f rotatio
 	// store these so they can be updated to clients
 	m_bone_position[bone] = core::vector2d<v3f>(position, rotation);
 	m_bone_position_sent = false;
+	wakeUp();
 }
 
 void UnitSAO::getBonePosition(const std::string &bone, v3f *position, v3f *rotation)
@@ -192,6 +196,7 @@ void UnitSAO::setAttachment(int parent_id, const std::string &bone, v3f position
 	m_attachment_position = position;
 	m_attachment_rotation = rotation;
 	m_attachment_sent = false;
+	wakeUp();
 
 	if (parent_id != old_parent) {
 		onDetach(old_parent);
@@ -235,6 +240,7 @@ void UnitSAO::clearParentAttachment()
 void UnitSAO::addAttachmentChild(int child_id)
 {
 	m_attachment_child_ids.insert(child_id);
+	wakeUp();
 }
 
 void UnitSAO::removeAttachmentChild(int child_id)
@@ -287,6 +293,38 @@ ObjectProperties* UnitSAO::accessObjectProperties()
 void UnitSAO::notifyObjectPropertiesModified()
 {
 	m_properties_sent = false;
+	wakeUp();
+}
+
+void UnitSAO::sendPropertiesUpdate(const std::string &full_packet)
+{
+	m_properties_sent = true;
+
+	if (m_prop_send_full) {
+		m_prop_send_full = false;
+		m_prop_sent = m_prop;
+		m_messages_out.emplace(getId(), true, full_packet);
+		return;
+	}
+
+	u32 fields = m_prop.diff(m_prop_sent);
+	if (fields == 0)
+		return;
+	m_prop_sent = m_prop;
+
+	ActiveObjectMessage aom(getId(), true, gob_cmd_update_properties(m_prop, fields));
+	aom.legacy_datastring = full_packet;
+	aom.min_protocol_version = 40;
+	m_messages_out.push(aom);
+}
+
+std::string UnitSAO::getInitPropertyPacket(const std::string &full_packet)
+{
+	// The client now holds m_prop, which a delta against m_prop_sent
+	// would not fully correct
+	if (!m_prop_send_full && m_prop.diff(m_prop_sent) != 0)
+		m_prop_send_full = true;
+	return full_packet;
 }
 
 /*
@@ -337,6 +375,9 @@ void LuaEntitySAO::addedToEnvironment(u32 dtime_s)
 		// Activate entity, supplying serialized state
 		m_env->getScriptIface()->
 			luaentity_Activate(m_id, m_init_state, dtime_s);
+		// Entities without on_step may fall asleep when idle
+		m_has_on_step = m_env->getScriptIface()->
+			luaentity_HasCallback(m_id, "on_step");
 	} else {
 		m_prop.infotext = m_init_name;
 	}
@@ -397,13 +438,7 @@ ServerActiveObject* LuaEntitySAO::create(ServerEnvironment *env, v3f pos,
 void LuaEntitySAO::step(float dtime, bool send_recommended)
 {
 	if(!m_properties_sent)
-	{
-		m_properties_sent = true;
-		std::string str = getPropertyPacket();
-		// create message and add to list
-		ActiveObjectMessage aom(getId(), true, str);
-		m_messages_out.push(aom);
-	}
+		sendPropertiesUpdate(getPropertyPacket());
 
 	// If attached, check that our parent is still there. If it isn't, detach.
 	if(m_attachment_parent_id && !isAttached())
@@ -429,23 +464,15 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 	else
 	{
 		if(m_prop.physical){
-			aabb3f box = m_prop.collisionbox;
-			box.MinEdge *= BS;
-			box.MaxEdge *= BS;
-			collisionMoveResult moveresult;
-			f32 pos_max_d = BS*0.25; // Distance per iteration
-			v3f p_pos = m_base_position;
-			v3f p_velocity = m_velocity;
-			v3f p_acceleration = m_acceleration;
-			moveresult = collisionMoveSimple(m_env, m_env->getGameDef(),
-					pos_max_d, box, m_prop.stepheight, dtime,
-					&p_pos, &p_velocity, p_acceleration,
-					this, m_prop.collideWithObjects);
+			// The movement may have been computed by stepPhysics() already
+			if (!m_physics_pending)
+				collideMove(dtime);
 
 			// Apply results
-			m_base_position = p_pos;
-			m_velocity = p_velocity;
-			m_acceleration = p_acceleration;
+			m_base_position = m_physics_position;
+			m_velocity = m_physics_velocity;
+			m_touching_ground = m_physics_touching_ground;
+			m_physics_pending = false;
 		} else {
 			m_base_position += dtime * m_velocity + 0.5 * dtime
 					* dtime * m_acceleration;
@@ -474,6 +501,11 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 		m_env->getScriptIface()->luaentity_Step(m_id, dtime);
 	}
 
+	if (isResting())
+		m_resting_time += dtime;
+	else
+		m_resting_time = 0.0f;
+
 	if (!send_recommended)
 		return;
 
@@ -543,6 +575,80 @@ void LuaEntitySAO::step(float dtime, bool send_recommended)
 		ActiveObjectMessage aom(getId(), true, str);
 		m_messages_out.push(aom);
 	}
+
+	// Everything has been sent, stop stepping the entity if it stays idle
+	if (m_resting_time > ENTITY_SLEEP_DELAY &&
+			m_base_position.getDistanceFrom(m_last_sent_position) < 0.01f * BS)
+		sleep();
+}
+
+void LuaEntitySAO::stepPhysics(float dtime)
+{
+	// Same conditions as in step(), which runs after this
+	if (!m_prop.physical || isAttached())
+		return;
+
+	collideMove(dtime);
+}
+
+void LuaEntitySAO::collideMove(float dtime)
+{
+	aabb3f box = m_prop.collisionbox;
+	box.MinEdge *= BS;
+	box.MaxEdge *= BS;
+	f32 pos_max_d = BS*0.25; // Distance per iteration
+	m_physics_position = m_base_position;
+	m_physics_velocity = m_velocity;
+	collisionMoveResult moveresult = collisionMoveSimple(m_env,
+			m_env->getGameDef(), pos_max_d, box, m_prop.stepheight, dtime,
+			&m_physics_position, &m_physics_velocity, m_acceleration,
+			this, m_prop.collideWithObjects);
+	m_physics_touching_ground = moveresult.touching_ground;
+	m_physics_pending = true;
+}
+
+bool LuaEntitySAO::isResting() const
+{
+	if (!m_registered || m_has_on_step || isAttached() ||
+			!m_attachment_child_ids.empty())
+		return false;
+
+	if (m_velocity.getLengthSQ() > 1e-6f || m_last_sent_velocity.getLengthSQ() > 1e-6f)
+		return false;
+
+	if (m_acceleration == v3f())
+		return true;
+
+	// Gravity does not move physical objects lying on the ground
+	return m_prop.physical && m_touching_ground && m_acceleration.X == 0.0f &&
+		m_acceleration.Z == 0.0f && m_acceleration.Y < 0.0f;
+}
+
+void LuaEntitySAO::sleep(float duration)
+{
+	// Attached entities follow their parent every step
+	if (isAttached())
+		return;
+
+	if (!isSleeping() && (m_velocity != v3f() ||
+			m_acceleration != v3f() || m_last_sent_velocity != v3f())) {
+		// The entity does not move while sleeping, stop it on the clients
+		m_last_sent_position = m_base_position;
+		m_last_sent_velocity = v3f();
+		m_last_sent_position_timer = 0;
+		std::string str = gob_cmd_update_position(m_base_position, v3f(), v3f(),
+			m_rotation, true, true, m_env->getSendRecommendedInterval());
+		m_messages_out.emplace(getId(), false, str);
+	}
+
+	UnitSAO::sleep(duration);
+}
+
+void LuaEntitySAO::wakeUp()
+{
+	m_resting_time = 0.0f;
+	m_physics_pending = false;
+	UnitSAO::wakeUp();
 }
 
 std::string LuaEntitySAO::getClientInitializationData(u16 protocol_version)
@@ -559,7 +665,7 @@ std::string LuaEntitySAO::getClientInitializationData(u16 protocol_version)
 	writeU16(os, m_hp);
 
 	std::ostringstream msg_os(std::ios::binary);
-	msg_os << serializeLongString(getPropertyPacket()); // message 1
+	msg_os << serializeLongString(getInitPropertyPacket(getPropertyPacket())); // message 1
 	msg_os << serializeLongString(gob_cmd_update_armor_groups(m_armor_groups)); // 2
 	msg_os << serializeLongString(gob_cmd_update_animation(
 		m_animation_range, m_animation_speed, m_animation_blend, m_animation_loop)); // 3
@@ -637,6 +743,8 @@ u16 LuaEntitySAO::punch(v3f dir,
 
 	FATAL_ERROR_IF(!puncher, "Punch action called without SAO");
 
+	wakeUp();
+
 	s32 old_hp = getHP();
 	ItemStack selected_item, hand_item;
 	ItemStack tool_item = puncher->getWieldedItem(&selected_item, &hand_item);
@@ -684,6 +792,7 @@ void LuaEntitySAO::rightClick(ServerActiveObject *clicker)
 	if (!m_registered)
 		return;
 
+	wakeUp();
 	m_env->getScriptIface()->luaentity_Rightclick(m_id, clicker);
 }
 
@@ -691,6 +800,7 @@ void LuaEntitySAO::setPos(const v3f &pos)
 {
 	if(isAttached())
 		return;
+	wakeUp();
 	m_base_position = pos;
 	sendPosition(false, true);
 }
@@ -699,6 +809,7 @@ void LuaEntitySAO::moveTo(v3f pos, bool continuous)
 {
 	if(isAttached())
 		return;
+	wakeUp();
 	m_base_position = pos;
 	if(!continuous)
 		sendPosition(true, true);
@@ -732,6 +843,7 @@ u16 LuaEntitySAO::getHP() const
 
 void LuaEntitySAO::setVelocity(v3f velocity)
 {
+	wakeUp();
 	m_velocity = velocity;
 }
 
@@ -742,6 +854,7 @@ v3f LuaEntitySAO::getVelocity()
 
 void LuaEntitySAO::setAcceleration(v3f acceleration)
 {
+	wakeUp();
 	m_acceleration = acceleration;
 }
 
@@ -902,6 +1015,7 @@ void PlayerSAO::finalize(RemotePlayer *player, const std::set<std::string> &priv
 	assert(player);
 	m_player = player;
 	m_privs = privs;
+	updateMovementLimits();
 }
 
 v3f PlayerSAO::getEyeOffset() const
@@ -950,7 +1064,7 @@ std::string PlayerSAO::getClientInitializationData(u16 protocol_version)
 	writeU16(os, getHP());
 
 	std::ostringstream msg_os(std::ios::binary);
-	msg_os << serializeLongString(getPropertyPacket()); // message 1
+	msg_os << serializeLongString(getInitPropertyPacket(getPropertyPacket())); // message 1
 	msg_os << serializeLongString(gob_cmd_update_armor_groups(m_armor_groups)); // 2
 	msg_os << serializeLongString(gob_cmd_update_animation(
 		m_animation_range, m_animation_speed, m_animation_blend, m_animation_loop)); // 3
@@ -1058,11 +1172,7 @@ void PlayerSAO::step(float dtime, bool send_recommended)
 	}
 
 	if (!m_properties_sent) {
-		m_properties_sent = true;
-		std::string str = getPropertyPacket();
-		// create message and add to list
-		ActiveObjectMessage aom(getId(), true, str);
-		m_messages_out.push(aom);
+		sendPropertiesUpdate(getPropertyPacket());
 		m_env->getScriptIface()->player_event(this, "properties_changed");
 	}
 
@@ -1445,36 +1555,14 @@ bool PlayerSAO::checkMovementCheat()
 		too, and much more lightweight.
 	*/
 
-	float override_max_H, override_max_V;
+	float player_max_walk = m_max_walk_speed; // horizontal movement
+	float player_max_jump = m_max_jump_speed; // vertical upwards movement
 	if (m_max_speed_override_time > 0.0f) {
-		override_max_H = MYMAX(fabs(m_max_speed_override.X), fabs(m_max_speed_override.Z));
-		override_max_V = fabs(m_max_speed_override.Y);
-	} else {
-		override_max_H = override_max_V = 0.0f;
+		player_max_walk = MYMAX(player_max_walk,
+			MYMAX(fabs(m_max_speed_override.X), fabs(m_max_speed_override.Z)));
+		player_max_jump = MYMAX(player_max_jump, fabs(m_max_speed_override.Y));
 	}
 
-	float player_max_walk = 0; // horizontal movement
-	float player_max_jump = 0; // vertical upwards movement
-
-	if (m_privs.count("fast") != 0)
-		player_max_walk = m_player->movement_speed_fast; // Fast speed
-	else
-		player_max_walk = m_player->movement_speed_walk; // Normal speed
-	player_max_walk *= m_physics_override_speed;
-	player_max_walk = MYMAX(player_max_walk, override_max_H);
-
-	player_max_jump = m_player->movement_speed_jump * m_physics_override_jump;
-	// FIXME: Bouncy nodes cause practically unbound increase in Y speed,
-	//        until this can be verified correctly, tolerate higher jumping speeds
-	player_max_jump *= 2.0;
-	player_max_jump = MYMAX(player_max_jump, override_max_V);
-
-	// Don't divide by zero!
-	if (player_max_walk < 0.0001f)
-		player_max_walk = 0.0001f;
-	if (player_max_jump < 0.0001f)
-		player_max_jump = 0.0001f;
-
 	v3f diff = (m_base_position - m_last_good_position);
 	float d_vert = diff.Y;
 	diff.Y = 0;
@@ -1506,6 +1594,29 @@ bool PlayerSAO::checkMovementCheat()
 	return cheated;
 }
 
+void PlayerSAO::updateMovementLimits()
+{
+	if (!m_player)
+		return;
+
+	if (m_privs.count("fast") != 0)
+		m_max_walk_speed = m_player->movement_speed_fast; // Fast speed
+	else
+		m_max_walk_speed = m_player->movement_speed_walk; // Normal speed
+	m_max_walk_speed *= m_physics_override_speed;
+
+	m_max_jump_speed = m_player->movement_speed_jump * m_physics_override_jump;
+	// FIXME: Bouncy nodes cause practically unbound increase in Y speed,
+	//        until this can be verified correctly, tolerate higher jumping speeds
+	m_max_jump_speed *= 2.0;
+
+	// Don't divide by zero!
+	if (m_max_walk_speed < 0.0001f)
+		m_max_walk_speed = 0.0001f;
+	if (m_max_jump_speed < 0.0001f)
+		m_max_jump_speed = 0.0001f;
+}
+
 bool PlayerSAO::getCollisionBox(aabb3f *toset) const
 {
 	//update collision box
@@ -32,7 +32,7 @@ class UnitSAO: public ServerActiveObject
 	UnitSAO(ServerEnvironment *env, v3f pos);
 	virtual ~UnitSAO() = default;
 
-	void setRotation(v3f rotation) { m_rotation = rotation; }
+	void setRotation(v3f rotation) { m_rotation = rotation; wakeUp(); }
 	const v3f &getRotation() const { return m_rotation; }
 	v3f getRadRotation() { return m_rotation * core::DEGTORAD; }
 
@@ -74,6 +74,18 @@ class UnitSAO: public ServerActiveObject
 
 	bool m_properties_sent = true;
 	ObjectProperties m_prop;
+	// Properties as of the last update sent to all clients, used to
+	// compute GENERIC_CMD_UPDATE_PROPERTIES deltas
+	ObjectProperties m_prop_sent;
+	// Set when a client may hold properties that differ from m_prop_sent,
+	// the next update then carries all fields
+	bool m_prop_send_full = true;
+
+	// Queues the properties update, `full_packet` is the
+	// GENERIC_CMD_SET_PROPERTIES fallback for older clients
+	void sendPropertiesUpdate(const std::string &full_packet);
+	// Returns the full property packet for a client that just got to know us
+	std::string getInitPropertyPacket(const std::string &full_packet);
 
 	ItemGroupList m_armor_groups;
 	bool m_armor_groups_sent = false;
@@ -118,6 +130,9 @@ class LuaEntitySAO : public UnitSAO
 	static ServerActiveObject* create(ServerEnvironment *env, v3f pos,
 		const std::string &data);
 	void step(float dtime, bool send_recommended);
+	void stepPhysics(float dtime);
+	void sleep(float duration = 0.0f);
+	void wakeUp();
 	std::string getClientInitializationData(u16 protocol_version);
 	bool isStaticAllowed() const
 	{ return m_prop.static_save; }
@@ -138,6 +153,7 @@ class LuaEntitySAO : public UnitSAO
 	void setVelocity(v3f velocity);
 	void addVelocity(v3f velocity)
 	{
+		wakeUp();
 		m_velocity += velocity;
 	}
 	v3f getVelocity();
@@ -155,10 +171,27 @@ class LuaEntitySAO : public UnitSAO
 private:
 	std::string getPropertyPacket();
 	void sendPosition(bool do_interpolate, bool is_movement_end);
+	// Whether the entity would do nothing when stepped
+	bool isResting() const;
+	// Moves the entity into m_physics_*, thread safe
+	void collideMove(float dtime);
 
 	std::string m_init_name;
 	std::string m_init_state;
 	bool m_registered = false;
+	bool m_has_on_step = true;
+
+	// Resting entities fall asleep after this many seconds
+	static constexpr float ENTITY_SLEEP_DELAY = 2.0f;
+	float m_resting_time = 0.0f;
+	bool m_touching_ground = false;
+
+	// Result of collideMove(), applied by the next step(). Anything that
+	// wakes the entity up also discards it.
+	bool m_physics_pending = false;
+	v3f m_physics_position;
+	v3f m_physics_velocity;
+	bool m_physics_touching_ground = false;
 
 	v3f m_velocity;
 	v3f m_acceleration;
@@ -325,6 +358,9 @@ class PlayerSAO : public UnitSAO
 	void setMaxSpeedOverride(const v3f &vel);
 	// Returns true if cheated
 	bool checkMovementCheat();
+	// Caches the speed limits checkMovementCheat() uses, call when the
+	// physics override or the privileges change
+	void updateMovementLimits();
 
 	// Other
 
@@ -333,6 +369,7 @@ class PlayerSAO : public UnitSAO
 	{
 		m_privs = privs;
 		m_is_singleplayer = is_singleplayer;
+		updateMovementLimits();
 	}
 
 	bool getCollisionBox(aabb3f *toset) const;
@@ -364,6 +401,9 @@ class PlayerSAO : public UnitSAO
 	float m_nocheat_dig_time = 0.0f;
 	float m_max_speed_override_time = 0.0f;
 	v3f m_max_speed_override = v3f(0.0f, 0.0f, 0.0f);
+	// Movement limits without the speed override, see updateMovementLimits()
+	float m_max_walk_speed = 0.0f;
+	float m_max_jump_speed = 0.0f;
 
 	// Timers
 	IntervalLimiter m_breathing_interval;
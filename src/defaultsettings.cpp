@@ -42,6 +42,10 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("mute_sound", "false");
 	settings->setDefault("enable_mesh_cache", "false");
 	settings->setDefault("mesh_generation_interval", "0");
+	settings->setDefault("mesh_generation_threads", "0");
+	settings->setDefault("occlusion_culling_threads", "2");
+	settings->setDefault("lod_distance", "0");
+	settings->setDefault("enable_mesh_batching", "false");
 	settings->setDefault("meshgen_block_cache_size", "20");
 	settings->setDefault("enable_vbo", "true");
 	settings->setDefault("free_move", "false");
@@ -59,6 +63,7 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("curl_file_download_timeout", "300000");
 	settings->setDefault("curl_verify_cert", "true");
 	settings->setDefault("enable_remote_media_server", "true");
+	settings->setDefault("media_decode_threads", "0");
 	settings->setDefault("enable_client_modding", "false");
 	settings->setDefault("max_out_chat_queue_size", "20");
 	settings->setDefault("pause_on_lost_focus", "false");
@@ -228,6 +233,8 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("show_entity_selectionbox", "true");
 	settings->setDefault("texture_clean_transparent", "false");
 	settings->setDefault("texture_min_size", "64");
+	settings->setDefault("texture_disk_cache", "true");
+	settings->setDefault("texture_disk_cache_size", "256");
 	settings->setDefault("ambient_occlusion_gamma", "2.2");
 #if ENABLE_GLES
 	settings->setDefault("enable_shaders", "false");
@@ -370,6 +377,8 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("chat_message_format", "<@name> @message");
 	settings->setDefault("profiler_print_interval", "0");
 	settings->setDefault("active_object_send_range_blocks", "4");
+	settings->setDefault("active_object_lod_distance", "32");
+	settings->setDefault("active_object_step_threads", "0");
 	settings->setDefault("active_block_range", "3");
 	//settings->setDefault("max_simultaneous_block_sends_per_client", "1");
 	// This causes frametime jitter on client side, or does it?
@@ -392,7 +401,16 @@ void set_default_settings(Settings *settings)
 	settings->setDefault("dedicated_server_step", "0.09");
 	settings->setDefault("active_block_mgmt_interval", "2.0");
 	settings->setDefault("abm_interval", "1.0");
+	settings->setDefault("lua_gc_pause", "200");
+	settings->setDefault("lua_gc_stepmul", "200");
+	settings->setDefault("lua_gc_step_budget", "1.0");
 	settings->setDefault("nodetimer_interval", "0.2");
+	settings->setDefault("nodetimer_time_budget", "20.0");
+	settings->setDefault("abm_time_budget", "20.0");
+	settings->setDefault("entity_step_time_budget", "0.0");
+	settings->setDefault("liquid_time_budget", "20.0");
+	settings->setDefault("object_send_time_budget", "10.0");
+	settings->setDefault("block_send_time_budget", "20.0");
 	settings->setDefault("ignore_world_load_errors", "false");
 	settings->setDefault("remote_media", "");
 	settings->setDefault("debug_log_level", "action");
@@ -123,6 +123,19 @@ bool IsDirDelimiter(char c)
 	return c == '/' || c == '\\';
 }
 
+bool GetFileInfo(const std::string &path, u64 *size, u64 *mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data))
+		return false;
+	*size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	// In 100 ns intervals
+	u64 time = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) |
+			data.ftLastWriteTime.dwLowDateTime;
+	*mtime = time / 10000000;
+	return true;
+}
+
 bool RecursiveDelete(const std::string &path)
 {
 	infostream << "Recursively deleting \"" << path << "\"" << std::endl;
@@ -287,6 +300,16 @@ bool IsDirDelimiter(char c)
 	return c == '/';
 }
 
+bool GetFileInfo(const std::string &path, u64 *size, u64 *mtime)
+{
+	struct stat statbuf{};
+	if (stat(path.c_str(), &statbuf))
+		return false;
+	*size = statbuf.st_size;
+	*mtime = statbuf.st_mtime;
+	return true;
+}
+
 bool RecursiveDelete(const std::string &path)
 {
 	/*
@@ -36,6 +36,14 @@ ObjectProperties gob_read_set_properties(std::istream &is)
 	return prop;
 }
 
+std::string gob_cmd_update_properties(const ObjectProperties &prop, u32 fields)
+{
+	std::ostringstream os(std::ios::binary);
+	writeU8(os, GENERIC_CMD_UPDATE_PROPERTIES);
+	prop.serializeDelta(os, fields);
+	return os.str();
+}
+
 std::string gob_cmd_update_position(
 	v3f position,
 	v3f velocity,
@@ -65,6 +73,41 @@ std::string gob_cmd_update_position(
 	return os.str();
 }
 
+// Layout of the GENERIC_CMD_UPDATE_POSITION message written above
+static const size_t UPDATE_POSITION_VELOCITY_OFFSET = 1 + 12;
+static const size_t UPDATE_POSITION_FLAGS_OFFSET = 1 + 4 * 12;
+static const size_t UPDATE_POSITION_SIZE = UPDATE_POSITION_FLAGS_OFFSET + 2 + 4;
+
+bool gob_update_position_is_skippable(const std::string &data)
+{
+	if (data.size() != UPDATE_POSITION_SIZE ||
+			(u8)data[0] != GENERIC_CMD_UPDATE_POSITION)
+		return false;
+
+	const u8 *flags = (const u8 *)&data[UPDATE_POSITION_FLAGS_OFFSET];
+	bool do_interpolate = flags[0];
+	bool is_movement_end = flags[1];
+	return do_interpolate && !is_movement_end;
+}
+
+void gob_update_position_get_motion(const std::string &data,
+		v3f *velocity, v3f *acceleration)
+{
+	// The acceleration follows the velocity
+	const u8 *motion = (const u8 *)&data[UPDATE_POSITION_VELOCITY_OFFSET];
+	*velocity = readV3F32(motion);
+	*acceleration = readV3F32(motion + 12);
+}
+
+void gob_update_position_scale_interval(std::string &data, float factor)
+{
+	if (data.size() != UPDATE_POSITION_SIZE)
+		return;
+
+	u8 *interval = (u8 *)&data[UPDATE_POSITION_SIZE - 4];
+	writeF32(interval, readF32(interval) * factor);
+}
+
 std::string gob_cmd_set_texture_mod(const std::string &mod)
 {
 	std::ostringstream os(std::ios::binary);
@@ -37,13 +37,17 @@ enum GenericCMD {
 	GENERIC_CMD_SET_PHYSICS_OVERRIDE,
 	GENERIC_CMD_UPDATE_NAMETAG_ATTRIBUTES,
 	GENERIC_CMD_SPAWN_INFANT,
-	GENERIC_CMD_SET_ANIMATION_SPEED
+	GENERIC_CMD_SET_ANIMATION_SPEED,
+	GENERIC_CMD_UPDATE_PROPERTIES // PROTOCOL_VERSION >= 40
 };
 
 #include "object_properties.h"
 std::string gob_cmd_set_properties(const ObjectProperties &prop);
 ObjectProperties gob_read_set_properties(std::istream &is);
 
+// Sends only the fields of `prop` selected by `fields`, see ObjectProperties::diff
+std::string gob_cmd_update_properties(const ObjectProperties &prop, u32 fields);
+
 std::string gob_cmd_update_position(
 	v3f position,
 	v3f velocity,
@@ -54,6 +58,16 @@ std::string gob_cmd_update_position(
 	f32 update_interval
 );
 
+// Whether a GENERIC_CMD_UPDATE_POSITION message may be left out in favour of a
+// later one, i.e. it is interpolated and not the end of a movement
+bool gob_update_position_is_skippable(const std::string &data);
+// Reads the velocity and acceleration of a skippable GENERIC_CMD_UPDATE_POSITION
+// message
+void gob_update_position_get_motion(const std::string &data,
+		v3f *velocity, v3f *acceleration);
+// Multiplies the update interval of a GENERIC_CMD_UPDATE_POSITION message
+void gob_update_position_scale_interval(std::string &data, float factor);
+
 std::string gob_cmd_set_texture_mod(const std::string &mod);
 
 std::string gob_cmd_set_sprite(
@@ -356,7 +356,7 @@ class CItemDefManager: public IWritableItemDefManager
 		}
 
 		// We're gonna ask the result to be put into here
-		static ResultQueue<std::string, ClientCached*, u8, u8> result_queue;
+		static thread_local ResultQueue<std::string, ClientCached*, u8, u8> result_queue;
 
 		// Throw a request in
 		m_get_clientcached_queue.add(name, 0, 0, &result_queue);
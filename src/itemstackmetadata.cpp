@@ -49,7 +49,7 @@ void ItemStackMetadata::serialize(std::ostream &os) const
 {
 	std::ostringstream os2;
 	os2 << DESERIALIZE_START;
-	for (const auto &stringvar : m_stringvars) {
+	for (const auto &stringvar : getStrings()) {
 		if (!stringvar.first.empty() || !stringvar.second.empty())
 			os2 << stringvar.first << DESERIALIZE_KV_DELIM
 				<< stringvar.second << DESERIALIZE_PAIR_DELIM;
@@ -61,20 +61,21 @@ void ItemStackMetadata::deSerialize(std::istream &is)
 {
 	std::string in = deSerializeJsonStringIfNeeded(is);
 
-	m_stringvars.clear();
+	Metadata::clear();
 
 	if (!in.empty()) {
+		StringMap &vars = getStringsMutable();
 		if (in[0] == DESERIALIZE_START) {
 			Strfnd fnd(in);
 			fnd.to(1);
 			while (!fnd.at_end()) {
 				std::string name = fnd.next(DESERIALIZE_KV_DELIM_STR);
 				std::string var  = fnd.next(DESERIALIZE_PAIR_DELIM_STR);
-				m_stringvars[name] = var;
+				vars[name] = var;
 			}
 		} else {
 			// BACKWARDS COMPATIBILITY
-			m_stringvars[""] = in;
+			vars[""] = in;
 		}
 	}
 	updateToolCapabilities();
@@ -83,12 +84,12 @@ void ItemStackMetadata::deSerialize(std::istream &is)
 void ItemStackMetadata::updateToolCapabilities()
 {
 	if (contains(TOOLCAP_KEY)) {
-		toolcaps_overridden = true;
-		toolcaps_override = ToolCapabilities();
+		std::shared_ptr<ToolCapabilities> caps(new ToolCapabilities());
 		std::istringstream is(getString(TOOLCAP_KEY));
-		toolcaps_override.deserializeJson(is);
+		caps->deserializeJson(is);
+		toolcaps_override = caps;
 	} else {
-		toolcaps_overridden = false;
+		toolcaps_override.reset();
 	}
 }
 
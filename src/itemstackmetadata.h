@@ -28,7 +28,7 @@ class IItemDefManager;
 class ItemStackMetadata : public Metadata
 {
 public:
-	ItemStackMetadata() : toolcaps_overridden(false) {}
+	ItemStackMetadata() = default;
 
 	// Overrides
 	void clear() override;
@@ -40,7 +40,7 @@ class ItemStackMetadata : public Metadata
 	const ToolCapabilities &getToolCapabilities(
 			const ToolCapabilities &default_caps) const
 	{
-		return toolcaps_overridden ? toolcaps_override : default_caps;
+		return toolcaps_override ? *toolcaps_override : default_caps;
 	}
 
 	void setToolCapabilities(const ToolCapabilities &caps);
@@ -49,6 +49,7 @@ class ItemStackMetadata : public Metadata
 private:
 	void updateToolCapabilities();
 
-	bool toolcaps_overridden;
-	ToolCapabilities toolcaps_override;
+	// Parsed from the metadata, nullptr if not overridden. Shared by the
+	// copies like the key-value map, never modified in place.
+	std::shared_ptr<const ToolCapabilities> toolcaps_override;
 };
@@ -132,6 +132,14 @@ MapBlock * Map::getBlockNoCreateNoEx(v3s16 p3d)
 	return block;
 }
 
+MapBlock * Map::getBlockNoCreateNoExUncached(v3s16 p3d) const
+{
+	auto n = m_sectors.find(v2s16(p3d.X, p3d.Z));
+	if (n == m_sectors.end())
+		return nullptr;
+	return n->second->getBlockNoCreateNoExUncached(p3d.Y);
+}
+
 MapBlock * Map::getBlockNoCreate(v3s16 p3d)
 {
 	MapBlock *block = getBlockNoCreateNoEx(p3d);
@@ -505,10 +513,15 @@ void Map::transforming_liquid_add(v3s16 p) {
 }
 
 void Map::transformLiquids(std::map<v3s16, MapBlock*> &modified_blocks,
-		ServerEnvironment *env)
+		ServerEnvironment *env, server::TickScheduler *scheduler)
 {
 	u32 loopcount = 0;
 	u32 initial_size = m_transforming_liquid.size();
+	// Finish the nodes of an interrupted call first, those that were
+	// queued since then wait for the next full update
+	if (m_transforming_liquid_unfinished > 0)
+		initial_size = std::min<u32>(initial_size, m_transforming_liquid_unfinished);
+	m_transforming_liquid_unfinished = 0;
 
 	/*if(initial_size != 0)
 		infostream<<"transformLiquids(): initial_size="<<initial_size<<std::endl;*/
@@ -543,6 +556,12 @@ void Map::transformLiquids(std::map<v3s16, MapBlock*> &modified_blocks,
 		// This should be done here so that it is done when continue is used
 		if (loopcount >= initial_size || loopcount >= loop_max)
 			break;
+		if (scheduler && (loopcount & 63) == 0 &&
+				scheduler->isOverBudget(server::TICK_LIQUID)) {
+			m_transforming_liquid_unfinished =
+				std::min(initial_size, loop_max) - loopcount;
+			break;
+		}
 		loopcount++;
 
 		/*
@@ -1110,11 +1129,27 @@ bool Map::isOccluded(const v3s16 &pos_camera, const v3s16 &pos_target,
 	u32 count = 0;
 	bool is_valid_position;
 
+	// Consecutive steps mostly stay in the same block
+	MapBlock *block = nullptr;
+	v3s16 block_pos;
+	bool block_looked_up = false;
+
 	for (; offset < distance + end_offset; offset += step) {
 		v3f pos_node_f = pos_origin_f + direction * offset;
 		v3s16 pos_node = floatToInt(pos_node_f, BS);
+		v3s16 pos_block = getNodeBlockPos(pos_node);
+
+		if (!block_looked_up || pos_block != block_pos) {
+			block = getBlockNoCreateNoExUncached(pos_block);
+			block_pos = pos_block;
+			block_looked_up = true;
+		}
 
-		MapNode node = getNode(pos_node, &is_valid_position);
+		MapNode node;
+		is_valid_position = false;
+		if (block)
+			node = block->getNodeNoCheck(pos_node - pos_block * MAP_BLOCKSIZE,
+				&is_valid_position);
 
 		if (is_valid_position &&
 				!m_nodedef->get(node).light_propagates) {
@@ -46,6 +46,9 @@ class IGameDef;
 class IRollbackManager;
 class EmergeManager;
 class ServerEnvironment;
+namespace server {
+class TickScheduler;
+}
 struct BlockMakeData;
 
 /*
@@ -160,6 +163,9 @@ class Map /*: public NodeContainer*/
 	MapBlock * getBlockNoCreate(v3s16 p);
 	// Returns NULL if not found
 	MapBlock * getBlockNoCreateNoEx(v3s16 p);
+	// Like above, but without the sector and block caches. Safe to call
+	// from several threads while the map is not being modified.
+	MapBlock * getBlockNoCreateNoExUncached(v3s16 p) const;
 
 	/* Server overrides */
 	virtual MapBlock * emergeBlock(v3s16 p, bool create_blank=true)
@@ -229,8 +235,15 @@ class Map /*: public NodeContainer*/
 	// For debug printing. Prints "Map: ", "ServerMap: " or "ClientMap: "
 	virtual void PrintInfo(std::ostream &out);
 
+	/*
+		Stops early when the liquid time budget of the scheduler is used
+		up, the rest of the queued nodes is then processed by the next call.
+	*/
 	void transformLiquids(std::map<v3s16, MapBlock*> & modified_blocks,
-			ServerEnvironment *env);
+			ServerEnvironment *env, server::TickScheduler *scheduler = nullptr);
+	// Whether the last transformLiquids() call ran out of time
+	bool isTransformingLiquidsUnfinished() const
+	{ return m_transforming_liquid_unfinished > 0; }
 
 	/*
 		Node metadata
@@ -277,6 +290,7 @@ class Map /*: public NodeContainer*/
 
 	void transforming_liquid_add(v3s16 p);
 
+	// Does not touch the caches of the map, see getBlockNoCreateNoExUncached
 	bool isBlockOccluded(MapBlock *block, v3s16 cam_pos_nodes);
 protected:
 	friend class LuaVoxelManip;
@@ -308,6 +322,8 @@ class Map /*: public NodeContainer*/
 private:
 	f32 m_transforming_liquid_loop_count_multiplier = 1.0f;
 	u32 m_unprocessed_count = 0;
+	// Queued nodes the last transformLiquids() call did not get to
+	u32 m_transforming_liquid_unfinished = 0;
 	u64 m_inc_trending_up_start_time = 0; // milliseconds
 	bool m_queue_size_timer_started = false;
 };
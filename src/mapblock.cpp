@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapblock.h"
 
 #include <sstream>
+#include "collision.h"
 #include "map.h"
 #include "light.h"
 #include "nodedef.h"
@@ -61,6 +62,8 @@ static const char *modified_reason_strings[] = {
 	"unknown",
 };
 
+// Seconds without collisions after which a block frees its collision cache
+#define COLLISION_CACHE_TIMEOUT 30.0f
 
 /*
 	MapBlock
@@ -88,6 +91,18 @@ MapBlock::~MapBlock()
 	delete[] data;
 }
 
+void MapBlock::clearCollisionCache()
+{
+	collision_cache.reset();
+}
+
+void MapBlock::stepCollisionCache(float dtime)
+{
+	collision_cache_unused_time += dtime;
+	if (collision_cache_unused_time > COLLISION_CACHE_TIMEOUT)
+		clearCollisionCache();
+}
+
 bool MapBlock::isValidPositionParent(v3s16 p)
 {
 	if (isValidPosition(p)) {
@@ -146,6 +161,8 @@ void MapBlock::copyTo(VoxelManipulator &dst)
 
 void MapBlock::copyFrom(VoxelManipulator &dst)
 {
+	clearCollisionCache();
+
 	v3s16 data_size(MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE);
 	VoxelArea data_area(v3s16(0,0,0), data_size - v3s16(1,1,1));
 
@@ -457,6 +474,7 @@ void MapBlock::deSerialize(std::istream &is, u8 version, bool disk)
 	TRACESTREAM(<<"MapBlock::deSerialize "<<PP(getPos())<<std::endl);
 
 	m_day_night_differs_expired = false;
+	clearCollisionCache();
 
 	if(version <= 21)
 	{
@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #pragma once
 
 #include <set>
+#include <memory>
 #include "irr_v3d.h"
 #include "mapnode.h"
 #include "exceptions.h"
@@ -37,6 +38,7 @@ class NodeMetadataList;
 class IGameDef;
 class MapBlockMesh;
 class VoxelManipulator;
+struct MapBlockCollisionCache;
 
 #define BLOCK_TIMESTAMP_UNDEFINED 0xffffffff
 
@@ -114,8 +116,11 @@ class MapBlock
 		} else if (mod == m_modified) {
 			m_modified_reason |= reason;
 		}
-		if (mod == MOD_STATE_WRITE_NEEDED)
+		if (mod == MOD_STATE_WRITE_NEEDED) {
 			contents_cached = false;
+			if (collision_cache)
+				clearCollisionCache();
+		}
 	}
 
 	inline u32 getModified()
@@ -425,6 +430,8 @@ class MapBlock
 	inline void incrementUsageTimer(float dtime)
 	{
 		m_usage_timer += dtime;
+		if (collision_cache)
+			stepCollisionCache(dtime);
 	}
 
 	inline float getUsageTimer()
@@ -520,6 +527,8 @@ class MapBlock
 
 #ifndef SERVER // Only on client
 	MapBlockMesh *mesh = nullptr;
+	// MeshMakeData::getHash() of the data the mesh was made from, 0 if none
+	u64 mesh_data_hash = 0;
 #endif
 
 	NodeMetadataList m_node_metadata;
@@ -539,6 +548,17 @@ class MapBlock
 	// True if we never want to cache content types for this block
 	bool do_not_cache_contents = false;
 
+	//// Collision optimizations ////
+	// Collision boxes of the nodes, built by collisionMoveSimple when needed.
+	// Freed when the nodes change or nothing collided in the block for a
+	// while, as it takes about 20 KB.
+	std::unique_ptr<MapBlockCollisionCache> collision_cache;
+	// Seconds since collision_cache was last used
+	float collision_cache_unused_time = 0.0f;
+
+	void clearCollisionCache();
+	void stepCollisionCache(float dtime);
+
 private:
 	/*
 		Private member variables
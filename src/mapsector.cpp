@@ -72,6 +72,12 @@ MapBlock * MapSector::getBlockNoCreateNoEx(s16 y)
 	return getBlockBuffered(y);
 }
 
+MapBlock * MapSector::getBlockNoCreateNoExUncached(s16 y) const
+{
+	auto n = m_blocks.find(y);
+	return n != m_blocks.end() ? n->second : nullptr;
+}
+
 MapBlock * MapSector::createBlankBlockNoInsert(s16 y)
 {
 	assert(getBlockBuffered(y) == NULL);	// Pre-condition
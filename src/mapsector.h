@@ -51,6 +51,9 @@ class MapSector
 	}
 
 	MapBlock * getBlockNoCreateNoEx(s16 y);
+	// Does not use the last-used block cache, may be called from several
+	// threads as long as no blocks are added or removed
+	MapBlock * getBlockNoCreateNoExUncached(s16 y) const;
 	MapBlock * createBlankBlockNoInsert(s16 y);
 	MapBlock * createBlankBlock(s16 y);
 
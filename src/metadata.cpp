@@ -24,33 +24,40 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 	Metadata
 */
 
+const StringMap Metadata::s_empty_strings;
+
 void Metadata::clear()
 {
-	m_stringvars.clear();
+	m_stringvars.reset();
 	m_modified = true;
 }
 
 bool Metadata::empty() const
 {
-	return m_stringvars.empty();
+	return !m_stringvars || m_stringvars->empty();
 }
 
 size_t Metadata::size() const
 {
-	return m_stringvars.size();
+	return m_stringvars ? m_stringvars->size() : 0;
 }
 
 bool Metadata::contains(const std::string &name) const
 {
-	return m_stringvars.find(name) != m_stringvars.end();
+	const StringMap &vars = getStrings();
+	return vars.find(name) != vars.end();
 }
 
 bool Metadata::operator==(const Metadata &other) const
 {
+	// Copies that were not modified since share the same map
+	if (m_stringvars == other.m_stringvars)
+		return true;
+
 	if (size() != other.size())
 		return false;
 
-	for (const auto &sv : m_stringvars) {
+	for (const auto &sv : getStrings()) {
 		if (!other.contains(sv.first) || other.getString(sv.first) != sv.second)
 			return false;
 	}
@@ -60,8 +67,9 @@ bool Metadata::operator==(const Metadata &other) const
 
 const std::string &Metadata::getString(const std::string &name, u16 recursion) const
 {
-	StringMap::const_iterator it = m_stringvars.find(name);
-	if (it == m_stringvars.end()) {
+	const StringMap &vars = getStrings();
+	StringMap::const_iterator it = vars.find(name);
+	if (it == vars.end()) {
 		static const std::string empty_string = std::string("");
 		return empty_string;
 	}
@@ -72,8 +80,9 @@ const std::string &Metadata::getString(const std::string &name, u16 recursion) c
 bool Metadata::getStringToRef(
 		const std::string &name, std::string &str, u16 recursion) const
 {
-	StringMap::const_iterator it = m_stringvars.find(name);
-	if (it == m_stringvars.end()) {
+	const StringMap &vars = getStrings();
+	StringMap::const_iterator it = vars.find(name);
+	if (it == vars.end()) {
 		return false;
 	}
 
@@ -91,16 +100,18 @@ bool Metadata::getStringToRef(
 bool Metadata::setString(const std::string &name, const std::string &var)
 {
 	if (var.empty()) {
-		m_stringvars.erase(name);
+		if (contains(name))
+			getStringsMutable().erase(name);
 		return true;
 	}
 
-	StringMap::iterator it = m_stringvars.find(name);
-	if (it != m_stringvars.end() && it->second == var) {
+	const StringMap &vars = getStrings();
+	StringMap::const_iterator it = vars.find(name);
+	if (it != vars.end() && it->second == var) {
 		return false;
 	}
 
-	m_stringvars[name] = var;
+	getStringsMutable()[name] = var;
 	m_modified = true;
 	return true;
 }
@@ -113,3 +124,12 @@ const std::string &Metadata::resolveString(const std::string &str, u16 recursion
 
 	return str;
 }
+
+StringMap &Metadata::getStringsMutable()
+{
+	if (!m_stringvars)
+		m_stringvars = std::make_shared<StringMap>();
+	else if (m_stringvars.use_count() > 1)
+		m_stringvars = std::make_shared<StringMap>(*m_stringvars);
+	return *m_stringvars;
+}
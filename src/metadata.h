@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "irr_v3d.h"
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "util/string.h"
 
@@ -51,7 +52,7 @@ class Metadata
 	inline bool removeString(const std::string &name) { return setString(name, ""); }
 	const StringMap &getStrings() const
 	{
-		return m_stringvars;
+		return m_stringvars ? *m_stringvars : s_empty_strings;
 	}
 	// Add support for variable names in values
 	const std::string &resolveString(const std::string &str, u16 recursion = 0) const;
@@ -59,5 +60,13 @@ class Metadata
 	inline bool isModified() const  { return m_modified; }
 	inline void setModified(bool v) { m_modified = v; }
 protected:
-	StringMap m_stringvars;
+	// Returns the key-value map for writing. Copies of a Metadata share
+	// their map until one of them is modified (copy-on-write).
+	StringMap &getStringsMutable();
+
+private:
+	static const StringMap s_empty_strings;
+
+	// nullptr while there are no key-value pairs
+	std::shared_ptr<StringMap> m_stringvars;
 };
@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapblock.h"
 #include "modchannels.h"
 #include "nodedef.h"
+#include "profiler.h"
 #include "remoteplayer.h"
 #include "rollback_interface.h"
 #include "scripting_server.h"
@@ -448,11 +449,10 @@ void Server::handleCommand_GotBlocks(NetworkPacket* pkt)
 	}
 }
 
-void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
-	NetworkPacket *pkt)
+bool Server::readPlayerPos(NetworkPacket *pkt, PlayerPosUpdate &update)
 {
 	if (pkt->getRemainingBytes() < 12 + 12 + 4 + 4 + 4 + 1 + 1)
-		return;
+		return false;
 
 	v3s32 ps, ss;
 	s32 f32pitch, f32yaw;
@@ -465,29 +465,31 @@ void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
 
 	f32 pitch = (f32)f32pitch / 100.0f;
 	f32 yaw = (f32)f32yaw / 100.0f;
-	u32 keyPressed = 0;
 
-	// default behavior (in case an old client doesn't send these)
-	f32 fov = 0;
-	u8 wanted_range = 0;
-
-	*pkt >> keyPressed;
+	*pkt >> update.keys_pressed;
 	*pkt >> f32fov;
-	fov = (f32)f32fov / 80.0f;
-	*pkt >> wanted_range;
+	update.fov = (f32)f32fov / 80.0f;
+	*pkt >> update.wanted_range;
 
-	v3f position((f32)ps.X / 100.0f, (f32)ps.Y / 100.0f, (f32)ps.Z / 100.0f);
-	v3f speed((f32)ss.X / 100.0f, (f32)ss.Y / 100.0f, (f32)ss.Z / 100.0f);
+	update.position = v3f((f32)ps.X / 100.0f, (f32)ps.Y / 100.0f, (f32)ps.Z / 100.0f);
+	update.speed = v3f((f32)ss.X / 100.0f, (f32)ss.Y / 100.0f, (f32)ss.Z / 100.0f);
 
-	pitch = modulo360f(pitch);
-	yaw = wrapDegrees_0_360(yaw);
+	update.pitch = modulo360f(pitch);
+	update.yaw = wrapDegrees_0_360(yaw);
+	return true;
+}
 
-	playersao->setBasePosition(position);
-	player->setSpeed(speed);
-	playersao->setLookPitch(pitch);
-	playersao->setPlayerYaw(yaw);
-	playersao->setFov(fov);
-	playersao->setWantedRange(wanted_range);
+void Server::applyPlayerPos(RemotePlayer *player, PlayerSAO *playersao,
+	const PlayerPosUpdate &update)
+{
+	u32 keyPressed = update.keys_pressed;
+
+	playersao->setBasePosition(update.position);
+	player->setSpeed(update.speed);
+	playersao->setLookPitch(update.pitch);
+	playersao->setPlayerYaw(update.yaw);
+	playersao->setFov(update.fov);
+	playersao->setWantedRange(update.wanted_range);
 	player->keyPressed = keyPressed;
 	player->control.up = (keyPressed & 1);
 	player->control.down = (keyPressed & 2);
@@ -502,7 +504,44 @@ void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
 	if (playersao->checkMovementCheat()) {
 		// Call callbacks
 		m_script->on_cheat(playersao, "moved_too_fast");
-		SendMovePlayer(pkt->getPeerId());
+		SendMovePlayer(playersao->getPeerID());
+	}
+}
+
+void Server::process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
+	NetworkPacket *pkt)
+{
+	PlayerPosUpdate update;
+	if (!readPlayerPos(pkt, update))
+		return;
+
+	// Older positions still waiting for the next step are superseded
+	m_pending_player_pos.erase(pkt->getPeerId());
+	applyPlayerPos(player, playersao, update);
+}
+
+void Server::processPendingPlayerPos()
+{
+	ScopeProfiler sp(g_profiler, "Server: process player positions", SPT_AVG);
+	g_profiler->avg("Server: player position packets [#]", m_player_pos_packets);
+	g_profiler->avg("Server: player positions applied [#]",
+		m_pending_player_pos.size());
+	m_player_pos_packets = 0;
+
+	// SendMovePlayer() drops the entry of a player that is moved back
+	std::unordered_map<session_t, PlayerPosUpdate> pending;
+	pending.swap(m_pending_player_pos);
+
+	for (const auto &it : pending) {
+		RemotePlayer *player = m_env->getPlayer(it.first);
+		if (!player)
+			continue;
+
+		PlayerSAO *playersao = player->getPlayerSAO();
+		if (!playersao || playersao->isDead())
+			continue;
+
+		applyPlayerPos(player, playersao, it.second);
 	}
 }
 
@@ -533,7 +572,12 @@ void Server::handleCommand_PlayerPos(NetworkPacket* pkt)
 		return;
 	}
 
-	process_PlayerPos(player, playersao, pkt);
+	// Validated and applied in the next step, replacing any older position
+	PlayerPosUpdate update;
+	if (readPlayerPos(pkt, update)) {
+		m_pending_player_pos[pkt->getPeerId()] = update;
+		m_player_pos_packets++;
+	}
 }
 
 void Server::handleCommand_DeletedBlocks(NetworkPacket* pkt)
@@ -26,9 +26,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "client/client.h"
 #include "client/renderingengine.h"
 #include "client/tile.h"
+#include "threading/workerpool.h"
 #include <IMeshManipulator.h>
 #endif
 #include "log.h"
+#include "porting.h"
 #include "settings.h"
 #include "nameidmapping.h"
 #include "util/numeric.h"
@@ -39,7 +41,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapnode.h"
 #include <fstream> // Used in applyTextureOverrides()
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <thread>
 
 /*
 	NodeBox
@@ -590,13 +594,125 @@ void ContentFeatures::deSerialize(std::istream &is)
 }
 
 #ifndef SERVER
-static void fillTileAttribs(ITextureSource *tsrc, TileLayer *layer,
-		const TileSpec &tile, const TileDef &tiledef, video::SColor color,
-		u8 material_type, u32 shader_id, bool backface_culling,
+/*
+	Lookups in the texture and shader sources, shared by all nodes during
+	NodeDefManager::updateTextures(). Most tiles are used by several sides
+	or several nodes, each distinct one is resolved only once.
+*/
+struct TileTextureCache
+{
+	// What fillTileAttribs() takes from the texture source
+	struct Tile
+	{
+		video::ITexture *texture = nullptr;
+		u32 texture_id = 0;
+		video::ITexture *normal_texture = nullptr;
+		video::ITexture *flags_texture = nullptr;
+		int frame_count = 1;
+		int frame_length_ms = 0;
+		// Shared by all layers using the tile
+		std::shared_ptr<std::vector<FrameSpec>> frames;
+	};
+
+	// Keyed by texture name and animation, see getTileKey()
+	std::unordered_map<std::string, Tile> tiles;
+	std::unordered_map<std::string, video::SColor> average_colors;
+	// Keyed by material type and drawtype
+	std::map<std::pair<u8, u8>, u32> shaders;
+
+	u32 tile_lookups = 0;
+};
+
+static std::string getTileKey(const TileDef &tiledef)
+{
+	const TileAnimationParams &anim = tiledef.animation;
+	std::ostringstream os(std::ios::binary);
+	os.precision(9); // Enough to tell every float apart
+	os << tiledef.name << '\n' << (int)anim.type;
+	if (anim.type == TAT_VERTICAL_FRAMES)
+		os << ' ' << anim.vertical_frames.aspect_w
+			<< ' ' << anim.vertical_frames.aspect_h
+			<< ' ' << anim.vertical_frames.length;
+	else if (anim.type == TAT_SHEET_2D)
+		os << ' ' << anim.sheet_2d.frames_w
+			<< ' ' << anim.sheet_2d.frames_h
+			<< ' ' << anim.sheet_2d.frame_length;
+	return os.str();
+}
+
+static const TileTextureCache::Tile &getTileTextures(ITextureSource *tsrc,
+		TileTextureCache &cache, const TileDef &tiledef,
 		const TextureSettings &tsettings)
 {
+	cache.tile_lookups++;
+	std::string key = getTileKey(tiledef);
+	auto it = cache.tiles.find(key);
+	if (it != cache.tiles.end())
+		return it->second;
+
+	TileTextureCache::Tile &tile = cache.tiles[key];
+	tile.texture = tsrc->getTextureForMesh(tiledef.name, &tile.texture_id);
+
+	// Normal texture and shader flags texture
+	if (tsettings.use_normal_texture) {
+		tile.normal_texture = tsrc->getNormalTexture(tiledef.name);
+	}
+	tile.flags_texture = tsrc->getShaderFlagsTexture(tile.normal_texture ? true : false);
+
+	// Animation parameters
+	if (tiledef.animation.type != TAT_NONE) {
+		tiledef.animation.determineParams(tile.texture->getOriginalSize(),
+				&tile.frame_count, &tile.frame_length_ms, NULL);
+	}
+
+	if (tile.frame_count > 1) {
+		std::ostringstream os(std::ios::binary);
+		tile.frames = std::make_shared<std::vector<FrameSpec>>();
+		tile.frames->resize(tile.frame_count);
+
+		for (int i = 0; i < tile.frame_count; i++) {
+
+			FrameSpec frame;
+
+			os.str("");
+			os << tiledef.name;
+			tiledef.animation.getTextureModifer(os,
+					tile.texture->getOriginalSize(), i);
+
+			frame.texture = tsrc->getTextureForMesh(os.str(), &frame.texture_id);
+			if (tile.normal_texture)
+				frame.normal_texture = tsrc->getNormalTexture(os.str());
+			frame.flags_texture = tile.flags_texture;
+			(*tile.frames)[i] = frame;
+		}
+	}
+	return tile;
+}
+
+static u32 getNodeShader(IShaderSource *shdsrc, TileTextureCache &cache,
+		u8 material_type, NodeDrawType drawtype)
+{
+	std::pair<u8, u8> key(material_type, drawtype);
+	auto it = cache.shaders.find(key);
+	if (it != cache.shaders.end())
+		return it->second;
+
+	u32 shader = shdsrc->getShader("nodes_shader", material_type, drawtype);
+	cache.shaders[key] = shader;
+	return shader;
+}
+
+static void fillTileAttribs(ITextureSource *tsrc, TileTextureCache &cache,
+		TileLayer *layer, const TileSpec &tile, const TileDef &tiledef,
+		video::SColor color, u8 material_type, u32 shader_id,
+		bool backface_culling, const TextureSettings &tsettings)
+{
+	const TileTextureCache::Tile &textures =
+			getTileTextures(tsrc, cache, tiledef, tsettings);
+
 	layer->shader_id     = shader_id;
-	layer->texture       = tsrc->getTextureForMesh(tiledef.name, &layer->texture_id);
+	layer->texture       = textures.texture;
+	layer->texture_id    = textures.texture_id;
 	layer->material_type = material_type;
 
 	bool has_scale = tiledef.scale > 0;
@@ -615,10 +731,8 @@ static void fillTileAttribs(ITextureSource *tsrc, TileLayer *layer,
 		layer->scale = 1;
 
 	// Normal texture and shader flags texture
-	if (tsettings.use_normal_texture) {
-		layer->normal_texture = tsrc->getNormalTexture(tiledef.name);
-	}
-	layer->flags_texture = tsrc->getShaderFlagsTexture(layer->normal_texture ? true : false);
+	layer->normal_texture = textures.normal_texture;
+	layer->flags_texture = textures.flags_texture;
 
 	// Material flags
 	layer->material_flags = 0;
@@ -639,40 +753,15 @@ static void fillTileAttribs(ITextureSource *tsrc, TileLayer *layer,
 		layer->color = color;
 
 	// Animation parameters
-	int frame_count = 1;
 	if (layer->material_flags & MATERIAL_FLAG_ANIMATION) {
-		int frame_length_ms;
-		tiledef.animation.determineParams(layer->texture->getOriginalSize(),
-				&frame_count, &frame_length_ms, NULL);
-		layer->animation_frame_count = frame_count;
-		layer->animation_frame_length_ms = frame_length_ms;
+		layer->animation_frame_count = textures.frame_count;
+		layer->animation_frame_length_ms = textures.frame_length_ms;
 	}
 
-	if (frame_count == 1) {
+	if (textures.frame_count == 1)
 		layer->material_flags &= ~MATERIAL_FLAG_ANIMATION;
-	} else {
-		std::ostringstream os(std::ios::binary);
-		if (!layer->frames) {
-			layer->frames = std::make_shared<std::vector<FrameSpec>>();
-		}
-		layer->frames->resize(frame_count);
-
-		for (int i = 0; i < frame_count; i++) {
-
-			FrameSpec frame;
-
-			os.str("");
-			os << tiledef.name;
-			tiledef.animation.getTextureModifer(os,
-					layer->texture->getOriginalSize(), i);
-
-			frame.texture = tsrc->getTextureForMesh(os.str(), &frame.texture_id);
-			if (layer->normal_texture)
-				frame.normal_texture = tsrc->getNormalTexture(os.str());
-			frame.flags_texture = layer->flags_texture;
-			(*layer->frames)[i] = frame;
-		}
-	}
+	else
+		layer->frames = textures.frames;
 }
 #endif
 
@@ -693,11 +782,17 @@ bool isWorldAligned(AlignStyle style, WorldAlignMode mode, NodeDrawType drawtype
 }
 
 void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc,
-	scene::IMeshManipulator *meshmanip, Client *client, const TextureSettings &tsettings)
+	Client *client, const TextureSettings &tsettings, TileTextureCache &cache)
 {
 	// minimap pixel color - the average color of a texture
-	if (tsettings.enable_minimap && !tiledef[0].name.empty())
-		minimap_color = tsrc->getTextureAverageColor(tiledef[0].name);
+	if (tsettings.enable_minimap && !tiledef[0].name.empty()) {
+		auto it = cache.average_colors.find(tiledef[0].name);
+		if (it == cache.average_colors.end()) {
+			it = cache.average_colors.emplace(tiledef[0].name,
+				tsrc->getTextureAverageColor(tiledef[0].name)).first;
+		}
+		minimap_color = it->second;
+	}
 
 	// Figure out the actual tiles to use
 	TileDef tdef[6];
@@ -827,7 +922,7 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 		}
 	}
 
-	u32 tile_shader = shdsrc->getShader("nodes_shader", material_type, drawtype);
+	u32 tile_shader = getNodeShader(shdsrc, cache, material_type, drawtype);
 
 	u8 overlay_material = material_type;
 	if (overlay_material == TILE_MATERIAL_OPAQUE)
@@ -835,17 +930,17 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 	else if (overlay_material == TILE_MATERIAL_LIQUID_OPAQUE)
 		overlay_material = TILE_MATERIAL_LIQUID_TRANSPARENT;
 
-	u32 overlay_shader = shdsrc->getShader("nodes_shader", overlay_material, drawtype);
+	u32 overlay_shader = getNodeShader(shdsrc, cache, overlay_material, drawtype);
 
 	// Tiles (fill in f->tiles[])
 	for (u16 j = 0; j < 6; j++) {
 		tiles[j].world_aligned = isWorldAligned(tdef[j].align_style,
 				tsettings.world_aligned_mode, drawtype);
-		fillTileAttribs(tsrc, &tiles[j].layers[0], tiles[j], tdef[j],
+		fillTileAttribs(tsrc, cache, &tiles[j].layers[0], tiles[j], tdef[j],
 				color, material_type, tile_shader,
 				tdef[j].backface_culling, tsettings);
 		if (!tdef_overlay[j].name.empty())
-			fillTileAttribs(tsrc, &tiles[j].layers[1], tiles[j], tdef_overlay[j],
+			fillTileAttribs(tsrc, cache, &tiles[j].layers[1], tiles[j], tdef_overlay[j],
 					color, overlay_material, overlay_shader,
 					tdef[j].backface_culling, tsettings);
 	}
@@ -857,11 +952,11 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 		else if (waving == 2)
 			special_material = TILE_MATERIAL_WAVING_LEAVES;
 	}
-	u32 special_shader = shdsrc->getShader("nodes_shader", special_material, drawtype);
+	u32 special_shader = getNodeShader(shdsrc, cache, special_material, drawtype);
 
 	// Special tiles (fill in f->special_tiles[])
 	for (u16 j = 0; j < CF_SPECIAL_COUNT; j++)
-		fillTileAttribs(tsrc, &special_tiles[j].layers[0], special_tiles[j], tdef_spec[j],
+		fillTileAttribs(tsrc, cache, &special_tiles[j].layers[0], special_tiles[j], tdef_spec[j],
 				color, special_material, special_shader,
 				tdef_spec[j].backface_culling, tsettings);
 
@@ -870,17 +965,24 @@ void ContentFeatures::updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc
 			param_type_2 == CPT2_COLORED_WALLMOUNTED)
 		palette = tsrc->getPalette(palette_name);
 
-	if (drawtype == NDT_MESH && !mesh.empty()) {
+	if (client && drawtype == NDT_MESH && !mesh.empty()) {
 		// Meshnode drawtype
-		// Read the mesh and apply scale
+		// Read the mesh, it is scaled by updateMeshes()
 		mesh_ptr[0] = client->getMesh(mesh);
-		if (mesh_ptr[0]){
-			v3f scale = v3f(1.0, 1.0, 1.0) * BS * visual_scale;
-			scaleMesh(mesh_ptr[0], scale);
-			recalculateBoundingBox(mesh_ptr[0]);
-			meshmanip->recalculateNormals(mesh_ptr[0], true, false);
-		}
 	}
+}
+
+void ContentFeatures::updateMeshes(scene::IMeshManipulator *meshmanip,
+	const TextureSettings &tsettings)
+{
+	if (!mesh_ptr[0])
+		return;
+
+	// Apply scale
+	v3f scale = v3f(1.0, 1.0, 1.0) * BS * visual_scale;
+	scaleMesh(mesh_ptr[0], scale);
+	recalculateBoundingBox(mesh_ptr[0]);
+	meshmanip->recalculateNormals(mesh_ptr[0], true, false);
 
 	//Cache 6dfacedir and wallmounted rotated clones of meshes
 	if (tsettings.enable_mesh_cache && mesh_ptr[0] &&
@@ -1366,26 +1468,78 @@ void NodeDefManager::updateTextures(IGameDef *gamedef,
 	void *progress_callback_args)
 {
 #ifndef SERVER
+	Client *client = (Client *)gamedef;
+	updateTextures(client->tsrc(), client->getShaderSource(), client,
+		progress_callback, progress_callback_args);
+#endif
+}
+
+#ifndef SERVER
+void NodeDefManager::updateTextures(ITextureSource *tsrc,
+	IShaderSource *shdsrc, Client *client,
+	void (*progress_callback)(void *progress_args, u32 progress, u32 max_progress),
+	void *progress_callback_args)
+{
 	infostream << "NodeDefManager::updateTextures(): Updating "
 		"textures in node definitions" << std::endl;
 
-	Client *client = (Client *)gamedef;
-	ITextureSource *tsrc = client->tsrc();
-	IShaderSource *shdsrc = client->getShaderSource();
-	scene::IMeshManipulator *meshmanip =
-		RenderingEngine::get_scene_manager()->getMeshManipulator();
 	TextureSettings tsettings;
 	tsettings.readSettings();
 
 	u32 size = m_content_features.size();
+	u32 mesh_count = 0;
+	for (const ContentFeatures &f : m_content_features) {
+		if (f.drawtype == NDT_MESH && !f.mesh.empty())
+			mesh_count++;
+	}
+	u32 max_progress = size + mesh_count;
 
+	// Textures, shaders and mesh files can only be loaded on this thread
+	u64 t0 = porting::getTimeMs();
+	TileTextureCache cache;
+	std::vector<ContentFeatures *> mesh_features;
 	for (u32 i = 0; i < size; i++) {
 		ContentFeatures *f = &(m_content_features[i]);
-		f->updateTextures(tsrc, shdsrc, meshmanip, client, tsettings);
-		progress_callback(progress_callback_args, i, size);
+		f->updateTextures(tsrc, shdsrc, client, tsettings, cache);
+		if (f->mesh_ptr[0])
+			mesh_features.push_back(f);
+		progress_callback(progress_callback_args, i + 1, max_progress);
 	}
-#endif
+
+	// Meshes of mesh nodes are prepared in parallel, only this thread
+	// reports the progress
+	u64 t1 = porting::getTimeMs();
+	scene::IMeshManipulator *meshmanip = nullptr;
+	u32 num_threads = 0;
+	if (!mesh_features.empty()) {
+		meshmanip = RenderingEngine::get_scene_manager()->getMeshManipulator();
+		if (!m_mesh_pool) {
+			u32 cpus = Thread::getNumberOfProcessors();
+			m_mesh_pool.reset(new WorkerPool("NodeMesh", cpus > 1 ? cpus - 1 : 0));
+		}
+		num_threads = m_mesh_pool->getThreadCount();
+	}
+	std::thread::id reporting_thread = std::this_thread::get_id();
+	std::atomic<u32> meshes_done(0);
+	auto update_meshes = [&] (size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			mesh_features[i]->updateMeshes(meshmanip, tsettings);
+			u32 done = ++meshes_done;
+			if (std::this_thread::get_id() == reporting_thread)
+				progress_callback(progress_callback_args, size + done, max_progress);
+		}
+	};
+	if (m_mesh_pool)
+		m_mesh_pool->run(mesh_features.size(), 1, update_meshes);
+	progress_callback(progress_callback_args, max_progress, max_progress);
+
+	infostream << "NodeDefManager::updateTextures(): " << cache.tiles.size()
+		<< " distinct tiles out of " << cache.tile_lookups << ", textures took "
+		<< t1 - t0 << " ms, " << mesh_features.size() << " meshes took "
+		<< porting::getTimeMs() - t1 << " ms on " << num_threads + 1
+		<< " threads" << std::endl;
 }
+#endif
 
 void NodeDefManager::serialize(std::ostream &os, u16 protocol_version) const
 {
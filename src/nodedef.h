@@ -23,12 +23,15 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <string>
 #include <iostream>
 #include <map>
+#include <memory>
 #include "mapnode.h"
 #include "nameidmapping.h"
 #ifndef SERVER
 #include "client/tile.h"
 #include <IMeshManipulator.h>
 class Client;
+class WorkerPool;
+struct TileTextureCache;
 #endif
 #include "itemgroup.h"
 #include "sound.h" // SimpleSoundSpec
@@ -434,8 +437,15 @@ struct ContentFeatures
 	}
 
 #ifndef SERVER
+	// Resolves tiles and shaders and loads the mesh, on the main thread.
+	// cache is shared by all nodes updated together.
 	void updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc,
-		scene::IMeshManipulator *meshmanip, Client *client, const TextureSettings &tsettings);
+		Client *client, const TextureSettings &tsettings,
+		TileTextureCache &cache);
+	// Scales the mesh loaded by updateTextures() and makes its rotated
+	// copies. Touches nothing but this node, so it may run on any thread.
+	void updateMeshes(scene::IMeshManipulator *meshmanip,
+		const TextureSettings &tsettings);
 #endif
 };
 
@@ -595,17 +605,32 @@ class NodeDefManager {
 
 	/*!
 	 * Only the client uses this. Loads textures and shaders required for
-	 * rendering the nodes.
+	 * rendering the nodes, then prepares the meshes of mesh nodes on
+	 * worker threads.
 	 * @param gamedef must be a Client.
-	 * @param progress_cbk called each time a node is loaded. Arguments:
-	 * `progress_cbk_args`, number of loaded ContentFeatures, number of
-	 * total ContentFeatures.
+	 * @param progress_cbk called on the main thread as the work goes on.
+	 * Arguments: `progress_cbk_args`, number of finished steps, number of
+	 * total steps. There is one step for the textures of each
+	 * ContentFeatures and one for each mesh.
 	 * @param progress_cbk_args passed to the callback function
 	 */
 	void updateTextures(IGameDef *gamedef,
 		void (*progress_cbk)(void *progress_args, u32 progress, u32 max_progress),
 		void *progress_cbk_args);
 
+#ifndef SERVER
+	/*!
+	 * Like updateTextures() above, with the sources given directly so that
+	 * it can run without a Client.
+	 * @param client loads the mesh files of mesh nodes. If it is NULL,
+	 * mesh nodes are left without a mesh.
+	 */
+	void updateTextures(ITextureSource *tsrc, IShaderSource *shdsrc,
+		Client *client,
+		void (*progress_cbk)(void *progress_args, u32 progress, u32 max_progress),
+		void *progress_cbk_args);
+#endif
+
 	/*!
 	 * Writes the content of this manager to the given output stream.
 	 * @param protocol_version serialization version of ContentFeatures
@@ -731,6 +756,14 @@ class NodeDefManager {
 	 * Even constant NodeDefManager instances can register listeners.
 	 */
 	mutable std::vector<NodeResolver *> m_pending_resolve_callbacks;
+
+#ifndef SERVER
+	/*!
+	 * Threads preparing the meshes of mesh nodes in updateTextures(),
+	 * started by its first call.
+	 */
+	std::unique_ptr<WorkerPool> m_mesh_pool;
+#endif
 };
 
 NodeDefManager *createNodeDefManager();
@@ -22,6 +22,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "serialization.h"
 #include "util/serialize.h"
 #include "constants.h" // MAP_BLOCKSIZE
+#include <algorithm>
+#include <cassert>
 
 /*
 	NodeTimer
@@ -63,7 +65,7 @@ void NodeTimerList::serialize(std::ostream &os, u8 map_format_version) const
 	for (const auto &timer : m_timers) {
 		NodeTimer t = timer.second;
 		NodeTimer nt = NodeTimer(t.timeout,
-			t.timeout - (f32)(timer.first - m_time), t.position);
+			t.timeout - (f32)(timer.first - getTime()), t.position);
 		v3s16 p = t.position;
 
 		u16 p16 = p.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE + p.Y * MAP_BLOCKSIZE + p.X;
@@ -125,26 +127,199 @@ void NodeTimerList::deSerialize(std::istream &is, u8 map_format_version)
 	}
 }
 
+NodeTimerList::~NodeTimerList()
+{
+	detach();
+}
+
 std::vector<NodeTimer> NodeTimerList::step(float dtime)
 {
-	std::vector<NodeTimer> elapsed_timers;
+	assert(!m_wheel);
 	m_time += dtime;
-	if (m_next_trigger_time == -1. || m_time < m_next_trigger_time) {
+	return takeElapsed();
+}
+
+std::vector<NodeTimer> NodeTimerList::takeElapsed()
+{
+	std::vector<NodeTimer> elapsed_timers;
+	double time = getTime();
+	if (m_next_trigger_time == -1. || time < m_next_trigger_time) {
 		return elapsed_timers;
 	}
 	std::multimap<double, NodeTimer>::iterator i = m_timers.begin();
 	// Process timers
-	for (; i != m_timers.end() && i->first <= m_time; ++i) {
+	for (; i != m_timers.end() && i->first <= time; ++i) {
 		NodeTimer t = i->second;
-		t.elapsed = t.timeout + (f32)(m_time - i->first);
+		t.elapsed = t.timeout + (f32)(time - i->first);
 		elapsed_timers.push_back(t);
 		m_iterators.erase(t.position);
 	}
 	// Delete elapsed timers
 	m_timers.erase(m_timers.begin(), i);
 	if (m_timers.empty())
-		m_next_trigger_time = -1.;
+		setNextTriggerTime(-1.);
 	else
-		m_next_trigger_time = m_timers.begin()->first;
+		setNextTriggerTime(m_timers.begin()->first);
 	return elapsed_timers;
 }
+
+void NodeTimerList::attach(NodeTimerWheel *wheel, const v3s16 &key)
+{
+	detach();
+
+	// Move the trigger times to the clock of the wheel
+	double offset = wheel->getTime() - m_time;
+	if (offset != 0.) {
+		std::multimap<double, NodeTimer> timers;
+		timers.swap(m_timers);
+		m_iterators.clear();
+		for (const auto &timer : timers) {
+			auto it = m_timers.insert(std::pair<double, NodeTimer>(
+				timer.first + offset, timer.second));
+			m_iterators.insert(std::pair<v3s16,
+				std::multimap<double, NodeTimer>::iterator>(
+					timer.second.position, it));
+		}
+		if (m_next_trigger_time != -1.)
+			m_next_trigger_time += offset;
+	}
+
+	m_time = wheel->getTime();
+	m_wheel = wheel;
+	m_wheel_key = key;
+	if (m_next_trigger_time != -1.)
+		m_wheel->set(m_wheel_key, m_next_trigger_time);
+}
+
+void NodeTimerList::detach()
+{
+	if (!m_wheel)
+		return;
+
+	m_time = m_wheel->getTime();
+	m_wheel->remove(m_wheel_key);
+	m_wheel = nullptr;
+}
+
+void NodeTimerList::setNextTriggerTime(double time)
+{
+	m_next_trigger_time = time;
+	if (!m_wheel)
+		return;
+
+	if (time == -1.)
+		m_wheel->remove(m_wheel_key);
+	else
+		m_wheel->set(m_wheel_key, time);
+}
+
+/*
+	NodeTimerWheel
+*/
+
+NodeTimerWheel::NodeTimerWheel(double resolution):
+	m_resolution(resolution)
+{
+}
+
+void NodeTimerWheel::set(const v3s16 &key, double expiry)
+{
+	auto it = m_expiry.find(key);
+	if (it != m_expiry.end()) {
+		if (it->second == expiry)
+			return;
+		// The old entry becomes stale and is dropped when its slot is visited
+		it->second = expiry;
+	} else {
+		m_expiry.emplace(key, expiry);
+	}
+	place(Entry{key, expiry});
+}
+
+void NodeTimerWheel::remove(const v3s16 &key)
+{
+	m_expiry.erase(key);
+}
+
+void NodeTimerWheel::clear()
+{
+	for (auto &level : m_slots)
+		for (auto &slot : level)
+			slot.clear();
+	m_overflow.clear();
+	m_expiry.clear();
+}
+
+void NodeTimerWheel::place(const Entry &entry)
+{
+	u64 tick = entry.expiry > m_time ? (u64)(entry.expiry / m_resolution) : m_tick;
+	if (tick < m_tick)
+		tick = m_tick;
+	u64 delta = tick - m_tick;
+
+	for (u32 level = 0; level < LEVEL_COUNT; level++) {
+		if (delta < (u64)1 << (SLOT_BITS * (level + 1))) {
+			u32 index = (tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1);
+			m_slots[level][index].push_back(entry);
+			return;
+		}
+	}
+	m_overflow.push_back(entry);
+}
+
+void NodeTimerWheel::cascade(std::vector<Entry> &slot)
+{
+	std::vector<Entry> entries;
+	entries.swap(slot);
+	for (const Entry &entry : entries) {
+		auto it = m_expiry.find(entry.key);
+		if (it != m_expiry.end() && it->second == entry.expiry)
+			place(entry);
+	}
+}
+
+void NodeTimerWheel::advance(double time, std::vector<v3s16> &expired)
+{
+	if (time < m_time)
+		return;
+	m_time = time;
+	u64 target = (u64)(time / m_resolution);
+
+	if (m_expiry.empty()) {
+		// Nothing to visit, the stale entries left in the slots are harmless
+		m_tick = std::max(m_tick, target);
+		return;
+	}
+
+	while (true) {
+		std::vector<Entry> entries;
+		entries.swap(m_slots[0][m_tick & (SLOT_COUNT - 1)]);
+		for (const Entry &entry : entries) {
+			auto it = m_expiry.find(entry.key);
+			if (it == m_expiry.end() || it->second != entry.expiry)
+				continue;
+			if (entry.expiry <= time) {
+				expired.push_back(entry.key);
+				m_expiry.erase(it);
+			} else {
+				// Expires later within the current tick
+				place(entry);
+			}
+		}
+
+		if (m_tick >= target)
+			break;
+		m_tick++;
+
+		// Move the entries of the coarser levels down when a level wraps
+		u32 level = 1;
+		for (; level < LEVEL_COUNT; level++) {
+			u64 shift = SLOT_BITS * level;
+			if ((m_tick & (((u64)1 << shift) - 1)) != 0)
+				break;
+			cascade(m_slots[level][(m_tick >> shift) & (SLOT_COUNT - 1)]);
+		}
+		if (level == LEVEL_COUNT)
+			cascade(m_overflow);
+	}
+}
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "irr_v3d.h"
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 /*
@@ -50,6 +51,56 @@ class NodeTimer
 	v3s16 position;
 };
 
+/*
+	Hierarchical timing wheel holding the next trigger time of the timer
+	lists of the active blocks, keyed by block position. Advancing it only
+	visits the slots that pass by and the entries that cascade down from
+	the coarser levels, so the cost of a step does not depend on the number
+	of registered blocks.
+*/
+
+class NodeTimerWheel
+{
+public:
+	NodeTimerWheel(double resolution = 0.1);
+
+	double getTime() const { return m_time; }
+	size_t size() const { return m_expiry.size(); }
+
+	// Registers a key or moves it to a new absolute expiry time
+	void set(const v3s16 &key, double expiry);
+	void remove(const v3s16 &key);
+	void clear();
+
+	// Moves the clock forward to time, appends the expired keys to expired
+	// and removes them
+	void advance(double time, std::vector<v3s16> &expired);
+
+private:
+	static const u32 SLOT_BITS = 6;
+	static const u32 SLOT_COUNT = 1 << SLOT_BITS;
+	static const u32 LEVEL_COUNT = 4;
+
+	struct Entry
+	{
+		v3s16 key;
+		double expiry;
+	};
+
+	void place(const Entry &entry);
+	void cascade(std::vector<Entry> &slot);
+
+	double m_resolution;
+	double m_time = 0.0;
+	// Tick of m_time, the level 0 slot of this tick is the current one
+	u64 m_tick = 0;
+	std::vector<Entry> m_slots[LEVEL_COUNT][SLOT_COUNT];
+	// Entries beyond the range of the top level
+	std::vector<Entry> m_overflow;
+	// Current expiry time of each key, slot entries not matching it are stale
+	std::unordered_map<v3s16, double> m_expiry;
+};
+
 /*
 	List of timers of all the nodes of a block
 */
@@ -58,7 +109,7 @@ class NodeTimerList
 {
 public:
 	NodeTimerList() = default;
-	~NodeTimerList() = default;
+	~NodeTimerList();
 
 	void serialize(std::ostream &os, u8 map_format_version) const;
 	void deSerialize(std::istream &is, u8 map_format_version);
@@ -70,7 +121,7 @@ class NodeTimerList
 		if (n == m_iterators.end())
 			return NodeTimer();
 		NodeTimer t = n->second->second;
-		t.elapsed = t.timeout - (n->second->first - m_time);
+		t.elapsed = t.timeout - (n->second->first - getTime());
 		return t;
 	}
 	// Deletes timer
@@ -86,16 +137,16 @@ class NodeTimerList
 			// and thus we never lose precision
 			if (removed_time == m_next_trigger_time) {
 				if (m_timers.empty())
-					m_next_trigger_time = -1.;
+					setNextTriggerTime(-1.);
 				else
-					m_next_trigger_time = m_timers.begin()->first;
+					setNextTriggerTime(m_timers.begin()->first);
 			}
 		}
 	}
 	// Undefined behaviour if there already is a timer
 	void insert(NodeTimer timer) {
 		v3s16 p = timer.position;
-		double trigger_time = m_time + (double)(timer.timeout - timer.elapsed);
+		double trigger_time = getTime() + (double)(timer.timeout - timer.elapsed);
 		std::multimap<double, NodeTimer>::iterator it =
 			m_timers.insert(std::pair<double, NodeTimer>(
 				trigger_time, timer
@@ -103,7 +154,7 @@ class NodeTimerList
 		m_iterators.insert(
 			std::pair<v3s16, std::multimap<double, NodeTimer>::iterator>(p, it));
 		if (m_next_trigger_time == -1. || trigger_time < m_next_trigger_time)
-			m_next_trigger_time = trigger_time;
+			setNextTriggerTime(trigger_time);
 	}
 	// Deletes old timer and sets a new one
 	inline void set(const NodeTimer &timer) {
@@ -114,15 +165,29 @@ class NodeTimerList
 	void clear() {
 		m_timers.clear();
 		m_iterators.clear();
-		m_next_trigger_time = -1.;
+		setNextTriggerTime(-1.);
 	}
 
-	// Move forward in time, returns elapsed timers
+	// Move forward in time, returns elapsed timers.
+	// Only for lists that are not attached to a wheel.
 	std::vector<NodeTimer> step(float dtime);
+	// Removes and returns the timers that have elapsed
+	std::vector<NodeTimer> takeElapsed();
+
+	// Runs the timers on the clock of the wheel, which is told the next
+	// trigger time of the list under the given key
+	void attach(NodeTimerWheel *wheel, const v3s16 &key);
+	void detach();
+	bool isAttached() const { return m_wheel != nullptr; }
 
 private:
+	double getTime() const { return m_wheel ? m_wheel->getTime() : m_time; }
+	void setNextTriggerTime(double time);
+
 	std::multimap<double, NodeTimer> m_timers;
 	std::map<v3s16, std::multimap<double, NodeTimer>::iterator> m_iterators;
 	double m_next_trigger_time = -1.0;
 	double m_time = 0.0;
+	NodeTimerWheel *m_wheel = nullptr;
+	v3s16 m_wheel_key;
 };
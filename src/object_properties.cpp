@@ -167,3 +167,207 @@ void ObjectProperties::deSerialize(std::istream &is)
 	zoom_fov = readF32(is);
 	use_texture_alpha = readU8(is);
 }
+
+static_assert(ObjectProperties::FIELD_COUNT <= 32,
+		"ObjectProperties field mask does not fit into u32");
+
+u32 ObjectProperties::diff(const ObjectProperties &other) const
+{
+	u32 fields = 0;
+	for (u8 i = 0; i < FIELD_COUNT; i++) {
+		if (!fieldEquals(other, (Field)i))
+			fields |= 1U << i;
+	}
+	return fields;
+}
+
+void ObjectProperties::serializeDelta(std::ostream &os, u32 fields) const
+{
+	writeU8(os, 1); // Delta format version
+	writeU32(os, fields);
+	for (u8 i = 0; i < FIELD_COUNT; i++) {
+		if (fields & (1U << i))
+			serializeField(os, (Field)i);
+	}
+}
+
+u32 ObjectProperties::deSerializeDelta(std::istream &is)
+{
+	int version = readU8(is);
+	if (version != 1)
+		throw SerializationError("unsupported ObjectProperties delta version");
+
+	u32 fields = readU32(is);
+	if (fields >> FIELD_COUNT)
+		throw SerializationError("unknown fields in ObjectProperties delta");
+
+	for (u8 i = 0; i < FIELD_COUNT; i++) {
+		if (fields & (1U << i))
+			deSerializeField(is, (Field)i);
+	}
+	return fields;
+}
+
+bool ObjectProperties::fieldEquals(const ObjectProperties &other, Field field) const
+{
+	switch (field) {
+	case FIELD_HP_MAX: return hp_max == other.hp_max;
+	case FIELD_PHYSICAL: return physical == other.physical;
+	case FIELD_COLLISIONBOX: return collisionbox == other.collisionbox;
+	case FIELD_SELECTIONBOX: return selectionbox == other.selectionbox;
+	case FIELD_POINTABLE: return pointable == other.pointable;
+	case FIELD_VISUAL: return visual == other.visual;
+	case FIELD_VISUAL_SIZE: return visual_size == other.visual_size;
+	case FIELD_TEXTURES: return textures == other.textures;
+	case FIELD_SPRITEDIV: return spritediv == other.spritediv;
+	case FIELD_INITIAL_SPRITE_BASEPOS:
+		return initial_sprite_basepos == other.initial_sprite_basepos;
+	case FIELD_IS_VISIBLE: return is_visible == other.is_visible;
+	case FIELD_MAKES_FOOTSTEP_SOUND:
+		return makes_footstep_sound == other.makes_footstep_sound;
+	case FIELD_AUTOMATIC_ROTATE: return automatic_rotate == other.automatic_rotate;
+	case FIELD_MESH: return mesh == other.mesh;
+	case FIELD_COLORS: return colors == other.colors;
+	case FIELD_COLLIDE_WITH_OBJECTS:
+		return collideWithObjects == other.collideWithObjects;
+	case FIELD_STEPHEIGHT: return stepheight == other.stepheight;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR:
+		return automatic_face_movement_dir == other.automatic_face_movement_dir;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR_OFFSET:
+		return automatic_face_movement_dir_offset ==
+				other.automatic_face_movement_dir_offset;
+	case FIELD_BACKFACE_CULLING: return backface_culling == other.backface_culling;
+	case FIELD_NAMETAG: return nametag == other.nametag;
+	case FIELD_NAMETAG_COLOR: return nametag_color == other.nametag_color;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_MAX_ROTATION_PER_SEC:
+		return automatic_face_movement_max_rotation_per_sec ==
+				other.automatic_face_movement_max_rotation_per_sec;
+	case FIELD_INFOTEXT: return infotext == other.infotext;
+	case FIELD_WIELD_ITEM: return wield_item == other.wield_item;
+	case FIELD_GLOW: return glow == other.glow;
+	case FIELD_BREATH_MAX: return breath_max == other.breath_max;
+	case FIELD_EYE_HEIGHT: return eye_height == other.eye_height;
+	case FIELD_ZOOM_FOV: return zoom_fov == other.zoom_fov;
+	case FIELD_USE_TEXTURE_ALPHA: return use_texture_alpha == other.use_texture_alpha;
+	case FIELD_COUNT: break;
+	}
+	return true;
+}
+
+void ObjectProperties::serializeField(std::ostream &os, Field field) const
+{
+	switch (field) {
+	case FIELD_HP_MAX: writeU16(os, hp_max); break;
+	case FIELD_PHYSICAL: writeU8(os, physical); break;
+	case FIELD_COLLISIONBOX:
+		writeV3F32(os, collisionbox.MinEdge);
+		writeV3F32(os, collisionbox.MaxEdge);
+		break;
+	case FIELD_SELECTIONBOX:
+		writeV3F32(os, selectionbox.MinEdge);
+		writeV3F32(os, selectionbox.MaxEdge);
+		break;
+	case FIELD_POINTABLE: writeU8(os, pointable); break;
+	case FIELD_VISUAL: os << serializeString(visual); break;
+	case FIELD_VISUAL_SIZE: writeV3F32(os, visual_size); break;
+	case FIELD_TEXTURES:
+		writeU16(os, textures.size());
+		for (const std::string &texture : textures)
+			os << serializeString(texture);
+		break;
+	case FIELD_SPRITEDIV: writeV2S16(os, spritediv); break;
+	case FIELD_INITIAL_SPRITE_BASEPOS: writeV2S16(os, initial_sprite_basepos); break;
+	case FIELD_IS_VISIBLE: writeU8(os, is_visible); break;
+	case FIELD_MAKES_FOOTSTEP_SOUND: writeU8(os, makes_footstep_sound); break;
+	case FIELD_AUTOMATIC_ROTATE: writeF32(os, automatic_rotate); break;
+	case FIELD_MESH: os << serializeString(mesh); break;
+	case FIELD_COLORS:
+		writeU16(os, colors.size());
+		for (video::SColor color : colors)
+			writeARGB8(os, color);
+		break;
+	case FIELD_COLLIDE_WITH_OBJECTS: writeU8(os, collideWithObjects); break;
+	case FIELD_STEPHEIGHT: writeF32(os, stepheight); break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR:
+		writeU8(os, automatic_face_movement_dir);
+		break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR_OFFSET:
+		writeF32(os, automatic_face_movement_dir_offset);
+		break;
+	case FIELD_BACKFACE_CULLING: writeU8(os, backface_culling); break;
+	case FIELD_NAMETAG: os << serializeString(nametag); break;
+	case FIELD_NAMETAG_COLOR: writeARGB8(os, nametag_color); break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_MAX_ROTATION_PER_SEC:
+		writeF32(os, automatic_face_movement_max_rotation_per_sec);
+		break;
+	case FIELD_INFOTEXT: os << serializeString(infotext); break;
+	case FIELD_WIELD_ITEM: os << serializeString(wield_item); break;
+	case FIELD_GLOW: writeS8(os, glow); break;
+	case FIELD_BREATH_MAX: writeU16(os, breath_max); break;
+	case FIELD_EYE_HEIGHT: writeF32(os, eye_height); break;
+	case FIELD_ZOOM_FOV: writeF32(os, zoom_fov); break;
+	case FIELD_USE_TEXTURE_ALPHA: writeU8(os, use_texture_alpha); break;
+	case FIELD_COUNT: break;
+	}
+}
+
+void ObjectProperties::deSerializeField(std::istream &is, Field field)
+{
+	switch (field) {
+	case FIELD_HP_MAX: hp_max = readU16(is); break;
+	case FIELD_PHYSICAL: physical = readU8(is); break;
+	case FIELD_COLLISIONBOX:
+		collisionbox.MinEdge = readV3F32(is);
+		collisionbox.MaxEdge = readV3F32(is);
+		break;
+	case FIELD_SELECTIONBOX:
+		selectionbox.MinEdge = readV3F32(is);
+		selectionbox.MaxEdge = readV3F32(is);
+		break;
+	case FIELD_POINTABLE: pointable = readU8(is); break;
+	case FIELD_VISUAL: visual = deSerializeString(is); break;
+	case FIELD_VISUAL_SIZE: visual_size = readV3F32(is); break;
+	case FIELD_TEXTURES: {
+		textures.clear();
+		u32 texture_count = readU16(is);
+		for (u32 i = 0; i < texture_count; i++)
+			textures.push_back(deSerializeString(is));
+		break;
+	}
+	case FIELD_SPRITEDIV: spritediv = readV2S16(is); break;
+	case FIELD_INITIAL_SPRITE_BASEPOS: initial_sprite_basepos = readV2S16(is); break;
+	case FIELD_IS_VISIBLE: is_visible = readU8(is); break;
+	case FIELD_MAKES_FOOTSTEP_SOUND: makes_footstep_sound = readU8(is); break;
+	case FIELD_AUTOMATIC_ROTATE: automatic_rotate = readF32(is); break;
+	case FIELD_MESH: mesh = deSerializeString(is); break;
+	case FIELD_COLORS: {
+		colors.clear();
+		u32 color_count = readU16(is);
+		for (u32 i = 0; i < color_count; i++)
+			colors.push_back(readARGB8(is));
+		break;
+	}
+	case FIELD_COLLIDE_WITH_OBJECTS: collideWithObjects = readU8(is); break;
+	case FIELD_STEPHEIGHT: stepheight = readF32(is); break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR:
+		automatic_face_movement_dir = readU8(is);
+		break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_DIR_OFFSET:
+		automatic_face_movement_dir_offset = readF32(is);
+		break;
+	case FIELD_BACKFACE_CULLING: backface_culling = readU8(is); break;
+	case FIELD_NAMETAG: nametag = deSerializeString(is); break;
+	case FIELD_NAMETAG_COLOR: nametag_color = readARGB8(is); break;
+	case FIELD_AUTOMATIC_FACE_MOVEMENT_MAX_ROTATION_PER_SEC:
+		automatic_face_movement_max_rotation_per_sec = readF32(is);
+		break;
+	case FIELD_INFOTEXT: infotext = deSerializeString(is); break;
+	case FIELD_WIELD_ITEM: wield_item = deSerializeString(is); break;
+	case FIELD_GLOW: glow = readS8(is); break;
+	case FIELD_BREATH_MAX: breath_max = readU16(is); break;
+	case FIELD_EYE_HEIGHT: eye_height = readF32(is); break;
+	case FIELD_ZOOM_FOV: zoom_fov = readF32(is); break;
+	case FIELD_USE_TEXTURE_ALPHA: use_texture_alpha = readU8(is); break;
+	case FIELD_COUNT: break;
+	}
+}
@@ -27,6 +27,45 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 struct ObjectProperties
 {
+	/*
+		Identifies a serialized field for the delta encoding, see
+		serializeDelta(). The numbering is part of the network protocol:
+		append new fields at the end and never reorder them.
+	*/
+	enum Field : u8 {
+		FIELD_HP_MAX,
+		FIELD_PHYSICAL,
+		FIELD_COLLISIONBOX,
+		FIELD_SELECTIONBOX,
+		FIELD_POINTABLE,
+		FIELD_VISUAL,
+		FIELD_VISUAL_SIZE,
+		FIELD_TEXTURES,
+		FIELD_SPRITEDIV,
+		FIELD_INITIAL_SPRITE_BASEPOS,
+		FIELD_IS_VISIBLE,
+		FIELD_MAKES_FOOTSTEP_SOUND,
+		FIELD_AUTOMATIC_ROTATE,
+		FIELD_MESH,
+		FIELD_COLORS,
+		FIELD_COLLIDE_WITH_OBJECTS,
+		FIELD_STEPHEIGHT,
+		FIELD_AUTOMATIC_FACE_MOVEMENT_DIR,
+		FIELD_AUTOMATIC_FACE_MOVEMENT_DIR_OFFSET,
+		FIELD_BACKFACE_CULLING,
+		FIELD_NAMETAG,
+		FIELD_NAMETAG_COLOR,
+		FIELD_AUTOMATIC_FACE_MOVEMENT_MAX_ROTATION_PER_SEC,
+		FIELD_INFOTEXT,
+		FIELD_WIELD_ITEM,
+		FIELD_GLOW,
+		FIELD_BREATH_MAX,
+		FIELD_EYE_HEIGHT,
+		FIELD_ZOOM_FOV,
+		FIELD_USE_TEXTURE_ALPHA,
+		FIELD_COUNT
+	};
+
 	u16 hp_max = 1;
 	u16 breath_max = 0;
 	bool physical = false;
@@ -65,4 +104,16 @@ struct ObjectProperties
 	std::string dump();
 	void serialize(std::ostream &os) const;
 	void deSerialize(std::istream &is);
+
+	// Returns a bitmask of (1 << Field) for every field that differs from `other`
+	u32 diff(const ObjectProperties &other) const;
+	// Writes only the fields selected by `fields`, a mask as returned by diff()
+	void serializeDelta(std::ostream &os, u32 fields) const;
+	// Applies a delta written by serializeDelta() and returns its field mask
+	u32 deSerializeDelta(std::istream &is);
+
+private:
+	bool fieldEquals(const ObjectProperties &other, Field field) const;
+	void serializeField(std::ostream &os, Field field) const;
+	void deSerializeField(std::istream &is, Field field);
 };
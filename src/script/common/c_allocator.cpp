@@ -0,0 +1,114 @@
+/*
+Minetest
+Copyright (C) 2013 celeron55, Perttu Ahola <celeron55@gmail.com>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "common/c_allocator.h"
+#include <cstdlib>
+#include <cstring>
+
+LuaPoolAllocator::~LuaPoolAllocator()
+{
+	for (char *page : m_pages)
+		free(page);
+}
+
+void *LuaPoolAllocator::alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	LuaPoolAllocator *self = (LuaPoolAllocator *)ud;
+
+	if (nsize == 0) {
+		if (ptr)
+			self->deallocate(ptr, osize);
+		return nullptr;
+	}
+	if (!ptr)
+		return self->allocate(nsize);
+	return self->reallocate(ptr, osize, nsize);
+}
+
+void *LuaPoolAllocator::allocate(size_t size)
+{
+	if (size > MAX_POOLED_SIZE)
+		return malloc(size);
+
+	size_t size_class = sizeClass(size);
+	FreeChunk *chunk = m_free[size_class];
+	if (chunk) {
+		m_free[size_class] = chunk->next;
+		return chunk;
+	}
+
+	size_t chunk_size = classSize(size_class);
+	if (m_page_left < chunk_size) {
+		// Chunk sizes are multiples of GRANULARITY, so the rest of the old
+		// page is exactly one chunk of a smaller class
+		if (m_page_left > 0) {
+			FreeChunk *rest = (FreeChunk *)m_page_pos;
+			rest->next = m_free[sizeClass(m_page_left)];
+			m_free[sizeClass(m_page_left)] = rest;
+			m_page_left = 0;
+		}
+
+		char *page = (char *)malloc(PAGE_SIZE);
+		if (!page)
+			return nullptr;
+		m_pages.push_back(page);
+		m_page_pos = page;
+		m_page_left = PAGE_SIZE;
+	}
+
+	void *ptr = m_page_pos;
+	m_page_pos += chunk_size;
+	m_page_left -= chunk_size;
+	return ptr;
+}
+
+void LuaPoolAllocator::deallocate(void *ptr, size_t size)
+{
+	if (size > MAX_POOLED_SIZE) {
+		free(ptr);
+		return;
+	}
+
+	size_t size_class = sizeClass(size);
+	FreeChunk *chunk = (FreeChunk *)ptr;
+	chunk->next = m_free[size_class];
+	m_free[size_class] = chunk;
+}
+
+void *LuaPoolAllocator::reallocate(void *ptr, size_t osize, size_t nsize)
+{
+	if (osize > MAX_POOLED_SIZE && nsize > MAX_POOLED_SIZE)
+		return realloc(ptr, nsize);
+
+	if (osize <= MAX_POOLED_SIZE && nsize <= MAX_POOLED_SIZE &&
+			sizeClass(osize) == sizeClass(nsize))
+		return ptr;
+
+	void *nptr = allocate(nsize);
+	if (!nptr) {
+		// Lua relies on shrinking never failing. Keep the old block, it is
+		// only ever given back with a smaller size, so it fits that class.
+		if (nsize <= osize)
+			return ptr;
+		return nullptr;
+	}
+	memcpy(nptr, ptr, osize < nsize ? osize : nsize);
+	deallocate(ptr, osize);
+	return nptr;
+}
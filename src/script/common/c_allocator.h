@@ -0,0 +1,75 @@
+/*
+Minetest
+Copyright (C) 2013 celeron55, Perttu Ahola <celeron55@gmail.com>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "util/basic_macros.h"
+
+/*
+	Size-class pool allocator for Lua states (lua_Alloc).
+
+	Lua allocates huge numbers of small objects (strings, tables, closures,
+	upvalues) of only a few distinct sizes. Requests up to MAX_POOLED_SIZE
+	bytes are served from per-class free lists carved out of larger pages,
+	bigger ones go to the system allocator. Pages are only released when the
+	allocator is destroyed, after lua_close().
+
+	Every Lua state gets its own allocator, and a state is only ever used by
+	one thread at a time, so no locking is needed.
+*/
+class LuaPoolAllocator
+{
+public:
+	LuaPoolAllocator() = default;
+	~LuaPoolAllocator();
+
+	// lua_Alloc compatible, ud must be the LuaPoolAllocator
+	static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+	// Bytes reserved by the pages of the small size classes, used or not
+	size_t getPooledBytes() const { return m_pages.size() * PAGE_SIZE; }
+
+private:
+	DISABLE_CLASS_COPY(LuaPoolAllocator);
+
+	static const size_t GRANULARITY = 16;
+	static const size_t MAX_POOLED_SIZE = 256;
+	static const size_t NUM_CLASSES = MAX_POOLED_SIZE / GRANULARITY;
+	static const size_t PAGE_SIZE = 64 * 1024;
+
+	static size_t sizeClass(size_t size) { return (size - 1) / GRANULARITY; }
+	static size_t classSize(size_t size_class) { return (size_class + 1) * GRANULARITY; }
+
+	void *allocate(size_t size);
+	void deallocate(void *ptr, size_t size);
+	void *reallocate(void *ptr, size_t osize, size_t nsize);
+
+	struct FreeChunk
+	{
+		FreeChunk *next;
+	};
+
+	FreeChunk *m_free[NUM_CLASSES] = {};
+	std::vector<char *> m_pages;
+	// Unused rest of the newest page
+	char *m_page_pos = nullptr;
+	size_t m_page_left = 0;
+};
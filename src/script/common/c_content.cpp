@@ -1185,7 +1185,7 @@ ItemStack read_item(lua_State* L, int index, IItemDefManager *idef)
 
 	if (lua_isuserdata(L, index)) {
 		// Convert from LuaItemStack
-		LuaItemStack *o = LuaItemStack::checkobject(L, index);
+		const LuaItemStack *o = LuaItemStack::checkobject(L, index);
 		return o->getItem();
 	}
 
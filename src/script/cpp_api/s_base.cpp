@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "cpp_api/s_internal.h"
 #include "cpp_api/s_security.h"
 #include "lua_api/l_object.h"
+#include "common/c_allocator.h"
 #include "common/c_converter.h"
 #include "serverobject.h"
 #include "filesys.h"
@@ -28,6 +29,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "porting.h"
 #include "util/string.h"
 #include "server.h"
+#include "settings.h"
 #ifndef SERVER
 #include "client/client.h"
 #endif
@@ -79,11 +81,23 @@ ScriptApiBase::ScriptApiBase(ScriptingType type):
 	m_lock_recursion_count = 0;
 #endif
 
+#if USE_LUAJIT
+	// LuaJIT has its own allocator and does not support custom ones on
+	// 64-bit platforms
 	m_luastack = luaL_newstate();
+#else
+	m_allocator = new LuaPoolAllocator();
+	m_luastack = lua_newstate(LuaPoolAllocator::alloc, m_allocator);
+#endif
 	FATAL_ERROR_IF(!m_luastack, "luaL_newstate() failed");
 
 	lua_atpanic(m_luastack, &luaPanic);
 
+	// Incremental garbage collector pacing, see stepGarbageCollector()
+	m_gc_pause = g_settings->getU16("lua_gc_pause");
+	lua_gc(m_luastack, LUA_GCSETPAUSE, m_gc_pause);
+	lua_gc(m_luastack, LUA_GCSETSTEPMUL, g_settings->getU16("lua_gc_stepmul"));
+
 	if (m_type == ScriptingType::Client)
 		clientOpenLibs(m_luastack);
 	else
@@ -127,6 +141,7 @@ ScriptApiBase::ScriptApiBase(ScriptingType type):
 ScriptApiBase::~ScriptApiBase()
 {
 	lua_close(m_luastack);
+	delete m_allocator;
 }
 
 int ScriptApiBase::luaPanic(lua_State *L)
@@ -160,6 +175,49 @@ void ScriptApiBase::clientOpenLibs(lua_State *L)
 	}
 }
 
+float ScriptApiBase::stepGarbageCollector(float budget_ms)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	// Start a new cycle halfway to the point where Lua's own collector would,
+	// so that collection work is mostly done here within the time budget
+	// rather than in whichever callback happens to allocate.
+	int start_kb = m_gc_heap_after_cycle * (100 + (m_gc_pause - 100) / 2) / 100;
+	if (!m_gc_cycle_running && lua_gc(L, LUA_GCCOUNT, 0) < start_kb)
+		return 0.0f;
+
+	m_gc_cycle_running = true;
+	u64 start_time = porting::getTimeUs();
+	u64 end_time = start_time + budget_ms * 1000.0f;
+	u64 now;
+	do {
+		if (lua_gc(L, LUA_GCSTEP, 0)) {
+			// Cycle finished
+			m_gc_cycle_running = false;
+			m_gc_heap_after_cycle = lua_gc(L, LUA_GCCOUNT, 0);
+			now = porting::getTimeUs();
+			break;
+		}
+		now = porting::getTimeUs();
+	} while (now < end_time);
+
+	return (now - start_time) / 1000.0f;
+}
+
+int ScriptApiBase::getHeapSize()
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	return lua_gc(L, LUA_GCCOUNT, 0);
+}
+
+int ScriptApiBase::getPooledHeapSize()
+{
+	RecursiveMutexAutoLock scriptlock(m_luastackmutex);
+
+	return m_allocator ? m_allocator->getPooledBytes() / 1024 : 0;
+}
+
 void ScriptApiBase::loadMod(const std::string &script_path,
 		const std::string &mod_name)
 {
@@ -74,6 +74,7 @@ class Environment;
 class GUIEngine;
 class ServerActiveObject;
 struct PlayerHPChangeReason;
+class LuaPoolAllocator;
 
 class ScriptApiBase : protected LuaHelper {
 public:
@@ -114,6 +115,17 @@ class ScriptApiBase : protected LuaHelper {
 
 	void clientOpenLibs(lua_State *L);
 
+	// Does incremental garbage collection work for at most budget_ms
+	// milliseconds, once the heap grew enough since the last cycle.
+	// Returns the time spent in milliseconds.
+	float stepGarbageCollector(float budget_ms);
+	// Size of the Lua heap in KiB
+	int getHeapSize();
+	// Size of the pages the Lua heap allocator keeps for small objects in
+	// KiB, used or not. They are only freed with the Lua state. 0 with
+	// LuaJIT.
+	int getPooledHeapSize();
+
 protected:
 	friend class LuaABM;
 	friend class LuaLBM;
@@ -155,6 +167,14 @@ class ScriptApiBase : protected LuaHelper {
 	static int luaPanic(lua_State *L);
 
 	lua_State      *m_luastack = nullptr;
+	// nullptr with LuaJIT, which brings its own allocator
+	LuaPoolAllocator *m_allocator = nullptr;
+
+	// Garbage collector pause in percent (LUA_GCSETPAUSE)
+	int            m_gc_pause = 200;
+	// Heap size in KiB at the end of the last explicitly stepped cycle
+	int            m_gc_heap_after_cycle = 0;
+	bool           m_gc_cycle_running = false;
 
 	IGameDef       *m_gamedef = nullptr;
 	Environment    *m_environment = nullptr;
@@ -213,11 +213,13 @@ bool ScriptApiClient::on_item_use(const ItemStack &item, const PointedThing &poi
 	lua_getfield(L, -1, "registered_on_item_use");
 
 	// Push data
-	LuaItemStack::create(L, item);
+	LuaItemStackViews views;
+	LuaItemStack::createView(L, item, views);
 	push_pointed_thing(L, pointed, true);
 
 	// Call functions
 	runCallbacks(2, RUN_CALLBACKS_MODE_OR);
+	views.detach();
 	return readParam<bool>(L, -1);
 }
 
@@ -299,3 +299,16 @@ void ScriptApiEntity::luaentity_on_detach(u16 id, ServerActiveObject *parent)
 {
 	luaentity_run_simple_callback(id, parent, "on_detach");
 }
+
+// Returns whether entity.<field> is a function
+bool ScriptApiEntity::luaentity_HasCallback(u16 id, const char *field)
+{
+	SCRIPTAPI_PRECHECKHEADER
+
+	// Get core.luaentities[id]
+	luaentity_get(L, id);
+	lua_getfield(L, -1, field);
+	bool has_callback = lua_isfunction(L, -1);
+	lua_pop(L, 2); // Pop callback field and entity
+	return has_callback;
+}
@@ -67,13 +67,15 @@ int ScriptApiDetached::detached_inventory_AllowPut(
 	if (!getDetachedInventoryCallback(ma.to_inv.name, "allow_put"))
 		return stack.count; // All will be accepted
 
+	LuaItemStackViews views;
 	// Call function(inv, listname, index, stack, player)
-	InvRef::create(L, ma.to_inv);          // inv
-	lua_pushstring(L, ma.to_list.c_str()); // listname
-	lua_pushinteger(L, ma.to_i + 1);       // index
-	LuaItemStack::create(L, stack);      // stack
-	objectrefGetOrCreate(L, player);     // player
+	InvRef::create(L, ma.to_inv);              // inv
+	lua_pushstring(L, ma.to_list.c_str());     // listname
+	lua_pushinteger(L, ma.to_i + 1);           // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 1, error_handler));
+	views.detach();
 	if (!lua_isnumber(L, -1))
 		throw LuaError("allow_put should return a number. name=" + ma.to_inv.name);
 	int ret = luaL_checkinteger(L, -1);
@@ -94,13 +96,15 @@ int ScriptApiDetached::detached_inventory_AllowTake(
 	if (!getDetachedInventoryCallback(ma.from_inv.name, "allow_take"))
 		return stack.count; // All will be accepted
 
+	LuaItemStackViews views;
 	// Call function(inv, listname, index, stack, player)
-	InvRef::create(L, ma.from_inv);          // inv
-	lua_pushstring(L, ma.from_list.c_str()); // listname
-	lua_pushinteger(L, ma.from_i + 1);       // index
-	LuaItemStack::create(L, stack);      // stack
-	objectrefGetOrCreate(L, player);     // player
+	InvRef::create(L, ma.from_inv);            // inv
+	lua_pushstring(L, ma.from_list.c_str());   // listname
+	lua_pushinteger(L, ma.from_i + 1);         // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 1, error_handler));
+	views.detach();
 	if (!lua_isnumber(L, -1))
 		throw LuaError("allow_take should return a number. name=" + ma.from_inv.name);
 	int ret = luaL_checkinteger(L, -1);
@@ -147,14 +151,16 @@ void ScriptApiDetached::detached_inventory_OnPut(
 	if (!getDetachedInventoryCallback(ma.to_inv.name, "on_put"))
 		return;
 
+	LuaItemStackViews views;
 	// Call function(inv, listname, index, stack, player)
 	// inv
 	InvRef::create(L, ma.to_inv);
-	lua_pushstring(L, ma.to_list.c_str()); // listname
-	lua_pushinteger(L, ma.to_i + 1);       // index
-	LuaItemStack::create(L, stack);        // stack
-	objectrefGetOrCreate(L, player);       // player
+	lua_pushstring(L, ma.to_list.c_str());     // listname
+	lua_pushinteger(L, ma.to_i + 1);           // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 0, error_handler));
+	views.detach();
 	lua_pop(L, 1);  // Pop error handler
 }
 
@@ -171,14 +177,16 @@ void ScriptApiDetached::detached_inventory_OnTake(
 	if (!getDetachedInventoryCallback(ma.from_inv.name, "on_take"))
 		return;
 
+	LuaItemStackViews views;
 	// Call function(inv, listname, index, stack, player)
 	// inv
 	InvRef::create(L, ma.from_inv);
-	lua_pushstring(L, ma.from_list.c_str()); // listname
-	lua_pushinteger(L, ma.from_i + 1);       // index
-	LuaItemStack::create(L, stack);          // stack
-	objectrefGetOrCreate(L, player);         // player
+	lua_pushstring(L, ma.from_list.c_str());   // listname
+	lua_pushinteger(L, ma.from_i + 1);         // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 0, error_handler));
+	views.detach();
 	lua_pop(L, 1);  // Pop error handler
 }
 
@@ -40,11 +40,13 @@ bool ScriptApiItem::item_OnDrop(ItemStack &item,
 	if (!getItemCallback(item.name.c_str(), "on_drop"))
 		return false;
 
+	LuaItemStackViews views;
 	// Call function
-	LuaItemStack::create(L, item);
+	LuaItemStack::createView(L, item, views);
 	objectrefGetOrCreate(L, dropper);
 	pushFloatPos(L, pos);
 	PCALL_RES(lua_pcall(L, 3, 1, error_handler));
+	views.detach();
 	if (!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -67,8 +69,9 @@ bool ScriptApiItem::item_OnPlace(ItemStack &item,
 	if (!getItemCallback(item.name.c_str(), "on_place"))
 		return false;
 
+	LuaItemStackViews views;
 	// Call function
-	LuaItemStack::create(L, item);
+	LuaItemStack::createView(L, item, views);
 
 	if (!placer)
 		lua_pushnil(L);
@@ -77,6 +80,7 @@ bool ScriptApiItem::item_OnPlace(ItemStack &item,
 
 	pushPointedThing(pointed);
 	PCALL_RES(lua_pcall(L, 3, 1, error_handler));
+	views.detach();
 	if (!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -99,11 +103,13 @@ bool ScriptApiItem::item_OnUse(ItemStack &item,
 	if (!getItemCallback(item.name.c_str(), "on_use"))
 		return false;
 
+	LuaItemStackViews views;
 	// Call function
-	LuaItemStack::create(L, item);
+	LuaItemStack::createView(L, item, views);
 	objectrefGetOrCreate(L, user);
 	pushPointedThing(pointed);
 	PCALL_RES(lua_pcall(L, 3, 1, error_handler));
+	views.detach();
 	if(!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -125,10 +131,12 @@ bool ScriptApiItem::item_OnSecondaryUse(ItemStack &item,
 	if (!getItemCallback(item.name.c_str(), "on_secondary_use"))
 		return false;
 
-	LuaItemStack::create(L, item);
+	LuaItemStackViews views;
+	LuaItemStack::createView(L, item, views);
 	objectrefGetOrCreate(L, user);
 	pushPointedThing(pointed);
 	PCALL_RES(lua_pcall(L, 3, 1, error_handler));
+	views.detach();
 	if (!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -149,7 +157,8 @@ bool ScriptApiItem::item_OnCraft(ItemStack &item, ServerActiveObject *user,
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "on_craft");
-	LuaItemStack::create(L, item);
+	LuaItemStackViews views;
+	LuaItemStack::createView(L, item, views);
 	objectrefGetOrCreate(L, user);
 
 	// Push inventory list
@@ -161,6 +170,7 @@ bool ScriptApiItem::item_OnCraft(ItemStack &item, ServerActiveObject *user,
 
 	InvRef::create(L, craft_inv);
 	PCALL_RES(lua_pcall(L, 4, 1, error_handler));
+	views.detach();
 	if (!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -181,7 +191,8 @@ bool ScriptApiItem::item_CraftPredict(ItemStack &item, ServerActiveObject *user,
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "craft_predict");
-	LuaItemStack::create(L, item);
+	LuaItemStackViews views;
+	LuaItemStack::createView(L, item, views);
 	objectrefGetOrCreate(L, user);
 
 	//Push inventory list
@@ -193,6 +204,7 @@ bool ScriptApiItem::item_CraftPredict(ItemStack &item, ServerActiveObject *user,
 
 	InvRef::create(L, craft_inv);
 	PCALL_RES(lua_pcall(L, 4, 1, error_handler));
+	views.detach();
 	if (!lua_isnil(L, -1)) {
 		try {
 			item = read_item(L, -1, getServer()->idef());
@@ -85,13 +85,15 @@ int ScriptApiNodemeta::nodemeta_inventory_AllowPut(
 	if (!getItemCallback(nodename.c_str(), "allow_metadata_inventory_put", &ma.to_inv.p))
 		return stack.count;
 
+	LuaItemStackViews views;
 	// Call function(pos, listname, index, stack, player)
-	push_v3s16(L, ma.to_inv.p);            // pos
-	lua_pushstring(L, ma.to_list.c_str()); // listname
-	lua_pushinteger(L, ma.to_i + 1);       // index
-	LuaItemStack::create(L, stack);        // stack
-	objectrefGetOrCreate(L, player);       // player
+	push_v3s16(L, ma.to_inv.p);                // pos
+	lua_pushstring(L, ma.to_list.c_str());     // listname
+	lua_pushinteger(L, ma.to_i + 1);           // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 1, error_handler));
+	views.detach();
 	if(!lua_isnumber(L, -1))
 		throw LuaError("allow_metadata_inventory_put should"
 				" return a number, guilty node: " + nodename);
@@ -121,13 +123,15 @@ int ScriptApiNodemeta::nodemeta_inventory_AllowTake(
 	if (!getItemCallback(nodename.c_str(), "allow_metadata_inventory_take", &ma.from_inv.p))
 		return stack.count;
 
+	LuaItemStackViews views;
 	// Call function(pos, listname, index, count, player)
-	push_v3s16(L, ma.from_inv.p);            // pos
-	lua_pushstring(L, ma.from_list.c_str()); // listname
-	lua_pushinteger(L, ma.from_i + 1);       // index
-	LuaItemStack::create(L, stack);          // stack
-	objectrefGetOrCreate(L, player);         // player
+	push_v3s16(L, ma.from_inv.p);              // pos
+	lua_pushstring(L, ma.from_list.c_str());   // listname
+	lua_pushinteger(L, ma.from_i + 1);         // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 1, error_handler));
+	views.detach();
 	if (!lua_isnumber(L, -1))
 		throw LuaError("allow_metadata_inventory_take should"
 				" return a number, guilty node: " + nodename);
@@ -190,13 +194,15 @@ void ScriptApiNodemeta::nodemeta_inventory_OnPut(
 	if (!getItemCallback(nodename.c_str(), "on_metadata_inventory_put", &ma.to_inv.p))
 		return;
 
+	LuaItemStackViews views;
 	// Call function(pos, listname, index, stack, player)
-	push_v3s16(L, ma.to_inv.p);            // pos
-	lua_pushstring(L, ma.to_list.c_str()); // listname
-	lua_pushinteger(L, ma.to_i + 1);       // index
-	LuaItemStack::create(L, stack);        // stack
-	objectrefGetOrCreate(L, player);       // player
+	push_v3s16(L, ma.to_inv.p);                // pos
+	lua_pushstring(L, ma.to_list.c_str());     // listname
+	lua_pushinteger(L, ma.to_i + 1);           // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 0, error_handler));
+	views.detach();
 	lua_pop(L, 1);  // Pop error handler
 }
 
@@ -221,12 +227,14 @@ void ScriptApiNodemeta::nodemeta_inventory_OnTake(
 	if (!getItemCallback(nodename.c_str(), "on_metadata_inventory_take", &ma.from_inv.p))
 		return;
 
+	LuaItemStackViews views;
 	// Call function(pos, listname, index, stack, player)
-	push_v3s16(L, ma.from_inv.p);            // pos
-	lua_pushstring(L, ma.from_list.c_str()); // listname
-	lua_pushinteger(L, ma.from_i + 1);       // index
-	LuaItemStack::create(L, stack);          // stack
-	objectrefGetOrCreate(L, player);         // player
+	push_v3s16(L, ma.from_inv.p);              // pos
+	lua_pushstring(L, ma.from_list.c_str());   // listname
+	lua_pushinteger(L, ma.from_i + 1);         // index
+	LuaItemStack::createView(L, stack, views); // stack
+	objectrefGetOrCreate(L, player);           // player
 	PCALL_RES(lua_pcall(L, 5, 0, error_handler));
+	views.detach();
 	lua_pop(L, 1);  // Pop error handler
 }
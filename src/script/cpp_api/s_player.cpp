@@ -257,7 +257,7 @@ void ScriptApiPlayer::pushMoveArguments(
 void ScriptApiPlayer::pushPutTakeArguments(
 		const char *method, const InventoryLocation &loc,
 		const std::string &listname, int index, const ItemStack &stack,
-		ServerActiveObject *player)
+		ServerActiveObject *player, LuaItemStackViews &views)
 {
 	lua_State *L = getStack();
 	objectrefGetOrCreate(L, player); // player
@@ -272,7 +272,7 @@ void ScriptApiPlayer::pushPutTakeArguments(
 		lua_pushinteger(L, index + 1);
 		lua_setfield(L, -2, "index");
 
-		LuaItemStack::create(L, stack);
+		LuaItemStack::createView(L, stack, views);
 		lua_setfield(L, -2, "stack");
 	}
 }
@@ -301,8 +301,10 @@ int ScriptApiPlayer::player_inventory_AllowPut(
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "registered_allow_player_inventory_actions");
-	pushPutTakeArguments("put", ma.to_inv, ma.to_list, ma.to_i, stack, player);
+	LuaItemStackViews views;
+	pushPutTakeArguments("put", ma.to_inv, ma.to_list, ma.to_i, stack, player, views);
 	runCallbacks(4, RUN_CALLBACKS_MODE_OR_SC);
+	views.detach();
 
 	return lua_type(L, -1) == LUA_TNUMBER ? lua_tonumber(L, -1) : stack.count;
 }
@@ -316,8 +318,10 @@ int ScriptApiPlayer::player_inventory_AllowTake(
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "registered_allow_player_inventory_actions");
-	pushPutTakeArguments("take", ma.from_inv, ma.from_list, ma.from_i, stack, player);
+	LuaItemStackViews views;
+	pushPutTakeArguments("take", ma.from_inv, ma.from_list, ma.from_i, stack, player, views);
 	runCallbacks(4, RUN_CALLBACKS_MODE_OR_SC);
+	views.detach();
 
 	return lua_type(L, -1) == LUA_TNUMBER ? lua_tonumber(L, -1) : stack.count;
 }
@@ -344,8 +348,10 @@ void ScriptApiPlayer::player_inventory_OnPut(
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "registered_on_player_inventory_actions");
-	pushPutTakeArguments("put", ma.to_inv, ma.to_list, ma.to_i, stack, player);
+	LuaItemStackViews views;
+	pushPutTakeArguments("put", ma.to_inv, ma.to_list, ma.to_i, stack, player, views);
 	runCallbacks(4, RUN_CALLBACKS_MODE_FIRST);
+	views.detach();
 }
 
 // Report taken items
@@ -357,6 +363,8 @@ void ScriptApiPlayer::player_inventory_OnTake(
 
 	lua_getglobal(L, "core");
 	lua_getfield(L, -1, "registered_on_player_inventory_actions");
-	pushPutTakeArguments("take", ma.from_inv, ma.from_list, ma.from_i, stack, player);
+	LuaItemStackViews views;
+	pushPutTakeArguments("take", ma.from_inv, ma.from_list, ma.from_i, stack, player, views);
 	runCallbacks(4, RUN_CALLBACKS_MODE_FIRST);
+	views.detach();
 }
@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 struct MoveAction;
 struct InventoryLocation;
+class LuaItemStackViews;
 struct ItemStack;
 struct ToolCapabilities;
 struct PlayerHPChangeReason;
@@ -81,7 +82,7 @@ class ScriptApiPlayer : virtual public ScriptApiBase
 	void pushPutTakeArguments(
 		const char *method, const InventoryLocation &loc,
 		const std::string &listname, int index, const ItemStack &stack,
-		ServerActiveObject *player);
+		ServerActiveObject *player, LuaItemStackViews &views);
 	void pushMoveArguments(const MoveAction &ma,
 		int count, ServerActiveObject *player);
 };
@@ -42,6 +42,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #ifndef SERVER
 #include "client/client.h"
 #endif
+#if USE_LUAJIT
+extern "C" {
+#include "lualib.h"
+}
+#endif
 
 struct EnumString ModApiEnvMod::es_ClearObjectsMode[] =
 {
@@ -811,7 +816,116 @@ int ModApiEnvMod::l_find_node_near(lua_State *L)
 	return 0;
 }
 
-// find_nodes_in_area(minp, maxp, nodenames) -> list of positions
+// Volume limit equal to 32 default mapchunks, 32 * 80 ^ 3 = 16,384,000
+#define FIND_NODES_MAX_VOLUME 16384000
+
+bool ModApiEnvMod::checkArea(lua_State *L, const char *fname,
+		v3s16 minp, v3s16 maxp)
+{
+	v3s16 cube = maxp - minp + 1;
+	if ((u64)cube.X * (u64)cube.Y * (u64)cube.Z > FIND_NODES_MAX_VOLUME) {
+		luaL_error(L, "%s(): area volume exceeds allowed value of %d",
+				fname, FIND_NODES_MAX_VOLUME);
+		return false;
+	}
+	return true;
+}
+
+void ModApiEnvMod::readNodeFilter(lua_State *L, int index,
+		const NodeDefManager *ndef, std::vector<content_t> &filter)
+{
+	if (lua_istable(L, index)) {
+		lua_pushnil(L);
+		while (lua_next(L, index) != 0) {
+			// key at index -2 and value at index -1
+			luaL_checktype(L, -1, LUA_TSTRING);
+			ndef->getIds(readParam<std::string>(L, -1), filter);
+			// removes value, keeps key for next iteration
+			lua_pop(L, 1);
+		}
+	} else if (lua_isstring(L, index)) {
+		ndef->getIds(readParam<std::string>(L, index), filter);
+	}
+	// getIds() may return the same id for several names or groups
+	std::sort(filter.begin(), filter.end());
+	filter.erase(std::unique(filter.begin(), filter.end()), filter.end());
+}
+
+/*
+	Returns false if the cached content list of the block proves that none
+	of the filtered contents are present, so the block can be skipped.
+	A missing block reads as CONTENT_IGNORE, just like Map::getNode().
+*/
+static bool blockMayContain(MapBlock *block, const std::vector<content_t> &filter)
+{
+	if (!block)
+		return CONTAINS(filter, CONTENT_IGNORE);
+	if (!block->contents_cached)
+		return true;
+	for (content_t c : filter) {
+		if (block->contents.find(c) != block->contents.end())
+			return true;
+	}
+	return false;
+}
+
+/*
+	Calls func(p, filter_index) for every node within minp..maxp whose content
+	is in the filter. The area is walked mapblock by mapblock, reading the
+	node data directly instead of looking up every position in the map.
+*/
+template <typename F>
+static void findNodesInArea(Map &map, v3s16 minp, v3s16 maxp,
+		const std::vector<content_t> &filter, F &&func)
+{
+	const v3s16 bpmin = getNodeBlockPos(minp);
+	const v3s16 bpmax = getNodeBlockPos(maxp);
+
+	v3s16 bp;
+	for (bp.X = bpmin.X; bp.X <= bpmax.X; bp.X++)
+	for (bp.Y = bpmin.Y; bp.Y <= bpmax.Y; bp.Y++)
+	for (bp.Z = bpmin.Z; bp.Z <= bpmax.Z; bp.Z++) {
+		MapBlock *block = map.getBlockNoCreateNoEx(bp);
+		if (!blockMayContain(block, filter))
+			continue;
+
+		// Intersection of the area with this block, in block-relative coords
+		const v3s16 relpos = bp * MAP_BLOCKSIZE;
+		const v3s16 from(
+			MYMAX(minp.X, relpos.X) - relpos.X,
+			MYMAX(minp.Y, relpos.Y) - relpos.Y,
+			MYMAX(minp.Z, relpos.Z) - relpos.Z);
+		const v3s16 to(
+			MYMIN(maxp.X - relpos.X, MAP_BLOCKSIZE - 1),
+			MYMIN(maxp.Y - relpos.Y, MAP_BLOCKSIZE - 1),
+			MYMIN(maxp.Z - relpos.Z, MAP_BLOCKSIZE - 1));
+
+		if (!block) {
+			// The filter contains "ignore", every position matches
+			u32 filt_index = std::find(filter.begin(), filter.end(),
+					CONTENT_IGNORE) - filter.begin();
+			for (s16 z = from.Z; z <= to.Z; z++)
+			for (s16 y = from.Y; y <= to.Y; y++)
+			for (s16 x = from.X; x <= to.X; x++)
+				func(relpos + v3s16(x, y, z), filt_index);
+			continue;
+		}
+
+		const MapNode *data = block->getData();
+		for (s16 z = from.Z; z <= to.Z; z++)
+		for (s16 y = from.Y; y <= to.Y; y++) {
+			u32 i = z * MapBlock::zstride + y * MapBlock::ystride + from.X;
+			for (s16 x = from.X; x <= to.X; x++, i++) {
+				auto it = std::find(filter.begin(), filter.end(),
+						data[i].getContent());
+				if (it != filter.end())
+					func(relpos + v3s16(x, y, z), it - filter.begin());
+			}
+		}
+	}
+}
+
+// find_nodes_in_area(minp, maxp, nodenames, [grouped]) -> list of positions
 // nodenames: eg. {"ignore", "group:tree"} or "default:dirt"
 int ModApiEnvMod::l_find_nodes_in_area(lua_State *L)
 {
@@ -831,49 +945,48 @@ int ModApiEnvMod::l_find_nodes_in_area(lua_State *L)
 	const NodeDefManager *ndef = getServer(L)->ndef();
 #endif
 
-	v3s16 cube = maxp - minp + 1;
-	// Volume limit equal to 8 default mapchunks, (80 * 2) ^ 3 = 4,096,000
-	if ((u64)cube.X * (u64)cube.Y * (u64)cube.Z > 4096000) {
-		luaL_error(L, "find_nodes_in_area(): area volume"
-				" exceeds allowed value of 4096000");
+	if (!checkArea(L, "find_nodes_in_area", minp, maxp))
 		return 0;
-	}
 
 	std::vector<content_t> filter;
-	if (lua_istable(L, 3)) {
-		lua_pushnil(L);
-		while (lua_next(L, 3) != 0) {
-			// key at index -2 and value at index -1
-			luaL_checktype(L, -1, LUA_TSTRING);
-			ndef->getIds(readParam<std::string>(L, -1), filter);
-			// removes value, keeps key for next iteration
-			lua_pop(L, 1);
+	readNodeFilter(L, 3, ndef, filter);
+
+	bool grouped = lua_isboolean(L, 4) && readParam<bool>(L, 4);
+	Map &map = env->getMap();
+
+	if (grouped) {
+		// Table with the node names as keys and lists of positions as values
+		std::vector<std::vector<v3s16>> found(filter.size());
+		findNodesInArea(map, minp, maxp, filter,
+			[&found] (v3s16 p, u32 filt_index) {
+				found[filt_index].push_back(p);
+			});
+
+		lua_createtable(L, 0, filter.size());
+		for (u32 i = 0; i < filter.size(); i++) {
+			const std::vector<v3s16> &list = found[i];
+			lua_createtable(L, list.size(), 0);
+			for (u32 j = 0; j < list.size(); j++) {
+				push_v3s16(L, list[j]);
+				lua_rawseti(L, -2, j + 1);
+			}
+			lua_setfield(L, -2, ndef->get(filter[i]).name.c_str());
 		}
-	} else if (lua_isstring(L, 3)) {
-		ndef->getIds(readParam<std::string>(L, 3), filter);
+		return 1;
 	}
 
-	std::vector<u32> individual_count;
-	individual_count.resize(filter.size());
+	std::vector<u32> individual_count(filter.size());
 
 	lua_newtable(L);
 	u64 i = 0;
-	for (s16 x = minp.X; x <= maxp.X; x++)
-	for (s16 y = minp.Y; y <= maxp.Y; y++)
-	for (s16 z = minp.Z; z <= maxp.Z; z++) {
-		v3s16 p(x, y, z);
-		content_t c = env->getMap().getNode(p).getContent();
-
-		std::vector<content_t>::iterator it = std::find(filter.begin(), filter.end(), c);
-		if (it != filter.end()) {
+	findNodesInArea(map, minp, maxp, filter,
+		[&] (v3s16 p, u32 filt_index) {
 			push_v3s16(L, p);
 			lua_rawseti(L, -2, ++i);
-
-			u32 filt_index = it - filter.begin();
 			individual_count[filt_index]++;
-		}
-	}
-	lua_newtable(L);
+		});
+
+	lua_createtable(L, 0, filter.size());
 	for (u32 i = 0; i < filter.size(); i++) {
 		lua_pushnumber(L, individual_count[i]);
 		lua_setfield(L, -2, ndef->get(filter[i]).name.c_str());
@@ -908,47 +1021,27 @@ int ModApiEnvMod::l_find_nodes_in_area_under_air(lua_State *L)
 	const NodeDefManager *ndef = getServer(L)->ndef();
 #endif
 
-	v3s16 cube = maxp - minp + 1;
-	// Volume limit equal to 8 default mapchunks, (80 * 2) ^ 3 = 4,096,000
-	if ((u64)cube.X * (u64)cube.Y * (u64)cube.Z > 4096000) {
-		luaL_error(L, "find_nodes_in_area_under_air(): area volume"
-				" exceeds allowed value of 4096000");
+	if (!checkArea(L, "find_nodes_in_area_under_air", minp, maxp))
 		return 0;
-	}
 
 	std::vector<content_t> filter;
+	readNodeFilter(L, 3, ndef, filter);
 
-	if (lua_istable(L, 3)) {
-		lua_pushnil(L);
-		while (lua_next(L, 3) != 0) {
-			// key at index -2 and value at index -1
-			luaL_checktype(L, -1, LUA_TSTRING);
-			ndef->getIds(readParam<std::string>(L, -1), filter);
-			// removes value, keeps key for next iteration
-			lua_pop(L, 1);
-		}
-	} else if (lua_isstring(L, 3)) {
-		ndef->getIds(readParam<std::string>(L, 3), filter);
-	}
-
+	Map &map = env->getMap();
 	lua_newtable(L);
 	u64 i = 0;
-	for (s16 x = minp.X; x <= maxp.X; x++)
-	for (s16 z = minp.Z; z <= maxp.Z; z++) {
-		s16 y = minp.Y;
-		v3s16 p(x, y, z);
-		content_t c = env->getMap().getNode(p).getContent();
-		for (; y <= maxp.Y; y++) {
-			v3s16 psurf(x, y + 1, z);
-			content_t csurf = env->getMap().getNode(psurf).getContent();
-			if (c != CONTENT_AIR && csurf == CONTENT_AIR &&
-					CONTAINS(filter, c)) {
-				push_v3s16(L, v3s16(x, y, z));
-				lua_rawseti(L, -2, ++i);
-			}
-			c = csurf;
-		}
-	}
+	// Air is never a match, only blocks containing a filtered node need
+	// to be looked at. The node above the topmost layer of a block is read
+	// from the block above it.
+	findNodesInArea(map, minp, maxp, filter,
+		[&] (v3s16 p, u32 filt_index) {
+			if (filter[filt_index] == CONTENT_AIR)
+				return;
+			if (map.getNode(p + v3s16(0, 1, 0)).getContent() != CONTENT_AIR)
+				return;
+			push_v3s16(L, p);
+			lua_rawseti(L, -2, ++i);
+		});
 	return 1;
 }
 
@@ -1318,6 +1411,118 @@ int ModApiEnvMod::l_forceload_free_block(lua_State *L)
 	return 0;
 }
 
+#if USE_LUAJIT
+/*
+	LuaJIT FFI fast path for the hottest environment calls, wrapped by
+	builtin/game/env_ffi.lua.
+
+	These are called through FFI and therefore must neither throw nor call
+	back into Lua. Whenever that could happen they return FFI_FALLBACK and
+	the wrapper repeats the call through the regular Lua API.
+*/
+
+#define FFI_FALLBACK -1
+
+// Must match the cdef in builtin/game/env_ffi.lua
+struct FfiNode
+{
+	u16 content;
+	u8 param1;
+	u8 param2;
+};
+
+int ModApiEnvMod::ffi_get_node(void *script, double x, double y, double z,
+		FfiNode *node)
+{
+	ServerEnvironment *env = (ServerEnvironment *)
+		((ScriptApiBase *)script)->getEnv();
+	if (!env)
+		return FFI_FALLBACK;
+
+	MapNode n = env->getMap().getNode(doubleToInt(v3d(x, y, z), 1.0));
+	node->content = n.getContent();
+	node->param1 = n.getParam1();
+	node->param2 = n.getParam2();
+	return 1;
+}
+
+int ModApiEnvMod::ffi_set_node(void *script, double x, double y, double z,
+		const FfiNode *node)
+{
+	ServerEnvironment *env = (ServerEnvironment *)
+		((ScriptApiBase *)script)->getEnv();
+	if (!env)
+		return FFI_FALLBACK;
+
+	const NodeDefManager *ndef = env->getGameDef()->ndef();
+	v3s16 pos = doubleToInt(v3d(x, y, z), 1.0);
+	MapNode n(node->content, node->param1, node->param2);
+
+	// Node callbacks need the Lua stack, let ServerEnvironment::setNode do it
+	const ContentFeatures &cf_old = ndef->get(env->getMap().getNode(pos));
+	if (cf_old.has_on_destruct || cf_old.has_after_destruct ||
+			ndef->get(n).has_on_construct)
+		return FFI_FALLBACK;
+
+	try {
+		if (!env->getMap().addNodeWithEvent(pos, n))
+			return 0;
+		env->getServerMap().updateVManip(pos);
+	} catch (std::exception &e) {
+		errorstream << "ffi_set_node(): " << e.what() << std::endl;
+		return 0;
+	}
+	return 1;
+}
+
+int ModApiEnvMod::ffi_get_objects_inside_radius(void *script,
+		double x, double y, double z, double radius, u16 *ids, int max_ids)
+{
+	ServerEnvironment *env = (ServerEnvironment *)
+		((ScriptApiBase *)script)->getEnv();
+	if (!env)
+		return FFI_FALLBACK;
+
+	std::vector<u16> found;
+	env->getObjectsInsideRadius(found, v3f(x, y, z) * BS, radius * BS);
+
+	// Returns the number of objects even if they do not all fit, so that
+	// the caller can retry with a larger buffer
+	int count = 0;
+	for (u16 id : found) {
+		ServerActiveObject *obj = env->getActiveObject(id);
+		if (obj->isGone())
+			continue;
+		if (count < max_ids)
+			ids[count] = id;
+		count++;
+	}
+	return count;
+}
+
+void ModApiEnvMod::InitializeFfi(lua_State *L, int top)
+{
+	// builtin takes this out of core before any mod is loaded
+	lua_newtable(L);
+
+	lua_pushcfunction(L, luaopen_ffi);
+	lua_call(L, 0, 1);
+	lua_setfield(L, -2, "ffi");
+
+	lua_pushlightuserdata(L, getScriptApiBase(L));
+	lua_setfield(L, -2, "script");
+
+	lua_pushlightuserdata(L, (void *)&ffi_get_node);
+	lua_setfield(L, -2, "get_node");
+	lua_pushlightuserdata(L, (void *)&ffi_set_node);
+	lua_setfield(L, -2, "set_node");
+	lua_pushlightuserdata(L, (void *)&ffi_get_objects_inside_radius);
+	lua_setfield(L, -2, "get_objects_inside_radius");
+
+	lua_setfield(L, top, "ffi_env_api");
+}
+#endif
+
 void ModApiEnvMod::Initialize(lua_State *L, int top)
 {
 	API_FCT(set_node);
@@ -1365,6 +1570,10 @@ void ModApiEnvMod::Initialize(lua_State *L, int top)
 	API_FCT(transforming_liquid_add);
 	API_FCT(forceload_block);
 	API_FCT(forceload_free_block);
+
+#if USE_LUAJIT
+	InitializeFfi(L, top);
+#endif
 }
 
 void ModApiEnvMod::InitializeClient(lua_State *L, int top)
@@ -23,6 +23,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "serverenvironment.h"
 #include "raycast.h"
 
+struct FfiNode;
+
 class ModApiEnvMod : public ModApiBase {
 private:
 	// set_node(pos, node)
@@ -127,7 +129,7 @@ class ModApiEnvMod : public ModApiBase {
 	// nodenames: eg. {"ignore", "group:tree"} or "default:dirt"
 	static int l_find_node_near(lua_State *L);
 
-	// find_nodes_in_area(minp, maxp, nodenames) -> list of positions
+	// find_nodes_in_area(minp, maxp, nodenames, [grouped]) -> list of positions
 	// nodenames: eg. {"ignore", "group:tree"} or "default:dirt"
 	static int l_find_nodes_in_area(lua_State *L);
 
@@ -187,6 +189,27 @@ class ModApiEnvMod : public ModApiBase {
 	// stops forceloading a position
 	static int l_forceload_free_block(lua_State *L);
 
+	// Raises a Lua error if the area volume is too large for find_nodes_*
+	static bool checkArea(lua_State *L, const char *fname, v3s16 minp, v3s16 maxp);
+
+	// Reads a node name, group or list of those into a sorted content id list
+	static void readNodeFilter(lua_State *L, int index,
+			const NodeDefManager *ndef, std::vector<content_t> &filter);
+
+#if USE_LUAJIT
+	// FFI entry points, called from builtin/game/env_ffi.lua.
+	// script is the ScriptApiBase, positions are in nodes.
+	static int ffi_get_node(void *script, double x, double y, double z,
+			FfiNode *node);
+	static int ffi_set_node(void *script, double x, double y, double z,
+			const FfiNode *node);
+	static int ffi_get_objects_inside_radius(void *script,
+			double x, double y, double z, double radius, u16 *ids, int max_ids);
+
+	// Hands the FFI entry points over to builtin
+	static void InitializeFfi(lua_State *L, int top);
+#endif
+
 public:
 	static void Initialize(lua_State *L, int top);
 	static void InitializeClient(lua_State *L, int top);
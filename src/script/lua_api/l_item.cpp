@@ -28,13 +28,14 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "content_sao.h"
 #include "inventory.h"
 #include "log.h"
+#include <new>
 
 
 // garbage collector
 int LuaItemStack::gc_object(lua_State *L)
 {
-	LuaItemStack *o = *(LuaItemStack **)(lua_touserdata(L, 1));
-	delete o;
+	LuaItemStack *o = (LuaItemStack *)lua_touserdata(L, 1);
+	o->~LuaItemStack();
 	return 0;
 }
 
@@ -42,8 +43,8 @@ int LuaItemStack::gc_object(lua_State *L)
 int LuaItemStack::l_is_empty(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushboolean(L, item.empty());
 	return 1;
 }
@@ -52,8 +53,8 @@ int LuaItemStack::l_is_empty(lua_State *L)
 int LuaItemStack::l_get_name(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushstring(L, item.name.c_str());
 	return 1;
 }
@@ -63,7 +64,7 @@ int LuaItemStack::l_set_name(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 
 	bool status = true;
 	item.name = luaL_checkstring(L, 2);
@@ -80,8 +81,8 @@ int LuaItemStack::l_set_name(lua_State *L)
 int LuaItemStack::l_get_count(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushinteger(L, item.count);
 	return 1;
 }
@@ -91,7 +92,7 @@ int LuaItemStack::l_set_count(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 
 	bool status;
 	lua_Integer count = luaL_checkinteger(L, 2);
@@ -111,8 +112,8 @@ int LuaItemStack::l_set_count(lua_State *L)
 int LuaItemStack::l_get_wear(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushinteger(L, item.wear);
 	return 1;
 }
@@ -122,7 +123,7 @@ int LuaItemStack::l_set_wear(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 
 	bool status;
 	lua_Integer wear = luaL_checkinteger(L, 2);
@@ -143,7 +144,8 @@ int LuaItemStack::l_get_meta(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStackMetaRef::create(L, &o->m_stack);
+	// Metadata references write through, so views copy the stack here
+	ItemStackMetaRef::create(L, &o->getItem());
 	return 1;
 }
 
@@ -152,8 +154,8 @@ int LuaItemStack::l_get_meta(lua_State *L)
 int LuaItemStack::l_get_metadata(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	const std::string &value = item.metadata.getString("");
 	lua_pushlstring(L, value.c_str(), value.size());
 	return 1;
@@ -165,7 +167,7 @@ int LuaItemStack::l_set_metadata(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 
 	size_t len = 0;
 	const char *ptr = luaL_checklstring(L, 2, &len);
@@ -179,8 +181,8 @@ int LuaItemStack::l_set_metadata(lua_State *L)
 int LuaItemStack::l_get_description(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	std::string desc = o->m_stack.getDescription(getGameDef(L)->idef());
+	const LuaItemStack *o = checkobject(L, 1);
+	std::string desc = o->getItem().getDescription(getGameDef(L)->idef());
 	lua_pushstring(L, desc.c_str());
 	return 1;
 }
@@ -190,7 +192,7 @@ int LuaItemStack::l_clear(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	o->m_stack.clear();
+	o->setItem(ItemStack());
 	lua_pushboolean(L, true);
 	return 1;
 }
@@ -200,7 +202,7 @@ int LuaItemStack::l_replace(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	o->m_stack = read_item(L, 2, getGameDef(L)->idef());
+	o->setItem(read_item(L, 2, getGameDef(L)->idef()));
 	lua_pushboolean(L, true);
 	return 1;
 }
@@ -209,8 +211,8 @@ int LuaItemStack::l_replace(lua_State *L)
 int LuaItemStack::l_to_string(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	std::string itemstring = o->m_stack.getItemString();
+	const LuaItemStack *o = checkobject(L, 1);
+	std::string itemstring = o->getItem().getItemString();
 	lua_pushstring(L, itemstring.c_str());
 	return 1;
 }
@@ -219,8 +221,8 @@ int LuaItemStack::l_to_string(lua_State *L)
 int LuaItemStack::l_to_table(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	const ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	if(item.empty())
 	{
 		lua_pushnil(L);
@@ -259,8 +261,8 @@ int LuaItemStack::l_to_table(lua_State *L)
 int LuaItemStack::l_get_stack_max(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushinteger(L, item.getStackMax(getGameDef(L)->idef()));
 	return 1;
 }
@@ -269,8 +271,8 @@ int LuaItemStack::l_get_stack_max(lua_State *L)
 int LuaItemStack::l_get_free_space(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	lua_pushinteger(L, item.freeSpace(getGameDef(L)->idef()));
 	return 1;
 }
@@ -280,8 +282,8 @@ int LuaItemStack::l_get_free_space(lua_State *L)
 int LuaItemStack::l_is_known(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	bool is_known = item.isKnown(getGameDef(L)->idef());
 	lua_pushboolean(L, is_known);
 	return 1;
@@ -293,8 +295,8 @@ int LuaItemStack::l_is_known(lua_State *L)
 int LuaItemStack::l_get_definition(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 
 	// Get registered_items[name]
 	lua_getglobal(L, "core");
@@ -315,8 +317,8 @@ int LuaItemStack::l_get_definition(lua_State *L)
 int LuaItemStack::l_get_tool_capabilities(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	const ToolCapabilities &prop =
 		item.getToolCapabilities(getGameDef(L)->idef());
 	push_tool_capabilities(L, prop);
@@ -331,7 +333,7 @@ int LuaItemStack::l_add_wear(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 	int amount = lua_tointeger(L, 2);
 	bool result = item.addWear(amount, getGameDef(L)->idef());
 	lua_pushboolean(L, result);
@@ -344,7 +346,7 @@ int LuaItemStack::l_add_item(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 	ItemStack newitem = read_item(L, -1, getGameDef(L)->idef());
 	ItemStack leftover = item.addItem(newitem, getGameDef(L)->idef());
 	create(L, leftover);
@@ -357,8 +359,8 @@ int LuaItemStack::l_add_item(lua_State *L)
 int LuaItemStack::l_item_fits(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	ItemStack newitem = read_item(L, 2, getGameDef(L)->idef());
 	ItemStack restitem;
 	bool fits = item.itemFits(newitem, &restitem, getGameDef(L)->idef());
@@ -372,7 +374,7 @@ int LuaItemStack::l_take_item(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
 	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	ItemStack &item = o->getItem();
 	u32 takecount = 1;
 	if(!lua_isnone(L, 2))
 		takecount = luaL_checkinteger(L, 2);
@@ -385,8 +387,8 @@ int LuaItemStack::l_take_item(lua_State *L)
 int LuaItemStack::l_peek_item(lua_State *L)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = checkobject(L, 1);
-	ItemStack &item = o->m_stack;
+	const LuaItemStack *o = checkobject(L, 1);
+	const ItemStack &item = o->getItem();
 	u32 peekcount = 1;
 	if(!lua_isnone(L, 2))
 		peekcount = lua_tointeger(L, 2);
@@ -400,15 +402,47 @@ LuaItemStack::LuaItemStack(const ItemStack &item):
 {
 }
 
+LuaItemStack::LuaItemStack(const ItemStack *borrowed, LuaItemStackViews *views):
+	m_borrowed(borrowed)
+{
+	views->add(this);
+}
+
+LuaItemStack::~LuaItemStack()
+{
+	if (m_views)
+		m_views->remove(this);
+	if (!m_borrowed)
+		m_stack.~ItemStack();
+}
+
 const ItemStack& LuaItemStack::getItem() const
 {
-	return m_stack;
+	return m_borrowed ? *m_borrowed : m_stack;
 }
 ItemStack& LuaItemStack::getItem()
 {
+	detach();
 	return m_stack;
 }
 
+void LuaItemStack::detach()
+{
+	if (m_borrowed)
+		setItem(*m_borrowed);
+}
+
+void LuaItemStack::setItem(const ItemStack &item)
+{
+	if (!m_borrowed) {
+		m_stack = item;
+		return;
+	}
+	new (&m_stack) ItemStack(item);
+	m_borrowed = nullptr;
+	m_views->remove(this);
+}
+
 // LuaItemStack(itemstack or itemstring or table or nil)
 // Creates an LuaItemStack and leaves it on top of stack
 int LuaItemStack::create_object(lua_State *L)
@@ -417,18 +451,24 @@ int LuaItemStack::create_object(lua_State *L)
 	ItemStack item;
 	if (!lua_isnone(L, 1))
 		item = read_item(L, 1, getGameDef(L)->idef());
-	LuaItemStack *o = new LuaItemStack(item);
-	*(void **)(lua_newuserdata(L, sizeof(void *))) = o;
+	create(L, item);
+	return 1;
+}
+// Not callable from Lua
+int LuaItemStack::create(lua_State *L, const ItemStack &item)
+{
+	NO_MAP_LOCK_REQUIRED;
+	new (lua_newuserdata(L, sizeof(LuaItemStack))) LuaItemStack(item);
 	luaL_getmetatable(L, className);
 	lua_setmetatable(L, -2);
 	return 1;
 }
 // Not callable from Lua
-int LuaItemStack::create(lua_State *L, const ItemStack &item)
+int LuaItemStack::createView(lua_State *L, const ItemStack &item,
+		LuaItemStackViews &views)
 {
 	NO_MAP_LOCK_REQUIRED;
-	LuaItemStack *o = new LuaItemStack(item);
-	*(void **)(lua_newuserdata(L, sizeof(void *))) = o;
+	new (lua_newuserdata(L, sizeof(LuaItemStack))) LuaItemStack(&item, &views);
 	luaL_getmetatable(L, className);
 	lua_setmetatable(L, -2);
 	return 1;
@@ -439,7 +479,7 @@ LuaItemStack* LuaItemStack::checkobject(lua_State *L, int narg)
 	luaL_checktype(L, narg, LUA_TUSERDATA);
 	void *ud = luaL_checkudata(L, narg, className);
 	if(!ud) luaL_typerror(L, narg, className);
-	return *(LuaItemStack**)ud;  // unbox pointer
+	return (LuaItemStack *)ud;
 }
 
 void LuaItemStack::Register(lua_State *L)
@@ -470,6 +510,30 @@ void LuaItemStack::Register(lua_State *L)
 	lua_register(L, className, create_object);
 }
 
+void LuaItemStackViews::detach()
+{
+	// Detaching a view removes it from the list
+	while (m_first)
+		m_first->detach();
+}
+
+void LuaItemStackViews::add(LuaItemStack *view)
+{
+	view->m_views = this;
+	view->m_next_view = m_first;
+	m_first = view;
+}
+
+void LuaItemStackViews::remove(LuaItemStack *view)
+{
+	LuaItemStack **link = &m_first;
+	while (*link != view)
+		link = &(*link)->m_next_view;
+	*link = view->m_next_view;
+	view->m_views = nullptr;
+	view->m_next_view = nullptr;
+}
+
 const char LuaItemStack::className[] = "ItemStack";
 const luaL_Reg LuaItemStack::methods[] = {
 	luamethod(LuaItemStack, is_empty),
@@ -21,10 +21,28 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "lua_api/l_base.h"
 #include "inventory.h"  // ItemStack
+#include "util/basic_macros.h"
 
+class LuaItemStackViews;
+
+/*
+	Lives inside its userdata, so pushing a stack costs one Lua allocation.
+
+	A borrowed view (see createView()) reads the stack of the caller and
+	copies it only when Lua modifies it or the caller detaches the view.
+*/
 class LuaItemStack : public ModApiBase {
 private:
-	ItemStack m_stack;
+	// Stack of the caller while this is a borrowed view
+	const ItemStack *m_borrowed = nullptr;
+	// Constructed once the stack is not borrowed
+	union {
+		ItemStack m_stack;
+	};
+	LuaItemStackViews *m_views = nullptr;
+	LuaItemStack *m_next_view = nullptr;
+
+	friend class LuaItemStackViews;
 
 	static const char className[];
 	static const luaL_Reg methods[];
@@ -122,23 +140,63 @@ class LuaItemStack : public ModApiBase {
 	// peek_item(self, peekcount=1) -> itemstack
 	static int l_peek_item(lua_State *L);
 
+	LuaItemStack(const ItemStack *borrowed, LuaItemStackViews *views);
+
+	// Replaces the stack, a borrowed view stops borrowing without a copy
+	void setItem(const ItemStack &item);
+
 public:
 	LuaItemStack(const ItemStack &item);
-	~LuaItemStack() = default;
+	~LuaItemStack();
 
+	// Does not copy the stack of a borrowed view
 	const ItemStack& getItem() const;
+	// Copies the stack of a borrowed view first
 	ItemStack& getItem();
 
+	// Turns a borrowed view into a stack of its own
+	void detach();
+
 	// LuaItemStack(itemstack or itemstring or table or nil)
 	// Creates an LuaItemStack and leaves it on top of stack
 	static int create_object(lua_State *L);
 	// Not callable from Lua
 	static int create(lua_State *L, const ItemStack &item);
+	// Not callable from Lua
+	// Pushes a borrowed view of item, which must stay unchanged until
+	// views.detach() is called
+	static int createView(lua_State *L, const ItemStack &item,
+			LuaItemStackViews &views);
 	static LuaItemStack* checkobject(lua_State *L, int narg);
 	static void Register(lua_State *L);
 
 };
 
+/*
+	The borrowed views pushed for one callback. Call detach() once the
+	callback returned, before the borrowed stacks change; views the callback
+	kept then hold copies. The destructor detaches too, for when the
+	callback raised an error.
+*/
+class LuaItemStackViews
+{
+public:
+	LuaItemStackViews() = default;
+	~LuaItemStackViews() { detach(); }
+
+	DISABLE_CLASS_COPY(LuaItemStackViews);
+
+	void detach();
+
+private:
+	friend class LuaItemStack;
+
+	void add(LuaItemStack *view);
+	void remove(LuaItemStack *view);
+
+	LuaItemStack *m_first = nullptr;
+};
+
 class ModApiItemMod : public ModApiBase {
 private:
 	static int l_register_item_raw(lua_State *L);
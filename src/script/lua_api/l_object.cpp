@@ -433,6 +433,7 @@ int ObjectRef::l_set_physics_override(lua_State *L)
 			co->m_physics_override_sent = false;
 		}
 	}
+	co->updateMovementLimits();
 	return 0;
 }
 
@@ -1057,6 +1058,43 @@ int ObjectRef::l_get_luaentity(lua_State *L)
 	return 1;
 }
 
+// sleep(self, duration)
+int ObjectRef::l_sleep(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	ObjectRef *ref = checkobject(L, 1);
+	LuaEntitySAO *co = getluaobject(ref);
+	if (co == NULL) return 0;
+	float duration = readParam<float>(L, 2, 0.0f);
+	// Do it
+	co->sleep(duration);
+	return 0;
+}
+
+// wake_up(self)
+int ObjectRef::l_wake_up(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	ObjectRef *ref = checkobject(L, 1);
+	LuaEntitySAO *co = getluaobject(ref);
+	if (co == NULL) return 0;
+	// Do it
+	co->wakeUp();
+	return 0;
+}
+
+// is_sleeping(self)
+int ObjectRef::l_is_sleeping(lua_State *L)
+{
+	NO_MAP_LOCK_REQUIRED;
+	ObjectRef *ref = checkobject(L, 1);
+	LuaEntitySAO *co = getluaobject(ref);
+	if (co == NULL) return 0;
+	// Do it
+	lua_pushboolean(L, co->isSleeping());
+	return 1;
+}
+
 /* Player-only */
 
 // is_player_connected(self)
@@ -2301,6 +2339,9 @@ luaL_Reg ObjectRef::methods[] = {
 	luamethod_aliased(ObjectRef, set_sprite, setsprite),
 	luamethod(ObjectRef, get_entity_name),
 	luamethod(ObjectRef, get_luaentity),
+	luamethod(ObjectRef, sleep),
+	luamethod(ObjectRef, wake_up),
+	luamethod(ObjectRef, is_sleeping),
 	// Player-only
 	luamethod(ObjectRef, is_player),
 	luamethod(ObjectRef, is_player_connected),
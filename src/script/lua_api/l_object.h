@@ -194,6 +194,15 @@ class ObjectRef : public ModApiBase {
 	//           select_horiz_by_yawpitch=false)
 	static int l_set_sprite(lua_State *L);
 
+	// sleep(self, duration)
+	static int l_sleep(lua_State *L);
+
+	// wake_up(self)
+	static int l_wake_up(lua_State *L);
+
+	// is_sleeping(self)
+	static int l_is_sleeping(lua_State *L);
+
 	// DEPRECATED
 	// get_entity_name(self)
 	static int l_get_entity_name(lua_State *L);
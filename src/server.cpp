@@ -235,6 +235,8 @@ Server::Server(
 	m_modchannel_mgr(new ModChannelMgr())
 {
 	m_lag = g_settings->getFloat("dedicated_server_step");
+	m_lua_gc_step_budget = g_settings->getFloat("lua_gc_step_budget");
+	m_object_lod_distance = g_settings->getFloat("active_object_lod_distance") * BS;
 
 	if (m_path_world.empty())
 		throw ServerError("Supplied empty world path");
@@ -481,6 +483,15 @@ void Server::step(float dtime)
 	}
 }
 
+// Sorts the peer ids so that the list starts at first_peer_id, clients that
+// were skipped because of a time budget are then handled first
+static void rotatePeerIds(std::vector<session_t> &peer_ids, session_t first_peer_id)
+{
+	std::sort(peer_ids.begin(), peer_ids.end());
+	std::rotate(peer_ids.begin(), std::lower_bound(peer_ids.begin(),
+		peer_ids.end(), first_peer_id), peer_ids.end());
+}
+
 void Server::AsyncRunStep(bool initial_step)
 {
 
@@ -543,10 +554,20 @@ void Server::AsyncRunStep(bool initial_step)
 			max_lag = dtime;
 		}
 		m_env->reportMaxLagEstimate(max_lag);
+		processPendingPlayerPos();
 		// Step environment
 		m_env->step(dtime);
 	}
 
+	if (m_lua_gc_step_budget > 0.0f) {
+		// Collect Lua garbage in a bounded slice of every step
+		float gc_ms = m_script->stepGarbageCollector(m_lua_gc_step_budget);
+		g_profiler->avg("Server: Lua GC step [ms]", gc_ms);
+	}
+	g_profiler->avg("Server: Lua heap size [KiB]", m_script->getHeapSize());
+	g_profiler->avg("Server: Lua heap pages [KiB]",
+			m_script->getPooledHeapSize());
+
 	static const float map_timer_and_unload_dtime = 2.92;
 	if(m_map_timer_and_unload_interval.step(dtime, map_timer_and_unload_dtime))
 	{
@@ -580,16 +601,24 @@ void Server::AsyncRunStep(bool initial_step)
 
 	/* Transform liquids */
 	m_liquid_transform_timer += dtime;
-	if(m_liquid_transform_timer >= m_liquid_transform_every)
+	// Liquids that ran out of time are continued in the next step
+	bool liquids_unfinished = m_env->getMap().isTransformingLiquidsUnfinished();
+	if (liquids_unfinished ||
+			m_liquid_transform_timer >= m_liquid_transform_every)
 	{
-		m_liquid_transform_timer -= m_liquid_transform_every;
+		if (!liquids_unfinished)
+			m_liquid_transform_timer -= m_liquid_transform_every;
 
 		MutexAutoLock lock(m_env_mutex);
 
 		ScopeProfiler sp(g_profiler, "Server: liquid transform");
 
 		std::map<v3s16, MapBlock*> modified_blocks;
-		m_env->getMap().transformLiquids(modified_blocks, m_env);
+		m_tick_scheduler.begin(server::TICK_LIQUID);
+		m_env->getMap().transformLiquids(modified_blocks, m_env,
+			&m_tick_scheduler);
+		m_tick_scheduler.end(server::TICK_LIQUID,
+			!m_env->getMap().isTransformingLiquidsUnfinished());
 
 		/*
 			Set the modified blocks unsent for all the clients
@@ -635,8 +664,21 @@ void Server::AsyncRunStep(bool initial_step)
 		const RemoteClientMap &clients = m_clients.getClientList();
 		ScopeProfiler sp(g_profiler, "Server: update objects within range");
 
-		for (const auto &client_it : clients) {
-			RemoteClient *client = client_it.second;
+		std::vector<session_t> peer_ids;
+		peer_ids.reserve(clients.size());
+		for (const auto &client_it : clients)
+			peer_ids.push_back(client_it.first);
+		rotatePeerIds(peer_ids, m_object_send_next_peer);
+
+		m_tick_scheduler.begin(server::TICK_OBJECT_SENDS);
+		m_object_send_next_peer = 0;
+		for (session_t peer_id : peer_ids) {
+			if (m_tick_scheduler.isOverBudget(server::TICK_OBJECT_SENDS)) {
+				m_object_send_next_peer = peer_id;
+				break;
+			}
+
+			RemoteClient *client = clients.find(peer_id)->second;
 
 			if (client->getState() < CS_DefinitionsSent)
 				continue;
@@ -651,6 +693,8 @@ void Server::AsyncRunStep(bool initial_step)
 
 			SendActiveObjectRemoveAdd(client, playersao);
 		}
+		m_tick_scheduler.end(server::TICK_OBJECT_SENDS,
+			m_object_send_next_peer == 0);
 		m_clients.unlock();
 
 		// Save mod storages if modified
@@ -674,94 +718,184 @@ void Server::AsyncRunStep(bool initial_step)
 		MutexAutoLock envlock(m_env_mutex);
 		ScopeProfiler sp(g_profiler, "Server: send SAO messages");
 
-		// Key = object id
-		// Value = data sent by object
-		std::unordered_map<u16, std::vector<ActiveObjectMessage>*> buffered_messages;
-
-		// Get active object messages from environment
+		// Get active object messages from environment, grouped by object.
+		// Messages of one object must stay in order.
 		for(;;) {
 			ActiveObjectMessage aom = m_env->getActiveObjectMessage();
 			if (aom.id == 0)
 				break;
+			m_aom_queue.push_back(std::move(aom));
+		}
+		std::stable_sort(m_aom_queue.begin(), m_aom_queue.end(),
+			[](const ActiveObjectMessage &a, const ActiveObjectMessage &b) {
+				return a.id < b.id;
+			});
 
-			std::vector<ActiveObjectMessage>* message_list = nullptr;
-			std::unordered_map<u16, std::vector<ActiveObjectMessage>* >::iterator n;
-			n = buffered_messages.find(aom.id);
-			if (n == buffered_messages.end()) {
-				message_list = new std::vector<ActiveObjectMessage>;
-				buffered_messages[aom.id] = message_list;
-			}
-			else {
-				message_list = n->second;
+		m_clients.lock();
+		u32 recipient_count = 0;
+		std::string new_data, legacy_data, scaled_data;
+
+		// Position update rate tiers, see getPositionUpdateTier
+		u32 tier_counts[POSITION_UPDATE_TIERS] = {};
+		u32 skipped_count = 0, skipped_bytes = 0;
+		m_aom_viewers.clear();
+		if (m_object_lod_distance > 0.0f) {
+			for (const auto &client_it : m_clients.getClientList()) {
+				PlayerSAO *playersao = getPlayerSAO(client_it.first);
+				if (!playersao)
+					continue;
+				float pitch = playersao->getRadLookPitchDep();
+				float yaw = playersao->getRadYawDep();
+				v3f look_dir(std::cos(pitch) * std::cos(yaw), std::sin(pitch),
+					std::cos(pitch) * std::sin(yaw));
+				m_aom_viewers[client_it.first] =
+					std::make_pair(playersao->getEyePosition(), look_dir);
 			}
-			message_list->push_back(aom);
 		}
+		for (auto it = m_aom_queue.begin(); it != m_aom_queue.end();) {
+			u16 id = it->id;
+			auto run_end = std::find_if(it, m_aom_queue.end(),
+				[id](const ActiveObjectMessage &aom) { return aom.id != id; });
+
+			// Only clients that know the object receive its messages
+			const std::vector<RemoteClient *> *subscribers =
+				m_clients.getObjectSubscribers(id);
+			ServerActiveObject *sao = m_env->getActiveObject(id);
+			if (!subscribers || !sao) {
+				it = run_end;
+				continue;
+			}
 
-		m_clients.lock();
-		const RemoteClientMap &clients = m_clients.getClientList();
-		// Route data to every client
-		for (const auto &client_it : clients) {
-			RemoteClient *client = client_it.second;
-			PlayerSAO *player = getPlayerSAO(client->peer_id);
-			std::string reliable_data;
-			std::string unreliable_data;
-			// Go through all objects in message buffer
-			for (const auto &buffered_message : buffered_messages) {
-				// If object does not exist or is not known by client, skip it
-				u16 id = buffered_message.first;
-				ServerActiveObject *sao = m_env->getActiveObject(id);
-				if (!sao || client->m_known_objects.find(id) == client->m_known_objects.end())
+			ServerActiveObject *parent = sao->getParent();
+			session_t own_peer_id = sao->getType() == ACTIVEOBJECT_TYPE_PLAYER ?
+				static_cast<PlayerSAO *>(sao)->getPeerID() : PEER_ID_INEXISTENT;
+
+			for (; it != run_end; ++it) {
+				const ActiveObjectMessage &aom = *it;
+				if (aom.datastring.empty())
 					continue;
 
-				// Get message list of object
-				std::vector<ActiveObjectMessage>* list = buffered_message.second;
-				// Go through every message
-				for (const ActiveObjectMessage &aom : *list) {
+				// Serialize once, with header, for all recipients
+				char buf[2];
+				writeU16((u8*)&buf[0], aom.id);
+				new_data.assign(buf, 2);
+				new_data += serializeString(aom.datastring);
+				legacy_data.clear();
+				if (!aom.legacy_datastring.empty()) {
+					legacy_data.assign(buf, 2);
+					legacy_data += serializeString(aom.legacy_datastring);
+				}
+
+				bool is_position = aom.datastring[0] == GENERIC_CMD_UPDATE_POSITION;
+				bool is_skippable = is_position && !m_aom_viewers.empty() &&
+					gob_update_position_is_skippable(aom.datastring);
+				v3f velocity, acceleration;
+				if (is_skippable)
+					gob_update_position_get_motion(aom.datastring,
+						&velocity, &acceleration);
+				for (RemoteClient *client : *subscribers) {
 					// Send position updates to players who do not see the attachment
-					if (aom.datastring[0] == GENERIC_CMD_UPDATE_POSITION) {
-						if (sao->getId() == player->getId())
+					if (is_position) {
+						if (client->peer_id == own_peer_id)
 							continue;
 
 						// Do not send position updates for attached players
 						// as long the parent is known to the client
-						ServerActiveObject *parent = sao->getParent();
 						if (parent && client->m_known_objects.find(parent->getId()) !=
 								client->m_known_objects.end())
 							continue;
 					}
-					// Compose the full new data with header
-					std::string new_data;
-					// Add object id
-					char buf[2];
-					writeU16((u8*)&buf[0], aom.id);
-					new_data.append(buf, 2);
-					// Add data
-					new_data += serializeString(aom.datastring);
-					// Add data to buffer
+
+					// Older clients get the fallback encoding, if there is one
+					const std::string *data =
+						client->net_proto_version < aom.min_protocol_version ?
+						&legacy_data : &new_data;
+					if (data->empty())
+						continue;
+
+					// Far away objects get fewer position updates, the client
+					// interpolates over the longer interval instead
+					if (is_position) {
+						u8 skipped = 0;
+						auto viewer = m_aom_viewers.find(client->peer_id);
+						if (is_skippable && viewer != m_aom_viewers.end()) {
+							u8 tier = getPositionUpdateTier(viewer->second.first,
+								viewer->second.second, sao->getBasePosition());
+							tier_counts[tier]++;
+							RemoteClient::PositionUpdateSkips &held_back =
+								client->m_position_updates_skipped[id];
+							// The client extrapolates the last motion it got, so
+							// a change such as stopping must not wait for a later
+							// update that may never come
+							bool motion_changed = velocity != held_back.velocity ||
+								acceleration != held_back.acceleration;
+							if (!motion_changed && held_back.count + 1 < (1 << tier)) {
+								held_back.count++;
+								skipped_count++;
+								skipped_bytes += data->size();
+								continue;
+							}
+							skipped = held_back.count;
+							held_back.count = 0;
+							held_back.velocity = velocity;
+							held_back.acceleration = acceleration;
+						} else if (!client->m_position_updates_skipped.empty()) {
+							client->m_position_updates_skipped.erase(id);
+						}
+
+						if (skipped > 0) {
+							std::string datastring = aom.datastring;
+							gob_update_position_scale_interval(datastring, skipped + 1);
+							scaled_data.assign(*data, 0, 2);
+							scaled_data += serializeString(datastring);
+							data = &scaled_data;
+						}
+					}
+
+					AOMessageBuffer &buffer = m_aom_buffers[client->peer_id];
 					if (aom.reliable)
-						reliable_data += new_data;
+						buffer.reliable += *data;
 					else
-						unreliable_data += new_data;
+						buffer.unreliable += *data;
+					recipient_count++;
 				}
 			}
-			/*
-				reliable_data and unreliable_data are now ready.
-				Send them.
-			*/
-			if (!reliable_data.empty()) {
-				SendActiveObjectMessages(client->peer_id, reliable_data);
-			}
+		}
 
-			if (!unreliable_data.empty()) {
-				SendActiveObjectMessages(client->peer_id, unreliable_data, false);
+		/*
+			The buffers are now ready. Send them and keep their memory for
+			the next step, unless the client got nothing this time.
+		*/
+		for (auto it = m_aom_buffers.begin(); it != m_aom_buffers.end();) {
+			AOMessageBuffer &buffer = it->second;
+			if (buffer.reliable.empty() && buffer.unreliable.empty()) {
+				it = m_aom_buffers.erase(it);
+				continue;
 			}
+
+			if (!buffer.reliable.empty())
+				SendActiveObjectMessages(it->first, buffer.reliable);
+
+			if (!buffer.unreliable.empty())
+				SendActiveObjectMessages(it->first, buffer.unreliable, false);
+
+			buffer.reliable.clear();
+			buffer.unreliable.clear();
+			++it;
 		}
 		m_clients.unlock();
 
-		// Clear buffered_messages
-		for (auto &buffered_message : buffered_messages) {
-			delete buffered_message.second;
+		g_profiler->avg("Server: SAO messages", m_aom_queue.size());
+		g_profiler->avg("Server: SAO message recipients", recipient_count);
+		if (!m_aom_viewers.empty()) {
+			for (u8 tier = 0; tier < POSITION_UPDATE_TIERS; tier++) {
+				g_profiler->avg("Server: SAO position updates in tier " +
+					itos(tier), tier_counts[tier]);
+			}
+			g_profiler->avg("Server: SAO position updates skipped", skipped_count);
+			g_profiler->avg("Server: SAO position bytes saved", skipped_bytes);
 		}
+		m_aom_queue.clear();
 	}
 
 	/*
@@ -1838,6 +1972,9 @@ void Server::SendMovePlayer(session_t peer_id)
 	PlayerSAO *sao = player->getPlayerSAO();
 	assert(sao);
 
+	// A position the client sent before it learns about this one is stale
+	m_pending_player_pos.erase(peer_id);
+
 	NetworkPacket pkt(TOCLIENT_MOVE_PLAYER, sizeof(v3f) + sizeof(f32) * 2, peer_id);
 	pkt << sao->getBasePosition() << sao->getLookPitch() << sao->getRotation().Y;
 
@@ -1927,6 +2064,20 @@ void Server::SendPlayerFormspecPrepend(session_t peer_id)
 	Send(&pkt);
 }
 
+u8 Server::getPositionUpdateTier(const v3f &eye_pos, const v3f &look_dir,
+	const v3f &object_pos) const
+{
+	v3f diff = object_pos - eye_pos;
+	u8 tier = MYMIN(diff.getLength() / m_object_lod_distance,
+		POSITION_UPDATE_TIERS - 1);
+
+	// Objects behind the player are less likely to be watched closely
+	if (tier > 0 && tier < POSITION_UPDATE_TIERS - 1 && diff.dotProduct(look_dir) < 0)
+		tier++;
+
+	return tier;
+}
+
 void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersao)
 {
 	// Radius inside which objects are active
@@ -1976,7 +2127,7 @@ void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersa
 		data.append(buf, 2);
 
 		// Remove from known objects
-		client->m_known_objects.erase(id);
+		m_clients.removeKnownObject(client, id);
 
 		if (obj && obj->m_known_by_count > 0)
 			obj->m_known_by_count--;
@@ -2012,7 +2163,7 @@ void Server::SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersa
 			obj->getClientInitializationData(client->net_proto_version)));
 
 		// Add to known objects
-		client->m_known_objects.insert(id);
+		m_clients.addKnownObject(client, id);
 
 		obj->m_known_by_count++;
 	}
@@ -2368,14 +2519,24 @@ void Server::SendBlocks(float dtime)
 	std::vector<PrioritySortedBlockTransfer> queue;
 
 	u32 total_sending = 0;
+	m_tick_scheduler.begin(server::TICK_BLOCK_SENDS);
 
 	{
 		ScopeProfiler sp2(g_profiler, "Server::SendBlocks(): Collect list");
 
 		std::vector<session_t> clients = m_clients.getClientIDs();
+		rotatePeerIds(clients, m_block_send_next_peer);
 
 		m_clients.lock();
+		m_block_send_next_peer = 0;
 		for (const session_t client_id : clients) {
+			// Only collecting is limited by the budget, everything collected
+			// is sent below. The other clients are first in the next step.
+			if (m_tick_scheduler.isOverBudget(server::TICK_BLOCK_SENDS)) {
+				m_block_send_next_peer = client_id;
+				break;
+			}
+
 			RemoteClient *client = m_clients.lockedGetClientNoEx(client_id, CS_Active);
 
 			if (!client)
@@ -2422,6 +2583,7 @@ void Server::SendBlocks(float dtime)
 		total_sending++;
 	}
 	m_clients.unlock();
+	m_tick_scheduler.end(server::TICK_BLOCK_SENDS, m_block_send_next_peer == 0);
 }
 
 bool Server::SendBlock(session_t peer_id, const v3s16 &blockpos)
@@ -2869,6 +3031,7 @@ void Server::DeleteClient(session_t peer_id, ClientDeletionReason reason)
 
 		// clear formspec info so the next client can't abuse the current state
 		m_formspec_state_data.erase(peer_id);
+		m_pending_player_pos.erase(peer_id);
 
 		RemotePlayer *player = m_env->getPlayer(peer_id);
 
@@ -184,6 +184,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// Helper for handleCommand_PlayerPos and handleCommand_Interact
 	void process_PlayerPos(RemotePlayer *player, PlayerSAO *playersao,
 		NetworkPacket *pkt);
+	// Applies the positions received by handleCommand_PlayerPos since the
+	// last step
+	void processPendingPlayerPos();
 
 	// Both setter and getter need no envlock,
 	// can be called freely from threads
@@ -295,6 +298,7 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	bool showFormspec(const char *name, const std::string &formspec, const std::string &formname);
 	Map & getMap() { return m_env->getMap(); }
 	ServerEnvironment & getEnv() { return *m_env; }
+	server::TickScheduler &getTickScheduler() { return m_tick_scheduler; }
 	v3f findSpawnPos();
 
 	u32 hudAdd(RemotePlayer *player, HudElement *element);
@@ -480,6 +484,10 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 		const struct TileAnimationParams &animation, u8 glow);
 
 	void SendActiveObjectRemoveAdd(RemoteClient *client, PlayerSAO *playersao);
+	// Update rate tier of an object position for a viewer, every
+	// (1 << tier)-th position update is sent
+	u8 getPositionUpdateTier(const v3f &eye_pos, const v3f &look_dir,
+		const v3f &object_pos) const;
 	void SendActiveObjectMessages(session_t peer_id, const std::string &datas,
 		bool reliable = true);
 	void SendCSMRestrictionFlags(session_t peer_id);
@@ -539,6 +547,13 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	// Thread can set; step() will throw as ServerError
 	MutexedVariable<std::string> m_async_fatal_error;
 
+	// Time budgets of the parts of a step
+	server::TickScheduler m_tick_scheduler;
+	// Clients are handled in a rotating order when the object or block
+	// send budget runs out, these are the ones to start with next time
+	session_t m_object_send_next_peer = 0;
+	session_t m_block_send_next_peer = 0;
+
 	// Some timers
 	float m_liquid_transform_timer = 0.0f;
 	float m_liquid_transform_every = 1.0f;
@@ -547,6 +562,12 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	float m_savemap_timer = 0.0f;
 	IntervalLimiter m_map_timer_and_unload_interval;
 
+	// Time budget for explicit Lua garbage collection per step, in ms
+	float m_lua_gc_step_budget = 0.0f;
+	// Distance per update rate tier of object positions, 0 to disable
+	float m_object_lod_distance = 0.0f;
+	static const u8 POSITION_UPDATE_TIERS = 4;
+
 	// Environment
 	ServerEnvironment *m_env = nullptr;
 
@@ -617,6 +638,27 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 
 	std::unordered_map<session_t, std::string> m_formspec_state_data;
 
+	/*
+		Latest TOSERVER_PLAYERPOS of each player, only the newest one
+		received within a step is validated and applied.
+		This is behind m_env_mutex
+	*/
+	struct PlayerPosUpdate {
+		v3f position;
+		v3f speed;
+		f32 pitch = 0.0f;
+		f32 yaw = 0.0f;
+		f32 fov = 0.0f;
+		u8 wanted_range = 0;
+		u32 keys_pressed = 0;
+	};
+	std::unordered_map<session_t, PlayerPosUpdate> m_pending_player_pos;
+	u32 m_player_pos_packets = 0;
+
+	static bool readPlayerPos(NetworkPacket *pkt, PlayerPosUpdate &update);
+	void applyPlayerPos(RemotePlayer *player, PlayerSAO *playersao,
+		const PlayerPosUpdate &update);
+
 	/*
 		Random stuff
 	*/
@@ -658,6 +700,19 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	s32 m_next_sound_id = 0; // positive values only
 	s32 nextSoundId();
 
+	/*
+		Active object message fanout (behind m_env_mutex).
+		Kept between steps to reuse their memory.
+	*/
+	struct AOMessageBuffer {
+		std::string reliable;
+		std::string unreliable;
+	};
+	std::vector<ActiveObjectMessage> m_aom_queue;
+	std::unordered_map<session_t, AOMessageBuffer> m_aom_buffers;
+	// Player eye position and look direction per client for the update rate
+	std::unordered_map<session_t, std::pair<v3f, v3f>> m_aom_viewers;
+
 	/*
 		Detached inventories (behind m_env_mutex)
 	*/
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "mapblock.h"
 #include "profiler.h"
 #include "activeobjectmgr.h"
+#include "threading/workerpool.h"
 
 namespace server
 {
@@ -50,6 +51,35 @@ void ActiveObjectMgr::step(
 	}
 }
 
+// Objects are handed out in batches to keep the shared counter cold
+static const size_t OBJECT_BATCH_SIZE = 16;
+
+void ActiveObjectMgr::stepPhysics(float dtime, WorkerPool &pool)
+{
+	m_physics_objects.clear();
+	for (auto &ao_it : m_active_objects) {
+		ServerActiveObject *obj = ao_it.second;
+		if (obj->getType() == ACTIVEOBJECT_TYPE_LUAENTITY &&
+				!obj->isGone() && !obj->isSleeping())
+			m_physics_objects.push_back(obj);
+	}
+
+	g_profiler->avg("ActiveObjectMgr: SAOs with parallel physics [#]",
+			m_physics_objects.size());
+	pool.run(m_physics_objects.size(), OBJECT_BATCH_SIZE,
+		[this, dtime] (size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				m_physics_objects[i]->stepPhysics(dtime);
+		});
+}
+
+void ActiveObjectMgr::getObjectIds(std::vector<u16> &result) const
+{
+	result.reserve(result.size() + m_active_objects.size());
+	for (const auto &ao_it : m_active_objects)
+		result.push_back(ao_it.first);
+}
+
 // clang-format off
 bool ActiveObjectMgr::registerObject(ServerActiveObject *obj)
 {
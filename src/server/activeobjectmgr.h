@@ -24,14 +24,21 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../activeobjectmgr.h"
 #include "serverobject.h"
 
+class WorkerPool;
+
 namespace server
 {
+
 class ActiveObjectMgr : public ::ActiveObjectMgr<ServerActiveObject>
 {
 public:
 	void clear(const std::function<bool(ServerActiveObject *, u16)> &cb);
 	void step(float dtime,
 			const std::function<void(ServerActiveObject *)> &f) override;
+	// Runs the physics of all awake entities on the pool, see
+	// ServerActiveObject::stepPhysics()
+	void stepPhysics(float dtime, WorkerPool &pool);
+	void getObjectIds(std::vector<u16> &result) const;
 	bool registerObject(ServerActiveObject *obj) override;
 	void removeObject(u16 id) override;
 
@@ -41,5 +48,9 @@ class ActiveObjectMgr : public ::ActiveObjectMgr<ServerActiveObject>
 	void getAddedActiveObjectsAroundPos(const v3f &player_pos, f32 radius,
 			f32 player_radius, std::set<u16> &current_objects,
 			std::queue<u16> &added_objects);
+
+private:
+	// Reused between calls to stepPhysics() to keep its memory
+	std::vector<ServerActiveObject *> m_physics_objects;
 };
 } // namespace server
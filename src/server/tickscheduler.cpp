@@ -0,0 +1,78 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "tickscheduler.h"
+#include <string>
+#include "porting.h"
+#include "profiler.h"
+#include "settings.h"
+
+namespace server
+{
+
+static const struct {
+	const char *name;
+	const char *setting;
+} subsystem_info[TICK_SUBSYSTEM_COUNT] = {
+	{"node timers", "nodetimer_time_budget"},
+	{"ABMs", "abm_time_budget"},
+	{"entity step", "entity_step_time_budget"},
+	{"liquid", "liquid_time_budget"},
+	{"object sends", "object_send_time_budget"},
+	{"block sends", "block_send_time_budget"},
+};
+
+TickScheduler::TickScheduler()
+{
+	for (u8 i = 0; i < TICK_SUBSYSTEM_COUNT; i++) {
+		Budget &budget = m_budgets[i];
+		budget.name = subsystem_info[i].name;
+		float budget_ms = g_settings->getFloat(subsystem_info[i].setting);
+		budget.budget_us = budget_ms > 0.0f ? budget_ms * 1000.0f : 0;
+		budget.start_us = 0;
+	}
+}
+
+void TickScheduler::begin(TickSubsystem subsystem)
+{
+	m_budgets[subsystem].start_us = porting::getTimeUs();
+}
+
+bool TickScheduler::isOverBudget(TickSubsystem subsystem) const
+{
+	const Budget &budget = m_budgets[subsystem];
+	return budget.budget_us > 0 &&
+		porting::getTimeUs() - budget.start_us >= budget.budget_us;
+}
+
+void TickScheduler::end(TickSubsystem subsystem, bool finished)
+{
+	const Budget &budget = m_budgets[subsystem];
+	u64 spent_us = porting::getTimeUs() - budget.start_us;
+
+	std::string name = std::string("Tick: ") + budget.name;
+	g_profiler->avg(name + " [ms]", spent_us / 1000.0f);
+	// The share of steps that left work for the next one
+	g_profiler->avg(name + " carried over [#]", finished ? 0.0f : 1.0f);
+	if (budget.budget_us > 0 && spent_us > budget.budget_us)
+		g_profiler->avg(name + " overrun [ms]",
+			(spent_us - budget.budget_us) / 1000.0f);
+}
+
+} // namespace server
@@ -0,0 +1,114 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <vector>
+#include "irrlichttypes.h"
+
+namespace server
+{
+
+enum TickSubsystem : u8
+{
+	TICK_NODE_TIMERS,
+	TICK_ABMS,
+	TICK_ENTITY_STEP,
+	TICK_LIQUID,
+	TICK_OBJECT_SENDS,
+	TICK_BLOCK_SENDS,
+	TICK_SUBSYSTEM_COUNT
+};
+
+/*
+	Time budgets of the parts of a server step. A subsystem calls begin(),
+	checks isOverBudget() between units of work and leaves the rest for the
+	next step once it returns true, then calls end(). The time spent and
+	the steps that did not finish their work are reported to the profiler.
+*/
+class TickScheduler
+{
+public:
+	TickScheduler();
+
+	void begin(TickSubsystem subsystem);
+	bool isOverBudget(TickSubsystem subsystem) const;
+	void end(TickSubsystem subsystem, bool finished);
+
+private:
+	struct Budget
+	{
+		const char *name;
+		// 0 is unlimited
+		u64 budget_us;
+		u64 start_us;
+	};
+
+	Budget m_budgets[TICK_SUBSYSTEM_COUNT];
+};
+
+/*
+	Work done in rounds over a list of items, such as blocks or objects,
+	that may be spread over several steps by the time budget. Every item of
+	a round is handled with the time since the previous round started, so
+	items handled late do not lose any time.
+*/
+template <typename T>
+class TickRound
+{
+public:
+	// Adds the step time, returns true if the next round should be started
+	bool step(float dtime, float interval)
+	{
+		m_elapsed += dtime;
+		return done() && m_elapsed >= interval;
+	}
+
+	template <typename It>
+	void start(It begin, It end)
+	{
+		m_items.assign(begin, end);
+		m_next = 0;
+		m_dtime = m_elapsed;
+		m_elapsed = 0.0f;
+	}
+
+	bool done() const { return m_next >= m_items.size(); }
+	const T &next() { return m_items[m_next++]; }
+
+	// Items of the current round, may be reordered before the first next()
+	std::vector<T> &getItems() { return m_items; }
+	size_t getPosition() const { return m_next; }
+	// Time the items of the current round are stepped with
+	float getDtime() const { return m_dtime; }
+
+	void clear()
+	{
+		m_items.clear();
+		m_next = 0;
+	}
+
+private:
+	std::vector<T> m_items;
+	size_t m_next = 0;
+	float m_dtime = 0.0f;
+	float m_elapsed = 0.0f;
+};
+
+} // namespace server
@@ -287,19 +287,17 @@ void LBMManager::applyLBMs(ServerEnvironment *env, MapBlock *block, u32 stamp)
 	ActiveBlockList
 */
 
-void fillRadiusBlock(v3s16 p0, s16 r, std::set<v3s16> &list)
+// Players have to move this far into another block before the blocks
+// around them are updated, so walking along a block border does not
+// activate and deactivate blocks all the time
+static const f32 ACTIVE_BLOCK_HYSTERESIS = 2.0f * BS;
+// Cosine of the angle the look direction has to change by before the
+// blocks in view are updated
+static const f32 ACTIVE_BLOCK_VIEW_DIR_HYSTERESIS = 0.985f; // 10 degrees
+
+static inline bool isInSphere(v3s16 p, v3s16 center, s16 radius)
 {
-	v3s16 p;
-	for(p.X=p0.X-r; p.X<=p0.X+r; p.X++)
-		for(p.Y=p0.Y-r; p.Y<=p0.Y+r; p.Y++)
-			for(p.Z=p0.Z-r; p.Z<=p0.Z+r; p.Z++)
-			{
-				// limit to a sphere
-				if (p.getDistanceFrom(p0) <= r) {
-					// Set in list
-					list.insert(p);
-				}
-			}
+	return radius >= 0 && p.getDistanceFrom(center) <= radius;
 }
 
 void fillViewConeBlock(v3s16 p0,
@@ -307,7 +305,7 @@ void fillViewConeBlock(v3s16 p0,
 	const v3f camera_pos,
 	const v3f camera_dir,
 	const float camera_fov,
-	std::set<v3s16> &list)
+	std::vector<v3s16> &list)
 {
 	v3s16 p;
 	const s16 r_nodes = r * BS * MAP_BLOCKSIZE;
@@ -315,7 +313,7 @@ void fillViewConeBlock(v3s16 p0,
 	for (p.Y = p0.Y - r; p.Y <= p0.Y+r; p.Y++)
 	for (p.Z = p0.Z - r; p.Z <= p0.Z+r; p.Z++) {
 		if (isBlockInSight(p, camera_pos, camera_dir, camera_fov, r_nodes)) {
-			list.insert(p);
+			list.push_back(p);
 		}
 	}
 }
@@ -327,57 +325,174 @@ void ActiveBlockList::update(std::vector<PlayerSAO*> &active_players,
 	std::set<v3s16> &blocks_added)
 {
 	/*
-		Create the new list
+		Update the blocks of each player
 	*/
-	std::set<v3s16> newlist = m_forceloaded_list;
-	m_abm_list = m_forceloaded_list;
+	for (auto &it : m_player_areas)
+		it.second.seen = false;
+
 	for (const PlayerSAO *playersao : active_players) {
-		v3s16 pos = getNodeBlockPos(floatToInt(playersao->getBasePosition(), BS));
-		fillRadiusBlock(pos, active_block_range, m_abm_list);
-		fillRadiusBlock(pos, active_block_range, newlist);
+		PlayerArea &area = m_player_areas[playersao->getId()];
+		area.seen = true;
+
+		v3f pos_f = playersao->getBasePosition();
+		v3s16 pos = getNodeBlockPos(floatToInt(pos_f, BS));
+		v3s16 center = area.center;
+		if (area.radius < 0) {
+			center = pos;
+		} else if (pos != center) {
+			v3f block_min = intToFloat(center * MAP_BLOCKSIZE, BS) -
+				v3f(0.5f * BS + ACTIVE_BLOCK_HYSTERESIS);
+			v3f block_max = block_min + v3f(MAP_BLOCKSIZE * BS +
+				2.0f * ACTIVE_BLOCK_HYSTERESIS);
+			if (!core::aabbox3d<f32>(block_min, block_max).isPointInside(pos_f))
+				center = pos;
+		}
+
+		bool moved = center != area.center || area.radius != active_block_range;
+		if (moved) {
+			updateSphere(area.center, area.radius, center, active_block_range);
+			area.center = center;
+			area.radius = active_block_range;
+		}
 
 		s16 player_ao_range = std::min(active_object_range, playersao->getWantedRange());
 		// only do this if this would add blocks
-		if (player_ao_range > active_block_range) {
-			v3f camera_dir = v3f(0,0,1);
-			camera_dir.rotateYZBy(playersao->getLookPitch());
-			camera_dir.rotateXZBy(playersao->getRotation().Y);
-			fillViewConeBlock(pos,
+		if (player_ao_range <= active_block_range)
+			player_ao_range = 0;
+
+		v3f camera_dir = v3f(0,0,1);
+		camera_dir.rotateYZBy(playersao->getLookPitch());
+		camera_dir.rotateXZBy(playersao->getRotation().Y);
+		f32 fov = playersao->getFov();
+		if (!moved && player_ao_range == area.view_range && fov == area.fov &&
+				camera_dir.dotProduct(area.view_dir) >= ACTIVE_BLOCK_VIEW_DIR_HYSTERESIS)
+			continue;
+
+		for (v3s16 p : area.view_cone)
+			unrefBlock(p, false);
+		area.view_cone.clear();
+		if (player_ao_range > 0) {
+			fillViewConeBlock(center,
 				player_ao_range,
 				playersao->getEyePosition(),
 				camera_dir,
-				playersao->getFov(),
-				newlist);
+				fov,
+				area.view_cone);
+		}
+		for (v3s16 p : area.view_cone)
+			refBlock(p, false);
+		area.view_dir = camera_dir;
+		area.view_range = player_ao_range;
+		area.fov = fov;
+	}
+
+	// Players that left
+	for (auto it = m_player_areas.begin(); it != m_player_areas.end();) {
+		PlayerArea &area = it->second;
+		if (area.seen) {
+			++it;
+			continue;
 		}
+
+		updateSphere(area.center, area.radius, area.center, -1);
+		for (v3s16 p : area.view_cone)
+			unrefBlock(p, false);
+		it = m_player_areas.erase(it);
 	}
 
 	/*
-		Find out which blocks on the old list are not on the new list
+		Forceloaded blocks, mods modify the list directly
 	*/
-	// Go through old list
-	for (v3s16 p : m_list) {
-		// If not on new list, it's been removed
-		if (newlist.find(p) == newlist.end())
-			blocks_removed.insert(p);
+	for (v3s16 p : m_forceloaded_list) {
+		if (m_forceloaded_refs.find(p) == m_forceloaded_refs.end())
+			refBlock(p, true);
 	}
+	for (v3s16 p : m_forceloaded_refs) {
+		if (m_forceloaded_list.find(p) == m_forceloaded_list.end())
+			unrefBlock(p, true);
+	}
+	m_forceloaded_refs = m_forceloaded_list;
 
 	/*
-		Find out which blocks on the new list are not on the old list
+		Apply the changes to the lists
 	*/
-	// Go through new list
-	for (v3s16 p : newlist) {
-		// If not on old list, it's been added
-		if(m_list.find(p) == m_list.end())
-			blocks_added.insert(p);
+	for (v3s16 p : m_changed) {
+		bool active = m_refs.find(p) != m_refs.end();
+		if (active) {
+			if (m_list.insert(p).second)
+				blocks_added.insert(p);
+		} else {
+			if (m_list.erase(p) > 0)
+				blocks_removed.insert(p);
+		}
+
+		if (m_abm_refs.find(p) != m_abm_refs.end())
+			m_abm_list.insert(p);
+		else
+			m_abm_list.erase(p);
 	}
+	m_changed.clear();
+}
 
-	/*
-		Update m_list
-	*/
+void ActiveBlockList::removeUnloadable(v3s16 p)
+{
+	m_list.erase(p);
+	m_abm_list.erase(p);
+	m_changed.insert(p);
+}
+
+void ActiveBlockList::clear()
+{
 	m_list.clear();
-	for (v3s16 p : newlist) {
-		m_list.insert(p);
+	m_abm_list.clear();
+	m_player_areas.clear();
+	m_forceloaded_refs.clear();
+	m_refs.clear();
+	m_abm_refs.clear();
+	m_changed.clear();
+}
+
+void ActiveBlockList::updateSphere(v3s16 old_center, s16 old_radius,
+	v3s16 new_center, s16 new_radius)
+{
+	// Blocks that are in both spheres are not touched
+	v3s16 p;
+	for (p.X = old_center.X - old_radius; p.X <= old_center.X + old_radius; p.X++)
+	for (p.Y = old_center.Y - old_radius; p.Y <= old_center.Y + old_radius; p.Y++)
+	for (p.Z = old_center.Z - old_radius; p.Z <= old_center.Z + old_radius; p.Z++) {
+		if (isInSphere(p, old_center, old_radius) &&
+				!isInSphere(p, new_center, new_radius))
+			unrefBlock(p, true);
 	}
+
+	for (p.X = new_center.X - new_radius; p.X <= new_center.X + new_radius; p.X++)
+	for (p.Y = new_center.Y - new_radius; p.Y <= new_center.Y + new_radius; p.Y++)
+	for (p.Z = new_center.Z - new_radius; p.Z <= new_center.Z + new_radius; p.Z++) {
+		if (isInSphere(p, new_center, new_radius) &&
+				!isInSphere(p, old_center, old_radius))
+			refBlock(p, true);
+	}
+}
+
+void ActiveBlockList::refBlock(v3s16 p, bool abm)
+{
+	m_refs[p]++;
+	if (abm)
+		m_abm_refs[p]++;
+	m_changed.insert(p);
+}
+
+void ActiveBlockList::unrefBlock(v3s16 p, bool abm)
+{
+	auto it = m_refs.find(p);
+	if (it != m_refs.end() && --it->second == 0)
+		m_refs.erase(it);
+	if (abm) {
+		it = m_abm_refs.find(p);
+		if (it != m_abm_refs.end() && --it->second == 0)
+			m_abm_refs.erase(it);
+	}
+	m_changed.insert(p);
 }
 
 /*
@@ -456,6 +571,16 @@ ServerEnvironment::ServerEnvironment(ServerMap *map,
 
 	m_player_database = openPlayerDatabase(player_backend_name, path_world, conf);
 	m_auth_database = openAuthDatabase(auth_backend_name, path_world, conf);
+
+	// Node changes wake up sleeping objects
+	m_map->addEventReceiver(this);
+
+	u16 step_threads = g_settings->getU16("active_object_step_threads");
+	if (step_threads > 0) {
+		verbosestream << "Using " << step_threads
+				<< " threads for entity physics." << std::endl;
+		m_object_step_pool.reset(new WorkerPool("ObjectStep", step_threads));
+	}
 }
 
 ServerEnvironment::~ServerEnvironment()
@@ -468,6 +593,7 @@ ServerEnvironment::~ServerEnvironment()
 	deactivateFarObjects(true);
 
 	// Drop/delete map
+	m_map->removeEventReceiver(this);
 	m_map->drop();
 
 	// Delete ActiveBlockModifiers
@@ -831,8 +957,7 @@ class ABMHandler
 						wider_unknown_count++;
 						continue;
 					}
-					wider += block2->m_static_objects.m_active.size()
-						+ block2->m_static_objects.m_stored.size();
+					wider += block2->m_static_objects.size();
 				}
 		// Extrapolate
 		u32 active_object_count = block->m_static_objects.m_active.size();
@@ -860,9 +985,22 @@ class ABMHandler
 			}
 			if (!run_abms)
 				return;
-		} else {
-			// Clear any caching
+		} else if (!block->do_not_cache_contents) {
+			// Cache the content types before any ABM runs. An ABM that
+			// changes the block invalidates the cache again through
+			// MapBlock::raiseModified(), so it never misses those changes.
 			block->contents.clear();
+			const MapNode *data = block->getData();
+			for (u32 i = 0; i < MapBlock::nodecount; i++) {
+				block->contents.insert(data[i].getContent());
+				if (block->contents.size() > 64) {
+					// Too many different nodes... don't try to cache
+					block->do_not_cache_contents = true;
+					block->contents.clear();
+					break;
+				}
+			}
+			block->contents_cached = !block->do_not_cache_contents;
 		}
 		blocks_scanned++;
 
@@ -879,16 +1017,6 @@ class ABMHandler
 		{
 			const MapNode &n = block->getNodeUnsafe(p0);
 			content_t c = n.getContent();
-			// Cache content types as we go
-			if (!block->contents_cached && !block->do_not_cache_contents) {
-				block->contents.insert(c);
-				if (block->contents.size() > 64) {
-					// Too many different nodes... don't try to cache
-					block->do_not_cache_contents = true;
-					block->contents.clear();
-				}
-			}
-
 			if (c >= m_aabms.size() || !m_aabms[c])
 				continue;
 
@@ -938,7 +1066,6 @@ class ABMHandler
 				}
 			}
 		}
-		block->contents_cached = !block->do_not_cache_contents;
 	}
 };
 
@@ -964,7 +1091,7 @@ void ServerEnvironment::activateBlock(MapBlock *block, u32 additional_dtime)
 
 	// Remove stored static objects if clearObjects was called since block's timestamp
 	if (stamp == BLOCK_TIMESTAMP_UNDEFINED || stamp < m_last_clear_objects_time) {
-		block->m_static_objects.m_stored.clear();
+		block->m_static_objects.clearStored();
 		// do not set changed flag to avoid unnecessary mapblock writes
 	}
 
@@ -980,9 +1107,13 @@ void ServerEnvironment::activateBlock(MapBlock *block, u32 additional_dtime)
 	/* Handle LoadingBlockModifiers */
 	m_lbm_mgr.applyLBMs(this, block, stamp);
 
-	// Run node timers
+	// Run node timers. Only active blocks keep running them, mapgen also
+	// activates the blocks it generates outside of the active area.
+	block->m_node_timers.detach();
 	std::vector<NodeTimer> elapsed_timers =
 		block->m_node_timers.step((float)dtime_s);
+	if (m_active_blocks.contains(block->getPos()))
+		block->m_node_timers.attach(&m_node_timer_wheel, block->getPos());
 	if (!elapsed_timers.empty()) {
 		MapNode n;
 		for (const NodeTimer &elapsed_timer : elapsed_timers) {
@@ -1157,10 +1288,10 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 				<< "Failed to emerge block " << PP(p) << std::endl;
 			continue;
 		}
-		u32 num_stored = block->m_static_objects.m_stored.size();
+		u32 num_stored = block->m_static_objects.getStoredCount();
 		u32 num_active = block->m_static_objects.m_active.size();
 		if (num_stored != 0 || num_active != 0) {
-			block->m_static_objects.m_stored.clear();
+			block->m_static_objects.clearStored();
 			block->m_static_objects.m_active.clear();
 			block->raiseModified(MOD_STATE_WRITE_NEEDED,
 				MOD_REASON_CLEAR_ALL_OBJECTS);
@@ -1284,6 +1415,8 @@ void ServerEnvironment::step(float dtime)
 
 			// Set current time as timestamp (and let it set ChangedFlag)
 			block->setTimestamp(m_game_time);
+
+			block->m_node_timers.detach();
 		}
 
 		/*
@@ -1293,22 +1426,12 @@ void ServerEnvironment::step(float dtime)
 		for (const v3s16 &p: blocks_added) {
 			MapBlock *block = m_map->getBlockOrEmerge(p);
 			if (!block) {
-				m_active_blocks.m_list.erase(p);
-				m_active_blocks.m_abm_list.erase(p);
+				m_active_blocks.removeUnloadable(p);
 				continue;
 			}
 
 			activateBlock(block);
 		}
-	}
-
-	/*
-		Mess around in active blocks
-	*/
-	if (m_active_blocks_nodemetadata_interval.step(dtime, m_cache_nodetimer_interval)) {
-		ScopeProfiler sp(g_profiler, "ServerEnv: Run node timers", SPT_AVG);
-
-		float dtime = m_cache_nodetimer_interval;
 
 		for (const v3s16 &p: m_active_blocks.m_list) {
 			MapBlock *block = m_map->getBlockNoCreateNoEx(p);
@@ -1325,9 +1448,37 @@ void ServerEnvironment::step(float dtime)
 			if(block->getTimestamp() > block->getDiskTimestamp() + 60)
 				block->raiseModified(MOD_STATE_WRITE_AT_UNLOAD,
 					MOD_REASON_BLOCK_EXPIRED);
+		}
+	}
+
+	/*
+		Mess around in active blocks
+	*/
+	server::TickScheduler &scheduler = m_server->getTickScheduler();
+
+	if (m_node_timer_round.step(dtime, m_cache_nodetimer_interval)) {
+		// Only the blocks with an elapsed timer are visited
+		std::vector<v3s16> expired;
+		m_node_timer_round.start(expired.begin(), expired.end());
+		m_node_timer_wheel.advance(m_node_timer_wheel.getTime() +
+			m_node_timer_round.getDtime(), m_node_timer_round.getItems());
+	}
+
+	if (!m_node_timer_round.done()) {
+		ScopeProfiler sp(g_profiler, "ServerEnv: Run node timers", SPT_AVG);
+		scheduler.begin(server::TICK_NODE_TIMERS);
+
+		while (!m_node_timer_round.done() &&
+				!scheduler.isOverBudget(server::TICK_NODE_TIMERS)) {
+			const v3s16 &p = m_node_timer_round.next();
+			MapBlock *block = m_map->getBlockNoCreateNoEx(p);
+			if (!block || !block->m_node_timers.isAttached() ||
+					!m_active_blocks.contains(p))
+				continue;
 
 			// Run node timers
-			std::vector<NodeTimer> elapsed_timers = block->m_node_timers.step(dtime);
+			std::vector<NodeTimer> elapsed_timers =
+				block->m_node_timers.takeElapsed();
 			if (!elapsed_timers.empty()) {
 				MapNode n;
 				v3s16 p2;
@@ -1341,57 +1492,57 @@ void ServerEnvironment::step(float dtime)
 				}
 			}
 		}
+
+		scheduler.end(server::TICK_NODE_TIMERS, m_node_timer_round.done());
 	}
 
-	if (m_active_block_modifier_interval.step(dtime, m_cache_abm_interval)) {
-		ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per interval", SPT_AVG);
-		TimeTaker timer("modify in active blocks per interval");
+	if (m_abm_round.step(dtime, m_cache_abm_interval)) {
+		// Shuffle the active blocks so that each block gets an equal chance
+		// of having its ABMs run.
+		m_abm_round.start(m_active_blocks.m_abm_list.begin(),
+			m_active_blocks.m_abm_list.end());
+		std::shuffle(m_abm_round.getItems().begin(),
+			m_abm_round.getItems().end(), m_rgen);
 
 		// Initialize handling of ActiveBlockModifiers
-		ABMHandler abmhandler(m_abms, m_cache_abm_interval, this, true);
+		m_abm_handler.reset(new ABMHandler(m_abms, m_abm_round.getDtime(),
+			this, true));
+	}
+
+	if (!m_abm_round.done()) {
+		ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per interval", SPT_AVG);
+		scheduler.begin(server::TICK_ABMS);
 
 		int blocks_scanned = 0;
 		int abms_run = 0;
 		int blocks_cached = 0;
 
-		std::vector<v3s16> output(m_active_blocks.m_abm_list.size());
-
-		// Shuffle the active blocks so that each block gets an equal chance
-		// of having its ABMs run.
-		std::copy(m_active_blocks.m_abm_list.begin(), m_active_blocks.m_abm_list.end(), output.begin());
-		std::shuffle(output.begin(), output.end(), m_rgen);
+		while (!m_abm_round.done() &&
+				!scheduler.isOverBudget(server::TICK_ABMS)) {
+			const v3s16 &p = m_abm_round.next();
+			if (!m_active_blocks.m_abm_list.count(p))
+				continue;
 
-		int i = 0;
-		// The time budget for ABMs is 20%.
-		u32 max_time_ms = m_cache_abm_interval * 1000 / 5;
-		for (const v3s16 &p : output) {
 			MapBlock *block = m_map->getBlockNoCreateNoEx(p);
 			if (!block)
 				continue;
 
-			i++;
-
 			// Set current time as timestamp
 			block->setTimestampNoChangedFlag(m_game_time);
 
 			/* Handle ActiveBlockModifiers */
-			abmhandler.apply(block, blocks_scanned, abms_run, blocks_cached);
+			m_abm_handler->apply(block, blocks_scanned, abms_run, blocks_cached);
+		}
 
-			u32 time_ms = timer.getTimerTime();
+		bool finished = m_abm_round.done();
+		scheduler.end(server::TICK_ABMS, finished);
+		if (finished)
+			m_abm_handler.reset();
 
-			if (time_ms > max_time_ms) {
-				warningstream << "active block modifiers took "
-					  << time_ms << "ms (processed " << i << " of "
-					  << output.size() << " active blocks)" << std::endl;
-				break;
-			}
-		}
 		g_profiler->avg("ServerEnv: active blocks", m_active_blocks.m_abm_list.size());
 		g_profiler->avg("ServerEnv: active blocks cached", blocks_cached);
 		g_profiler->avg("ServerEnv: active blocks scanned for ABMs", blocks_scanned);
 		g_profiler->avg("ServerEnv: ABMs run", abms_run);
-
-		timer.stop(true);
 	}
 
 	/*
@@ -1413,19 +1564,48 @@ void ServerEnvironment::step(float dtime)
 			send_recommended = true;
 		}
 
-		auto cb_state = [this, dtime, send_recommended] (ServerActiveObject *obj) {
+		// Objects are stepped in rounds that may take several steps when
+		// the entity step time budget is used up
+		if (m_object_step_round.step(dtime, 0.0f)) {
+			std::vector<u16> ids;
+			m_ao_manager.getObjectIds(ids);
+			m_object_step_round.start(ids.begin(), ids.end());
+			g_profiler->avg("ServerEnv: SAO count [#]", ids.size());
+
+			// Collision detection does not need Lua, run it for all entities
+			// in parallel first. step() then applies the results and runs the
+			// Lua callbacks on this thread.
+			if (m_object_step_pool) {
+				m_ao_manager.stepPhysics(m_object_step_round.getDtime(),
+					*m_object_step_pool);
+			}
+		}
+
+		float object_dtime = m_object_step_round.getDtime();
+		auto cb_state = [this, object_dtime, send_recommended] (ServerActiveObject *obj) {
 			if (obj->isGone())
 				return;
 
-			// Step object
-			obj->step(dtime, send_recommended);
+			// Step object, unless it sleeps
+			if (!obj->isSleeping() || obj->stepSleep(object_dtime))
+				obj->step(object_dtime, send_recommended);
 			// Read messages from object
 			while (!obj->m_messages_out.empty()) {
 				this->m_active_object_messages.push(obj->m_messages_out.front());
 				obj->m_messages_out.pop();
 			}
 		};
-		m_ao_manager.step(dtime, cb_state);
+
+		scheduler.begin(server::TICK_ENTITY_STEP);
+		while (!m_object_step_round.done() &&
+				!scheduler.isOverBudget(server::TICK_ENTITY_STEP)) {
+			ServerActiveObject *obj =
+				m_ao_manager.getActiveObject(m_object_step_round.next());
+			if (obj)
+				cb_state(obj);
+		}
+		scheduler.end(server::TICK_ENTITY_STEP, m_object_step_round.done());
+		g_profiler->avg("ServerEnv: sleeping SAOs [#]", m_sleeping_object_count);
 	}
 
 	/*
@@ -1614,11 +1794,79 @@ ActiveObjectMessage ServerEnvironment::getActiveObjectMessage()
 	if(m_active_object_messages.empty())
 		return ActiveObjectMessage(0);
 
-	ActiveObjectMessage message = m_active_object_messages.front();
+	ActiveObjectMessage message = std::move(m_active_object_messages.front());
 	m_active_object_messages.pop();
 	return message;
 }
 
+void ServerEnvironment::addSleepingObject(v3s16 blockpos, u16 id)
+{
+	m_sleeping_objects[blockpos].push_back(id);
+	m_sleeping_object_count++;
+}
+
+void ServerEnvironment::removeSleepingObject(v3s16 blockpos, u16 id)
+{
+	auto it = m_sleeping_objects.find(blockpos);
+	if (it == m_sleeping_objects.end())
+		return;
+
+	std::vector<u16> &ids = it->second;
+	auto found = std::find(ids.begin(), ids.end(), id);
+	if (found == ids.end())
+		return;
+
+	*found = ids.back();
+	ids.pop_back();
+	m_sleeping_object_count--;
+	if (ids.empty())
+		m_sleeping_objects.erase(it);
+}
+
+void ServerEnvironment::wakeUpObjectsInBlock(v3s16 blockpos)
+{
+	auto it = m_sleeping_objects.find(blockpos);
+	if (it == m_sleeping_objects.end())
+		return;
+
+	// wakeUp() unregisters the object, so work on a copy
+	std::vector<u16> ids = it->second;
+	for (u16 id : ids) {
+		ServerActiveObject *obj = getActiveObject(id);
+		if (obj)
+			obj->wakeUp();
+		else
+			removeSleepingObject(blockpos, id);
+	}
+}
+
+void ServerEnvironment::onMapEditEvent(const MapEditEvent &event)
+{
+	if (m_sleeping_objects.empty())
+		return;
+
+	switch (event.type) {
+	case MEET_ADDNODE:
+	case MEET_REMOVENODE:
+	case MEET_SWAPNODE:
+		// Wake up objects resting on or touching the node, which may be
+		// in a neighbouring block
+		for (s16 x = -1; x <= 1; x += 2)
+		for (s16 y = -1; y <= 1; y += 2)
+		for (s16 z = -1; z <= 1; z += 2)
+			wakeUpObjectsInBlock(getNodeBlockPos(event.p + v3s16(x, y, z)));
+		break;
+	case MEET_OTHER:
+		for (v3s16 blockpos : event.modified_blocks) {
+			wakeUpObjectsInBlock(blockpos);
+			wakeUpObjectsInBlock(blockpos + v3s16(0, 1, 0));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 void ServerEnvironment::getSelectedActiveObjects(
 	const core::line3d<f32> &shootline_on_map,
 	std::vector<PointedThing> &objects)
@@ -1675,7 +1923,14 @@ u16 ServerEnvironment::addActiveObjectRaw(ServerActiveObject *object,
 		// Add to the block where the object is located in
 		v3s16 blockpos = getNodeBlockPos(floatToInt(objectpos, BS));
 		MapBlock *block = m_map->emergeBlock(blockpos);
-		if(block){
+		if (block && block->m_static_objects.size() >=
+				g_settings->getU16("max_objects_per_block")) {
+			// The object stays active but is not saved
+			warningstream << "ServerEnvironment::addActiveObjectRaw(): "
+				<< "not storing id=" << object->getId() << " statically, block "
+				<< PP(blockpos) << " already contains "
+				<< block->m_static_objects.size() << " objects" << std::endl;
+		} else if(block){
 			block->m_static_objects.m_active[object->getId()] = s_obj;
 			object->m_static_exists = true;
 			object->m_static_block = blockpos;
@@ -1734,8 +1989,8 @@ void ServerEnvironment::removeRemovedObjects()
 			if (block) {
 				const auto i = block->m_static_objects.m_active.find(id);
 				if (i != block->m_static_objects.m_active.end()) {
-					block->m_static_objects.m_stored.push_back(i->second);
-					block->m_static_objects.m_active.erase(id);
+					block->m_static_objects.insert(0, i->second);
+					block->m_static_objects.m_active.erase(i);
 					block->raiseModified(MOD_STATE_WRITE_NEEDED,
 						MOD_REASON_REMOVE_OBJECTS_DEACTIVATE);
 				} else {
@@ -1808,29 +2063,34 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 		return;
 
 	// Ignore if no stored objects (to not set changed flag)
-	if(block->m_static_objects.m_stored.empty())
+	u32 num_stored = block->m_static_objects.getStoredCount();
+	if (num_stored == 0)
 		return;
 
 	verbosestream<<"ServerEnvironment::activateObjects(): "
 		<<"activating objects of block "<<PP(block->getPos())
-		<<" ("<<block->m_static_objects.m_stored.size()
+		<<" ("<<num_stored
 		<<" objects)"<<std::endl;
-	bool large_amount = (block->m_static_objects.m_stored.size() > g_settings->getU16("max_objects_per_block"));
+	bool large_amount = (num_stored > g_settings->getU16("max_objects_per_block"));
 	if (large_amount) {
 		errorstream<<"suspiciously large amount of objects detected: "
-			<<block->m_static_objects.m_stored.size()<<" in "
+			<<num_stored<<" in "
 			<<PP(block->getPos())
 			<<"; removing all of them."<<std::endl;
 		// Clear stored list
-		block->m_static_objects.m_stored.clear();
+		block->m_static_objects.clearStored();
 		block->raiseModified(MOD_STATE_WRITE_NEEDED,
 			MOD_REASON_TOO_MANY_OBJECTS);
 		return;
 	}
 
+	// Take the stored objects out of the block first, so that the objects
+	// activated here are not counted twice against the block's limit
+	std::vector<StaticObject> stored;
+	stored.swap(block->m_static_objects.getStored());
+
 	// Activate stored objects
-	std::vector<StaticObject> new_stored;
-	for (const StaticObject &s_obj : block->m_static_objects.m_stored) {
+	for (const StaticObject &s_obj : stored) {
 		// Create an active object from the data
 		ServerActiveObject *obj = ServerActiveObject::create
 			((ActiveObjectType) s_obj.type, this, 0, s_obj.pos, s_obj.data);
@@ -1842,7 +2102,8 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 				<<" type="<<(int)s_obj.type<<" data:"<<std::endl;
 			print_hexdump(verbosestream, s_obj.data);
 
-			new_stored.push_back(s_obj);
+			// Store it back
+			block->m_static_objects.insert(0, s_obj);
 			continue;
 		}
 		verbosestream<<"ServerEnvironment::activateObjects(): "
@@ -1852,13 +2113,6 @@ void ServerEnvironment::activateObjects(MapBlock *block, u32 dtime_s)
 		addActiveObjectRaw(obj, false, dtime_s);
 	}
 
-	// Clear stored list
-	block->m_static_objects.m_stored.clear();
-	// Add leftover failed stuff to stored list
-	for (const StaticObject &s_obj : new_stored) {
-		block->m_static_objects.m_stored.push_back(s_obj);
-	}
-
 	/*
 		Note: Block hasn't really been modified here.
 		The objects have just been activated and moved from the stored
@@ -1946,7 +2200,7 @@ void ServerEnvironment::deactivateFarObjects(bool _force_delete)
 				if (block) {
 					const auto n = block->m_static_objects.m_active.find(id);
 					if (n != block->m_static_objects.m_active.end()) {
-						StaticObject static_old = n->second;
+						const StaticObject &static_old = n->second;
 
 						float save_movem = obj->getMinimumSavedMovement();
 
@@ -2055,11 +2309,12 @@ bool ServerEnvironment::saveStaticToBlock(
 				<< " when saving static data of object to it. id=" << store_id << std::endl;
 		return false;
 	}
-	if (block->m_static_objects.m_stored.size() >= g_settings->getU16("max_objects_per_block")) {
+	// Active objects count too, they are stored when they are deactivated
+	if (block->m_static_objects.size() >= g_settings->getU16("max_objects_per_block")) {
 		warningstream << "ServerEnv: Trying to store id = " << store_id
 				<< " statically but block " << PP(blockpos)
 				<< " already contains "
-				<< block->m_static_objects.m_stored.size()
+				<< block->m_static_objects.size()
 				<< " objects." << std::endl;
 		return false;
 	}
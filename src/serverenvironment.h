@@ -21,12 +21,19 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "activeobject.h"
 #include "environment.h"
+#include "map.h"
 #include "mapnode.h"
+#include "nodetimer.h"
 #include "settings.h"
+#include "threading/workerpool.h"
 #include "server/activeobjectmgr.h"
+#include "server/tickscheduler.h"
 #include "util/numeric.h"
+#include <memory>
 #include <set>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 class IGameDef;
 class ServerMap;
@@ -38,6 +45,7 @@ class AuthDatabase;
 class PlayerSAO;
 class ServerEnvironment;
 class ActiveBlockModifier;
+class ABMHandler;
 struct StaticObject;
 class ServerActiveObject;
 class Server;
@@ -157,25 +165,57 @@ class LBMManager
 class ActiveBlockList
 {
 public:
+	/*
+		Only the blocks around players that moved to another block or
+		turned around are looked at, blocks_removed and blocks_added
+		receive the changes.
+	*/
 	void update(std::vector<PlayerSAO*> &active_players,
 		s16 active_block_range,
 		s16 active_object_range,
 		std::set<v3s16> &blocks_removed,
 		std::set<v3s16> &blocks_added);
 
-	bool contains(v3s16 p){
+	bool contains(v3s16 p) const {
 		return (m_list.find(p) != m_list.end());
 	}
 
-	void clear(){
-		m_list.clear();
-	}
+	// Removes an added block that could not be loaded, the next update()
+	// adds it again if it is still in range
+	void removeUnloadable(v3s16 p);
 
-	std::set<v3s16> m_list;
-	std::set<v3s16> m_abm_list;
+	void clear();
+
+	std::unordered_set<v3s16> m_list;
+	std::unordered_set<v3s16> m_abm_list;
 	std::set<v3s16> m_forceloaded_list;
 
 private:
+	// The blocks that one player keeps active
+	struct PlayerArea
+	{
+		v3s16 center;
+		s16 radius = -1;
+		// Blocks added for active objects in view, may overlap the sphere
+		std::vector<v3s16> view_cone;
+		v3f view_dir;
+		s16 view_range = 0;
+		f32 fov = 0.0f;
+		bool seen = false;
+	};
+
+	void updateSphere(v3s16 old_center, s16 old_radius,
+		v3s16 new_center, s16 new_radius);
+	void refBlock(v3s16 p, bool abm);
+	void unrefBlock(v3s16 p, bool abm);
+
+	std::unordered_map<u16, PlayerArea> m_player_areas;
+	std::set<v3s16> m_forceloaded_refs;
+	// Number of players and forceloads keeping each block active
+	std::unordered_map<v3s16, u16> m_refs;
+	std::unordered_map<v3s16, u16> m_abm_refs;
+	// Blocks whose reference count changed since the last update()
+	std::unordered_set<v3s16> m_changed;
 };
 
 /*
@@ -198,7 +238,7 @@ enum ClearObjectsMode {
 
 typedef std::unordered_map<u16, ServerActiveObject *> ServerActiveObjectMap;
 
-class ServerEnvironment : public Environment
+class ServerEnvironment : public Environment, public MapEventReceiver
 {
 public:
 	ServerEnvironment(ServerMap *map, ServerScripting *scriptIface,
@@ -293,6 +333,17 @@ class ServerEnvironment : public Environment
 	*/
 	ActiveObjectMessage getActiveObjectMessage();
 
+	/*
+		Sleeping objects, indexed by block so that node changes can
+		wake them up. See ServerActiveObject::sleep.
+	*/
+	void addSleepingObject(v3s16 blockpos, u16 id);
+	void removeSleepingObject(v3s16 blockpos, u16 id);
+	void wakeUpObjectsInBlock(v3s16 blockpos);
+
+	// MapEventReceiver implementation
+	void onMapEditEvent(const MapEditEvent &event);
+
 	virtual void getSelectedActiveObjects(
 		const core::line3d<f32> &shootline_on_map,
 		std::vector<PointedThing> &objects
@@ -436,18 +487,29 @@ class ServerEnvironment : public Environment
 	Server *m_server;
 	// Active Object Manager
 	server::ActiveObjectMgr m_ao_manager;
+	// Worker threads for entity physics, null if disabled
+	std::unique_ptr<WorkerPool> m_object_step_pool;
 	// World path
 	const std::string m_path_world;
 	// Outgoing network message buffer for active objects
 	std::queue<ActiveObjectMessage> m_active_object_messages;
+	// Ids of sleeping objects per block
+	std::map<v3s16, std::vector<u16>> m_sleeping_objects;
+	u32 m_sleeping_object_count = 0;
 	// Some timers
 	float m_send_recommended_timer = 0.0f;
 	IntervalLimiter m_object_management_interval;
 	// List of active blocks
 	ActiveBlockList m_active_blocks;
 	IntervalLimiter m_active_blocks_management_interval;
-	IntervalLimiter m_active_block_modifier_interval;
-	IntervalLimiter m_active_blocks_nodemetadata_interval;
+	// Node timers, ABMs and object steps may be spread over several steps,
+	// see server::TickScheduler
+	server::TickRound<v3s16> m_node_timer_round;
+	// Next trigger times of the node timers of the active blocks
+	NodeTimerWheel m_node_timer_wheel;
+	server::TickRound<v3s16> m_abm_round;
+	std::unique_ptr<ABMHandler> m_abm_handler;
+	server::TickRound<u16> m_object_step_round;
 	// Time from the beginning of the game in seconds.
 	// Incremented in step().
 	u32 m_game_time = 0;
@@ -22,6 +22,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "inventory.h"
 #include "constants.h" // BS
 #include "log.h"
+#include "mapblock.h"
+#include "serverenvironment.h"
+#include "util/numeric.h"
 
 ServerActiveObject::ServerActiveObject(ServerEnvironment *env, v3f pos):
 	ActiveObject(0),
@@ -30,6 +33,12 @@ ServerActiveObject::ServerActiveObject(ServerEnvironment *env, v3f pos):
 {
 }
 
+ServerActiveObject::~ServerActiveObject()
+{
+	if (m_sleeping && m_env)
+		m_env->removeSleepingObject(m_sleep_blockpos, m_id);
+}
+
 ServerActiveObject* ServerActiveObject::create(ActiveObjectType type,
 		ServerEnvironment *env, u16 id, v3f pos,
 		const std::string &data)
@@ -81,3 +90,36 @@ bool ServerActiveObject::setWieldedItem(const ItemStack &item)
 {
 	return false;
 }
+
+void ServerActiveObject::sleep(float duration)
+{
+	m_sleep_timer = duration;
+	if (m_sleeping)
+		return;
+
+	m_sleeping = true;
+	m_sleep_blockpos = getNodeBlockPos(floatToInt(m_base_position, BS));
+	m_env->addSleepingObject(m_sleep_blockpos, m_id);
+}
+
+void ServerActiveObject::wakeUp()
+{
+	if (!m_sleeping)
+		return;
+
+	m_sleeping = false;
+	m_env->removeSleepingObject(m_sleep_blockpos, m_id);
+}
+
+bool ServerActiveObject::stepSleep(float dtime)
+{
+	if (m_sleep_timer <= 0.0f)
+		return false;
+
+	m_sleep_timer -= dtime;
+	if (m_sleep_timer > 0.0f)
+		return false;
+
+	wakeUp();
+	return true;
+}
@@ -56,7 +56,7 @@ class ServerActiveObject : public ActiveObject
 		Prototypes are used that way.
 	*/
 	ServerActiveObject(ServerEnvironment *env, v3f pos);
-	virtual ~ServerActiveObject() = default;
+	virtual ~ServerActiveObject();
 
 	virtual ActiveObjectType getSendType() const
 	{ return getType(); }
@@ -109,6 +109,26 @@ class ServerActiveObject : public ActiveObject
 	*/
 	virtual void step(float dtime, bool send_recommended){}
 
+	/*
+		Runs the part of step() that does not depend on Lua, such as
+		collision detection, ahead of time. It may be called from several
+		threads at once: it may read the map and other objects but must
+		only modify the state of this object that step() picks up.
+	*/
+	virtual void stepPhysics(float dtime) {}
+
+	/*
+		Sleeping objects are not stepped until something wakes them up:
+		a punch, an attachment, a node change nearby, a change that has
+		to be sent to the clients or the sleep time running out.
+		duration <= 0 sleeps until woken up.
+	*/
+	virtual void sleep(float duration = 0.0f);
+	virtual void wakeUp();
+	bool isSleeping() const { return m_sleeping; }
+	// Counts down the sleep time, returns true if the object woke up
+	bool stepSleep(float dtime);
+
 	/*
 		The return value of this is passed to the client-side object
 		when it is created
@@ -255,6 +275,11 @@ class ServerActiveObject : public ActiveObject
 	v3f m_base_position;
 	std::unordered_set<u32> m_attached_particle_spawners;
 
+	bool m_sleeping = false;
+	float m_sleep_timer = 0.0f;
+	// Block the object is registered in as sleeping, see ServerEnvironment
+	v3s16 m_sleep_blockpos;
+
 private:
 	// Used for creating objects based on type
 	static std::map<u16, Factory> m_types;
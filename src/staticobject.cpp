@@ -28,7 +28,7 @@ StaticObject::StaticObject(const ServerActiveObject *s_obj, const v3f &pos_):
 	s_obj->getStaticData(&data);
 }
 
-void StaticObject::serialize(std::ostream &os)
+void StaticObject::serialize(std::ostream &os) const
 {
 	// type
 	writeU8(os, type);
@@ -49,12 +49,16 @@ void StaticObject::deSerialize(std::istream &is, u8 version)
 
 void StaticObjectList::serialize(std::ostream &os)
 {
+	// Objects read in a different version can not be copied as they are
+	if (m_serialized_count > 0 && m_serialized_version != 0)
+		deSerializeStored();
+
 	// version
 	u8 version = 0;
 	writeU8(os, version);
 
 	// count
-	size_t count = m_stored.size() + m_active.size();
+	size_t count = size();
 	// Make sure it fits into u16, else it would get truncated and cause e.g.
 	// issue #2610 (Invalid block data in database: unsupported NameIdMapping version).
 	if (count > U16_MAX) {
@@ -66,13 +70,14 @@ void StaticObjectList::serialize(std::ostream &os)
 	}
 	writeU16(os, count);
 
-	for (StaticObject &s_obj : m_stored) {
+	os << m_serialized;
+
+	for (const StaticObject &s_obj : m_stored) {
 		s_obj.serialize(os);
 	}
 
-	for (auto &i : m_active) {
-		StaticObject s_obj = i.second;
-		s_obj.serialize(os);
+	for (const auto &i : m_active) {
+		i.second.serialize(os);
 	}
 }
 void StaticObjectList::deSerialize(std::istream &is)
@@ -81,19 +86,50 @@ void StaticObjectList::deSerialize(std::istream &is)
 		errorstream << "StaticObjectList::deSerialize(): "
 			<< "deserializing objects while " << m_active.size()
 			<< " active objects already exist (not cleared). "
-			<< m_stored.size() << " stored objects _were_ cleared"
+			<< getStoredCount() << " stored objects _were_ cleared"
 			<< std::endl;
 	}
-	m_stored.clear();
+	clearStored();
 
 	// version
-	u8 version = readU8(is);
+	m_serialized_version = readU8(is);
 	// count
 	u16 count = readU16(is);
-	for(u16 i = 0; i < count; i++) {
-		StaticObject s_obj;
-		s_obj.deSerialize(is, version);
-		m_stored.push_back(s_obj);
+
+	// Only find the end of each object here, they are parsed when
+	// getStored() is called
+	for (u16 i = 0; i < count; i++) {
+		// type, pos and data length
+		size_t offset = m_serialized.size();
+		m_serialized.resize(offset + 15);
+		is.read(&m_serialized[offset], 15);
+		if (is.gcount() != 15)
+			throw SerializationError("StaticObjectList: truncated object");
+
+		u16 data_len = readU16((const u8 *)&m_serialized[offset + 13]);
+		m_serialized.resize(offset + 15 + data_len);
+		is.read(&m_serialized[offset + 15], data_len);
+		if (is.gcount() != data_len)
+			throw SerializationError("StaticObjectList: truncated object");
 	}
+	m_serialized_count = count;
 }
 
+void StaticObjectList::deSerializeStored()
+{
+	std::vector<StaticObject> stored;
+	stored.reserve(m_serialized_count + m_stored.size());
+
+	std::istringstream is(m_serialized, std::ios_base::binary);
+	for (u16 i = 0; i < m_serialized_count; i++) {
+		StaticObject s_obj;
+		s_obj.deSerialize(is, m_serialized_version);
+		stored.push_back(std::move(s_obj));
+	}
+	for (StaticObject &s_obj : m_stored)
+		stored.push_back(std::move(s_obj));
+
+	m_stored = std::move(stored);
+	m_serialized.clear();
+	m_serialized_count = 0;
+}
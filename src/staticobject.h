@@ -37,7 +37,7 @@ struct StaticObject
 	StaticObject() = default;
 	StaticObject(const ServerActiveObject *s_obj, const v3f &pos_);
 
-	void serialize(std::ostream &os);
+	void serialize(std::ostream &os) const;
 	void deSerialize(std::istream &is, u8 version);
 };
 
@@ -78,16 +78,49 @@ class StaticObjectList
 		m_active.erase(id);
 	}
 
+	// Number of stored and active objects, this is what the per-block
+	// object limit applies to
+	size_t size() const { return getStoredCount() + m_active.size(); }
+
+	size_t getStoredCount() const
+	{ return m_stored.size() + m_serialized_count; }
+
+	/*
+		Stored objects are kept in their serialized form until they are
+		accessed, so that blocks that are loaded and unloaded again
+		without activating their objects do not parse them.
+	*/
+	std::vector<StaticObject> &getStored()
+	{
+		if (m_serialized_count > 0)
+			deSerializeStored();
+		return m_stored;
+	}
+
+	void clearStored()
+	{
+		m_stored.clear();
+		m_serialized.clear();
+		m_serialized_count = 0;
+	}
+
 	void serialize(std::ostream &os);
 	void deSerialize(std::istream &is);
 
 	/*
 		NOTE: When an object is transformed to active, it is removed
-		from m_stored and inserted to m_active.
+		from the stored list and inserted to m_active.
 		The caller directly manipulates these containers.
 	*/
-	std::vector<StaticObject> m_stored;
 	std::map<u16, StaticObject> m_active;
 
 private:
+	void deSerializeStored();
+
+	std::vector<StaticObject> m_stored;
+
+	// Stored objects as read from disk, not parsed yet
+	std::string m_serialized;
+	u16 m_serialized_count = 0;
+	u8 m_serialized_version = 0;
 };
@@ -0,0 +1,105 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <algorithm>
+#include "workerpool.h"
+
+WorkerPool::WorkerThread::WorkerThread(const std::string &name,
+		WorkerPool *pool) :
+	Thread(name),
+	m_pool(pool)
+{
+}
+
+void *WorkerPool::WorkerThread::run()
+{
+	while (true) {
+		m_start.wait();
+		if (stopRequested())
+			break;
+
+		m_pool->work();
+		m_pool->m_done.post();
+	}
+	return nullptr;
+}
+
+WorkerPool::WorkerPool(const std::string &name, u16 num_threads)
+{
+	for (u16 i = 0; i < num_threads; i++) {
+		WorkerThread *thread = new WorkerThread(name, this);
+		thread->start();
+		m_threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	for (WorkerThread *thread : m_threads) {
+		thread->stop();
+		thread->m_start.post();
+	}
+	for (WorkerThread *thread : m_threads) {
+		thread->wait();
+		delete thread;
+	}
+}
+
+void WorkerPool::run(size_t count, size_t batch_size, const Job &job)
+{
+	if (count == 0)
+		return;
+
+	batch_size = std::max<size_t>(batch_size, 1);
+
+	// A single batch is done faster than the threads wake up
+	size_t num_batches = (count + batch_size - 1) / batch_size;
+	size_t num_threads = std::min(m_threads.size(), num_batches - 1);
+	if (num_threads == 0) {
+		job(0, count);
+		return;
+	}
+
+	m_job = &job;
+	m_count = count;
+	m_batch_size = batch_size;
+	m_next_index = 0;
+
+	for (size_t i = 0; i < num_threads; i++)
+		m_threads[i]->m_start.post();
+
+	work();
+
+	for (size_t i = 0; i < num_threads; i++)
+		m_done.wait();
+
+	m_job = nullptr;
+}
+
+void WorkerPool::work()
+{
+	while (true) {
+		size_t begin = m_next_index.fetch_add(m_batch_size);
+		if (begin >= m_count)
+			break;
+
+		(*m_job)(begin, std::min(begin + m_batch_size, m_count));
+	}
+}
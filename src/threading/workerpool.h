@@ -0,0 +1,77 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "irrlichttypes.h"
+#include "threading/semaphore.h"
+#include "threading/thread.h"
+
+/*
+	A fixed set of worker threads that split up loops over many independent
+	items. The calling thread helps out and run() returns once all items
+	have been handled. run() must only be called by one thread at a time.
+*/
+class WorkerPool
+{
+public:
+	typedef std::function<void(size_t begin, size_t end)> Job;
+
+	WorkerPool(const std::string &name, u16 num_threads);
+	~WorkerPool();
+
+	DISABLE_CLASS_COPY(WorkerPool);
+
+	// Calls job for consecutive ranges of at most batch_size of the
+	// count items, possibly on several threads at once
+	void run(size_t count, size_t batch_size, const Job &job);
+
+	u16 getThreadCount() const { return m_threads.size(); }
+
+private:
+	class WorkerThread : public Thread
+	{
+	public:
+		WorkerThread(const std::string &name, WorkerPool *pool);
+
+		void *run();
+
+		Semaphore m_start;
+
+	private:
+		WorkerPool *m_pool;
+	};
+
+	// Takes batches of the current job until none are left
+	void work();
+
+	std::vector<WorkerThread *> m_threads;
+	Semaphore m_done;
+
+	// Current job, set by run() before the threads are started
+	const Job *m_job = nullptr;
+	size_t m_count = 0;
+	size_t m_batch_size = 1;
+	std::atomic<size_t> m_next_index;
+};
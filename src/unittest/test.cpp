@@ -294,6 +294,12 @@ bool run_tests()
 	return num_modules_failed;
 }
 
+bool full_benchmarks()
+{
+	static const bool full = getenv("MINETEST_UNITTEST_BENCHMARKS") != nullptr;
+	return full;
+}
+
 ////
 //// TestBase
 ////
@@ -140,3 +140,8 @@ extern content_t t_CONTENT_LAVA;
 extern content_t t_CONTENT_BRICK;
 
 bool run_tests();
+
+// Benchmarks run at full size and print their timings only if the
+// MINETEST_UNITTEST_BENCHMARKS environment variable is set, otherwise they
+// run a small version that just exercises the code
+bool full_benchmarks();
@@ -20,6 +20,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "test.h"
 
 #include "activeobject.h"
+#include "object_properties.h"
+#include <sstream>
 
 class TestActiveObject : public TestBase
 {
@@ -30,6 +32,7 @@ class TestActiveObject : public TestBase
 	void runTests(IGameDef *gamedef);
 
 	void testAOAttributes();
+	void testPropertiesDelta();
 };
 
 static TestActiveObject g_test_instance;
@@ -37,6 +40,7 @@ static TestActiveObject g_test_instance;
 void TestActiveObject::runTests(IGameDef *gamedef)
 {
 	TEST(testAOAttributes);
+	TEST(testPropertiesDelta);
 }
 
 class TestAO : public ActiveObject
@@ -58,3 +62,27 @@ void TestActiveObject::testAOAttributes()
 	ao.setId(558);
 	UASSERT(ao.getId() == 558);
 }
+
+void TestActiveObject::testPropertiesDelta()
+{
+	ObjectProperties sent;
+	ObjectProperties prop = sent;
+	UASSERT(prop.diff(sent) == 0);
+
+	prop.nametag = "Sam";
+	prop.textures = {"mob.png", "mob_overlay.png"};
+	prop.collisionbox.MaxEdge.Y = 2.0f;
+	u32 fields = prop.diff(sent);
+	UASSERT(fields == ((1U << ObjectProperties::FIELD_NAMETAG) |
+		(1U << ObjectProperties::FIELD_TEXTURES) |
+		(1U << ObjectProperties::FIELD_COLLISIONBOX)));
+
+	std::ostringstream os(std::ios::binary);
+	prop.serializeDelta(os, fields);
+
+	std::istringstream is(os.str(), std::ios::binary);
+	UASSERT(sent.deSerializeDelta(is) == fields);
+	UASSERT(sent.diff(prop) == 0);
+	UASSERT(sent.nametag == "Sam");
+	UASSERT(sent.textures.size() == 2);
+}
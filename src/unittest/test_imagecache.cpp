@@ -0,0 +1,271 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <irrlicht.h>
+#include <cstring>
+#include <unordered_map>
+#include "client/imagecache.h"
+#include "filesys.h"
+
+class TestImageCache : public TestBase
+{
+public:
+	TestImageCache() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestImageCache"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testHitAndMiss();
+	void testSourceChanged();
+	void testDisk();
+	void testTrimAfterWrites();
+
+private:
+	video::IVideoDriver *m_driver = nullptr;
+};
+
+static TestImageCache g_test_instance;
+
+void TestImageCache::runTests(IGameDef *gamedef)
+{
+	// The null driver makes images without a window
+	IrrlichtDevice *device = createDevice(video::EDT_NULL);
+	m_driver = device->getVideoDriver();
+
+	TEST(testHitAndMiss);
+	TEST(testSourceChanged);
+	TEST(testDisk);
+	TEST(testTrimAfterWrites);
+
+	m_driver = nullptr;
+	device->drop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hashes of the source files, counts the lookups
+class TestSourceHashes : public ISourceImageHashes
+{
+public:
+	u64 getSourceHash(const std::string &name) override
+	{
+		lookups++;
+		auto it = hashes.find(name);
+		return it != hashes.end() ? it->second : 0;
+	}
+
+	std::unordered_map<std::string, u64> hashes;
+	u32 lookups = 0;
+};
+
+// An image of noise, which does not compress
+static video::IImage *make_image(video::IVideoDriver *driver, u32 seed, u32 size)
+{
+	video::IImage *img = driver->createImage(video::ECF_A8R8G8B8,
+			core::dimension2d<u32>(size, size));
+	u32 state = seed * 2654435761U + 1;
+	for (u32 y = 0; y < size; y++)
+	for (u32 x = 0; x < size; x++) {
+		state = state * 1103515245U + 12345U;
+		img->setPixel(x, y, video::SColor(state));
+	}
+	return img;
+}
+
+static bool images_equal(video::IImage *img1, video::IImage *img2)
+{
+	if (img1->getDimension() != img2->getDimension() ||
+			img1->getColorFormat() != img2->getColorFormat())
+		return false;
+	bool equal = memcmp(img1->lock(), img2->lock(),
+			img1->getImageDataSizeInBytes()) == 0;
+	img1->unlock();
+	img2->unlock();
+	return equal;
+}
+
+static u64 get_disk_usage(const std::string &dir, u32 *file_count)
+{
+	u64 total_bytes = 0;
+	*file_count = 0;
+	for (const fs::DirListNode &node : fs::GetDirListing(dir)) {
+		u64 size, mtime;
+		if (node.dir || !fs::GetFileInfo(dir + DIR_DELIM + node.name,
+				&size, &mtime))
+			continue;
+		total_bytes += size;
+		(*file_count)++;
+	}
+	return total_bytes;
+}
+
+void TestImageCache::testHitAndMiss()
+{
+	GeneratedImageCache cache(m_driver, "", "settings", 0);
+	TestSourceHashes sources;
+	sources.hashes["a.png"] = 10;
+	sources.hashes["b.png"] = 20;
+	const std::string name = "a.png^b.png^[invert:rgb";
+
+	std::vector<std::string> source_names;
+	UASSERT(!cache.get(name, sources, source_names));
+	UASSERT(source_names.empty());
+
+	// Like a nested generateImage() call, the first source belongs to the
+	// outer one and a.png was read twice
+	source_names = {"outer.png", "a.png", "b.png", "a.png"};
+	video::IImage *img = make_image(m_driver, 1, 16);
+	cache.insert(name, img, sources, source_names, 1, false);
+
+	source_names.clear();
+	sources.lookups = 0;
+	video::IImage *hit = cache.get(name, sources, source_names);
+	UASSERT(hit && hit != img);
+	UASSERT(images_equal(hit, img));
+	hit->drop();
+	// The sources are reported once each, a hit only looks at their hashes
+	UASSERTEQ(size_t, source_names.size(), 2);
+	UASSERTEQ(std::string, source_names[0], "a.png");
+	UASSERTEQ(std::string, source_names[1], "b.png");
+	UASSERTEQ(u32, sources.lookups, 2);
+
+	source_names.clear();
+	UASSERT(!cache.get("b.png^a.png", sources, source_names));
+	UASSERT(source_names.empty());
+
+	img->drop();
+}
+
+void TestImageCache::testSourceChanged()
+{
+	GeneratedImageCache cache(m_driver, "", "settings", 0);
+	TestSourceHashes sources;
+	sources.hashes["a.png"] = 10;
+	sources.hashes["b.png"] = 20;
+
+	std::vector<std::string> source_names = {"a.png", "b.png"};
+	video::IImage *img = make_image(m_driver, 2, 16);
+	cache.insert("a.png^b.png", img, sources, source_names, 0, false);
+	source_names = {"a.png"};
+	cache.insert("a.png^[invert:rgb", img, sources, source_names, 0, false);
+	img->drop();
+
+	// Another file for b.png, like changed media from a server
+	sources.hashes["b.png"] = 21;
+	source_names.clear();
+	UASSERT(!cache.get("a.png^b.png", sources, source_names));
+	UASSERT(source_names.empty());
+	// The stale entry is gone for good
+	sources.hashes["b.png"] = 20;
+	UASSERT(!cache.get("a.png^b.png", sources, source_names));
+
+	// Images made from other sources stay
+	sources.hashes["b.png"] = 22;
+	video::IImage *hit = cache.get("a.png^[invert:rgb", sources, source_names);
+	UASSERT(hit);
+	hit->drop();
+
+	// A source file that is gone
+	sources.hashes.erase("a.png");
+	UASSERT(!cache.get("a.png^[invert:rgb", sources, source_names));
+}
+
+void TestImageCache::testDisk()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "disk";
+	const u64 max_bytes = 1024 * 1024;
+	TestSourceHashes sources;
+	sources.hashes["a.png"] = 10;
+	sources.hashes["b.png"] = 20;
+	video::IImage *img = make_image(m_driver, 3, 16);
+
+	{
+		GeneratedImageCache cache(m_driver, dir, "settings", max_bytes);
+		std::vector<std::string> source_names = {"a.png"};
+		cache.insert("a.png^[invert:rgb", img, sources, source_names, 0, true);
+		// Parts of a texture are only kept in memory
+		source_names = {"b.png"};
+		cache.insert("b.png^[invert:rgb", img, sources, source_names, 0, false);
+	}
+
+	// Joining again
+	{
+		GeneratedImageCache cache(m_driver, dir, "settings", max_bytes);
+		std::vector<std::string> source_names;
+		video::IImage *hit = cache.get("a.png^[invert:rgb", sources, source_names);
+		UASSERT(hit);
+		UASSERT(images_equal(hit, img));
+		hit->drop();
+		UASSERTEQ(size_t, source_names.size(), 1);
+		UASSERTEQ(std::string, source_names[0], "a.png");
+
+		source_names.clear();
+		UASSERT(!cache.get("b.png^[invert:rgb", sources, source_names));
+	}
+
+	// Settings that make other images
+	{
+		GeneratedImageCache cache(m_driver, dir, "other settings", max_bytes);
+		std::vector<std::string> source_names;
+		UASSERT(!cache.get("a.png^[invert:rgb", sources, source_names));
+	}
+
+	// The server sent another a.png
+	{
+		sources.hashes["a.png"] = 11;
+		GeneratedImageCache cache(m_driver, dir, "settings", max_bytes);
+		std::vector<std::string> source_names;
+		UASSERT(!cache.get("a.png^[invert:rgb", sources, source_names));
+	}
+
+	img->drop();
+}
+
+void TestImageCache::testTrimAfterWrites()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "trim";
+	// A file takes a bit more than 4 KiB
+	const u64 max_bytes = 16 * 1024;
+	const u32 count = 20;
+	GeneratedImageCache cache(m_driver, dir, "settings", max_bytes);
+	TestSourceHashes sources;
+	sources.hashes["a.png"] = 10;
+
+	std::vector<std::string> source_names = {"a.png"};
+	for (u32 i = 0; i < count; i++) {
+		video::IImage *img = make_image(m_driver, i, 32);
+		cache.insert("a.png^[opacity:" + std::to_string(i), img, sources,
+				source_names, 0, true);
+		img->drop();
+
+		u32 file_count;
+		UASSERT(get_disk_usage(dir, &file_count) <= max_bytes);
+		UASSERT(file_count > 0);
+	}
+
+	// The memory part is not limited by the disk
+	for (u32 i = 0; i < count; i++) {
+		video::IImage *hit = cache.get("a.png^[opacity:" + std::to_string(i),
+				sources, source_names);
+		UASSERT(hit);
+		hit->drop();
+	}
+}
@@ -32,6 +32,7 @@ class TestInventory : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testSerializeDeserialize(IItemDefManager *idef);
+	void testItemMetadataCopyOnWrite(IItemDefManager *idef);
 
 	static const char *serialized_inventory_in;
 	static const char *serialized_inventory_out;
@@ -43,6 +44,7 @@ static TestInventory g_test_instance;
 void TestInventory::runTests(IGameDef *gamedef)
 {
 	TEST(testSerializeDeserialize, gamedef->getItemDefManager());
+	TEST(testItemMetadataCopyOnWrite, gamedef->getItemDefManager());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -80,6 +82,47 @@ void TestInventory::testSerializeDeserialize(IItemDefManager *idef)
 	UASSERT(leftover == wanted);
 }
 
+void TestInventory::testItemMetadataCopyOnWrite(IItemDefManager *idef)
+{
+	ItemStack stick("default:stick", 1, 0, idef);
+	stick.metadata.setString("description", "A stick");
+
+	// Copies share the metadata until one of them is written to
+	ItemStack copy = stick;
+	UASSERT(&copy.metadata.getStrings() == &stick.metadata.getStrings());
+	UASSERT(copy == stick);
+
+	copy.metadata.setString("description", "Another stick");
+	UASSERT(&copy.metadata.getStrings() != &stick.metadata.getStrings());
+	UASSERTEQ(std::string, stick.metadata.getString("description"), "A stick");
+	UASSERTEQ(std::string, copy.metadata.getString("description"), "Another stick");
+
+	// Removing a key from a copy does not touch the original
+	ItemStack cleared = stick;
+	cleared.metadata.setString("description", "");
+	UASSERT(cleared.metadata.empty());
+	UASSERTEQ(size_t, stick.metadata.size(), 1);
+
+	stick.metadata.clear();
+	UASSERT(stick.metadata.empty());
+	UASSERT(stick.metadata == cleared.metadata);
+
+	// The parsed tool capabilities are shared too
+	ToolCapabilities caps;
+	caps.full_punch_interval = 0.5f;
+	stick.metadata.setToolCapabilities(caps);
+	ItemStack tool = stick;
+	const ToolCapabilities &stick_caps =
+		stick.metadata.getToolCapabilities(ToolCapabilities());
+	UASSERT(&tool.metadata.getToolCapabilities(ToolCapabilities()) ==
+		&stick_caps);
+	UASSERT(stick_caps.full_punch_interval == 0.5f);
+
+	tool.metadata.clearToolCapabilities();
+	UASSERT(stick.metadata.getToolCapabilities(ToolCapabilities())
+		.full_punch_interval == 0.5f);
+}
+
 const char *TestInventory::serialized_inventory_in =
 	"List 0 10\n"
 	"Width 3\n"
@@ -0,0 +1,159 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <cstring>
+#include "common/c_allocator.h"
+
+class TestLuaAllocator : public TestBase
+{
+public:
+	TestLuaAllocator() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestLuaAllocator"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testSizeClasses();
+	void testReallocate();
+	void testPageTail();
+};
+
+static TestLuaAllocator g_test_instance;
+
+void TestLuaAllocator::runTests(IGameDef *gamedef)
+{
+	TEST(testSizeClasses);
+	TEST(testReallocate);
+	TEST(testPageTail);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void *alloc(LuaPoolAllocator &pool, void *ptr, size_t osize, size_t nsize)
+{
+	return LuaPoolAllocator::alloc(&pool, ptr, osize, nsize);
+}
+
+static bool has_bytes(const void *ptr, size_t size, char c)
+{
+	for (size_t i = 0; i < size; i++)
+		if (((const char *)ptr)[i] != c)
+			return false;
+	return true;
+}
+
+void TestLuaAllocator::testSizeClasses()
+{
+	LuaPoolAllocator pool;
+	UASSERTEQ(size_t, pool.getPooledBytes(), 0);
+
+	// Chunks of the same class follow each other in a page
+	char *p1 = (char *)alloc(pool, nullptr, 0, 10);
+	char *p2 = (char *)alloc(pool, nullptr, 0, 16);
+	UASSERT(p1 && p2);
+	UASSERT(p2 == p1 + 16);
+	size_t page_size = pool.getPooledBytes();
+	UASSERT(page_size > 0);
+
+	// Freed chunks are reused by their own class only
+	alloc(pool, p1, 10, 0);
+	char *p3 = (char *)alloc(pool, nullptr, 0, 17);
+	UASSERT(p3 != p1);
+	char *p4 = (char *)alloc(pool, nullptr, 0, 1);
+	UASSERT(p4 == p1);
+
+	// Large blocks do not take pages
+	void *large = alloc(pool, nullptr, 0, 4096);
+	UASSERT(large);
+	memset(large, 'x', 4096);
+	UASSERTEQ(size_t, pool.getPooledBytes(), page_size);
+
+	alloc(pool, large, 4096, 0);
+	alloc(pool, p2, 16, 0);
+	alloc(pool, p3, 17, 0);
+	alloc(pool, p4, 1, 0);
+	// Pages are kept until the allocator is destroyed
+	UASSERTEQ(size_t, pool.getPooledBytes(), page_size);
+}
+
+void TestLuaAllocator::testReallocate()
+{
+	LuaPoolAllocator pool;
+
+	char *p = (char *)alloc(pool, nullptr, 0, 20);
+	memset(p, 'a', 20);
+
+	// Same class, the block stays
+	UASSERT(alloc(pool, p, 20, 32) == p);
+
+	// Into a larger class
+	char *q = (char *)alloc(pool, p, 32, 100);
+	UASSERT(q && q != p);
+	UASSERT(has_bytes(q, 20, 'a'));
+	memset(q, 'b', 100);
+
+	// Out of the pooled sizes and back
+	char *r = (char *)alloc(pool, q, 100, 1000);
+	UASSERT(r);
+	UASSERT(has_bytes(r, 100, 'b'));
+	memset(r, 'c', 1000);
+	r = (char *)alloc(pool, r, 1000, 2000);
+	UASSERT(r);
+	UASSERT(has_bytes(r, 1000, 'c'));
+	char *s = (char *)alloc(pool, r, 2000, 40);
+	UASSERT(s);
+	UASSERT(has_bytes(s, 40, 'c'));
+
+	// The chunk q was moved out of is free for its class again
+	UASSERT(alloc(pool, nullptr, 0, 100) == q);
+
+	alloc(pool, s, 40, 0);
+	alloc(pool, q, 100, 0);
+}
+
+void TestLuaAllocator::testPageTail()
+{
+	LuaPoolAllocator pool;
+
+	// Fill the first page with chunks of 240 bytes until the rest is too
+	// small for another one
+	char *first = (char *)alloc(pool, nullptr, 0, 240);
+	const size_t page_size = pool.getPooledBytes();
+	const size_t chunks = page_size / 240;
+	char *last = first;
+	for (size_t i = 1; i < chunks; i++) {
+		last = (char *)alloc(pool, nullptr, 0, 240);
+		UASSERT(last == first + i * 240);
+	}
+	UASSERTEQ(size_t, pool.getPooledBytes(), page_size);
+
+	// The next chunk takes a new page, the rest of the old page becomes a
+	// chunk of the class that fits it
+	const size_t tail = page_size - chunks * 240;
+	UASSERT(tail > 0);
+	char *next = (char *)alloc(pool, nullptr, 0, 240);
+	UASSERT(next && (next < first || next >= first + page_size));
+	UASSERTEQ(size_t, pool.getPooledBytes(), 2 * page_size);
+
+	char *rest = (char *)alloc(pool, nullptr, 0, tail);
+	UASSERT(rest == last + 240);
+	memset(rest, 'r', tail);
+	UASSERT(has_bytes(last + 240, tail, 'r'));
+}
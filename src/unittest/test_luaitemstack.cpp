@@ -0,0 +1,220 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <algorithm>
+#include "lua_api/l_item.h"
+#include "porting.h"
+
+class TestLuaItemStack : public TestBase
+{
+public:
+	TestLuaItemStack() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestLuaItemStack"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testViewReads(lua_State *L);
+	void testViewWrites(lua_State *L);
+	void testViewKept(lua_State *L);
+	void testViewCollected(lua_State *L);
+	void testCallbackBenchmark(lua_State *L);
+};
+
+static TestLuaItemStack g_test_instance;
+
+static const char *test_callbacks =
+	"function read(stack) return stack:get_count() end\n"
+	"function modify(stack) stack:set_count(3) return stack end\n"
+	"function keep(stack) kept = stack end\n";
+
+void TestLuaItemStack::runTests(IGameDef *gamedef)
+{
+	lua_State *L = luaL_newstate();
+	LuaItemStack::Register(L);
+	if (luaL_loadstring(L, test_callbacks) || lua_pcall(L, 0, 0, 0)) {
+		rawstream << "Loading test callbacks failed: "
+			<< lua_tostring(L, -1) << std::endl;
+		lua_close(L);
+		return;
+	}
+
+	TEST(testViewReads, L);
+	TEST(testViewWrites, L);
+	TEST(testViewKept, L);
+	TEST(testViewCollected, L);
+	TEST(testCallbackBenchmark, L);
+
+	lua_close(L);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static ItemStack make_stack()
+{
+	ItemStack stack;
+	stack.name = "default:pick_steel";
+	stack.count = 10;
+	stack.metadata.setString("owner", "singleplayer");
+	return stack;
+}
+
+static const ItemStack &stack_at(lua_State *L, int index)
+{
+	const LuaItemStack *o = LuaItemStack::checkobject(L, index);
+	return o->getItem();
+}
+
+void TestLuaItemStack::testViewReads(lua_State *L)
+{
+	ItemStack stack = make_stack();
+	LuaItemStackViews views;
+
+	lua_getglobal(L, "read");
+	LuaItemStack::createView(L, stack, views);
+	// Reading through the view does not copy the stack
+	UASSERT(&stack_at(L, -1) == &stack);
+	UASSERT(lua_pcall(L, 1, 1, 0) == 0);
+	views.detach();
+
+	UASSERTEQ(int, lua_tointeger(L, -1), 10);
+	lua_pop(L, 1);
+}
+
+void TestLuaItemStack::testViewWrites(lua_State *L)
+{
+	ItemStack stack = make_stack();
+	LuaItemStackViews views;
+
+	lua_getglobal(L, "modify");
+	LuaItemStack::createView(L, stack, views);
+	UASSERT(lua_pcall(L, 1, 1, 0) == 0);
+	views.detach();
+
+	// The view copied the stack before the write
+	UASSERTEQ(u16, stack.count, 10);
+	const ItemStack &result = stack_at(L, -1);
+	UASSERT(&result != &stack);
+	UASSERTEQ(u16, result.count, 3);
+	UASSERTEQ(std::string, result.metadata.getString("owner"), "singleplayer");
+	lua_pop(L, 1);
+}
+
+void TestLuaItemStack::testViewKept(lua_State *L)
+{
+	ItemStack stack = make_stack();
+	{
+		LuaItemStackViews views;
+		lua_getglobal(L, "keep");
+		LuaItemStack::createView(L, stack, views);
+		UASSERT(lua_pcall(L, 1, 0, 0) == 0);
+		views.detach();
+	}
+
+	// A view kept after the callback holds its own copy, which shares the
+	// metadata
+	stack.count = 1;
+	lua_getglobal(L, "kept");
+	const ItemStack &kept = stack_at(L, -1);
+	UASSERT(&kept != &stack);
+	UASSERTEQ(u16, kept.count, 10);
+	UASSERT(&kept.metadata.getStrings() == &stack.metadata.getStrings());
+	lua_pop(L, 1);
+
+	lua_pushnil(L);
+	lua_setglobal(L, "kept");
+}
+
+void TestLuaItemStack::testViewCollected(lua_State *L)
+{
+	ItemStack stack = make_stack();
+	LuaItemStackViews views;
+
+	// Views collected before detach() leave the list
+	LuaItemStack::createView(L, stack, views);
+	LuaItemStack::createView(L, stack, views);
+	lua_pop(L, 1);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	views.detach();
+
+	UASSERT(&stack_at(L, -1) != &stack);
+	UASSERTEQ(u16, stack_at(L, -1).count, 10);
+	lua_pop(L, 1);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+}
+
+// Lua memory allocated so far, in bytes
+static int lua_bytes(lua_State *L)
+{
+	return lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+// Calls a callback that only looks at the stack, like most allow_put ones.
+// Returns the time taken in microseconds, the Lua memory is allocated with the
+// garbage collector stopped.
+static u64 run_callbacks(lua_State *L, const ItemStack &stack, int calls,
+		bool views, int *bytes)
+{
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	lua_gc(L, LUA_GCSTOP, 0);
+	int bytes_start = lua_bytes(L);
+	u64 t_start = porting::getTimeUs();
+	for (int i = 0; i < calls; i++) {
+		LuaItemStackViews stack_views;
+		lua_getglobal(L, "read");
+		if (views)
+			LuaItemStack::createView(L, stack, stack_views);
+		else
+			LuaItemStack::create(L, stack);
+		lua_pcall(L, 1, 1, 0);
+		stack_views.detach();
+		lua_pop(L, 1);
+	}
+	u64 t_end = porting::getTimeUs();
+	*bytes = lua_bytes(L) - bytes_start;
+	lua_gc(L, LUA_GCRESTART, 0);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	return t_end - t_start;
+}
+
+void TestLuaItemStack::testCallbackBenchmark(lua_State *L)
+{
+	const int calls = full_benchmarks() ? 100000 : 1000;
+	ItemStack stack = make_stack();
+
+	// Alternate, so neither profits from memory the other one freed
+	u64 t_copies = U64_MAX, t_views = U64_MAX;
+	int bytes_copies, bytes_views;
+	for (int i = 0; i < 3; i++) {
+		t_copies = std::min(t_copies,
+				run_callbacks(L, stack, calls, false, &bytes_copies));
+		t_views = std::min(t_views,
+				run_callbacks(L, stack, calls, true, &bytes_views));
+	}
+
+	UASSERT(bytes_views <= bytes_copies);
+	if (full_benchmarks()) {
+		rawstream << "    " << calls << " callbacks: copies "
+			<< t_copies * 1000 / calls << "ns and "
+			<< bytes_copies / calls << " Lua bytes each, views "
+			<< t_views * 1000 / calls << "ns and "
+			<< bytes_views / calls << " Lua bytes each" << std::endl;
+	}
+}
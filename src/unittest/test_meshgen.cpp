@@ -0,0 +1,265 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include "client/mapblock_mesh.h"
+#include "client/shader.h"
+#include "client/tile.h"
+#include "nodedef.h"
+#include "porting.h"
+#include "settings.h"
+#include "threading/workerpool.h"
+
+class TestMeshGen : public TestBase
+{
+public:
+	TestMeshGen() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestMeshGen"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testWorkersBenchmark();
+};
+
+static TestMeshGen g_test_instance;
+
+void TestMeshGen::runTests(IGameDef *gamedef)
+{
+	TEST(testWorkersBenchmark);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hands out an id per name, there are no textures and no shaders
+class TestTextureSource : public ITextureSource
+{
+public:
+	u32 getTextureId(const std::string &name) override { return 0; }
+	std::string getTextureName(u32 id) override { return ""; }
+	video::ITexture *getTexture(u32 id) override { return nullptr; }
+	video::ITexture *getTexture(const std::string &name, u32 *id) override
+	{
+		return nullptr;
+	}
+	video::ITexture *getTextureForMesh(const std::string &name,
+			u32 *id) override
+	{
+		// Ids start at 1, faces without a texture are left out of meshes
+		u32 &texture_id = texture_ids[name];
+		if (texture_id == 0)
+			texture_id = texture_ids.size();
+		if (id)
+			*id = texture_id;
+		return nullptr;
+	}
+	Palette *getPalette(const std::string &name) override { return nullptr; }
+	bool isKnownSourceImage(const std::string &name) override { return false; }
+	video::ITexture *getNormalTexture(const std::string &name) override
+	{
+		return nullptr;
+	}
+	video::SColor getTextureAverageColor(const std::string &name) override
+	{
+		return video::SColor(255, 127, 127, 127);
+	}
+	video::ITexture *getShaderFlagsTexture(bool normalmap_present) override
+	{
+		return nullptr;
+	}
+
+	std::unordered_map<std::string, u32> texture_ids;
+};
+
+class TestShaderSource : public IShaderSource
+{
+};
+
+static void no_progress(void *args, u32 progress, u32 max_progress)
+{
+}
+
+struct TestTerrain
+{
+	content_t stone, dirt, grass, water, leaves, plant;
+	// The nodes of each block
+	std::map<v3s16, std::vector<MapNode>> blocks;
+};
+
+static content_t add_node(NodeDefManager *ndef, const std::string &name,
+		NodeDrawType drawtype)
+{
+	ContentFeatures f;
+	f.name = name;
+	f.drawtype = drawtype;
+	for (TileDef &tiledef : f.tiledef)
+		tiledef.name = name + ".png";
+	if (drawtype != NDT_NORMAL) {
+		f.param_type = CPT_LIGHT;
+		f.light_propagates = true;
+	}
+	if (drawtype == NDT_LIQUID) {
+		f.liquid_type = LIQUID_SOURCE;
+		f.walkable = false;
+		f.alpha = 160;
+	}
+	if (drawtype == NDT_PLANTLIKE) {
+		f.sunlight_propagates = true;
+		f.walkable = false;
+	}
+	return ndef->set(f.name, f);
+}
+
+/*
+	Hills of stone below dirt and grass, with trees of leaves, plants and
+	lakes, like the surface of a generated map
+*/
+static void make_terrain(TestTerrain &terrain, NodeDefManager *ndef,
+		v3s16 blocks_min, v3s16 blocks_max)
+{
+	terrain.stone = add_node(ndef, "test:stone", NDT_NORMAL);
+	terrain.dirt = add_node(ndef, "test:dirt", NDT_NORMAL);
+	terrain.grass = add_node(ndef, "test:grass", NDT_NORMAL);
+	terrain.water = add_node(ndef, "test:water", NDT_LIQUID);
+	terrain.leaves = add_node(ndef, "test:leaves", NDT_ALLFACES);
+	terrain.plant = add_node(ndef, "test:plant", NDT_PLANTLIKE);
+
+	v3s16 bp;
+	for (bp.Z = blocks_min.Z; bp.Z <= blocks_max.Z; bp.Z++)
+	for (bp.Y = blocks_min.Y; bp.Y <= blocks_max.Y; bp.Y++)
+	for (bp.X = blocks_min.X; bp.X <= blocks_max.X; bp.X++) {
+		std::vector<MapNode> &nodes = terrain.blocks[bp];
+		nodes.reserve(MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE);
+
+		v3s16 rel;
+		for (rel.Z = 0; rel.Z < MAP_BLOCKSIZE; rel.Z++)
+		for (rel.Y = 0; rel.Y < MAP_BLOCKSIZE; rel.Y++)
+		for (rel.X = 0; rel.X < MAP_BLOCKSIZE; rel.X++) {
+			v3s16 p = bp * MAP_BLOCKSIZE + rel;
+			s16 height = 8 * std::sin(p.X * 0.1f) + 6 * std::cos(p.Z * 0.13f);
+			// Some columns carry a tree or a plant
+			bool tree = (p.X * 7 + p.Z * 13) % 61 == 0;
+			bool plant = (p.X * 11 + p.Z * 5) % 7 == 0;
+
+			content_t c = CONTENT_AIR;
+			if (p.Y < height - 3)
+				c = terrain.stone;
+			else if (p.Y < height)
+				c = terrain.dirt;
+			else if (p.Y == height)
+				c = height < 0 ? terrain.dirt : terrain.grass;
+			else if (p.Y <= 0)
+				c = terrain.water;
+			else if (tree && p.Y > height + 2 && p.Y <= height + 6)
+				c = terrain.leaves;
+			else if (plant && p.Y == height + 1)
+				c = terrain.plant;
+
+			u8 light = c == CONTENT_AIR || c == terrain.plant ?
+				LIGHT_SUN : 0;
+			nodes.emplace_back(c, light);
+		}
+	}
+}
+
+// Builds the mesh of the block at p like a mesh update thread
+static u32 make_block_mesh(TestTerrain &terrain, const NodeDefManager *ndef,
+		ITextureSource *tsrc, IShaderSource *shdsrc, v3s16 p)
+{
+	MeshMakeData data(ndef, tsrc, shdsrc, false);
+	data.fillBlockDataBegin(p);
+	v3s16 dp;
+	for (dp.Z = -1; dp.Z <= 1; dp.Z++)
+	for (dp.Y = -1; dp.Y <= 1; dp.Y++)
+	for (dp.X = -1; dp.X <= 1; dp.X++) {
+		auto it = terrain.blocks.find(p + dp);
+		if (it != terrain.blocks.end())
+			data.fillBlockData(dp, it->second.data());
+	}
+	data.setSmoothLighting(true);
+
+	MapBlockMesh mesh(&data, v3s16(0, 0, 0));
+	u32 vertex_count = 0;
+	for (int layer = 0; layer < MAX_TILE_LAYERS; layer++) {
+		scene::IMesh *layer_mesh = mesh.getMesh(layer);
+		for (u32 i = 0; i < layer_mesh->getMeshBufferCount(); i++)
+			vertex_count += layer_mesh->getMeshBuffer(i)->getVertexCount();
+	}
+	return vertex_count;
+}
+
+void TestMeshGen::testWorkersBenchmark()
+{
+	// The meshes are not drawn, so there are no hardware buffers to free
+	const bool enable_vbo = g_settings->getBool("enable_vbo");
+	g_settings->setBool("enable_vbo", false);
+
+	TestTextureSource tsrc;
+	TestShaderSource shdsrc;
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	TestTerrain terrain;
+	const s16 size = full_benchmarks() ? 4 : 2;
+	make_terrain(terrain, ndef.get(), v3s16(-size, -1, -size),
+			v3s16(size - 1, 1, size - 1));
+	ndef->updateTextures(&tsrc, &shdsrc, nullptr, no_progress, nullptr);
+
+	// The middle layer of blocks, which has most of the surface
+	std::vector<v3s16> positions;
+	for (auto &it : terrain.blocks)
+		if (it.first.Y == 0)
+			positions.push_back(it.first);
+
+	// Vertices of the meshes of the blocks, per number of workers
+	static const u16 worker_counts[] = {1, 2, 4, 8};
+	std::vector<std::vector<u32>> vertices;
+	for (u16 workers : worker_counts) {
+		vertices.emplace_back(positions.size());
+		std::vector<u32> &block_vertices = vertices.back();
+
+		// The calling thread is one of the workers
+		WorkerPool pool("MeshGenTest", workers - 1);
+		u64 t_start = porting::getTimeUs();
+		pool.run(positions.size(), 1, [&] (size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				block_vertices[i] = make_block_mesh(terrain, ndef.get(), &tsrc,
+						&shdsrc, positions[i]);
+		});
+		u64 t_end = porting::getTimeUs();
+
+		if (full_benchmarks()) {
+			rawstream << "    " << positions.size() << " blocks with "
+				<< workers << " workers: " << (t_end - t_start) / 1000
+				<< "ms" << std::endl;
+		}
+	}
+
+	g_settings->setBool("enable_vbo", enable_vbo);
+
+	// Every number of workers makes the same meshes
+	for (const std::vector<u32> &block_vertices : vertices)
+		UASSERT(block_vertices == vertices[0]);
+	u32 total_vertices = 0;
+	for (u32 count : vertices[0])
+		total_vertices += count;
+	UASSERT(total_vertices > 0);
+}
@@ -0,0 +1,185 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include "client/mesh.h"
+#include "constants.h"
+#include "porting.h"
+
+class TestMeshMerge : public TestBase
+{
+public:
+	TestMeshMerge() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestMeshMerge"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testMergeByMaterial();
+	void testIndexLimit();
+	void testRejected();
+	void testMergeBenchmark();
+};
+
+static TestMeshMerge g_test_instance;
+
+void TestMeshMerge::runTests(IGameDef *gamedef)
+{
+	TEST(testMergeByMaterial);
+	TEST(testIndexLimit);
+	TEST(testRejected);
+	TEST(testMergeBenchmark);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef std::vector<std::pair<u8, scene::SMeshBuffer *>> MergedBuffers;
+
+// A buffer of quads along x, materials are told apart by MaterialTypeParam
+static scene::SMeshBuffer *make_buffer(u32 quads, int material)
+{
+	scene::SMeshBuffer *buf = new scene::SMeshBuffer();
+	buf->Material.MaterialTypeParam = material;
+	const video::SColor c(255, 255, 255, 255);
+	for (u32 q = 0; q < quads; q++) {
+		u16 base = buf->Vertices.size();
+		f32 x = q * BS;
+		buf->Vertices.push_back(video::S3DVertex(x, 0, 0, 0, 1, 0, c, 0, 1));
+		buf->Vertices.push_back(video::S3DVertex(x, 0, BS, 0, 1, 0, c, 0, 0));
+		buf->Vertices.push_back(video::S3DVertex(x + BS, 0, BS, 0, 1, 0, c, 1, 0));
+		buf->Vertices.push_back(video::S3DVertex(x + BS, 0, 0, 0, 1, 0, c, 1, 1));
+		const u16 indices[] = {0, 1, 2, 2, 3, 0};
+		for (u16 i : indices)
+			buf->Indices.push_back(base + i);
+	}
+	return buf;
+}
+
+static void drop_all(MergedBuffers &merged)
+{
+	for (auto &it : merged)
+		it.second->drop();
+	merged.clear();
+}
+
+void TestMeshMerge::testMergeByMaterial()
+{
+	MergedBuffers merged;
+	scene::SMeshBuffer *a = make_buffer(1, 0);
+	scene::SMeshBuffer *b = make_buffer(2, 0);
+	scene::SMeshBuffer *c = make_buffer(1, 1);
+
+	UASSERT(mergeMeshBuffer(merged, 0, a, false));
+	UASSERT(mergeMeshBuffer(merged, 0, b, false));
+	UASSERT(mergeMeshBuffer(merged, 0, c, false));
+	// Same material, but another layer
+	UASSERT(mergeMeshBuffer(merged, 1, a, false));
+
+	UASSERTEQ(size_t, merged.size(), 3);
+	scene::SMeshBuffer *ab = merged[0].second;
+	UASSERTEQ(u32, ab->getVertexCount(), 12);
+	UASSERTEQ(u32, ab->getIndexCount(), 18);
+	// The indices of b follow the vertices of a
+	UASSERTEQ(u16, ab->getIndices()[6], 4);
+	UASSERTEQ(u16, ab->getIndices()[17], 8);
+	UASSERT(merged[1].second->Material.MaterialTypeParam == 1);
+	UASSERTEQ(int, merged[2].first, 1);
+
+	drop_all(merged);
+	a->drop();
+	b->drop();
+	c->drop();
+}
+
+void TestMeshMerge::testIndexLimit()
+{
+	MergedBuffers merged;
+	// 40000 vertices each, two do not fit below the 16-bit index limit
+	scene::SMeshBuffer *big = make_buffer(10000, 0);
+	scene::SMeshBuffer *small = make_buffer(100, 0);
+
+	UASSERT(mergeMeshBuffer(merged, 0, big, false));
+	UASSERT(mergeMeshBuffer(merged, 0, big, false));
+	UASSERT(mergeMeshBuffer(merged, 0, small, false));
+
+	UASSERTEQ(size_t, merged.size(), 2);
+	UASSERTEQ(u32, merged[0].second->getVertexCount(), 40400);
+	UASSERTEQ(u32, merged[1].second->getVertexCount(), 40000);
+
+	drop_all(merged);
+	big->drop();
+	small->drop();
+}
+
+void TestMeshMerge::testRejected()
+{
+	MergedBuffers merged;
+	scene::SMeshBuffer *buf = make_buffer(1, 0);
+	scene::SMeshBufferTangents *tangents = new scene::SMeshBufferTangents();
+
+	UASSERT(!mergeMeshBuffer(merged, 0, buf, true));
+	UASSERT(!mergeMeshBuffer(merged, 0, tangents, false));
+	UASSERTEQ(size_t, merged.size(), 0);
+
+	buf->drop();
+	tangents->drop();
+}
+
+void TestMeshMerge::testMergeBenchmark()
+{
+	// A batch region of 4x4x4 blocks with a few materials each, like the
+	// surface of a map. Only the full run is the size of a real batch.
+	const u32 blocks = full_benchmarks() ? 64 : 8;
+	const int materials = 6;
+	const int runs = full_benchmarks() ? 20 : 2;
+
+	std::vector<scene::SMeshBuffer *> buffers;
+	u32 vertex_count = 0;
+	for (u32 b = 0; b < blocks; b++)
+	for (int m = 0; m < materials; m++) {
+		// Between 16 and 256 faces
+		buffers.push_back(make_buffer(16 + (b * 7 + m * 31) % 241, m));
+		vertex_count += buffers.back()->getVertexCount();
+	}
+
+	MergedBuffers merged;
+	u64 t_start = porting::getTimeUs();
+	for (int r = 0; r < runs; r++) {
+		drop_all(merged);
+		for (scene::SMeshBuffer *buf : buffers)
+			mergeMeshBuffer(merged, 0, buf, false);
+	}
+	u64 t_end = porting::getTimeUs();
+
+	u32 merged_vertex_count = 0;
+	for (auto &it : merged)
+		merged_vertex_count += it.second->getVertexCount();
+	UASSERTEQ(u32, merged_vertex_count, vertex_count);
+	UASSERT(merged.size() < buffers.size());
+
+	if (full_benchmarks()) {
+		rawstream << "    " << buffers.size() << " buffers with " << vertex_count
+			<< " vertices merged into " << merged.size() << " in "
+			<< (t_end - t_start) / runs << "us" << std::endl;
+	}
+
+	drop_all(merged);
+	for (scene::SMeshBuffer *buf : buffers)
+		buf->drop();
+}
@@ -0,0 +1,215 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include "client/shader.h"
+#include "client/tile.h"
+#include "network/networkprotocol.h"
+#include "nodedef.h"
+#include "porting.h"
+#include "settings.h"
+
+class TestNodeTextures : public TestBase
+{
+public:
+	TestNodeTextures() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestNodeTextures"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testTileLookupsShared();
+	void testUpdateTexturesBenchmark();
+};
+
+static TestNodeTextures g_test_instance;
+
+void TestNodeTextures::runTests(IGameDef *gamedef)
+{
+	TEST(testTileLookupsShared);
+	TEST(testUpdateTexturesBenchmark);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counts the lookups and hands out an id per name, there are no textures
+class TestTextureSource : public ITextureSource
+{
+public:
+	u32 getTextureId(const std::string &name) override { return 0; }
+	std::string getTextureName(u32 id) override { return ""; }
+	video::ITexture *getTexture(u32 id) override { return nullptr; }
+	video::ITexture *getTexture(const std::string &name, u32 *id) override
+	{
+		return nullptr;
+	}
+	video::ITexture *getTextureForMesh(const std::string &name,
+			u32 *id) override
+	{
+		texture_lookups++;
+		// Ids start at 1, 0 is no texture
+		u32 &texture_id = texture_ids[name];
+		if (texture_id == 0)
+			texture_id = texture_ids.size();
+		if (id)
+			*id = texture_id;
+		return nullptr;
+	}
+	Palette *getPalette(const std::string &name) override { return nullptr; }
+	bool isKnownSourceImage(const std::string &name) override { return false; }
+	video::ITexture *getNormalTexture(const std::string &name) override
+	{
+		return nullptr;
+	}
+	video::SColor getTextureAverageColor(const std::string &name) override
+	{
+		average_color_lookups++;
+		return video::SColor(255, 127, 127, 127);
+	}
+	video::ITexture *getShaderFlagsTexture(bool normalmap_present) override
+	{
+		return nullptr;
+	}
+
+	u32 texture_lookups = 0;
+	u32 average_color_lookups = 0;
+	std::unordered_map<std::string, u32> texture_ids;
+};
+
+class TestShaderSource : public IShaderSource
+{
+public:
+	u32 getShader(const std::string &name, const u8 material_type,
+			const u8 drawtype) override
+	{
+		shader_lookups++;
+		return 0;
+	}
+
+	u32 shader_lookups = 0;
+};
+
+static void no_progress(void *args, u32 progress, u32 max_progress)
+{
+}
+
+/*
+	Serialized definitions of count nodes, like those a server sends. The
+	nodes of a mod share a handful of textures, mostly the same on all
+	sides, and some have an overlay.
+*/
+static std::string make_node_dump(u32 count)
+{
+	static const NodeDrawType drawtypes[] = {
+		NDT_NORMAL, NDT_NORMAL, NDT_ALLFACES, NDT_GLASSLIKE, NDT_PLANTLIKE,
+	};
+
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	for (u32 i = 0; i < count; i++) {
+		std::ostringstream name;
+		name << "mod" << i / 100 << ":node" << i % 100;
+		std::ostringstream texture;
+		texture << "mod" << i / 100 << "_" << i % 7 << ".png";
+
+		ContentFeatures f;
+		f.name = name.str();
+		f.drawtype = drawtypes[i % 5];
+		for (TileDef &tiledef : f.tiledef)
+			tiledef.name = texture.str();
+		// Grass-like top and bottom
+		if (i % 3 == 0) {
+			f.tiledef[0].name = texture.str() + "^[colorize:#00FF00:64";
+			f.tiledef[1].name = "default_dirt.png";
+		}
+		if (i % 10 == 0) {
+			for (TileDef &tiledef : f.tiledef_overlay)
+				tiledef.name = "overlay_" + texture.str();
+		}
+		ndef->set(f.name, f);
+	}
+
+	std::ostringstream os(std::ios::binary);
+	ndef->serialize(os, LATEST_PROTOCOL_VERSION);
+	return os.str();
+}
+
+void TestNodeTextures::testTileLookupsShared()
+{
+	std::istringstream is(make_node_dump(500), std::ios::binary);
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	ndef->deSerialize(is);
+
+	TestTextureSource tsrc;
+	TestShaderSource shdsrc;
+	ndef->updateTextures(&tsrc, &shdsrc, nullptr, no_progress, nullptr);
+
+	// Per mod 7 textures, 7 colorized ones and 7 overlays, plus the dirt,
+	// "unknown_node.png" of the built-in nodes and the empty special tiles.
+	// Each is looked up once.
+	UASSERTEQ(u32, tsrc.texture_lookups, 5 * 21 + 3);
+	UASSERTEQ(size_t, tsrc.texture_ids.size(), tsrc.texture_lookups);
+	// The top textures, plain or colorized
+	UASSERTEQ(u32, tsrc.average_color_lookups,
+		g_settings->getBool("enable_minimap") ? 5 * 14 : 0);
+	// Normal nodes need a second shader for their overlays, the built-in
+	// unknown node is a normal node too, air and ignore are airlike
+	UASSERTEQ(u32, shdsrc.shader_lookups, 6);
+
+	const ContentFeatures &f = ndef->get("mod1:node20");
+	UASSERTEQ(std::string, f.tiledef[0].name, "mod1_1.png^[colorize:#00FF00:64");
+	UASSERTEQ(std::string, f.tiledef_overlay[0].name, "overlay_mod1_1.png");
+
+	// Nodes with the same texture share the tile, on any drawtype
+	const TileLayer &a = ndef->get("mod0:node1").tiles[0].layers[0];
+	const TileLayer &b = ndef->get("mod0:node8").tiles[0].layers[0];
+	const TileLayer &c = ndef->get("mod0:node2").tiles[0].layers[0];
+	UASSERT(a.texture_id != 0);
+	UASSERTEQ(u32, a.texture_id, b.texture_id);
+	UASSERTEQ(u32, a.texture_id, tsrc.texture_ids["mod0_1.png"]);
+	UASSERT(c.texture_id != a.texture_id);
+}
+
+void TestNodeTextures::testUpdateTexturesBenchmark()
+{
+	const u32 count = full_benchmarks() ? 20000 : 1000;
+	std::string dump = make_node_dump(count);
+
+	u64 t_start = porting::getTimeUs();
+	std::istringstream is(dump, std::ios::binary);
+	std::unique_ptr<NodeDefManager> ndef(createNodeDefManager());
+	ndef->deSerialize(is);
+	u64 t_deserialized = porting::getTimeUs();
+
+	TestTextureSource tsrc;
+	TestShaderSource shdsrc;
+	ndef->updateTextures(&tsrc, &shdsrc, nullptr, no_progress, nullptr);
+	u64 t_end = porting::getTimeUs();
+
+	UASSERT(ndef->getId("mod0:node0") != CONTENT_IGNORE);
+	if (full_benchmarks()) {
+		rawstream << "    " << count << " nodes (" << dump.size() / 1024
+			<< " KiB): deSerialize " << (t_deserialized - t_start) / 1000
+			<< "ms, updateTextures " << (t_end - t_deserialized) / 1000 << "ms with "
+			<< tsrc.texture_lookups << " texture and " << shdsrc.shader_lookups
+			<< " shader lookups" << std::endl;
+	}
+}
@@ -0,0 +1,164 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <cmath>
+#include "nodetimer.h"
+
+class TestNodeTimer : public TestBase {
+public:
+	TestNodeTimer() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestNodeTimer"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testWheelExpiry();
+	void testWheelFarExpiry();
+	void testWheelSetRemove();
+	void testListAttach();
+};
+
+static TestNodeTimer g_test_instance;
+
+void TestNodeTimer::runTests(IGameDef *gamedef)
+{
+	TEST(testWheelExpiry);
+	TEST(testWheelFarExpiry);
+	TEST(testWheelSetRemove);
+	TEST(testListAttach);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestNodeTimer::testWheelExpiry()
+{
+	NodeTimerWheel wheel(0.1);
+	wheel.set(v3s16(1, 0, 0), 0.25);
+	wheel.set(v3s16(2, 0, 0), 0.5);
+	wheel.set(v3s16(3, 0, 0), 1.0);
+	UASSERTEQ(size_t, wheel.size(), 3);
+
+	std::vector<v3s16> expired;
+	wheel.advance(0.2, expired);
+	UASSERT(expired.empty());
+
+	// Expires within the tick the clock is in
+	wheel.advance(0.3, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+	UASSERT(expired[0] == v3s16(1, 0, 0));
+
+	expired.clear();
+	wheel.advance(2.0, expired);
+	UASSERTEQ(size_t, expired.size(), 2);
+	UASSERT(expired[0] == v3s16(2, 0, 0));
+	UASSERT(expired[1] == v3s16(3, 0, 0));
+	UASSERTEQ(size_t, wheel.size(), 0);
+
+	// Times in the past expire on the next advance
+	expired.clear();
+	wheel.set(v3s16(4, 0, 0), 1.0);
+	wheel.advance(2.0, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+}
+
+void TestNodeTimer::testWheelFarExpiry()
+{
+	NodeTimerWheel wheel(0.1);
+	// Covers every level and the overflow list. Advancing visits every tick,
+	// reaching the overflow list takes 30 million of them.
+	const double expiries[] = {3.0, 150.0, 9000.0, 30000.0, 3000000.0};
+	const size_t count = full_benchmarks() ? 5 : 4;
+	for (size_t i = 0; i < count; i++)
+		wheel.set(v3s16(i, 0, 0), expiries[i]);
+
+	std::vector<v3s16> expired;
+	double time = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		wheel.advance(expiries[i] - 0.05, expired);
+		UASSERTEQ(size_t, expired.size(), i);
+		time = expiries[i];
+		wheel.advance(time, expired);
+		UASSERTEQ(size_t, expired.size(), i + 1);
+		UASSERT(expired[i] == v3s16(i, 0, 0));
+	}
+	UASSERT(wheel.getTime() == time);
+}
+
+void TestNodeTimer::testWheelSetRemove()
+{
+	NodeTimerWheel wheel(0.1);
+	v3s16 key(0, -1, 2);
+	wheel.set(key, 1.0);
+	wheel.set(key, 5.0);
+	wheel.set(v3s16(9, 9, 9), 1.0);
+	wheel.remove(v3s16(9, 9, 9));
+	UASSERTEQ(size_t, wheel.size(), 1);
+
+	std::vector<v3s16> expired;
+	wheel.advance(2.0, expired);
+	UASSERT(expired.empty());
+
+	// Moved back to the original time
+	wheel.set(key, 3.0);
+	wheel.advance(4.0, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+	wheel.advance(10.0, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+}
+
+void TestNodeTimer::testListAttach()
+{
+	NodeTimerWheel wheel(0.1);
+	std::vector<v3s16> expired;
+	wheel.advance(100.0, expired);
+
+	v3s16 blockpos(1, 2, 3);
+	NodeTimerList timers;
+	timers.set(NodeTimer(2.0f, 0.0f, v3s16(0, 0, 0)));
+	timers.set(NodeTimer(5.0f, 1.0f, v3s16(1, 0, 0)));
+	UASSERT(timers.step(1.0f).empty());
+
+	timers.attach(&wheel, blockpos);
+	UASSERTEQ(size_t, wheel.size(), 1);
+	UASSERT(std::fabs(timers.get(v3s16(0, 0, 0)).elapsed - 1.0f) < 0.001f);
+
+	wheel.advance(101.5, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+	UASSERT(expired[0] == blockpos);
+	std::vector<NodeTimer> elapsed = timers.takeElapsed();
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(0, 0, 0));
+	UASSERT(std::fabs(elapsed[0].elapsed - 2.5f) < 0.001f);
+	// Registered again with the next timer
+	UASSERTEQ(size_t, wheel.size(), 1);
+
+	// Timers set while attached run on the clock of the wheel
+	timers.set(NodeTimer(0.2f, 0.0f, v3s16(2, 0, 0)));
+	expired.clear();
+	wheel.advance(101.8, expired);
+	UASSERTEQ(size_t, expired.size(), 1);
+	elapsed = timers.takeElapsed();
+	UASSERTEQ(size_t, elapsed.size(), 1);
+	UASSERT(elapsed[0].position == v3s16(2, 0, 0));
+
+	timers.detach();
+	UASSERTEQ(size_t, wheel.size(), 0);
+	UASSERT(std::fabs(timers.get(v3s16(1, 0, 0)).elapsed - 3.8f) < 0.001f);
+}
@@ -0,0 +1,284 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <cmath>
+#include "client/particlestore.h"
+#include "constants.h"
+#include "porting.h"
+
+class TestParticles : public TestBase
+{
+public:
+	TestParticles() { TestManager::registerTestModule(this); }
+	const char *getName() override { return "TestParticles"; }
+
+	void runTests(IGameDef *gamedef) override;
+
+	void testFreeMotion();
+	void testFloorCollision();
+	void testWallCollision();
+	void testExpiry();
+	void testCollisionRemoval();
+	void testAnimation();
+	void testRemapTextures();
+	void testStepBenchmark();
+};
+
+static TestParticles g_test_instance;
+
+// Solid below y = 0 and at x >= 3
+class TestParticleWorld : public ParticleWorld
+{
+public:
+	bool isSolid(v3s16 p) override { return p.Y < 0 || p.X >= 3; }
+
+	u8 getLight(v3s16 p) override { return p.Y < 0 ? 0 : 15; }
+
+	bool moveWithObjects(float size, float dtime,
+			v3f &pos, v3f &vel, v3f acc) override
+	{
+		object_moves++;
+		vel += acc * dtime;
+		pos += vel * dtime;
+		return false;
+	}
+
+	int object_moves = 0;
+};
+
+void TestParticles::runTests(IGameDef *gamedef)
+{
+	TEST(testFreeMotion);
+	TEST(testFloorCollision);
+	TEST(testWallCollision);
+	TEST(testExpiry);
+	TEST(testCollisionRemoval);
+	TEST(testAnimation);
+	TEST(testRemapTextures);
+	TEST(testStepBenchmark);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestParticles::testFreeMotion()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.pos = v3f(0.0f, 2.0f, 0.0f);
+	spec.vel = v3f(1.0f, 0.0f, 0.0f);
+	spec.acc = v3f(0.0f, -1.0f, 0.0f);
+	spec.expiration = 10.0f;
+	store.add(spec);
+
+	for (int i = 0; i < 10; i++)
+		store.step(0.1f, &world);
+
+	// Semi-implicit Euler: y = 2 - 0.01 * (1 + 2 + ... + 10)
+	v3f pos = store.getPosition(0);
+	UASSERT(std::fabs(pos.X - 1.0f) < 0.001f);
+	UASSERT(std::fabs(pos.Y - 1.45f) < 0.001f);
+	UASSERT(std::fabs(store.getVelocity(0).Y + 1.0f) < 0.001f);
+	UASSERTEQ(int, store.getLight(0), 15);
+	// Does not collide, even though the floor is crossed later
+	spec.pos = v3f(0.0f, 0.2f, 0.0f);
+	spec.vel = v3f(0.0f, -1.0f, 0.0f);
+	store.add(spec);
+	store.step(1.0f, &world);
+	UASSERT(store.getPosition(1).Y < -0.5f);
+}
+
+void TestParticles::testFloorCollision()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.pos = v3f(0.0f, 3.0f, 0.0f);
+	spec.vel = v3f(0.3f, 0.0f, 0.0f);
+	spec.acc = v3f(0.0f, -10.0f, 0.0f);
+	spec.expiration = 10.0f;
+	spec.size = 0.2f * BS;
+	spec.collisiondetection = true;
+	store.add(spec);
+
+	for (int i = 0; i < 100; i++)
+		store.step(0.05f, &world);
+
+	// Resting on the floor at y = -0.5, sliding on along x
+	v3f pos = store.getPosition(0);
+	UASSERT(std::fabs(pos.Y - (-0.5f + 0.1f)) < 0.001f);
+	UASSERT(store.getVelocity(0).Y == 0.0f);
+	UASSERT(std::fabs(pos.X - 1.5f) < 0.001f);
+	UASSERTEQ(int, world.object_moves, 0);
+
+	// Too fast to be checked only once per step
+	ParticleStore fast;
+	spec.pos = v3f(0.0f, 1.0f, 0.0f);
+	spec.vel = v3f(0.0f, -30.0f, 0.0f);
+	spec.acc = v3f(0.0f, 0.0f, 0.0f);
+	fast.add(spec);
+	fast.step(0.1f, &world);
+	UASSERT(std::fabs(fast.getPosition(0).Y - (-0.4f)) < 0.001f);
+
+	// Object collision takes the full collision path
+	spec.object_collision = true;
+	fast.add(spec);
+	fast.step(0.1f, &world);
+	UASSERTEQ(int, world.object_moves, 1);
+}
+
+void TestParticles::testWallCollision()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.pos = v3f(0.0f, 1.0f, 0.0f);
+	spec.vel = v3f(4.0f, 0.0f, 1.0f);
+	spec.expiration = 10.0f;
+	spec.size = 0.4f * BS;
+	spec.collisiondetection = true;
+	store.add(spec);
+
+	for (int i = 0; i < 10; i++)
+		store.step(0.1f, &world);
+
+	// Stopped at the wall face x = 2.5, still moving along z
+	v3f pos = store.getPosition(0);
+	UASSERT(std::fabs(pos.X - 2.3f) < 0.001f);
+	UASSERT(std::fabs(pos.Z - 1.0f) < 0.001f);
+	UASSERT(store.getVelocity(0).X == 0.0f);
+}
+
+void TestParticles::testExpiry()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.pos = v3f(0.0f, 1.0f, 0.0f);
+	for (int i = 0; i < 10; i++) {
+		spec.expiration = 0.1f + i;
+		spec.collisiondetection = i % 2 == 0;
+		// Tells the particles apart after removals have reordered them
+		spec.vel = v3f(0.0f, 0.0f, i);
+		store.add(spec);
+	}
+	UASSERTEQ(size_t, store.size(), 10);
+
+	// Expired particles go on the step after their expiration
+	for (int t = 0; t < 5; t++)
+		store.step(1.0f, &world);
+	store.step(0.0f, &world);
+	UASSERTEQ(size_t, store.size(), 5);
+
+	for (size_t i = 0; i < store.size(); i++) {
+		int id = std::round(store.getVelocity(i).Z);
+		UASSERT(id >= 5);
+	}
+
+	store.clear();
+	UASSERTEQ(size_t, store.size(), 0);
+}
+
+void TestParticles::testCollisionRemoval()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.pos = v3f(0.0f, 1.0f, 0.0f);
+	spec.vel = v3f(0.0f, -2.0f, 0.0f);
+	spec.expiration = 10.0f;
+	spec.collisiondetection = true;
+	spec.collision_removal = true;
+	store.add(spec);
+	spec.collision_removal = false;
+	store.add(spec);
+
+	store.step(1.0f, &world);
+	UASSERTEQ(size_t, store.size(), 2);
+	store.step(0.1f, &world);
+	UASSERTEQ(size_t, store.size(), 1);
+	// The one left rests on the floor
+	UASSERT(store.getVelocity(0).Y == 0.0f);
+}
+
+void TestParticles::testAnimation()
+{
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.expiration = 10.0f;
+	spec.animation.type = TAT_VERTICAL_FRAMES;
+	spec.frame_length = 0.25f;
+	store.add(spec);
+
+	store.step(0.6f, &world);
+	UASSERTEQ(int, store.getLook(0).animation_frame, 2);
+	store.step(0.5f, &world);
+	UASSERTEQ(int, store.getLook(0).animation_frame, 4);
+}
+
+void TestParticles::testRemapTextures()
+{
+	ParticleStore store;
+	ParticleSpec spec;
+	for (u16 texture : {0, 2, 3, 2}) {
+		spec.texture = texture;
+		store.add(spec);
+	}
+
+	// Texture 1 is unused and dropped
+	store.remapTextures({0, 0, 1, 2});
+	UASSERTEQ(u16, store.getLook(0).texture, 0);
+	UASSERTEQ(u16, store.getLook(1).texture, 1);
+	UASSERTEQ(u16, store.getLook(2).texture, 2);
+	UASSERTEQ(u16, store.getLook(3).texture, 1);
+}
+
+void TestParticles::testStepBenchmark()
+{
+	const size_t count = full_benchmarks() ? 100000 : 2000;
+	const int steps = full_benchmarks() ? 60 : 10;
+
+	TestParticleWorld world;
+	ParticleStore store;
+	ParticleSpec spec;
+	spec.acc = v3f(0.0f, -1.0f, 0.0f);
+	spec.expiration = 100.0f;
+	spec.size = 0.5f;
+	for (size_t i = 0; i < count; i++) {
+		spec.pos = v3f(i % 100, 10.0f + i % 7, i / 100 % 100);
+		spec.vel = v3f((i % 11) * 0.1f, 1.0f, (i % 13) * 0.1f);
+		// One in eight collides, like node particles among spawner ones
+		spec.collisiondetection = i % 8 == 0;
+		store.add(spec);
+	}
+
+	u64 t_start = porting::getTimeUs();
+	for (int i = 0; i < steps; i++)
+		store.step(1.0f / 60.0f, &world);
+	u64 t_end = porting::getTimeUs();
+
+	UASSERTEQ(size_t, store.size(), count);
+	if (full_benchmarks()) {
+		rawstream << "    " << count << " particles, " << steps << " steps: "
+			<< (t_end - t_start) / steps << "us per step" << std::endl;
+	}
+}
@@ -0,0 +1,130 @@
+/*
+Minetest
+Copyright (C) 2020 Minetest core developers & community
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "test.h"
+
+#include <sstream>
+#include "staticobject.h"
+
+class TestStaticObject : public TestBase {
+public:
+	TestStaticObject() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestStaticObject"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testSerializeUntouched();
+	void testSerializeModified();
+	void testDeSerializeTruncated();
+};
+
+static TestStaticObject g_test_instance;
+
+void TestStaticObject::runTests(IGameDef *gamedef)
+{
+	TEST(testSerializeUntouched);
+	TEST(testSerializeModified);
+	TEST(testDeSerializeTruncated);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static StaticObject make_static_object(u8 type, v3f pos, const std::string &data)
+{
+	StaticObject s_obj;
+	s_obj.type = type;
+	s_obj.pos = pos;
+	s_obj.data = data;
+	return s_obj;
+}
+
+static std::string serialize_list(StaticObjectList &list)
+{
+	std::ostringstream os(std::ios::binary);
+	list.serialize(os);
+	return os.str();
+}
+
+void TestStaticObject::testSerializeUntouched()
+{
+	StaticObjectList list;
+	list.insert(0, make_static_object(7, v3f(1, 2, 3), "first"));
+	list.insert(0, make_static_object(7, v3f(-4, 5, -6), ""));
+	list.insert(0, make_static_object(7, v3f(0, 0, 0), std::string(300, 'x')));
+	std::string data = serialize_list(list);
+
+	// Trailing data must not be consumed
+	std::istringstream is(data + "tail", std::ios::binary);
+	StaticObjectList list2;
+	list2.deSerialize(is);
+	UASSERTEQ(size_t, list2.getStoredCount(), 3);
+	UASSERTEQ(size_t, list2.size(), 3);
+	std::string tail;
+	is >> tail;
+	UASSERTEQ(std::string, tail, "tail");
+
+	// Blocks that are saved again without being activated stay the same
+	UASSERTEQ(std::string, serialize_list(list2), data);
+
+	std::vector<StaticObject> &stored = list2.getStored();
+	UASSERTEQ(size_t, stored.size(), 3);
+	UASSERTEQ(int, stored[0].type, 7);
+	UASSERT(stored[1].pos == v3f(-4, 5, -6));
+	UASSERTEQ(std::string, stored[0].data, "first");
+	UASSERTEQ(size_t, stored[2].data.size(), 300);
+	UASSERTEQ(std::string, serialize_list(list2), data);
+}
+
+void TestStaticObject::testSerializeModified()
+{
+	StaticObjectList list;
+	list.insert(0, make_static_object(7, v3f(1, 2, 3), "first"));
+	std::istringstream is(serialize_list(list), std::ios::binary);
+
+	StaticObjectList list2;
+	list2.deSerialize(is);
+	list2.insert(0, make_static_object(7, v3f(4, 5, 6), "second"));
+	list2.insert(12, make_static_object(7, v3f(7, 8, 9), "active"));
+	UASSERTEQ(size_t, list2.getStoredCount(), 2);
+	UASSERTEQ(size_t, list2.size(), 3);
+
+	// Active objects are saved as stored ones
+	std::istringstream is2(serialize_list(list2), std::ios::binary);
+	StaticObjectList list3;
+	list3.deSerialize(is2);
+	std::vector<StaticObject> &stored = list3.getStored();
+	UASSERTEQ(size_t, stored.size(), 3);
+	UASSERTEQ(std::string, stored[0].data, "first");
+	UASSERTEQ(std::string, stored[1].data, "second");
+	UASSERTEQ(std::string, stored[2].data, "active");
+
+	list3.clearStored();
+	UASSERTEQ(size_t, list3.size(), 0);
+}
+
+void TestStaticObject::testDeSerializeTruncated()
+{
+	StaticObjectList list;
+	list.insert(0, make_static_object(7, v3f(1, 2, 3), "first"));
+	std::string data = serialize_list(list);
+
+	std::istringstream is(data.substr(0, data.size() - 1), std::ios::binary);
+	StaticObjectList list2;
+	EXCEPTION_CHECK(SerializationError, list2.deSerialize(is));
+}
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <atomic>
 #include "threading/semaphore.h"
 #include "threading/thread.h"
+#include "threading/workerpool.h"
 
 
 class TestThreading : public TestBase {
@@ -33,6 +34,7 @@ class TestThreading : public TestBase {
 	void testStartStopWait();
 	void testThreadKill();
 	void testAtomicSemaphoreThread();
+	void testWorkerPool();
 };
 
 static TestThreading g_test_instance;
@@ -42,6 +44,7 @@ void TestThreading::runTests(IGameDef *gamedef)
 	TEST(testStartStopWait);
 	TEST(testThreadKill);
 	TEST(testAtomicSemaphoreThread);
+	TEST(testWorkerPool);
 }
 
 class SimpleTestThread : public Thread {
@@ -181,3 +184,37 @@ void TestThreading::testAtomicSemaphoreThread()
 	UASSERT(val == num_threads * 0x10000);
 }
 
+
+void TestThreading::testWorkerPool()
+{
+	const size_t count = 1000;
+	std::atomic<u32> visits[count];
+
+	// Every item is handled exactly once per run, with and without threads
+	for (u16 num_threads : {0, 3}) {
+		WorkerPool pool("WorkerPoolTest", num_threads);
+		UASSERTEQ(u16, pool.getThreadCount(), num_threads);
+
+		for (size_t batch_size : {0, 1, 7, 16, 5000}) {
+			for (std::atomic<u32> &v : visits)
+				v = 0;
+
+			std::atomic<u32> bad_ranges(0);
+
+			// Assertions cannot be thrown on the worker threads
+			auto job = [&] (size_t begin, size_t end) {
+				if (begin >= end || end > count)
+					bad_ranges++;
+				for (size_t i = begin; i < end && i < count; i++)
+					visits[i]++;
+			};
+			pool.run(count, batch_size, job);
+			pool.run(0, batch_size, job);
+			pool.run(count, batch_size, job);
+
+			UASSERTEQ(u32, bad_ranges, 0);
+			for (std::atomic<u32> &v : visits)
+				UASSERTEQ(u32, v, 2);
+		}
+	}
+}